@@ -981,6 +981,8 @@ gx_default_dev_spec_op(gx_device *pdev, int dev_spec_op, void *data, int size)
             return (dev_proc(pdev, map_cmyk_color) == cmyk_1bit_map_cmyk_color);
         case gxdso_interpolate_antidropout:
             return pdev->color_info.use_antidropout_downscaler;
+        case gxdso_shading_direct_fill:
+            return pdev->shading_direct_fill;
         case gxdso_interpolate_threshold:
             if ((pdev->color_info.num_components == 1 &&
                  pdev->color_info.max_gray < 15) ||
@@ -3912,6 +3912,7 @@ gs_pdf14_device_copy_params(gx_device *dev, const gx_device *target)
     copy_tag_setup(dev, target);
     COPY_PARAM(interpolate_control);
     COPY_PARAM(non_strict_bounds);
+    COPY_PARAM(shading_direct_fill);
     memcpy(&(dev->space_params), &(target->space_params), sizeof(gdev_space_params));
 
     if (dev->icc_struct == NULL) {
@@ -3942,6 +3943,7 @@ gs_pdf14_device_copy_params(gx_device *dev, const gx_device *target)
         dev->icc_struct->blackvector = profile_targ->blackvector;
         dev->icc_struct->blackthresholdL = profile_targ->blackthresholdL;
         dev->icc_struct->blackthresholdC = profile_targ->blackthresholdC;
+        dev->icc_struct->tinttablesize = profile_targ->tinttablesize;
 
         switch (pdev->blend_cs_state) {
             case PDF14_BLEND_CS_UNSPECIFIED:
@@ -28,6 +28,7 @@
 #include "gdevplnx.h"
 #include "gstrans.h"
 #include "gxdownscale.h"
+#include "gxperf.h"
 #include "gsbitops.h"
 
 #include "gdevkrnlsclass.h" /* 'standard' built in subclasses, currently First/Last Page and obejct filter */
@@ -72,6 +73,9 @@ static void prn_print_page_in_background(void *data);
 /* wait for a background thread to finish and clean up background printing */
 static void prn_finish_bg_print(gx_device_printer *ppdev);
 
+/* queue the page printing in the background rather than waiting for it */
+static void prn_queue_bg_print(gx_device_printer *ppdev);
+
 /* ------ Open/close ------ */
 /* Open a generic printer device. */
 /* Specific devices may wish to extend this. */
@@ -109,11 +113,65 @@ gdev_prn_open(gx_device * pdev)
     return code;
 }
 
+/* Close and unlink the original clist files of a page printed in the background */
+static void
+prn_bg_print_release_files(gx_device_printer *ppdev, bg_print_t *bg_print)
+{
+    int closecode;
+
+    if (bg_print->ocfile) {
+        closecode = bg_print->oio_procs->fclose(bg_print->ocfile, bg_print->ocfname, true);
+        if (bg_print->return_code == 0)
+           bg_print->return_code = closecode;
+    }
+    if (bg_print->ocfname) {
+        gs_free_object(ppdev->memory->non_gc_memory, bg_print->ocfname, "prn_finish_bg_print(ocfname)");
+    }
+    if (bg_print->obfile) {
+        closecode = bg_print->oio_procs->fclose(bg_print->obfile, bg_print->obfname, true);
+        if (bg_print->return_code == 0)
+           bg_print->return_code = closecode;
+    }
+    if (bg_print->obfname) {
+        gs_free_object(ppdev->memory->non_gc_memory, bg_print->obfname, "prn_finish_bg_print(obfname)");
+    }
+    bg_print->ocfile = bg_print->obfile =
+      bg_print->ocfname = bg_print->obfname = NULL;
+}
+
+/* Wait for the oldest page on the background printing queue and clean it up. */
+/* Queued pages always have an output file of their own (see prn_queue_bg_print) */
+static void
+prn_finish_queued_bg_print(gx_device_printer *ppdev)
+{
+    bg_print_t *bg_print = ppdev->bg_print->next;
+    gx_device_printer *bgppdev = (gx_device_printer *)bg_print->device;
+    int closecode;
+
+    ppdev->bg_print->next = bg_print->next;
+    gx_semaphore_wait(bg_print->sema);
+    /* OutputFile may have changed since this page was queued */
+    closecode = gx_device_close_output_file((gx_device *)ppdev, bg_print->ofname, bgppdev->file);
+    if (bg_print->return_code == 0)
+        bg_print->return_code = closecode;
+    teardown_device_and_mem_for_thread(bg_print->device, bg_print->thread_id, true);
+    prn_bg_print_release_files(ppdev, bg_print);
+    gx_semaphore_free(bg_print->sema);
+    gs_free_object(ppdev->memory->non_gc_memory, bg_print->ofname, "prn_finish_queued_bg_print(ofname)");
+    if (ppdev->bg_print->queued_return_code == 0)
+        ppdev->bg_print->queued_return_code = bg_print->return_code;
+    gs_free_object(ppdev->memory->non_gc_memory, bg_print, "prn_finish_queued_bg_print");
+}
+
 /* This is called various places to wait for any pending bg print thread and */
 /* perform its cleanup                                                       */
 static void
 prn_finish_bg_print(gx_device_printer *ppdev)
 {
+    /* Pages on the queue were started before the current one */
+    while (ppdev->bg_print && ppdev->bg_print->next != NULL)
+        prn_finish_queued_bg_print(ppdev);
+
     /* if we have a a bg printing device that was created, then wait for its	*/
     /* semaphore (it may already have been signalled, but that's OK.) then	*/
     /* close and unlink the files and free the device and its private allocator	*/
@@ -134,26 +192,71 @@ prn_finish_bg_print(gx_device_printer *ppdev)
         teardown_device_and_mem_for_thread(ppdev->bg_print->device,
                                            ppdev->bg_print->thread_id, true);
         ppdev->bg_print->device = NULL;
-        if (ppdev->bg_print->ocfile) {
-            closecode = ppdev->bg_print->oio_procs->fclose(ppdev->bg_print->ocfile, ppdev->bg_print->ocfname, true);
-            if (ppdev->bg_print->return_code == 0)
-               ppdev->bg_print->return_code = closecode;
-        }
-        if (ppdev->bg_print->ocfname) {
-            gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->ocfname, "prn_finish_bg_print(ocfname)");
-        }
-        if (ppdev->bg_print->obfile) {
-            closecode = ppdev->bg_print->oio_procs->fclose(ppdev->bg_print->obfile, ppdev->bg_print->obfname, true);
-            if (ppdev->bg_print->return_code == 0)
-               ppdev->bg_print->return_code = closecode;
-        }
-        if (ppdev->bg_print->obfname) {
-            gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->obfname, "prn_finish_bg_print(obfname)");
-        }
-        ppdev->bg_print->ocfile = ppdev->bg_print->obfile =
-          ppdev->bg_print->ocfname = ppdev->bg_print->obfname = NULL;
+        prn_bg_print_release_files(ppdev, ppdev->bg_print);
     }
 }
+
+/* Pages may only be queued when each has an output file of its own; once */
+/* started, such a page shares nothing with the device printing it.       */
+static bool
+prn_bg_print_can_queue(gx_device_printer *ppdev)
+{
+    return ppdev->bg_print_requested && ppdev->bg_print_queue_depth > 1 &&
+           gx_outputfile_is_separate_pages(ppdev->fname, ppdev->memory);
+}
+
+/* Called instead of prn_finish_bg_print when the next page may start printing */
+/* in the background before the current one has finished. The current page is */
+/* moved to the queue, then the oldest pages are waited for until no more than */
+/* BGPrintQueueDepth - 1 remain, and they hold no more than BGPrintMaxMemory.  */
+static void
+prn_queue_bg_print(gx_device_printer *ppdev)
+{
+    bg_print_t *bg_print = ppdev->bg_print;
+    bg_print_t *fresh, **tail;
+    int count = 0;
+    size_t footprint = 0;
+
+    if (bg_print == NULL || bg_print->device == NULL) {
+        prn_finish_bg_print(ppdev);
+        return;
+    }
+    /* The background thread holds on to 'bg_print', so it moves to the queue */
+    /* as it is and the device gets a new one for the next page.              */
+    fresh = (bg_print_t *)gs_alloc_bytes(ppdev->memory->non_gc_memory, sizeof(bg_print_t),
+                                         "prn_queue_bg_print");
+    bg_print->ofname = (char *)gs_alloc_bytes(ppdev->memory->non_gc_memory, strlen(ppdev->fname) + 1,
+                                              "prn_queue_bg_print(ofname)");
+    if (fresh == NULL || bg_print->ofname == NULL) {
+        gs_free_object(ppdev->memory->non_gc_memory, fresh, "prn_queue_bg_print");
+        gs_free_object(ppdev->memory->non_gc_memory, bg_print->ofname, "prn_queue_bg_print(ofname)");
+        bg_print->ofname = NULL;
+        prn_finish_bg_print(ppdev);
+        return;
+    }
+    strcpy(bg_print->ofname, ppdev->fname);
+    memset(fresh, 0, sizeof(bg_print_t));
+    fresh->queued_return_code = bg_print->queued_return_code;
+    fresh->next = bg_print->next;
+    bg_print->next = NULL;
+    for (tail = &fresh->next; *tail != NULL; tail = &(*tail)->next)
+        ;
+    *tail = bg_print;
+    ppdev->bg_print = fresh;
+
+    for (bg_print = fresh->next; bg_print != NULL; bg_print = bg_print->next) {
+        count++;
+        footprint += bg_print->footprint;
+    }
+    while (fresh->next != NULL &&
+           (count >= ppdev->bg_print_queue_depth ||
+            (ppdev->bg_print_max_memory > 0 && footprint > ppdev->bg_print_max_memory))) {
+        count--;
+        footprint -= fresh->next->footprint;
+        prn_finish_queued_bg_print(ppdev);
+    }
+}
+
 /* Generic closing for the printer device. */
 /* Specific devices may wish to extend this. */
 int
@@ -232,7 +335,11 @@ gdev_prn_tear_down(gx_device *pdev, byte **the_memory)
         pmemdev->base = 0;		/* in case finalize tries to free this */
         was_command_list = true;
 
-        prn_finish_bg_print(ppdev);
+        /* Pages printing in the background from a queue have their own clist  */
+        /* files, buffers and output file, so a change of page size or of the */
+        /* transparency setting between pages need not wait for them.         */
+        if (!prn_bg_print_can_queue(ppdev))
+            prn_finish_bg_print(ppdev);
 
         gs_free_object(pcldev->memory->non_gc_memory, pcldev->cache_chunk, "free tile cache for clist");
         pcldev->cache_chunk = 0;
@@ -291,13 +398,20 @@ gdev_prn_allocate(gx_device *pdev, gdev_space_params *new_space_params,
 
 
     /* bg_print allocation is not fatal, we just continue (as far as possible) without BGPrint */
-    if (ppdev->bg_print == NULL)
+    if (ppdev->bg_print == NULL) {
         ppdev->bg_print = (bg_print_t *)gs_alloc_bytes(pdev->memory->non_gc_memory, sizeof(bg_print_t), "prn bg_print");
+        if (ppdev->bg_print != NULL)
+            memset(ppdev->bg_print, 0, sizeof(bg_print_t));
+    }
     if (ppdev->bg_print == NULL) {
         emprintf(pdev->memory, "Failed to allocate memory for BGPrint, attempting to continue without BGPrint\n");
-    } else {
+    } else if (ppdev->bg_print->device == NULL && ppdev->bg_print->next == NULL) {
+        int queued_return_code = ppdev->bg_print->queued_return_code;
+
         memset(ppdev->bg_print, 0, sizeof(bg_print_t));
+        ppdev->bg_print->queued_return_code = queued_return_code;
     }
+    /* else pages are still printing in the background (see gdev_prn_tear_down) */
 
     /* Re/allocate memory */
     ppdev->orig_procs = pdev->procs;
@@ -584,12 +698,21 @@ gdev_prn_get_param(gx_device *dev, char *Param, void *list)
     if (strcmp(Param, "NumRenderingThreads") == 0) {
         return param_write_int(plist, "NumRenderingThreads", &ppdev->num_render_threads_requested);
     }
+    if (strcmp(Param, "BandReorderDepth") == 0) {
+        return param_write_int(plist, "BandReorderDepth", &ppdev->band_reorder_depth_requested);
+    }
     if (strcmp(Param, "OpenOutputFile") == 0) {
         return param_write_bool(plist, "OpenOutputFile", &ppdev->OpenOutputFile);
     }
     if (strcmp(Param, "BGPrint") == 0) {
         return param_write_bool(plist, "BGPrint", &ppdev->bg_print_requested);
     }
+    if (strcmp(Param, "BGPrintQueueDepth") == 0) {
+        return param_write_int(plist, "BGPrintQueueDepth", &ppdev->bg_print_queue_depth);
+    }
+    if (strcmp(Param, "BGPrintMaxMemory") == 0) {
+        return param_write_size_t(plist, "BGPrintMaxMemory", &ppdev->bg_print_max_memory);
+    }
     if (strcmp(Param, "ReopenPerPage") == 0) {
         return param_write_bool(plist, "ReopenPerPage", &ppdev->ReopenPerPage);
     }
@@ -610,6 +733,22 @@ gdev_prn_get_param(gx_device *dev, char *Param, void *list)
         }
         return param_write_string(plist, "BandListStorage", &bls);
     }
+    if (strcmp(Param, "BandListCompression") == 0) {
+        gs_param_string blc;
+
+        param_string_from_string(blc,
+            ppdev->clist_compress_method == clist_compress_fast ? "fast" : "default");
+        return param_write_string(plist, "BandListCompression", &blc);
+    }
+    if (strcmp(Param, "BandListCompressionStats") == 0) {
+        return param_write_bool(plist, "BandListCompressionStats", &ppdev->clist_compress_report);
+    }
+    if (strcmp(Param, "PerfLog") == 0) {
+        gs_param_string pls;
+
+        param_string_from_transient_string(pls, gx_perf_log_name(ppdev->memory));
+        return param_write_string(plist, "PerfLog", &pls);
+    }
     if (strcmp(Param, "OutputFile") == 0) {
         gs_param_string ofns;
 
@@ -643,6 +782,8 @@ gdev_prn_get_params(gx_device * pdev, gs_param_list * plist)
     int code = gx_default_get_params(pdev, plist);
     gs_param_string ofns;
     gs_param_string bls;
+    gs_param_string blc;
+    gs_param_string pls;
     gs_param_string saved_pages;
     bool pageneutralcolor = false;
     gs_lib_ctx_core_t *core = pdev->memory->gs_lib_ctx->core;
@@ -655,8 +796,11 @@ gdev_prn_get_params(gx_device * pdev, gs_param_list * plist)
                   param_write_bool(plist, "Duplex", &ppdev->Duplex) :
                   param_write_null(plist, "Duplex"))) < 0) ||
         (code = param_write_int(plist, "NumRenderingThreads", &ppdev->num_render_threads_requested)) < 0 ||
+        (code = param_write_int(plist, "BandReorderDepth", &ppdev->band_reorder_depth_requested)) < 0 ||
         (code = param_write_bool(plist, "OpenOutputFile", &ppdev->OpenOutputFile)) < 0 ||
         (code = param_write_bool(plist, "BGPrint", &ppdev->bg_print_requested)) < 0 ||
+        (code = param_write_int(plist, "BGPrintQueueDepth", &ppdev->bg_print_queue_depth)) < 0 ||
+        (code = param_write_size_t(plist, "BGPrintMaxMemory", &ppdev->bg_print_max_memory)) < 0 ||
         (code = param_write_bool(plist, "ReopenPerPage", &ppdev->ReopenPerPage)) < 0 ||
         (code = param_write_bool(plist, "pageneutralcolor", &pageneutralcolor)) < 0
         )
@@ -676,6 +820,14 @@ gdev_prn_get_params(gx_device * pdev, gs_param_list * plist)
     }
     if( (code = param_write_string(plist, "BandListStorage", &bls)) < 0 )
         return code;
+    param_string_from_string(blc,
+        ppdev->clist_compress_method == clist_compress_fast ? "fast" : "default");
+    if ((code = param_write_string(plist, "BandListCompression", &blc)) < 0 ||
+        (code = param_write_bool(plist, "BandListCompressionStats", &ppdev->clist_compress_report)) < 0)
+        return code;
+    param_string_from_transient_string(pls, gx_perf_log_name(ppdev->memory));
+    if ((code = param_write_string(plist, "PerfLog", &pls)) < 0)
+        return code;
 
     ofns.data = (const byte *)ppdev->fname,
         ofns.size = strlen(ppdev->fname),
@@ -715,14 +867,21 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     bool rpp = ppdev->ReopenPerPage;
     bool old_page_uses_transparency = ppdev->page_uses_transparency;
     bool bg_print_requested = ppdev->bg_print_requested;
+    int bg_print_queue_depth = ppdev->bg_print_queue_depth;
+    size_t bg_print_max_memory = ppdev->bg_print_max_memory;
     bool duplex;
     int duplex_set = -1;
     int width = pdev->width;
     int height = pdev->height;
     int nthreads = ppdev->num_render_threads_requested;
+    int reorder_depth = ppdev->band_reorder_depth_requested;
+    int compress_method = ppdev->clist_compress_method;
+    bool compress_report = ppdev->clist_compress_report;
     gdev_space_params save_sp;
     gs_param_string ofs;
     gs_param_string bls;
+    gs_param_string blc;
+    gs_param_string pls;
     gs_param_dict mdict;
     gs_param_string saved_pages;
     bool pageneutralcolor = false;
@@ -780,6 +939,33 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
             bls.data = 0;
             break;
     }
+    switch (code = param_read_string(plist, (param_name = "BandListCompression"), &blc)) {
+        case 0:
+            if (!bytes_compare(blc.data, blc.size, (const byte *)"default", 7)) {
+                compress_method = clist_compress_default;
+                break;
+            }
+            if (!bytes_compare(blc.data, blc.size, (const byte *)"fast", 4)) {
+                compress_method = clist_compress_fast;
+                break;
+            }
+            code = gs_error_rangecheck;
+            /* fall through */
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 1:
+            break;
+    }
+    switch (code = param_read_bool(plist, (param_name = "BandListCompressionStats"),
+                                                        &compress_report)) {
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 0:
+        case 1:
+            break;
+    }
 
     switch (code = param_read_string(plist, (param_name = "OutputFile"), &ofs)) {
         case 0:
@@ -801,6 +987,25 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
             ofs.data = 0;
             break;
     }
+    switch (code = param_read_string(plist, (param_name = "PerfLog"), &pls)) {
+        case 0:
+            if (pdev->LockSafetyParams &&
+                    bytes_compare(pls.data, pls.size, (const byte *)gx_perf_log_name(ppdev->memory),
+                                  strlen(gx_perf_log_name(ppdev->memory))))
+                code = gs_error_invalidaccess;
+            else if (pls.size >= gp_file_name_sizeof)
+                code = gs_error_limitcheck;
+            if (code >= 0)
+                break;
+            /* fall through */
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+            /* fall through */
+        case 1:
+            pls.data = 0;
+            break;
+    }
 
     /* Read InputAttributes and OutputAttributes just for the type */
     /* check and to indicate that they aren't undefined. */
@@ -829,6 +1034,18 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
         case 1:
             ;
     }
+    switch (code = param_read_int(plist, (param_name = "BandReorderDepth"), &reorder_depth)) {
+        case 0:
+            if (reorder_depth >= 0)
+                break;
+            code = gs_error_rangecheck;
+            /* fall through */
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 1:
+            ;
+    }
     switch (code = param_read_bool(plist, (param_name = "BGPrint"),
                                                         &bg_print_requested)) {
         default:
@@ -838,6 +1055,28 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
         case 1:
             break;
     }
+    switch (code = param_read_int(plist, (param_name = "BGPrintQueueDepth"),
+                                                        &bg_print_queue_depth)) {
+        case 0:
+            if (bg_print_queue_depth >= 1)
+                break;
+            code = gs_error_rangecheck;
+            /* fall through */
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 1:
+            break;
+    }
+    switch (code = param_read_size_t(plist, (param_name = "BGPrintMaxMemory"),
+                                                        &bg_print_max_memory)) {
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 0:
+        case 1:
+            break;
+    }
 
     switch (code = param_read_string(plist, (param_name = "saved-pages"),
                                                         &saved_pages)) {
@@ -877,14 +1116,19 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     }
 
     ppdev->bg_print_requested = bg_print_requested;
+    ppdev->bg_print_queue_depth = bg_print_queue_depth;
+    ppdev->bg_print_max_memory = bg_print_max_memory;
     if (duplex_set >= 0) {
         ppdev->Duplex = duplex;
         ppdev->Duplex_set = duplex_set;
     }
     ppdev->num_render_threads_requested = nthreads;
+    ppdev->band_reorder_depth_requested = reorder_depth;
     if (bls.data != 0) {
         ppdev->BLS_force_memory = (bls.data[0] == 'm');
     }
+    ppdev->clist_compress_method = compress_method;
+    ppdev->clist_compress_report = compress_report;
 
     /* If necessary, free and reallocate the printer memory. */
     /* Formerly, would not reallocate if device is not open: */
@@ -909,6 +1153,9 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
         memcpy(ppdev->fname, ofs.data, ofs.size);
         ppdev->fname[ofs.size] = 0;
     }
+    if (pls.data != 0 &&
+        (code = gx_perf_set_log(ppdev->memory, pls.data, pls.size)) < 0)
+        return code;
     /* If the device is open and OpenOutputFile is true, */
     /* open the OutputFile now.  (If the device isn't open, */
     /* this will happen when it is opened.) */
@@ -950,8 +1197,19 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
     gs_devn_params *pdevn_params;
     int outcode = 0, errcode = 0, endcode, closecode = 0;
     int code;
+    gx_perf_t *perf = gx_perf_log(pdev->memory);
+    bool background = false;
 
-    prn_finish_bg_print(ppdev);		/* finish any previous background printing */
+    if (perf && num_copies > 0)
+        gx_perf_page_output_begin(perf);
+
+    /* With separate output files, pages can be queued to print in the   */
+    /* background at the same time, otherwise finish any previous page.  */
+    if (num_copies > 0 && ppdev->saved_pages_list == NULL &&
+        prn_bg_print_can_queue(ppdev))
+        prn_queue_bg_print(ppdev);
+    else
+        prn_finish_bg_print(ppdev);		/* finish any previous background printing */
 
     if (num_copies > 0 && ppdev->saved_pages_list != NULL) {
         /* We are putting pages on a list */
@@ -978,12 +1236,21 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
                 outcode = ppdev->bg_print->return_code;
                 threads_enabled = 0;	/* and allow current page to try foreground */
             }
+            if (ppdev->bg_print && (ppdev->bg_print->queued_return_code < 0)) {
+                outcode = ppdev->bg_print->queued_return_code;
+                ppdev->bg_print->queued_return_code = 0;
+                threads_enabled = 0;
+            }
             /* Use 'while' instead of 'if' to avoid nesting */
             while (ppdev->bg_print_requested && ppdev->bg_print && threads_enabled) {
                 gx_device *ndev;
                 gx_device_printer *npdev;
                 gx_device_clist_reader *crdev = (gx_device_clist_reader *)ppdev;
+                int64_t clist_size = 0;
 
+                /* The writer appends, so this is (near enough) the page's clist size */
+                if (crdev->ymin < 0 && crdev->page_info.cfile != NULL)
+                    clist_size = max(0, crdev->page_info.io_procs->ftell(crdev->page_info.cfile));
                 if ((code = clist_close_writer_and_init_reader((gx_device_clist *)ppdev)) < 0)
                     /* should not happen -- do foreground print */
                     break;
@@ -1008,6 +1275,11 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
                 ppdev->bg_print->oio_procs = crdev->page_info.io_procs;
                 crdev->page_info.cfile = crdev->page_info.bfile = NULL;
 
+                /* Estimate what this page holds until it is printed: the clist */
+                /* data and a band buffer for the page and each render thread.  */
+                ppdev->bg_print->footprint = clist_size + crdev->page_info.bfile_end_pos +
+                        ppdev->buffer_space * (1 + max(0, ppdev->num_render_threads_requested));
+
                 if (ppdev->bg_print->sema == NULL)
                 {
                     ppdev->bg_print->sema = gx_semaphore_label(gx_semaphore_alloc(ppdev->memory->non_gc_memory), "BGPrint");
@@ -1024,6 +1296,7 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
                 npdev = (gx_device_printer *)ndev;
                 npdev->bg_print_requested = 0;
                 npdev->num_render_threads_requested = ppdev->num_render_threads_requested;
+                npdev->band_reorder_depth_requested = ppdev->band_reorder_depth_requested;
                 /* The bgprint's device was created with normal procs, so multi-threaded */
                 /* rendering was turned off. Re-enable it now if it is needed.           */
                 if (npdev->num_render_threads_requested > 0) {
@@ -1041,6 +1314,11 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
                 gp_thread_label(ppdev->bg_print->thread_id, "BG print thread");
                 /* Page was succesfully started in bg_print mode */
                 print_foreground = 0;
+                background = true;
+                /* The bg device owns this page's output file. If the page may */
+                /* be queued, the next page must open its own file.            */
+                if (prn_bg_print_can_queue(ppdev))
+                    ppdev->file = NULL;
                 /* Now we need to set up the next page so it will use new clist files */
                 if ((code = clist_open(pdev)) < 0) 	/* this should do it */
                     /* OOPS! can't proceed with the next page */
@@ -1085,6 +1363,8 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
     endcode = (PRINTER_IS_CLIST(ppdev) &&
               !((gx_device_clist_common *)ppdev)->do_not_open_or_close_bandfiles ?
               clist_finish_page(pdev, flush) : 0);
+    if (perf && num_copies > 0)
+        gx_perf_page_output_end(perf, pdev, background);
 
     if (outcode < 0)
         return outcode;
@@ -124,6 +124,11 @@ typedef struct bg_print_s {
     char *obfname;	                /* block file name */
     clist_file_ptr obfile;	/* block file, normally 0 */
     const clist_io_procs_t *oio_procs;
+    size_t footprint;			/* estimated memory held until printed */
+    char *ofname;			/* output file of a queued page */
+    struct bg_print_s *next;		/* pages still printing from before this */
+                                        /* one (oldest first), BGPrintQueueDepth > 1 */
+    int queued_return_code;		/* first error from a page on the queue */
 } bg_print_t;
 
 #define gx_prn_device_common\
@@ -142,7 +147,11 @@ typedef struct bg_print_s {
         gp_file *file;  		/* output file */\
         bool bg_print_requested;	/* request background printing of page from clist */\
         bg_print_t *bg_print;           /* background printing data shared with thread */\
+        int bg_print_queue_depth;	/* max pages printing in the background at once */\
+        size_t bg_print_max_memory;	/* don't start more bg pages while those printing */\
+                                        /* hold more than this (0 = no limit) */\
         int num_render_threads_requested;	/* for multiple band rendering threads */\
+        int band_reorder_depth_requested;	/* extra finished-band slots for the render threads */\
         gx_saved_pages_list *saved_pages_list;	/* list when we are saving pages instead of printing */\
         gx_device_procs save_procs_while_delaying_erasepage	/* save device procs while delaying erasepage. */
 
@@ -221,7 +230,10 @@ prn_dev_proc_get_space_params(gx_default_get_space_params);
         0,	        /* *file */\
         0/*false*/,	/* bg_print_requested */\
         0,              /* *bg_print */\
+        1,              /* bg_print_queue_depth */\
+        0,              /* bg_print_max_memory */\
         0, 		/* num_render_threads_requested */\
+        0, 		/* band_reorder_depth_requested */\
         0,              /* saved_pages_list */\
         { 0 }           /* save_procs_while_delaying_erasepage */
 #define prn_device_body_rest_(print_page)\
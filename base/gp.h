@@ -439,6 +439,19 @@ int gp_unlink(gs_memory_t *mem, const char *fname);
 /* Rename utf-8 filename, subject to 'control' path permissions */
 int gp_rename(gs_memory_t *mem, const char *from, const char *to);
 
+/* Map the whole of an open file read only into memory, returning the
+ * address of the data and setting *psize to its length. Returns NULL if
+ * the file cannot be mapped (not a regular host file, empty, or mapping
+ * is not supported on this platform), in which case the caller should
+ * read the file as usual. The mapping stays valid after the file is
+ * closed, until it is released with gp_unmap_file. The file must not
+ * change while it is mapped: reading a mapped page past the end of a
+ * file that has since been truncated raises SIGBUS (an access violation
+ * on Windows), which the caller cannot detect beforehand. */
+void *gp_map_file(gp_file *f, gs_offset_t *psize);
+
+void gp_unmap_file(void *data, gs_offset_t size);
+
 /* gp_stat is defined in stat_.h rather than here due to macro problems */
 
 typedef enum {
@@ -648,6 +661,10 @@ FILE *gp_fdup_impl(FILE *f, const char *mode);
 
 bool gp_fseekable_impl(FILE *f);
 
+void *gp_map_file_impl(FILE *f, gs_offset_t *psize);
+
+void gp_unmap_file_impl(void *data, gs_offset_t size);
+
 /* Force given file into binary mode (no eol translations, etc) */
 /* if 2nd param true, text mode if 2nd param false */
 int gp_setmode_binary_impl(FILE * pfile, bool mode);
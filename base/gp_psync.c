@@ -216,8 +216,10 @@ gp_semaphore_signal(gp_semaphore * sema)
     scode = pthread_mutex_lock(&sem->mutex);
     if (scode != 0)
         return SEM_ERROR_CODE(scode);
-    if (sem->count++ == 0)
-        scode = pthread_cond_signal(&sem->cond);
+    /* Always signal: with more than one waiter, a second signal can arrive */
+    /* before the first waiter has run and decremented the count.          */
+    sem->count++;
+    scode = pthread_cond_signal(&sem->cond);
     scode2 = pthread_mutex_unlock(&sem->mutex);
     if (scode == 0)
         scode = scode2;
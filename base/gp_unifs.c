@@ -32,6 +32,7 @@
 #include "dirent_.h"
 #include "unistd_.h"
 #include <stdlib.h>             /* for mkstemp/mktemp */
+#include <sys/mman.h>           /* for mmap */
 
 #if !defined(HAVE_FSEEKO)
 #define ftello ftell
@@ -657,3 +658,32 @@ bool gp_fseekable_impl(FILE *f)
 
     return((bool)S_ISREG(s.st_mode));
 }
+
+void *gp_map_file_impl(FILE *f, gs_offset_t *psize)
+{
+    struct stat s;
+    void *data;
+    int fno;
+
+    fno = fileno(f);
+    if (fno < 0)
+        return NULL;
+
+    if (fstat(fno, &s) < 0 || !S_ISREG(s.st_mode) || s.st_size <= 0)
+        return NULL;
+
+    if ((uint64_t)s.st_size > (uint64_t)(size_t)-1)
+        return NULL;
+
+    data = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_SHARED, fno, 0);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    *psize = (gs_offset_t)s.st_size;
+    return data;
+}
+
+void gp_unmap_file_impl(void *data, gs_offset_t size)
+{
+    munmap(data, (size_t)size);
+}
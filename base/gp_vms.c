@@ -733,3 +733,13 @@ bool gp_fseekable_impl(FILE *f)
 
     return((bool)S_ISREG(s.st_mode));
 }
+
+/* Memory mapped files are not supported */
+void *gp_map_file_impl(FILE *f, gs_offset_t *psize)
+{
+    return NULL;
+}
+
+void gp_unmap_file_impl(void *data, gs_offset_t size)
+{
+}
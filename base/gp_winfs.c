@@ -210,3 +210,40 @@ bool gp_fseekable_impl(FILE *f)
 
     return((bool)S_ISREG(s.st_mode));
 }
+
+void *gp_map_file_impl(FILE *f, gs_offset_t *psize)
+{
+    HANDLE file, map;
+    LARGE_INTEGER size;
+    void *data;
+    int fno;
+
+    fno = fileno(f);
+    if (fno < 0)
+        return NULL;
+
+    file = (HANDLE)_get_osfhandle(fno);
+    if (file == INVALID_HANDLE_VALUE || GetFileType(file) != FILE_TYPE_DISK)
+        return NULL;
+
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 ||
+        (uint64_t)size.QuadPart > (uint64_t)(size_t)-1)
+        return NULL;
+
+    map = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (map == NULL)
+        return NULL;
+    data = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    /* The view keeps the mapping object alive */
+    CloseHandle(map);
+    if (data == NULL)
+        return NULL;
+
+    *psize = (gs_offset_t)size.QuadPart;
+    return data;
+}
+
+void gp_unmap_file_impl(void *data, gs_offset_t size)
+{
+    UnmapViewOfFile(data);
+}
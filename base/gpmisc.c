@@ -23,6 +23,7 @@
 #include "stdio_.h"
 #include "memory_.h"
 #include "string_.h"
+#include "time_.h"
 #include "gp.h"
 #include "gpgetenv.h"
 #include "gpmisc.h"
@@ -45,6 +46,40 @@ gp_gettmpdir(char *ptr, int *plen)
     return gp_getenv("TEMP", ptr, plen);
 }
 
+/*
+ * Get the document time from the SOURCE_DATE_EPOCH environment variable,
+ * as used for reproducible builds. The PostScript and PDF writers date
+ * their output from it rather than from the clock when it is set, so that
+ * running the same job twice produces identical files.
+ * Returns false if the variable is absent, not a plain decimal number, or
+ * a time that gmtime can't convert or a PDF date (years 0000-9999) can't
+ * express.
+ */
+bool
+gp_source_date_epoch(int64_t *secs)
+{
+    char buf[32];
+    int len = sizeof(buf), i;
+    int64_t t = 0;
+    time_t tt;
+
+    if (gp_getenv("SOURCE_DATE_EPOCH", buf, &len) != 0 || buf[0] == 0)
+        return false;
+    for (i = 0; buf[i] != 0; i++) {
+        if (buf[i] < '0' || buf[i] > '9' || i >= 18)
+            return false;
+        t = t * 10 + (buf[i] - '0');
+    }
+    /* 9999-12-31T23:59:59Z */
+    if (t > (int64_t)253402300799)
+        return false;
+    tt = (time_t)t;
+    if ((int64_t)tt != t || gmtime(&tt) == NULL)
+        return false;
+    *secs = t;
+    return true;
+}
+
 /*
  * Open a temporary file, using O_EXCL and S_I*USR to prevent race
  * conditions and symlink attacks.
@@ -856,6 +891,24 @@ gp_stat(const gs_memory_t *mem, const char *path, struct stat *buf)
     return gp_stat_impl(mem, path, buf);
 }
 
+void *
+gp_map_file(gp_file *f, gs_offset_t *psize)
+{
+    FILE *file;
+
+    if (f == NULL || (file = gp_get_file(f)) == NULL)
+        return NULL;
+    gp_fflush(f);
+    return gp_map_file_impl(file, psize);
+}
+
+void
+gp_unmap_file(void *data, gs_offset_t size)
+{
+    if (data != NULL)
+        gp_unmap_file_impl(data, size);
+}
+
 file_enum *
 gp_enumerate_files_init(gs_memory_t *mem, const char *pat, uint patlen)
 {
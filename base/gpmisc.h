@@ -33,6 +33,13 @@
  */
 int gp_gettmpdir(char *ptr, int *plen);
 
+/*
+ * Get the document time, in seconds since 1970, from the SOURCE_DATE_EPOCH
+ * environment variable used for reproducible builds. Returns false if it is
+ * unset or unusable, and the caller should use the clock instead.
+ */
+bool gp_source_date_epoch(int64_t *secs);
+
 /*
  * Open a temporary file, using O_EXCL and S_IRWXU to prevent race
  * conditions and symlink attacks.
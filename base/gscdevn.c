@@ -22,6 +22,8 @@
 #include "gserrors.h"
 #include "gscdevn.h"
 #include "gsfunc.h"
+#include "gsfunc0.h"
+#include "gsfunc4.h"
 #include "gsrefct.h"
 #include "gsmatrix.h"		/* for gscolor2.h */
 #include "gsstruct.h"
@@ -150,6 +152,14 @@ gs_cspace_new_DeviceN(
     return 0;
 }
 
+/* Free a DeviceN map, including its tint transform table. */
+static void
+free_device_n_map(gs_memory_t * mem, void *data, client_name_t cname)
+{
+    gx_free_tint_table((gs_device_n_map *)data);
+    rc_free_struct_only(mem, data, cname);
+}
+
 /* Allocate and initialize a DeviceN map. */
 int
 alloc_device_n_map(gs_device_n_map ** ppmap, gs_memory_t * mem,
@@ -159,9 +169,12 @@ alloc_device_n_map(gs_device_n_map ** ppmap, gs_memory_t * mem,
 
     rc_alloc_struct_1(pimap, gs_device_n_map, &st_device_n_map, mem,
                       return_error(gs_error_VMerror), cname);
+    pimap->rc.free = free_device_n_map;
     pimap->tint_transform = 0;
     pimap->tint_transform_data = 0;
     pimap->cache_valid = false;
+    pimap->tint_table_size = 0;
+    pimap->tint_table = NULL;
     *ppmap = pimap;
     return 0;
 }
@@ -277,6 +290,290 @@ map_devn_using_function(const float *in, float *out,
     return gs_function_evaluate(pfn, in, out);
 }
 
+/*
+ * Sampled Type 0 and Type 4 tint transforms are expensive to evaluate, and
+ * images in DeviceN and Separation spaces evaluate them for every distinct
+ * pixel value.  If the device's TintTableSize parameter is set, the first
+ * time such a Function is used we sample it on a regular grid of that many
+ * points per input over its Domain, and from then on interpolate
+ * multilinearly in the grid instead.  The decision is taken once per map,
+ * so the same tint always gives the same color.
+ *
+ * The table is used only if the interpolated value is within
+ * TINT_TABLE_TOLERANCE of the Function's own value (as a fraction of the
+ * output Range) at the centre of every grid cell and, for a Type 0
+ * Function, at each of its samples.  A Type 0 Function with more samples
+ * than the grid has is never tabulated.  TINT_TABLE_MAX_POINTS bounds the
+ * size of the grid: the resolution is reduced for functions with several
+ * inputs until the grid fits.
+ */
+#ifndef TINT_TABLE_MAX_POINTS
+#  define TINT_TABLE_MAX_POINTS 65536
+#endif
+#ifndef TINT_TABLE_TOLERANCE
+#  define TINT_TABLE_TOLERANCE (1.0 / 1024)
+#endif
+#define TINT_TABLE_MAX_INPUTS 4
+
+/* Discard the tint transform table. */
+void
+gx_free_tint_table(gs_device_n_map *map)
+{
+    if (map->tint_table != NULL)
+        gs_free_object(map->rc.memory->non_gc_memory, map->tint_table,
+                       "gx_free_tint_table");
+    map->tint_table = NULL;
+    map->tint_table_size = 0;
+}
+
+/* Return the number of grid points in a table of size points per input. */
+static int64_t
+tint_table_points(int m, int size)
+{
+    int64_t points = 1;
+    int k;
+
+    for (k = 0; k < m; ++k)
+        points *= size;
+    return points;
+}
+
+/*
+ * Return the grid points per input to sample a Function at, given the
+ * requested resolution, or 0 if the Function shouldn't be tabulated.
+ */
+static int
+tint_table_size(const gs_function_t *pfn, int requested)
+{
+    int m = pfn->params.m, size, k;
+
+    if ((pfn->head.type != function_type_Sampled &&
+         pfn->head.type != function_type_PostScript_Calculator) ||
+        m < 1 || m > TINT_TABLE_MAX_INPUTS)
+        return 0;
+    for (k = 0; k < m; ++k)
+        if (!(pfn->params.Domain[2 * k + 1] > pfn->params.Domain[2 * k]))
+            return 0;
+    size = (int)pow((double)TINT_TABLE_MAX_POINTS, 1.0 / m) + 1;
+    while (size > 2 && tint_table_points(m, size) > TINT_TABLE_MAX_POINTS)
+        --size;
+    if (size > requested)
+        size = requested;
+    if (size < 2)
+        return 0;
+    if (pfn->head.type == function_type_Sampled) {
+        const gs_function_Sd_params_t *params =
+            (const gs_function_Sd_params_t *)&pfn->params;
+
+        for (k = 0; k < m; ++k)
+            if (params->Size[k] > size)
+                return 0;
+    }
+    return size;
+}
+
+/* Interpolate in the tint transform table. */
+static void
+tint_table_lookup(const gs_device_n_map *map, const float *in, float *out)
+{
+    const gs_function_t *pfn = map->tint_transform_data;
+    int m = pfn->params.m, n = pfn->params.n, size = map->tint_table_size;
+    int offset[TINT_TABLE_MAX_INPUTS];
+    float fraction[TINT_TABLE_MAX_INPUTS];
+    int base = 0, stride = 1, corner, k, j;
+
+    for (k = 0; k < m; ++k, stride *= size) {
+        float d0 = pfn->params.Domain[2 * k], d1 = pfn->params.Domain[2 * k + 1];
+        float t = (in[k] - d0) * (size - 1) / (d1 - d0);
+        int i;
+
+        if (!(t > 0))
+            t = 0;
+        else if (t > size - 1)
+            t = (float)(size - 1);
+        i = (int)t;
+        if (i > size - 2)
+            i = size - 2;
+        fraction[k] = t - i;
+        base += i * stride;
+        offset[k] = stride;
+    }
+    for (j = 0; j < n; ++j)
+        out[j] = 0;
+    for (corner = 0; corner < 1 << m; ++corner) {
+        const float *values;
+        float w = 1;
+        int index = base;
+
+        for (k = 0; k < m; ++k)
+            if (corner & (1 << k)) {
+                w *= fraction[k];
+                index += offset[k];
+            } else
+                w *= 1 - fraction[k];
+        if (w == 0)
+            continue;
+        values = map->tint_table + index * n;
+        for (j = 0; j < n; ++j)
+            out[j] += w * values[j];
+    }
+}
+
+/*
+ * Evaluate the Function at count points and compare with the table.
+ * Return 1 if the table is close enough everywhere, 0 if not.
+ */
+static int
+tint_table_check(const gs_device_n_map *map, const float *in, float *out,
+                 int count, const float *tolerance)
+{
+    const gs_function_t *pfn = map->tint_transform_data;
+    int m = pfn->params.m, n = pfn->params.n, i, j;
+    int code = gs_function_evaluate_multiple(pfn, in, out, count);
+
+    if (code < 0)
+        return code;
+    for (i = 0; i < count; ++i) {
+        float approx[GS_CLIENT_COLOR_MAX_COMPONENTS];
+
+        tint_table_lookup(map, in + i * m, approx);
+        for (j = 0; j < n; ++j)
+            if (!(fabs(approx[j] - out[i * n + j]) <= tolerance[j]))
+                return 0;
+    }
+    return 1;
+}
+
+/*
+ * Sample the tint transform Function into a table of the requested
+ * resolution, and check the table against the Function.  If the Function
+ * can't be approximated well enough, or evaluating it fails, the map is
+ * left without a table and the Function is used.
+ */
+static int
+tint_table_build(gs_device_n_map *map, int requested)
+{
+    const gs_function_t *pfn = map->tint_transform_data;
+    gs_memory_t *mem = map->rc.memory->non_gc_memory;
+    int m = pfn->params.m, n = pfn->params.n;
+    int size = tint_table_size(pfn, requested);
+    int points, count, i, k, code;
+    float *table = NULL, *in = NULL, *out = NULL;
+    float tolerance[GS_CLIENT_COLOR_MAX_COMPONENTS];
+
+    if (size == 0 || n > GS_CLIENT_COLOR_MAX_COMPONENTS)
+        return 0;
+    points = (int)tint_table_points(m, size);
+    table = (float *)gs_alloc_byte_array(mem, points * n, sizeof(float),
+                                         "tint_table_build(table)");
+    in = (float *)gs_alloc_byte_array(mem, points * m, sizeof(float),
+                                      "tint_table_build(in)");
+    out = (float *)gs_alloc_byte_array(mem, points * n, sizeof(float),
+                                       "tint_table_build(out)");
+    if (table == NULL || in == NULL || out == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto done;
+    }
+    /* Sample the Function at the grid points, the first input varying fastest. */
+    for (i = 0; i < points; ++i) {
+        int rest = i;
+
+        for (k = 0; k < m; ++k, rest /= size) {
+            float d0 = pfn->params.Domain[2 * k], d1 = pfn->params.Domain[2 * k + 1];
+
+            in[i * m + k] = d0 + (d1 - d0) * (rest % size) / (size - 1);
+        }
+    }
+    code = gs_function_evaluate_multiple(pfn, in, table, points);
+    if (code < 0)
+        goto done;
+    for (k = 0; k < n; ++k)
+        tolerance[k] = TINT_TABLE_TOLERANCE *
+            (pfn->params.Range == NULL ? 1 :
+             pfn->params.Range[2 * k + 1] - pfn->params.Range[2 * k]);
+    map->tint_table = table;
+    map->tint_table_size = size;
+    /* Compare at the cell centres. */
+    count = (int)tint_table_points(m, size - 1);
+    for (i = 0; i < count; ++i) {
+        int rest = i;
+
+        for (k = 0; k < m; ++k, rest /= size - 1) {
+            float d0 = pfn->params.Domain[2 * k], d1 = pfn->params.Domain[2 * k + 1];
+
+            in[i * m + k] = d0 + (d1 - d0) * (rest % (size - 1) + 0.5) / (size - 1);
+        }
+    }
+    code = tint_table_check(map, in, out, count, tolerance);
+    /* Compare at the samples of a Type 0 Function, which we may have missed. */
+    if (code > 0 && pfn->head.type == function_type_Sampled) {
+        const gs_function_Sd_params_t *params =
+            (const gs_function_Sd_params_t *)&pfn->params;
+
+        for (k = 0, count = 1; k < m; ++k)
+            count *= params->Size[k];
+        for (i = 0; i < count; ++i) {
+            int rest = i;
+
+            for (k = 0; k < m; ++k) {
+                float d0 = pfn->params.Domain[2 * k], d1 = pfn->params.Domain[2 * k + 1];
+                float e0 = (params->Encode ? params->Encode[2 * k] : 0);
+                float e1 = (params->Encode ? params->Encode[2 * k + 1] :
+                            params->Size[k] - 1);
+                float x = d0;
+
+                if (e1 != e0)
+                    x = d0 + (rest % params->Size[k] - e0) * (d1 - d0) / (e1 - e0);
+                in[i * m + k] = (x < d0 ? d0 : x > d1 ? d1 : x);
+                rest /= params->Size[k];
+            }
+        }
+        code = tint_table_check(map, in, out, count, tolerance);
+    }
+    if (code <= 0) {
+        if_debug1m('c', mem, "[c]tint transform table of %d points rejected\n",
+                   points);
+        map->tint_table = NULL;
+        map->tint_table_size = -1;
+    } else {
+        if_debug2m('c', mem, "[c]tint transform table of %d points for %d inputs\n",
+                   points, m);
+        table = NULL;
+        code = 0;
+    }
+done:
+    gs_free_object(mem, out, "tint_table_build(out)");
+    gs_free_object(mem, in, "tint_table_build(in)");
+    gs_free_object(mem, table, "tint_table_build(table)");
+    return code;
+}
+
+/*
+ * Run the tint transform of a map, using the sampled table for a Function
+ * if the device asks for one and the Function allows it.
+ */
+int
+gx_apply_tint_transform(gs_device_n_map *map, const float *in, float *out,
+                        const gs_gstate *pgs, gx_device *dev)
+{
+    if (map->tint_table_size == 0) {
+        cmm_dev_profile_t *dev_profile = NULL;
+
+        /* Decide once, on first use. Building the table is optional. */
+        map->tint_table_size = -1;
+        if (map->tint_transform == map_devn_using_function && dev != NULL &&
+            dev_proc(dev, get_profile) != NULL &&
+            dev_proc(dev, get_profile)(dev, &dev_profile) >= 0 &&
+            dev_profile != NULL && dev_profile->tinttablesize > 0)
+            (void)tint_table_build(map, dev_profile->tinttablesize);
+    }
+    if (map->tint_table != NULL) {
+        tint_table_lookup(map, in, out);
+        return 0;
+    }
+    return (*map->tint_transform)(in, out, pgs, map->tint_transform_data);
+}
+
 /*
  * Set the DeviceN tint transformation procedure to a Function.
  */
@@ -294,6 +591,7 @@ gs_cspace_set_devn_function(gs_color_space *pcspace, gs_function_t *pfn)
     pimap->tint_transform = map_devn_using_function;
     pimap->tint_transform_data = pfn;
     pimap->cache_valid = false;
+    gx_free_tint_table(pimap);
     return 0;
 }
 
@@ -482,9 +780,8 @@ gx_concretize_DeviceN(const gs_client_color * pc, const gs_color_space * pcs,
                 return 0;
             }
         }
-        tcode = (*pcs->params.device_n.map->tint_transform)
-             (pc->paint.values, &cc.paint.values[0],
-             pgs, pcs->params.device_n.map->tint_transform_data);
+        tcode = gx_apply_tint_transform(map, pc->paint.values,
+                                        &cc.paint.values[0], pgs, dev);
         (*pacs->type->restrict_color)(&cc, pacs);
         if (tcode < 0)
             return tcode;
@@ -300,6 +300,7 @@ struct cmm_dev_profile_s {
         gs_overprint_control_t overprint_control;	/* enable is the default */
         gsicc_namelist_t *spotnames;  /* If our device profiles are devn */
         bool prebandthreshold;     /* Used to indicate use of HT pre-clist */
+        int tinttablesize;         /* Grid points per input for sampled tint transforms, 0 = off */
         gs_memory_t *memory;
         rc_header rc;
 };
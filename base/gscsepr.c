@@ -299,6 +299,7 @@ gs_cspace_set_sepr_function(const gs_color_space *pcspace, gs_function_t *pfn)
     pimap->tint_transform = map_devn_using_function;
     pimap->tint_transform_data = pfn;
     pimap->cache_valid = false;
+    gx_free_tint_table(pimap);
     return 0;
 }
 
@@ -376,9 +377,8 @@ gx_concretize_Separation(const gs_client_color *pc, const gs_color_space *pcs,
                 pconc[i] = map->conc[i];
             return 0;
         }
-        code = (*pcs->params.separation.map->tint_transform)
-            (pc->paint.values, &cc.paint.values[0],
-             pgs, pcs->params.separation.map->tint_transform_data);
+        code = gx_apply_tint_transform(map, pc->paint.values,
+                                       &cc.paint.values[0], pgs, dev);
         if (code < 0)
             return code;
         (*pacs->type->restrict_color)(&cc, pacs);
@@ -149,6 +149,7 @@ int gx_default_get_param(gx_device *dev, char *Param, void *list)
     /* By default overprinting only valid with cmyk devices */
     gs_overprint_control_t overprint_control = gs_overprint_control_enable;
     bool prebandthreshold = true, temp_bool = false;
+    int tinttablesize = 0;
 
     if(strcmp(Param, "OutputDevice") == 0){
         gs_param_string dns;
@@ -303,6 +304,9 @@ int gx_default_get_param(gx_device *dev, char *Param, void *list)
         int interpolate_control = dev->interpolate_control;
         return param_write_int(plist, "InterpolateControl", &interpolate_control);
     }
+    if (strcmp(Param, "ShadingDirectFill") == 0) {
+        return param_write_bool(plist, "ShadingDirectFill", &dev->shading_direct_fill);
+    }
     if (strcmp(Param, "LeadingEdge") == 0) {
         if (dev->LeadingEdge & LEADINGEDGE_SET_MASK) {
             int leadingedge = dev->LeadingEdge & LEADINGEDGE_MASK;
@@ -409,6 +413,7 @@ int gx_default_get_param(gx_device *dev, char *Param, void *list)
         blackthresholdL = dev_profile->blackthresholdL;
         overprint_control = dev_profile->overprint_control;
         prebandthreshold = dev_profile->prebandthreshold;
+        tinttablesize = dev_profile->tinttablesize;
         /* With respect to Output profiles that have non-standard colorants,
            we rely upon the default profile to give us the colorants if they do
            exist. */
@@ -471,6 +476,9 @@ int gx_default_get_param(gx_device *dev, char *Param, void *list)
     if (strcmp(Param, "PreBandThreshold") == 0) {
         return param_write_bool(plist, "PreBandThreshold", &prebandthreshold);
     }
+    if (strcmp(Param, "TintTableSize") == 0) {
+        return param_write_int(plist, "TintTableSize", &tinttablesize);
+    }
     if (strcmp(Param, "PostRenderProfile") == 0) {
         return param_write_string(plist, "PostRenderProfile", &(postren_profile));
     }
@@ -609,6 +617,7 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
     /* By default, only overprint if the device supports it */
     gs_overprint_control_t overprint_control = gs_overprint_control_enable;
     bool prebandthreshold = true, temp_bool;
+    int tinttablesize = 0;
     int k;
     int color_accuracy = MAX_COLOR_ACCURACY;
     gs_param_float_array msa, ibba, hwra, ma;
@@ -727,6 +736,7 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
         blackthresholdL = dev_profile->blackthresholdL;
         overprint_control = dev_profile->overprint_control;
         prebandthreshold = dev_profile->prebandthreshold;
+        tinttablesize = dev_profile->tinttablesize;
         /* With respect to Output profiles that have non-standard colorants,
            we rely upon the default profile to give us the colorants if they do
            exist. */
@@ -789,6 +799,7 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
         (code = param_write_float(plist, "BlackThresholdL", &blackthresholdL)) < 0 ||
         (code = param_write_float(plist, "BlackThresholdC", &blackthresholdC)) < 0 ||
         (code = param_write_bool(plist, "PreBandThreshold", &prebandthreshold)) < 0 ||
+        (code = param_write_int(plist, "TintTableSize", &tinttablesize)) < 0 ||
         (code = param_write_string(plist,"OutputICCProfile", &(profile_array[0]))) < 0 ||
         (code = param_write_string(plist,"VectorICCProfile", &(profile_array[1]))) < 0 ||
         (code = param_write_string(plist,"ImageICCProfile", &(profile_array[2]))) < 0 ||
@@ -835,7 +846,8 @@ gx_default_get_params(gx_device * dev, gs_param_list * plist)
         (code = param_write_int(plist, "BandHeight", &dev->space_params.band.BandHeight)) < 0 ||
         (code = param_write_int(plist, "BandWidth", &dev->space_params.band.BandWidth)) < 0 ||
         (code = param_write_size_t(plist, "BufferSpace", &dev->space_params.BufferSpace)) < 0 ||
-        (code = param_write_int(plist, "InterpolateControl", &dev->interpolate_control)) < 0
+        (code = param_write_int(plist, "InterpolateControl", &dev->interpolate_control)) < 0 ||
+        (code = param_write_bool(plist, "ShadingDirectFill", &dev->shading_direct_fill)) < 0
         )
     {
         gs_free_object(dev->memory, colorant_names, "gx_default_get_param");
@@ -1254,6 +1266,35 @@ gx_default_put_prebandthreshold(bool prebandthreshold, gx_device * dev)
     return code;
 }
 
+static int
+gx_default_put_tinttablesize(int tinttablesize, gx_device * dev)
+{
+    int code = 0;
+    cmm_dev_profile_t *profile_struct;
+
+    /* See gx_default_put_prebandthreshold for why get_profile may be NULL. */
+    if (dev_proc(dev, get_profile) == NULL) {
+        if (dev->icc_struct == NULL) {
+            /* Allocate at this time the structure */
+            dev->icc_struct = gsicc_new_device_profile_array(dev);
+            if (dev->icc_struct == NULL)
+                return_error(gs_error_VMerror);
+        }
+        dev->icc_struct->tinttablesize = tinttablesize;
+    } else {
+        code = dev_proc(dev, get_profile)(dev,  &profile_struct);
+        if (profile_struct == NULL) {
+            /* Create now  */
+            dev->icc_struct = gsicc_new_device_profile_array(dev);
+            profile_struct =  dev->icc_struct;
+            if (profile_struct == NULL)
+                return_error(gs_error_VMerror);
+        }
+        profile_struct->tinttablesize = tinttablesize;
+    }
+    return code;
+}
+
 static int
 gx_default_put_usefastcolor(bool fastcolor, gx_device * dev)
 {
@@ -1675,6 +1716,7 @@ gx_default_put_params(gx_device * dev, gs_param_list * plist)
     int gab = dev->color_info.anti_alias.graphics_bits;
     size_t mpbm = dev->MaxPatternBitmap;
     int ic = dev->interpolate_control;
+    bool sdf = dev->shading_direct_fill;
     bool page_uses_transparency = dev->page_uses_transparency;
     bool page_uses_overprint = dev->page_uses_overprint;
     gdev_space_params sp = dev->space_params;
@@ -1695,6 +1737,7 @@ gx_default_put_params(gx_device * dev, gs_param_list * plist)
     float blackthresholdC = BLACKTHRESHOLDC;
     gs_overprint_control_t overprint_control = gs_overprint_control_enable;
     bool prebandthreshold = false;
+    int tinttablesize = 0;
     bool use_antidropout = dev->color_info.use_antidropout_downscaler;
     bool temp_bool;
     int  profile_types[NUM_DEVICE_PROFILES] = {gsDEFAULTPROFILE,
@@ -1717,6 +1760,7 @@ gx_default_put_params(gx_device * dev, gs_param_list * plist)
         blackthresholdL = dev->icc_struct->blackthresholdL;
         blackthresholdC = dev->icc_struct->blackthresholdC;
         prebandthreshold = dev->icc_struct->prebandthreshold;
+        tinttablesize = dev->icc_struct->tinttablesize;
         overprint_control = dev->icc_struct->overprint_control;
     } else {
         for (k = 0; k < NUM_DEVICE_PROFILES; k++) {
@@ -2101,6 +2145,12 @@ nce:
         ecode = code;
         param_signal_error(plist, param_name, ecode);
     }
+    if ((code = param_read_int(plist, (param_name = "TintTableSize"), &tinttablesize)) < 0 ||
+        (code == 0 && tinttablesize != 0 &&
+         (tinttablesize < 2 || tinttablesize > 65536))) {
+        ecode = (code < 0 ? code : gs_note_error(gs_error_rangecheck));
+        param_signal_error(plist, param_name, ecode);
+    }
     if ((code = param_read_bool(plist, (param_name = "UseCIEColor"), &ucc)) < 0) {
         ecode = code;
         param_signal_error(plist, param_name, ecode);
@@ -2115,6 +2165,8 @@ nce:
         ecode = code;
     if ((code = param_read_int(plist, "InterpolateControl", &ic)) < 0)
         ecode = code;
+    if ((code = param_read_bool(plist, "ShadingDirectFill", &sdf)) < 0)
+        ecode = code;
     if ((code = param_read_bool(plist, (param_name = "PageUsesTransparency"),
                                 &page_uses_transparency)) < 0) {
         ecode = code;
@@ -2479,6 +2531,7 @@ label:\
     dev->LockSafetyParams = locksafe;
     dev->MaxPatternBitmap = mpbm;
     dev->interpolate_control = ic;
+    dev->shading_direct_fill = sdf;
     dev->space_params = sp;
     dev->page_uses_transparency = page_uses_transparency;
     dev->page_uses_overprint = page_uses_overprint;
@@ -2544,6 +2597,9 @@ label:\
     if (code < 0)
         return code;
     code = gx_default_put_graydetection(graydetection, dev);
+    if (code < 0)
+        return code;
+    code = gx_default_put_tinttablesize(tinttablesize, dev);
     if (code < 0)
         return code;
     return gx_default_put_prebandthreshold(prebandthreshold, dev);
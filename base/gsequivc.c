@@ -475,7 +475,8 @@ capture_spot_equivalent_cmyk_colors(gx_device * pdev, const gs_gstate * pgs,
                           0 /* usefastcolor */, 0 /* blacktext */, 0 /* blackvector */,
                           0.0 /* blackthresholdL */, 0.0 /* blackthresholdC */,
                           0 /* supports_devn */, 0 /* overprint_control */,
-                          0 /* spotnames */, 0 /* prebandthreshold */, 0 /* memory */,
+                          0 /* spotnames */, 0 /* prebandthreshold */,
+                          0 /* tinttablesize */, 0 /* memory */,
                           { 0 } /* rc_header */
                           };
 
@@ -109,6 +109,14 @@ typedef FN_FREE_PROC((*fn_free_proc_t));
   int proc(const gs_function_t * pfn, stream *s)
 typedef FN_SERIALIZE_PROC((*fn_serialize_proc_t));
 
+/*
+ * Evaluate a function at count points. in holds count * m inputs and out
+ * receives count * n outputs. Stops at the first error and returns it.
+ */
+#define FN_EVALUATE_MULTIPLE_PROC(proc)\
+  int proc(const gs_function_t * pfn, const float *in, float *out, int count)
+typedef FN_EVALUATE_MULTIPLE_PROC((*fn_evaluate_multiple_proc_t));
+
 /* Define the generic function structures. */
 typedef struct gs_function_procs_s {
     fn_evaluate_proc_t evaluate;
@@ -119,6 +127,7 @@ typedef struct gs_function_procs_s {
     fn_free_params_proc_t free_params;
     fn_free_proc_t free;
     fn_serialize_proc_t serialize;
+    fn_evaluate_multiple_proc_t evaluate_multiple;
 } gs_function_procs_t;
 typedef struct gs_function_head_s {
     gs_function_type_t type;
@@ -173,6 +182,10 @@ int alloc_function_array(uint count, gs_function_t *** pFunctions,
 #define gs_function_evaluate(pfn, in, out)\
   ((pfn)->head.procs.evaluate)(pfn, in, out)
 
+/* Evaluate a function at several points. */
+#define gs_function_evaluate_multiple(pfn, in, out, count)\
+  ((pfn)->head.procs.evaluate_multiple)(pfn, in, out, count)
+
 /*
  * Test whether a function is monotonic on a given (closed) interval.
  * return 1 = monotonic, 0 = not or don't know, <0 = error..
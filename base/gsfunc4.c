@@ -29,11 +29,14 @@
 #include "spprint.h"
 #include "stream.h"
 
+typedef struct calc_code_s calc_code_t;
+
 typedef struct gs_function_PtCr_s {
     gs_function_head_t head;
     gs_function_PtCr_params_t params;
     /* Define a bogus DataSource for get_function_info. */
     gs_data_source_t data_source;
+    calc_code_t *code;		/* compiled ops, or NULL (see below) */
 } gs_function_PtCr_t;
 
 /* GC descriptor */
@@ -98,42 +101,35 @@ typedef enum {
         /* Miscellaneous */
 
     PtCr_no_op,
-    PtCr_typecheck
+    PtCr_typecheck,
 
-} gs_PtCr_typed_opcode_t;
+        /* Compiled code only */
 
-/* Evaluate a PostScript Calculator function. */
-static int
-fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
-{
-    const gs_function_PtCr_t *pfn = (const gs_function_PtCr_t *)pfn_common;
-    calc_value_t vstack_buf[2 + MAX_VSTACK + 1];
-    calc_value_t *vstack = &vstack_buf[1];
-    calc_value_t *vsp = vstack + pfn->params.m;
-    const byte *p = pfn->params.ops.data;
-    int repeat_count[MAX_PSC_FUNCTION_NESTING];
-    int repeat_proc_size[MAX_PSC_FUNCTION_NESTING];
-    int repeat_nesting_level = -1;
-    int i;
+    PtCr_mov,
+    PtCr_select,
+    PtCr_jump,
+    PtCr_jump_if_false
 
-    /*
-     * Define the table for mapping explicit opcodes to typed opcodes.
-     * We index this table with the opcode and the types of the top 2
-     * values on the stack.
-     */
-    static const struct op_defn_s {
-        byte opcode[16];	/* 4 * type[-1] + type[0] */
-    } op_defn_table[] = {
-        /* Keep this consistent with opcodes in gsfunc4.h! */
+} gs_PtCr_typed_opcode_t;
+
+/*
+ * Define the table for mapping explicit opcodes to typed opcodes.
+ * We index this table with the opcode and the types of the top 2
+ * values on the stack.
+ */
+static const struct op_defn_s {
+    byte opcode[16];	/* 4 * type[-1] + type[0] */
+} op_defn_table[] = {
+    /* Keep this consistent with opcodes in gsfunc4.h! */
 
 #define O4(op) op,op,op,op
 #define E PtCr_typecheck
 #define E4 O4(E)
 #define N PtCr_no_op
-        /* 0-operand operators */
+    /* 0-operand operators */
 #define OP_NONE(op)\
   {{O4(op), O4(op), O4(op), O4(op)}}
-        /* 1-operand operators */
+    /* 1-operand operators */
 #define OP1(b, i, f)\
   {{E,b,i,f, E,b,i,f, E,b,i,f, E,b,i,f}}
 #define OP_NUM1(i, f)\
@@ -142,7 +138,7 @@ fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
   OP1(E, PtCr_int_to_float, f)
 #define OP_ANY1(op)\
   OP1(op, op, op)
-        /* 2-operand operators */
+    /* 2-operand operators */
 #define OP_NUM2(i, f)\
   {{E4, E4, E,E,i,PtCr_2nd_int_to_float, E,E,PtCr_int_to_float,f}}
 #define OP_INT_BOOL2(i)\
@@ -157,69 +153,855 @@ fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
 #define OP_ANY2(op)\
   {{E4, E,op,op,op, E,op,op,op, E,op,op,op}}
 
-    /* Arithmetic operators */
-
-        OP_NUM1(PtCr_abs_int, PtCr_abs),	/* abs */
-        OP_NUM2(PtCr_add_int, PtCr_add),	/* add */
-        OP_INT_BOOL2(PtCr_and),  /* and */
-        OP_MATH2(PtCr_atan),	/* atan */
-        OP_INT2(PtCr_bitshift),	/* bitshift */
-        OP_NUM1(N, PtCr_ceiling),	/* ceiling */
-        OP_MATH1(PtCr_cos),	/* cos */
-        OP_NUM1(N, PtCr_cvi),	/* cvi */
-        OP_NUM1(PtCr_int_to_float, N),	/* cvr */
-        OP_MATH2(PtCr_div),	/* div */
-        OP_MATH2(PtCr_exp),	/* exp */
-        OP_NUM1(N, PtCr_floor),	/* floor */
-        OP_INT2(PtCr_idiv),	/* idiv */
-        OP_MATH1(PtCr_ln),	/* ln */
-        OP_MATH1(PtCr_log),	/* log */
-        OP_INT2(PtCr_mod),	/* mod */
-        OP_NUM2(PtCr_mul_int, PtCr_mul),	/* mul */
-        OP_NUM1(PtCr_neg_int, PtCr_neg),	/* neg */
-        OP1(PtCr_not, PtCr_not, E),	/* not */
-        OP_INT_BOOL2(PtCr_or),  /* or */
-        OP_NUM1(N, PtCr_round),	/* round */
-        OP_MATH1(PtCr_sin),	/* sin */
-        OP_MATH1(PtCr_sqrt),	/* sqrt */
-        OP_NUM2(PtCr_sub_int, PtCr_sub),	/* sub */
-        OP_NUM1(N, PtCr_truncate),	/* truncate */
-        OP_INT_BOOL2(PtCr_xor),  /* xor */
-
-    /* Comparison operators */
-
-        OP_REL2(PtCr_eq_int, PtCr_eq),	/* eq */
-        OP_NUM2(PtCr_ge_int, PtCr_ge),	/* ge */
-        OP_NUM2(PtCr_gt_int, PtCr_gt),	/* gt */
-        OP_NUM2(PtCr_le_int, PtCr_le),	/* le */
-        OP_NUM2(PtCr_lt_int, PtCr_lt),	/* lt */
-        OP_REL2(PtCr_ne_int, PtCr_ne),	/* ne */
-
-    /* Stack operators */
-
-        OP1(E, PtCr_copy, E),	/* copy */
-        OP_ANY1(PtCr_dup),	/* dup */
-        OP_ANY2(PtCr_exch),	/* exch */
-        OP1(E, PtCr_index, E),	/* index */
-        OP_ANY1(PtCr_pop),	/* pop */
-        OP_INT2(PtCr_roll),	/* roll */
-
-    /* Constants */
-
-        OP_NONE(PtCr_byte),		/* byte */
-        OP_NONE(PtCr_int),		/* int */
-        OP_NONE(PtCr_float),		/* float */
-        OP_NONE(PtCr_true),		/* true */
-        OP_NONE(PtCr_false),		/* false */
-
-    /* Special */
-
-        OP1(PtCr_if, E, E),		/* if */
-        OP_NONE(PtCr_else),		/* else */
-        OP_NONE(PtCr_return),		/* return */
-        OP1(E, PtCr_repeat, E),		/* repeat */
-        OP_NONE(PtCr_repeat_end)	/* repeat_end */
-    };
+/* Arithmetic operators */
+
+    OP_NUM1(PtCr_abs_int, PtCr_abs),	/* abs */
+    OP_NUM2(PtCr_add_int, PtCr_add),	/* add */
+    OP_INT_BOOL2(PtCr_and),  /* and */
+    OP_MATH2(PtCr_atan),	/* atan */
+    OP_INT2(PtCr_bitshift),	/* bitshift */
+    OP_NUM1(N, PtCr_ceiling),	/* ceiling */
+    OP_MATH1(PtCr_cos),	/* cos */
+    OP_NUM1(N, PtCr_cvi),	/* cvi */
+    OP_NUM1(PtCr_int_to_float, N),	/* cvr */
+    OP_MATH2(PtCr_div),	/* div */
+    OP_MATH2(PtCr_exp),	/* exp */
+    OP_NUM1(N, PtCr_floor),	/* floor */
+    OP_INT2(PtCr_idiv),	/* idiv */
+    OP_MATH1(PtCr_ln),	/* ln */
+    OP_MATH1(PtCr_log),	/* log */
+    OP_INT2(PtCr_mod),	/* mod */
+    OP_NUM2(PtCr_mul_int, PtCr_mul),	/* mul */
+    OP_NUM1(PtCr_neg_int, PtCr_neg),	/* neg */
+    OP1(PtCr_not, PtCr_not, E),	/* not */
+    OP_INT_BOOL2(PtCr_or),  /* or */
+    OP_NUM1(N, PtCr_round),	/* round */
+    OP_MATH1(PtCr_sin),	/* sin */
+    OP_MATH1(PtCr_sqrt),	/* sqrt */
+    OP_NUM2(PtCr_sub_int, PtCr_sub),	/* sub */
+    OP_NUM1(N, PtCr_truncate),	/* truncate */
+    OP_INT_BOOL2(PtCr_xor),  /* xor */
+
+/* Comparison operators */
+
+    OP_REL2(PtCr_eq_int, PtCr_eq),	/* eq */
+    OP_NUM2(PtCr_ge_int, PtCr_ge),	/* ge */
+    OP_NUM2(PtCr_gt_int, PtCr_gt),	/* gt */
+    OP_NUM2(PtCr_le_int, PtCr_le),	/* le */
+    OP_NUM2(PtCr_lt_int, PtCr_lt),	/* lt */
+    OP_REL2(PtCr_ne_int, PtCr_ne),	/* ne */
+
+/* Stack operators */
+
+    OP1(E, PtCr_copy, E),	/* copy */
+    OP_ANY1(PtCr_dup),	/* dup */
+    OP_ANY2(PtCr_exch),	/* exch */
+    OP1(E, PtCr_index, E),	/* index */
+    OP_ANY1(PtCr_pop),	/* pop */
+    OP_INT2(PtCr_roll),	/* roll */
+
+/* Constants */
+
+    OP_NONE(PtCr_byte),		/* byte */
+    OP_NONE(PtCr_int),		/* int */
+    OP_NONE(PtCr_float),		/* float */
+    OP_NONE(PtCr_true),		/* true */
+    OP_NONE(PtCr_false),		/* false */
+
+/* Special */
+
+    OP1(PtCr_if, E, E),		/* if */
+    OP_NONE(PtCr_else),		/* else */
+    OP_NONE(PtCr_return),		/* return */
+    OP1(E, PtCr_repeat, E),		/* repeat */
+    OP_NONE(PtCr_repeat_end)	/* repeat_end */
+};
+
+#undef O4
+#undef E
+#undef E4
+#undef N
+#undef OP_NONE
+#undef OP1
+#undef OP_NUM1
+#undef OP_MATH1
+#undef OP_ANY1
+#undef OP_NUM2
+#undef OP_INT_BOOL2
+#undef OP_MATH2
+#undef OP_INT2
+#undef OP_REL2
+#undef OP_ANY2
+
+/* ---------------- Compiled evaluation ---------------- */
+
+/*
+ * Most calculator functions only rearrange the stack and do arithmetic,
+ * so the depth of the stack and the type of each entry are the same every
+ * time the function is evaluated. For such functions we translate the ops
+ * once, when the function is created, into a list of instructions on
+ * registers: each stack entry becomes a register, the stack operators
+ * only rename registers, operations on constants are done by the compiler,
+ * and short if/else bodies which can't fail are both executed and the
+ * results selected. Functions which we can't translate (repeat, stack
+ * operators with computed operands, integer arithmetic that may overflow
+ * into reals, branches leaving different stacks, or errors we can detect
+ * in advance) are interpreted as before.
+ */
+
+#define MAX_CALC_REGS 1024
+#define MAX_CALC_INSNS 2048
+#define MAX_CALC_SELECT 8	/* max instructions in both bodies of a select */
+
+typedef union calc_reg_u {
+    int i;			/* also used for Boolean */
+    float f;
+} calc_reg_t;
+
+/* op is a gs_PtCr_typed_opcode_t or one of the original float opcodes. */
+/* Jump offsets (in d) are relative to the next instruction. */
+typedef struct calc_insn_s {
+    ushort op, d, a, b, c;
+} calc_insn_t;
+
+/*
+ * The compiled code is one block, so that it can be freed and relocated
+ * as a single object. The header is followed by the initial registers
+ * (the inputs, then constants and temporaries), the instructions and the
+ * n registers holding the outputs.
+ */
+struct calc_code_s {
+    int num_regs;
+    int num_insns;
+    int num_out;
+};
+#define calc_code_regs(pc) ((calc_reg_t *)((pc) + 1))
+#define calc_code_insns(pc)\
+  ((calc_insn_t *)(calc_code_regs(pc) + (pc)->num_regs))
+#define calc_code_out(pc)\
+  ((ushort *)(calc_code_insns(pc) + (pc)->num_insns))
+
+/* Execute compiled instructions. */
+static int
+calc_execute(const calc_insn_t *ip, const calc_insn_t *end, calc_reg_t *r)
+{
+    for (; ip < end; ip++) {
+        calc_reg_t *d = &r[ip->d];
+        const calc_reg_t *a = &r[ip->a], *b = &r[ip->b];
+        int code, n;
+
+        switch (ip->op) {
+        case PtCr_int_to_float:
+            d->f = (float)a->i;
+            continue;
+        case PtCr_abs:
+            d->f = fabs(a->f);
+            continue;
+        case PtCr_add:
+            d->f = a->f + b->f;
+            continue;
+        case PtCr_and:
+            d->i = a->i & b->i;
+            continue;
+        case PtCr_atan: {
+            double result;
+
+            code = gs_atan2_degrees(a->f, b->f, &result);
+            if (code < 0)
+                return code;
+            d->f = result;
+            continue;
+        }
+        case PtCr_bitshift:
+#define MAX_SHIFT (ARCH_SIZEOF_INT * 8 - 1)
+            if (b->i < -MAX_SHIFT || b->i > MAX_SHIFT)
+                d->i = 0;
+#undef MAX_SHIFT
+            else if ((n = b->i) < 0)
+                d->i = ((uint)(a->i)) >> -n;
+            else
+                d->i = a->i << n;
+            continue;
+        case PtCr_ceiling:
+            d->f = ceil(a->f);
+            continue;
+        case PtCr_cos:
+            d->f = gs_cos_degrees(a->f);
+            continue;
+        case PtCr_cvi:
+            d->i = (int)(a->f);
+            continue;
+        case PtCr_div:
+            if (b->f == 0)
+                return_error(gs_error_undefinedresult);
+            d->f = a->f / b->f;
+            continue;
+        case PtCr_exp:
+            d->f = pow(a->f, b->f);
+            continue;
+        case PtCr_floor:
+            d->f = floor(a->f);
+            continue;
+        case PtCr_idiv:
+            if (b->i == 0)
+                return_error(gs_error_undefinedresult);
+            if (a->i == min_int && b->i == -1)  /* anomalous boundary case, fail */
+                return_error(gs_error_rangecheck);
+            d->i = a->i / b->i;
+            continue;
+        case PtCr_ln:
+            d->f = log(a->f);
+            continue;
+        case PtCr_log:
+            d->f = log10(a->f);
+            continue;
+        case PtCr_mod:
+            if (b->i == 0)
+                return_error(gs_error_undefinedresult);
+            d->i = (b->i == -1 ? 0 : a->i % b->i); /* min_int % -1 traps */
+            continue;
+        case PtCr_mul:
+            d->f = a->f * b->f;
+            continue;
+        case PtCr_neg:
+            d->f = -a->f;
+            continue;
+        case PtCr_not:
+            d->i = ~a->i;
+            continue;
+        case PtCr_or:
+            d->i = a->i | b->i;
+            continue;
+        case PtCr_round:
+            d->f = floor(a->f + 0.5);
+            continue;
+        case PtCr_sin:
+            d->f = gs_sin_degrees(a->f);
+            continue;
+        case PtCr_sqrt:
+            d->f = sqrt(a->f);
+            continue;
+        case PtCr_sub:
+            d->f = a->f - b->f;
+            continue;
+        case PtCr_truncate:
+            d->f = (a->f < 0 ? ceil(a->f) : floor(a->f));
+            continue;
+        case PtCr_xor:
+            d->i = a->i ^ b->i;
+            continue;
+        case PtCr_eq_int: d->i = a->i == b->i; continue;
+        case PtCr_ge_int: d->i = a->i >= b->i; continue;
+        case PtCr_gt_int: d->i = a->i > b->i; continue;
+        case PtCr_le_int: d->i = a->i <= b->i; continue;
+        case PtCr_lt_int: d->i = a->i < b->i; continue;
+        case PtCr_ne_int: d->i = a->i != b->i; continue;
+        case PtCr_eq: d->i = a->f == b->f; continue;
+        case PtCr_ge: d->i = a->f >= b->f; continue;
+        case PtCr_gt: d->i = a->f > b->f; continue;
+        case PtCr_le: d->i = a->f <= b->f; continue;
+        case PtCr_lt: d->i = a->f < b->f; continue;
+        case PtCr_ne: d->i = a->f != b->f; continue;
+        case PtCr_mov:
+            *d = *a;
+            continue;
+        case PtCr_select:
+            *d = (a->i ? *b : r[ip->c]);
+            continue;
+        case PtCr_jump_if_false:
+            if (a->i)
+                continue;
+            /* falls through */
+        case PtCr_jump:
+            ip += ip->d;
+            continue;
+        default:
+            return_error(gs_error_unregistered); /* Must not happen. */
+        }
+    }
+    return 0;
+}
+
+/* Evaluate compiled code at count points. */
+static int
+calc_evaluate(const calc_code_t *pc, int m, int n, const float *in,
+              float *out, int count)
+{
+    calc_reg_t regs[MAX_CALC_REGS];
+    const calc_insn_t *insns = calc_code_insns(pc);
+    const ushort *outs = calc_code_out(pc);
+    int i, code;
+
+    memcpy(regs, calc_code_regs(pc), pc->num_regs * sizeof(calc_reg_t));
+    for (; count > 0; count--, in += m, out += n) {
+        for (i = 0; i < m; ++i)
+            regs[i].f = in[i];
+        code = calc_execute(insns, insns + pc->num_insns, regs);
+        if (code < 0)
+            return code;
+        for (i = 0; i < n; ++i)
+            out[i] = regs[outs[i]].f;
+    }
+    return 0;
+}
+
+/* The compiler keeps the register and type of each stack entry. */
+typedef struct calc_slot_s {
+    ushort reg;
+    byte type;			/* calc_value_type_t */
+} calc_slot_t;
+
+typedef struct calc_compiler_s {
+    calc_reg_t regs[MAX_CALC_REGS];	/* values of the constants */
+    byte is_const[MAX_CALC_REGS];
+    int num_regs;
+    calc_insn_t insns[MAX_CALC_INSNS];
+    int num_insns;
+    calc_slot_t stack[MAX_VSTACK];
+    int depth;
+} calc_compiler_t;
+
+#define CALC_TOP(cc, k) ((cc)->stack[(cc)->depth - 1 - (k)])
+
+/* Allocate a register for a constant. Return the register or -1. */
+static int
+calc_const(calc_compiler_t *cc, calc_reg_t v)
+{
+    if (cc->num_regs == MAX_CALC_REGS)
+        return -1;
+    cc->regs[cc->num_regs] = v;
+    cc->is_const[cc->num_regs] = 1;
+    return cc->num_regs++;
+}
+
+/* Push a constant. */
+static int
+calc_push_const(calc_compiler_t *cc, calc_value_type_t type, calc_reg_t v)
+{
+    int r;
+
+    if (cc->depth == MAX_VSTACK || (r = calc_const(cc, v)) < 0)
+        return -1;
+    cc->stack[cc->depth].reg = r;
+    cc->stack[cc->depth].type = type;
+    cc->depth++;
+    return 0;
+}
+
+/*
+ * Emit an instruction with a new destination register, or compute it
+ * now if its operands are constants. Return the register or -1.
+ */
+static int
+calc_emit(calc_compiler_t *cc, int op, int a, int b, int c)
+{
+    calc_insn_t *ip;
+    int d;
+
+    if (cc->num_insns == MAX_CALC_INSNS || cc->num_regs == MAX_CALC_REGS)
+        return -1;
+    d = cc->num_regs++;
+    cc->is_const[d] = 0;
+    ip = &cc->insns[cc->num_insns];
+    ip->op = op, ip->d = d, ip->a = a, ip->b = b, ip->c = c;
+    if (cc->is_const[a] && cc->is_const[b] && cc->is_const[c] &&
+        calc_execute(ip, ip + 1, cc->regs) >= 0)
+        cc->is_const[d] = 1;
+    else
+        cc->num_insns++;	/* Errors are left to the evaluation. */
+    return d;
+}
+
+/* Replace the top k (1 or 2) stack entries with the result of op. */
+static int
+calc_emit_op(calc_compiler_t *cc, int op, int k, calc_value_type_t type)
+{
+    int a = CALC_TOP(cc, k - 1).reg, b = CALC_TOP(cc, 0).reg;
+    int d = calc_emit(cc, op, a, b, a);
+
+    if (d < 0)
+        return -1;
+    cc->depth -= k - 1;
+    CALC_TOP(cc, 0).reg = d;
+    CALC_TOP(cc, 0).type = type;
+    return 0;
+}
+
+/* Convert the k'th stack entry from the top to float. */
+static int
+calc_int_to_float(calc_compiler_t *cc, int k)
+{
+    int r = CALC_TOP(cc, k).reg;
+    int d = calc_emit(cc, PtCr_int_to_float, r, r, r);
+
+    if (d < 0)
+        return -1;
+    CALC_TOP(cc, k).reg = d;
+    CALC_TOP(cc, k).type = CVT_FLOAT;
+    return 0;
+}
+
+/*
+ * Do integer arithmetic on constants, where the result may overflow into
+ * a real. At evaluation time the type would depend on the values, so we
+ * don't compile these for non-constant operands.
+ */
+static int
+calc_fold_int(calc_compiler_t *cc, int op)
+{
+    int k = (op == PtCr_abs_int || op == PtCr_neg_int ? 1 : 2);
+    int int1 = cc->regs[CALC_TOP(cc, k - 1).reg].i;
+    int int2 = cc->regs[CALC_TOP(cc, 0).reg].i;
+    calc_value_type_t type = CVT_INT;
+    calc_reg_t v;
+    double prod;
+    int r;
+
+    if (!cc->is_const[CALC_TOP(cc, 0).reg] ||
+        !cc->is_const[CALC_TOP(cc, k - 1).reg])
+        return -1;
+    switch (op) {
+    case PtCr_abs_int:
+        if (int1 >= 0) {
+            v.i = int1;
+            break;
+        }
+        /* fallthrough */
+    case PtCr_neg_int:
+        if (int1 == min_int)
+            v.f = (float)(double)int1, type = CVT_FLOAT;
+        else
+            v.i = -int1;
+        break;
+    case PtCr_add_int:
+        if ((int1 ^ int2) >= 0 && ((int1 + int2) ^ int1) < 0)
+            v.f = (float)((double)int1 + int2), type = CVT_FLOAT;
+        else
+            v.i = int1 + int2;
+        break;
+    case PtCr_sub_int:
+        if ((int1 ^ int2) < 0 && ((int1 - int2) ^ int1) >= 0)
+            v.f = (float)((double)int1 - int2), type = CVT_FLOAT;
+        else
+            v.i = int1 - int2;
+        break;
+    default:			/* PtCr_mul_int */
+        prod = (double)int1 * int2;
+        if (prod < min_int || prod > max_int)
+            v.f = (float)prod, type = CVT_FLOAT;
+        else
+            v.i = (int)prod;
+    }
+    if ((r = calc_const(cc, v)) < 0)
+        return -1;
+    cc->depth -= k - 1;
+    CALC_TOP(cc, 0).reg = r;
+    CALC_TOP(cc, 0).type = type;
+    return 0;
+}
+
+/* Get the value of a constant integer operand of copy, index or roll. */
+static int
+calc_const_int(const calc_compiler_t *cc, int k, int *pi)
+{
+    const calc_slot_t *ps = &CALC_TOP(cc, k);
+
+    if (ps->type != CVT_INT || !cc->is_const[ps->reg])
+        return -1;
+    *pi = cc->regs[ps->reg].i;
+    return 0;
+}
+
+static int calc_compile_ops(calc_compiler_t *cc, const byte **pp,
+                            const byte *end, int nesting);
+
+/*
+ * Compile an if with a condition known only at evaluation time.
+ * p points to the length of the body, the body ends at end.
+ */
+static int
+calc_compile_if(calc_compiler_t *cc, int cond, const byte **pp,
+                const byte *end, int nesting)
+{
+    const byte *p = *pp;
+    const byte *body = p + 2, *bend = body + (p[0] << 8) + p[1], *q = body;
+    calc_slot_t saved[MAX_VSTACK], then_stack[MAX_VSTACK];
+    int saved_depth = cc->depth, jz, jmp, then_start, else_start, else_end;
+    int len2 = 0, i, k, nd, code;
+    bool use_select = true;
+
+    if (bend > end || cc->num_insns >= MAX_CALC_INSNS - 1)
+        return -1;
+    memcpy(saved, cc->stack, saved_depth * sizeof(calc_slot_t));
+    jz = cc->num_insns++;
+    then_start = cc->num_insns;
+    code = calc_compile_ops(cc, &q, bend, nesting + 1);
+    if (code < 0)
+        return code;
+    if (code > 0) {		/* q is at the length of the else body */
+        if (q != bend - 2)
+            return -1;
+        len2 = (q[0] << 8) + q[1];
+        if (bend + len2 > end)
+            return -1;
+    }
+    memcpy(then_stack, cc->stack, cc->depth * sizeof(calc_slot_t));
+    if (cc->num_insns == MAX_CALC_INSNS)
+        return -1;
+    jmp = cc->num_insns++;
+    /* Compile the else body, if any, from the stack before the if. */
+    k = cc->depth;
+    memcpy(cc->stack, saved, saved_depth * sizeof(calc_slot_t));
+    cc->depth = saved_depth;
+    else_start = cc->num_insns;
+    q = bend;
+    code = calc_compile_ops(cc, &q, bend + len2, nesting + 1);
+    if (code != 0)
+        return -1;
+    else_end = cc->num_insns;
+    *pp = bend + len2;
+    /* Both bodies must leave the same types at the same depths. */
+    if (k != cc->depth)
+        return -1;
+    for (i = nd = 0; i < k; ++i) {
+        if (then_stack[i].type != cc->stack[i].type)
+            return -1;
+        nd += (then_stack[i].reg != cc->stack[i].reg);
+    }
+    if ((jmp - then_start) + (else_end - else_start) > MAX_CALC_SELECT)
+        use_select = false;
+    for (i = then_start; i < else_end && use_select; ++i)
+        switch (cc->insns[i].op) {
+        case PtCr_atan: case PtCr_div: case PtCr_idiv: case PtCr_mod:
+            use_select = false;
+        }
+    if (use_select) {
+        /* Drop the jumps, execute both bodies and select the results. */
+        memmove(&cc->insns[jz], &cc->insns[then_start],
+                (jmp - then_start) * sizeof(calc_insn_t));
+        memmove(&cc->insns[jmp - 1], &cc->insns[else_start],
+                (else_end - else_start) * sizeof(calc_insn_t));
+        cc->num_insns -= 2;
+        for (i = 0; i < k; ++i)
+            if (then_stack[i].reg != cc->stack[i].reg) {
+                int d = calc_emit(cc, PtCr_select, cond, then_stack[i].reg,
+                                  cc->stack[i].reg);
+
+                if (d < 0)
+                    return -1;
+                cc->stack[i].reg = d;
+            }
+        return 0;
+    }
+    /* Move the results of each body into common registers. */
+    if (cc->num_insns + 2 * nd > MAX_CALC_INSNS ||
+        cc->num_regs + nd > MAX_CALC_REGS)
+        return -1;
+    memmove(&cc->insns[jmp + nd], &cc->insns[jmp],
+            (cc->num_insns - jmp) * sizeof(calc_insn_t));
+    cc->num_insns += nd;
+    for (i = 0; i < k; ++i)
+        if (then_stack[i].reg != cc->stack[i].reg) {
+            int d = cc->num_regs++;
+            calc_insn_t *ip = &cc->insns[jmp++];
+
+            cc->is_const[d] = 0;
+            ip->op = PtCr_mov, ip->d = d;
+            ip->a = ip->b = ip->c = then_stack[i].reg;
+            ip = &cc->insns[cc->num_insns++];
+            ip->op = PtCr_mov, ip->d = d;
+            ip->a = ip->b = ip->c = cc->stack[i].reg;
+            cc->stack[i].reg = d;
+        }
+    cc->insns[jz].op = PtCr_jump_if_false;
+    cc->insns[jz].d = jmp - jz;
+    cc->insns[jz].a = cc->insns[jz].b = cc->insns[jz].c = cond;
+    cc->insns[jmp].op = PtCr_jump;
+    cc->insns[jmp].d = cc->num_insns - (jmp + 1);
+    cc->insns[jmp].a = cc->insns[jmp].b = cc->insns[jmp].c = 0;
+    return 0;
+}
+
+/*
+ * Compile the ops from *pp up to end. Return 0 at the end, 1 with *pp
+ * at the length of the else body if we reach an else, or -1 if the ops
+ * can't be compiled.
+ */
+static int
+calc_compile_ops(calc_compiler_t *cc, const byte **pp, const byte *end,
+                 int nesting)
+{
+    const byte *p = *pp;
+
+    if (nesting > MAX_PSC_FUNCTION_NESTING)
+        return -1;
+    while (p < end) {
+        int op = *p++, typed, i, n;
+        calc_reg_t v;
+
+        /* Coerce as the interpreter does, then dispatch on the types. */
+        for (;;) {
+            int t0 = (cc->depth > 0 ? CALC_TOP(cc, 0).type : CVT_NONE);
+            int t1 = (cc->depth > 1 ? CALC_TOP(cc, 1).type : CVT_NONE);
+
+            typed = op_defn_table[op].opcode[(t1 << 2) + t0];
+            if (typed == PtCr_int_to_float || typed == PtCr_int2_to_float) {
+                if (calc_int_to_float(cc, 0) < 0)
+                    return -1;
+            }
+            if (typed == PtCr_2nd_int_to_float || typed == PtCr_int2_to_float) {
+                if (calc_int_to_float(cc, 1) < 0)
+                    return -1;
+            }
+            if (typed != PtCr_int_to_float && typed != PtCr_int2_to_float &&
+                typed != PtCr_2nd_int_to_float)
+                break;
+        }
+        switch (typed) {
+        case PtCr_no_op:
+            continue;
+        case PtCr_abs: case PtCr_ceiling: case PtCr_cos: case PtCr_floor:
+        case PtCr_ln: case PtCr_log: case PtCr_neg: case PtCr_round:
+        case PtCr_sin: case PtCr_sqrt: case PtCr_truncate:
+            if (calc_emit_op(cc, typed, 1, CVT_FLOAT) < 0)
+                return -1;
+            continue;
+        case PtCr_cvi:
+            if (calc_emit_op(cc, typed, 1, CVT_INT) < 0)
+                return -1;
+            continue;
+        case PtCr_not:
+            if (calc_emit_op(cc, typed, 1, CALC_TOP(cc, 0).type) < 0)
+                return -1;
+            continue;
+        case PtCr_add: case PtCr_atan: case PtCr_div: case PtCr_exp:
+        case PtCr_mul: case PtCr_sub:
+            if (calc_emit_op(cc, typed, 2, CVT_FLOAT) < 0)
+                return -1;
+            continue;
+        case PtCr_and: case PtCr_or: case PtCr_xor:
+            if (calc_emit_op(cc, typed, 2, CALC_TOP(cc, 1).type) < 0)
+                return -1;
+            continue;
+        case PtCr_bitshift: case PtCr_idiv: case PtCr_mod:
+            if (calc_emit_op(cc, typed, 2, CVT_INT) < 0)
+                return -1;
+            continue;
+        case PtCr_eq: case PtCr_ge: case PtCr_gt:
+        case PtCr_le: case PtCr_lt: case PtCr_ne:
+        case PtCr_eq_int: case PtCr_ge_int: case PtCr_gt_int:
+        case PtCr_le_int: case PtCr_lt_int: case PtCr_ne_int:
+            if (calc_emit_op(cc, typed, 2, CVT_BOOL) < 0)
+                return -1;
+            continue;
+        case PtCr_abs_int: case PtCr_neg_int:
+        case PtCr_add_int: case PtCr_sub_int: case PtCr_mul_int:
+            if (calc_fold_int(cc, typed) < 0)
+                return -1;
+            continue;
+
+            /* Stack operators only move registers. */
+
+        case PtCr_copy:
+            if (calc_const_int(cc, 0, &i) < 0)
+                return -1;
+            n = cc->depth;
+            if (i < 0 || i >= n || i > MAX_VSTACK - (n - 1))
+                return -1;
+            cc->depth--;
+            memcpy(&cc->stack[cc->depth], &cc->stack[cc->depth - i],
+                   i * sizeof(calc_slot_t));
+            cc->depth += i;
+            continue;
+        case PtCr_dup:
+            if (cc->depth == MAX_VSTACK)
+                return -1;
+            cc->stack[cc->depth] = cc->stack[cc->depth - 1];
+            cc->depth++;
+            continue;
+        case PtCr_exch: {
+            calc_slot_t t = CALC_TOP(cc, 0);
+
+            CALC_TOP(cc, 0) = CALC_TOP(cc, 1);
+            CALC_TOP(cc, 1) = t;
+            continue;
+        }
+        case PtCr_index:
+            if (calc_const_int(cc, 0, &i) < 0 || i < 0 || i >= cc->depth - 1)
+                return -1;
+            CALC_TOP(cc, 0) = CALC_TOP(cc, i + 1);
+            continue;
+        case PtCr_pop:
+            cc->depth--;
+            continue;
+        case PtCr_roll: {
+            calc_slot_t rolled[MAX_VSTACK];
+            int j, base;
+
+            if (calc_const_int(cc, 1, &n) < 0 || calc_const_int(cc, 0, &j) < 0 ||
+                n < 0 || n > cc->depth - 2)
+                return -1;
+            cc->depth -= 2;
+            if (n == 0)
+                continue;
+            base = cc->depth - n;
+            j %= n;
+            if (j < 0)
+                j += n;
+            for (i = 0; i < n; ++i)
+                rolled[(i + j) % n] = cc->stack[base + i];
+            memcpy(&cc->stack[base], rolled, n * sizeof(calc_slot_t));
+            continue;
+        }
+
+            /* Constants */
+
+        case PtCr_byte:
+            v.i = *p++;
+            if (calc_push_const(cc, CVT_INT, v) < 0)
+                return -1;
+            continue;
+        case PtCr_int:
+            memcpy(&v.i, p, sizeof(int));
+            p += sizeof(int);
+            if (calc_push_const(cc, CVT_INT, v) < 0)
+                return -1;
+            continue;
+        case PtCr_float:
+            memcpy(&v.f, p, sizeof(float));
+            p += sizeof(float);
+            if (calc_push_const(cc, CVT_FLOAT, v) < 0)
+                return -1;
+            continue;
+        case PtCr_true:
+        case PtCr_false:
+            v.i = (typed == PtCr_true);
+            if (calc_push_const(cc, CVT_BOOL, v) < 0)
+                return -1;
+            continue;
+
+            /* Special */
+
+        case PtCr_if: {
+            int cond = CALC_TOP(cc, 0).reg;
+
+            cc->depth--;
+            if (!cc->is_const[cond]) {
+                if (calc_compile_if(cc, cond, &p, end, nesting) < 0)
+                    return -1;
+                continue;
+            }
+            if (cc->regs[cond].i) {
+                const byte *bend = p + 2 + (p[0] << 8) + p[1], *q = p + 2;
+                int code;
+
+                if (bend > end)
+                    return -1;
+                code = calc_compile_ops(cc, &q, bend, nesting + 1);
+                if (code < 0)
+                    return code;
+                p = bend;
+                if (code > 0) {	/* skip the else body */
+                    if (q != bend - 2)
+                        return -1;
+                    p += (q[0] << 8) + q[1];
+                    if (p > end)
+                        return -1;
+                }
+            } else
+                p += 2 + (p[0] << 8) + p[1];	/* any else body follows */
+            continue;
+        }
+        case PtCr_else:
+            *pp = p;
+            return 1;
+        default:		/* repeat, typecheck, ... */
+            return -1;
+        }
+    }
+    *pp = p;
+    return 0;
+}
+
+/*
+ * Compile the ops of a function. Set *ppcode to NULL if the function
+ * can't be compiled.
+ */
+static int
+calc_compile(const gs_function_PtCr_t *pfn, gs_memory_t *mem,
+             calc_code_t **ppcode)
+{
+    int m = pfn->params.m, n = pfn->params.n;
+    const byte *p = pfn->params.ops.data;
+    calc_compiler_t *cc;
+    calc_code_t *pc = NULL;
+    ushort out[MAX_VSTACK];
+    int i, extra, code;
+
+    *ppcode = NULL;
+    cc = (calc_compiler_t *)gs_alloc_bytes(mem, sizeof(calc_compiler_t),
+                                           "calc_compile");
+    if (cc == NULL)
+        return_error(gs_error_VMerror);
+    memset(cc, 0, sizeof(*cc));
+    for (i = 0; i < m; ++i) {
+        cc->stack[i].reg = i;
+        cc->stack[i].type = CVT_FLOAT;
+    }
+    cc->num_regs = cc->depth = m;
+    code = calc_compile_ops(cc, &p, pfn->params.ops.data + pfn->params.ops.size - 1, 0);
+    /* Following Acrobat, take the outputs from the top of stack. */
+    extra = cc->depth - n;
+    if (code != 0 || extra < 0)
+        goto out;
+    for (i = 0; i < n; ++i) {
+        calc_slot_t *ps = &cc->stack[extra + i];
+
+        if (ps->type == CVT_INT) {
+            code = calc_emit(cc, PtCr_int_to_float, ps->reg, ps->reg, ps->reg);
+            if (code < 0)
+                goto out;
+            ps->reg = code;
+        } else if (ps->type != CVT_FLOAT)
+            goto out;
+        out[i] = ps->reg;
+    }
+    pc = (calc_code_t *)gs_alloc_bytes(mem, sizeof(calc_code_t) +
+                                       cc->num_regs * sizeof(calc_reg_t) +
+                                       cc->num_insns * sizeof(calc_insn_t) +
+                                       n * sizeof(ushort), "calc_compile");
+    if (pc == NULL) {
+        gs_free_object(mem, cc, "calc_compile");
+        return_error(gs_error_VMerror);
+    }
+    pc->num_regs = cc->num_regs;
+    pc->num_insns = cc->num_insns;
+    pc->num_out = n;
+    memcpy(calc_code_regs(pc), cc->regs, cc->num_regs * sizeof(calc_reg_t));
+    memcpy(calc_code_insns(pc), cc->insns, cc->num_insns * sizeof(calc_insn_t));
+    memcpy(calc_code_out(pc), out, n * sizeof(ushort));
+    *ppcode = pc;
+ out:
+    gs_free_object(mem, cc, "calc_compile");
+    return 0;
+}
+
+/* Evaluate a PostScript Calculator function. */
+static int
+fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
+{
+    const gs_function_PtCr_t *pfn = (const gs_function_PtCr_t *)pfn_common;
+    calc_value_t vstack_buf[2 + MAX_VSTACK + 1];
+    calc_value_t *vstack = &vstack_buf[1];
+    calc_value_t *vsp = vstack + pfn->params.m;
+    const byte *p = pfn->params.ops.data;
+    int repeat_count[MAX_PSC_FUNCTION_NESTING];
+    int repeat_proc_size[MAX_PSC_FUNCTION_NESTING];
+    int repeat_nesting_level = -1;
+    int i;
+
+    if (pfn->code != NULL)
+        return calc_evaluate(pfn->code, pfn->params.m, pfn->params.n, in, out, 1);
 
     memset(repeat_count, 0x00, MAX_PSC_FUNCTION_NESTING * sizeof(int));
     memset(repeat_proc_size, 0x00, MAX_PSC_FUNCTION_NESTING * sizeof(int));
@@ -341,7 +1123,10 @@ fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
         case PtCr_mod:
             if (vsp->value.i == 0)
                 return_error(gs_error_undefinedresult);
-            vsp[-1].value.i %= vsp->value.i;
+            if (vsp->value.i == -1)  /* min_int % -1 traps */
+                vsp[-1].value.i = 0;
+            else
+                vsp[-1].value.i %= vsp->value.i;
             --vsp; continue;
         case PtCr_mul_int: {
             /* We don't bother to optimize this. */
@@ -578,6 +1363,18 @@ fn_PtCr_evaluate(const gs_function_t *pfn_common, const float *in, float *out)
     return 0;
 }
 
+/* Evaluate a PostScript Calculator function at several points. */
+static int
+fn_PtCr_evaluate_multiple(const gs_function_t *pfn_common, const float *in,
+                          float *out, int count)
+{
+    const gs_function_PtCr_t *pfn = (const gs_function_PtCr_t *)pfn_common;
+
+    if (pfn->code != NULL)
+        return calc_evaluate(pfn->code, pfn->params.m, pfn->params.n, in, out, count);
+    return fn_common_evaluate_multiple(pfn_common, in, out, count);
+}
+
 /* Test whether a PostScript Calculator function is monotonic. */
 static int
 fn_PtCr_is_monotonic(const gs_function_t * pfn_common,
@@ -760,6 +1557,7 @@ fn_PtCr_make_scaled(const gs_function_PtCr_t *pfn, gs_function_PtCr_t **ppsfn,
     psfn->params.ops.data = ops;
     psfn->params.ops.size = opsize;
     psfn->data_source = pfn->data_source;
+    psfn->code = NULL;
     code = fn_common_scale((gs_function_t *)psfn, (const gs_function_t *)pfn,
                            pranges, mem);
     if (code < 0) {
@@ -794,10 +1592,26 @@ fn_PtCr_make_scaled(const gs_function_PtCr_t *pfn, gs_function_PtCr_t **ppsfn,
     psfn->params.ops.data =
         gs_resize_string(mem, ops, opsize, psfn->params.ops.size,
                          "fn_PtCr_make_scaled");
+    code = calc_compile(psfn, mem, &psfn->code);
+    if (code < 0) {
+        gs_function_free((gs_function_t *)psfn, true, mem);
+        return code;
+    }
     *ppsfn = psfn;
     return 0;
 }
 
+/* Free a PostScript Calculator function. */
+static void
+fn_PtCr_free(gs_function_t * pfn_common, bool free_params, gs_memory_t * mem)
+{
+    gs_function_PtCr_t *pfn = (gs_function_PtCr_t *)pfn_common;
+
+    gs_free_object(mem, pfn->code, "fn_PtCr_free");
+    pfn->code = NULL;
+    fn_common_free(pfn_common, free_params, mem);
+}
+
 /* Free the parameters of a PostScript Calculator function. */
 void
 gs_function_PtCr_free_params(gs_function_PtCr_params_t * params, gs_memory_t * mem)
@@ -838,8 +1652,9 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
             fn_common_get_params,
             (fn_make_scaled_proc_t) fn_PtCr_make_scaled,
             (fn_free_params_proc_t) gs_function_PtCr_free_params,
-            fn_common_free,
+            fn_PtCr_free,
             (fn_serialize_proc_t) gs_function_PtCr_serialize,
+            fn_PtCr_evaluate_multiple,
         }
     };
     int code;
@@ -888,6 +1703,7 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
         if (pfn == 0)
             return_error(gs_error_VMerror);
         pfn->params = *params;
+        pfn->code = NULL;
         /*
          * We claim to have a DataSource, in order to write the function
          * definition in symbolic form for embedding in PDF files.
@@ -896,6 +1712,11 @@ gs_function_PtCr_init(gs_function_t ** ppfn,
         data_source_init_string2(&pfn->data_source, NULL, 0);
         pfn->data_source.access = calc_access;
         pfn->head = function_PtCr_head;
+        code = calc_compile(pfn, mem, &pfn->code);
+        if (code < 0) {
+            gs_free_object(mem, pfn, "gs_function_PtCr_init");
+            return code;
+        }
         *ppfn = (gs_function_t *) pfn;
     }
     return 0;
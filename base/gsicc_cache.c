@@ -36,6 +36,7 @@
 #include "gzstate.h"
 #include "stdint_.h"
 #include "assert_.h"
+#include "gp.h"
         /*
          *  Note that the the external memory used to maintain
          *  links in the CMS is generally not visible to GS.
@@ -69,6 +70,36 @@ static void gsicc_get_buff_hash(unsigned char *data, int64_t *hash, unsigned int
 
 static void rc_gsicc_link_cache_free(gs_memory_t * mem, void *ptr_in, client_name_t cname);
 
+/* Links may also be kept on disc, in the directory given by the
+   ICCLinkCacheDir user parameter, so that later runs (including other
+   processes) that use the same profiles need not go through the CMS to
+   build them again.  Each link is stored as a device link profile in its
+   own file.  The file starts with the key below, which is also what the
+   file name is made from, so a hash collision is detected on reading. */
+#define ICC_DISKCACHE_VERSION 1
+
+typedef struct gsicc_diskcache_key_s {
+    char magic[8];
+    int version;
+    int cms_flags;
+    int accuracy;
+    int graytok;
+    int64_t src_hash;
+    int64_t des_hash;
+    int64_t rend_hash;
+    int64_t proof_hash;
+    int64_t devlink_hash;
+} gsicc_diskcache_key_t;
+
+static gcmmhlink_t gsicc_diskcache_get_link(gs_memory_t *memory,
+                                            const gsicc_diskcache_key_t *key,
+                                            int cms_flags);
+
+static gcmmhlink_t gsicc_diskcache_put_link(gs_memory_t *memory,
+                                            const gsicc_diskcache_key_t *key,
+                                            gcmmhlink_t link_handle,
+                                            int cms_flags);
+
 /* Structure pointer information */
 
 struct_proc_finalize(icc_link_finalize);
@@ -959,6 +990,149 @@ gsicc_alloc_link_entry(gsicc_link_cache_t *icc_link_cache,
     return false;	/* we didn't find it, but return a link to be filled */
 }
 
+/* Make the name of the disc cache file for a key.  Returns false if
+   there is no disc cache or the name will not fit. */
+static bool
+gsicc_diskcache_name(gs_memory_t *memory, const gsicc_diskcache_key_t *key,
+                     char fname[gp_file_name_sizeof])
+{
+    const gs_lib_ctx_t *lib_ctx = memory->gs_lib_ctx;
+    const char *sep = gp_file_name_directory_separator();
+    int64_t hash;
+    int len = lib_ctx->icclinkcachedir_len;
+
+    if (lib_ctx->icclinkcachedir == NULL || len == 0)
+        return false;
+    /* Room for separator, "gsicc_", 16 hex digits, ".icl" and null */
+    if (len + strlen(sep) + 27 > gp_file_name_sizeof)
+        return false;
+    gsicc_get_buff_hash((unsigned char *)key, &hash, sizeof(*key));
+    memcpy(fname, lib_ctx->icclinkcachedir, len);
+    fname[len] = 0;
+    if (strncmp(fname + len - strlen(sep), sep, strlen(sep)) != 0)
+        strcat(fname, sep);
+    gs_snprintf(fname + strlen(fname), gp_file_name_sizeof - strlen(fname),
+                "gsicc_%08x%08x.icl", (unsigned int)((uint64_t)hash >> 32),
+                (unsigned int)(hash & 0xffffffff));
+    return true;
+}
+
+/* Make a link from the device link profile data kept in the disc cache. */
+static gcmmhlink_t
+gsicc_diskcache_make_link(gs_memory_t *memory, unsigned char *buffer,
+                          unsigned int size, int cms_flags)
+{
+    gsicc_rendering_param_t rendering_params;
+    gcmmhprofile_t devlink;
+    gcmmhlink_t link_handle;
+
+    devlink = gscms_get_profile_handle_mem(buffer, size, memory);
+    if (devlink == NULL)
+        return NULL;
+    /* The intent, black point and black preservation are already in the
+       device link, so the link from it must not apply them again. */
+    memset(&rendering_params, 0, sizeof(rendering_params));
+    rendering_params.rendering_intent = gsPERCEPTUAL;
+    rendering_params.black_point_comp = gsBLACKPTCOMP_OFF;
+    rendering_params.preserve_black = gsBLACKPRESERVE_OFF;
+    link_handle = gscms_get_link(devlink, NULL, &rendering_params, cms_flags,
+                                 memory);
+    gscms_release_profile(devlink, memory);
+    return link_handle;
+}
+
+/* Try to get a link from the disc cache.  Any problem just means that
+   we have to build the link as usual, so there is no error return. */
+static gcmmhlink_t
+gsicc_diskcache_get_link(gs_memory_t *memory, const gsicc_diskcache_key_t *key,
+                         int cms_flags)
+{
+    char fname[gp_file_name_sizeof];
+    gsicc_diskcache_key_t file_key;
+    gcmmhlink_t link_handle;
+    unsigned char *buffer;
+    unsigned int size;
+    gp_file *fid;
+
+    if (!gsicc_diskcache_name(memory, key, fname))
+        return NULL;
+    fid = gp_fopen(memory, fname, "rb");
+    if (fid == NULL)
+        return NULL;
+    if (gp_fread(&file_key, 1, sizeof(file_key), fid) != sizeof(file_key) ||
+        memcmp(&file_key, key, sizeof(file_key)) != 0 ||
+        gp_fread(&size, 1, sizeof(size), fid) != sizeof(size) ||
+        size == 0 || size > max_int) {
+        gp_fclose(fid);
+        return NULL;
+    }
+    buffer = gs_alloc_bytes(memory, size, "gsicc_diskcache_get_link");
+    if (buffer == NULL) {
+        gp_fclose(fid);
+        return NULL;
+    }
+    if (gp_fread(buffer, 1, size, fid) != size) {
+        gp_fclose(fid);
+        gs_free_object(memory, buffer, "gsicc_diskcache_get_link");
+        return NULL;
+    }
+    gp_fclose(fid);
+    link_handle = gsicc_diskcache_make_link(memory, buffer, size, cms_flags);
+    gs_free_object(memory, buffer, "gsicc_diskcache_get_link");
+    if_debug2m(gs_debug_flag_icc, memory, "[icc] Disc cache %s %s\n",
+               link_handle == NULL ? "failed" : "hit", fname);
+    return link_handle;
+}
+
+/* Store a link in the disc cache.  The link is written to a scratch file
+   which is then renamed, so that another process never sees a part
+   written file.  The device link only samples the original link, so this
+   returns a link made from the stored data, which the caller uses in place
+   of the original so that colours don't depend on whether the link was
+   found in the cache.  Returns NULL, and stores nothing, if no link can be
+   made from the device link. */
+static gcmmhlink_t
+gsicc_diskcache_put_link(gs_memory_t *memory, const gsicc_diskcache_key_t *key,
+                         gcmmhlink_t link_handle, int cms_flags)
+{
+    char fname[gp_file_name_sizeof];
+    char prefix[gp_file_name_sizeof];
+    char tmpname[gp_file_name_sizeof];
+    unsigned char *buffer;
+    unsigned int size;
+    gp_file *fid;
+    gcmmhlink_t cached_link;
+    bool ok;
+
+    if (!gsicc_diskcache_name(memory, key, fname))
+        return NULL;
+    if (gscms_get_link_data(link_handle, &buffer, &size, memory) < 0)
+        return NULL;
+    cached_link = gsicc_diskcache_make_link(memory, buffer, size, cms_flags);
+    if (cached_link == NULL) {
+        gs_free_object(memory->non_gc_memory, buffer, "gsicc_diskcache_put_link");
+        return NULL;
+    }
+    /* Scratch file in the cache directory (i.e. the name up to and
+       including "gsicc_"), so the rename is atomic */
+    memcpy(prefix, fname, strlen(fname) - 20);
+    prefix[strlen(fname) - 20] = 0;
+    fid = gp_open_scratch_file(memory, prefix, tmpname, "wb");
+    if (fid != NULL) {
+        ok = gp_fwrite(key, 1, sizeof(*key), fid) == sizeof(*key) &&
+             gp_fwrite(&size, 1, sizeof(size), fid) == sizeof(size) &&
+             gp_fwrite(buffer, 1, size, fid) == size;
+        gp_fclose(fid);
+        if (!ok || gp_rename(memory, tmpname, fname) != 0)
+            gp_unlink(memory, tmpname);
+        else
+            if_debug1m(gs_debug_flag_icc, memory, "[icc] Disc cache stored %s\n",
+                       fname);
+    }
+    gs_free_object(memory->non_gc_memory, buffer, "gsicc_diskcache_put_link");
+    return cached_link;
+}
+
 /* This is the main function called to obtain a linked transform from the ICC
    cache If the cache has the link ready, it will return it.  If not, it will
    request one from the CMS and then return it.  We may need to do some cache
@@ -992,6 +1166,10 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
     bool src_dev_link = gs_input_profile->isdevlink;
     bool pageneutralcolor = false;
     int cms_flags = 0;
+    bool graytok = false;
+    bool use_diskcache;
+    gsicc_diskcache_key_t disk_key;
+    gcmmhlink_t cached_link;
 
     /* Determine if we are using a soft proof or device link profile */
     if (dev != NULL ) {
@@ -1245,16 +1423,44 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
         /* Turn off bp compensation in this case as there is a bug in lcms */
         rendering_params->black_point_comp = false;
         cms_flags = 0;  /* Turn off any flag setting */
+        graytok = true;
+    }
+    /* See if an earlier run left this link in the disc cache.  The key
+       must be made before the CMS gets the rendering params, as it may
+       change the intent */
+    use_diskcache = memory->gs_lib_ctx->icclinkcachedir != NULL;
+    if (use_diskcache) {
+        memset(&disk_key, 0, sizeof(disk_key));
+        memcpy(disk_key.magic, "GSICCLNK", 8);
+        disk_key.version = ICC_DISKCACHE_VERSION;
+        disk_key.cms_flags = cms_flags;
+        disk_key.accuracy = memory->gs_lib_ctx->icc_color_accuracy;
+        disk_key.graytok = graytok;
+        disk_key.src_hash = hash.src_hash;
+        disk_key.des_hash = src_dev_link ? 0 : hash.des_hash;
+        disk_key.rend_hash = ((rendering_params->black_point_comp) << BP_SHIFT) +
+                             ((rendering_params->rendering_intent) << REND_SHIFT) +
+                             ((rendering_params->preserve_black) << PRESERVE_SHIFT);
+        if (include_softproof)
+            disk_key.proof_hash = gsicc_get_hash(proof_profile);
+        if (include_devicelink)
+            disk_key.devlink_hash = gsicc_get_hash(devlink_profile);
+        link_handle = gsicc_diskcache_get_link(cache_mem->non_gc_memory,
+                                               &disk_key, cms_flags);
+        /* Already have it, so no need to store it again */
+        if (link_handle != NULL)
+            use_diskcache = false;
     }
     /* Get the link with the proof and or device link profile */
     if (include_softproof || include_devicelink || src_dev_link) {
-        link_handle = gscms_get_link_proof_devlink(cms_input_profile,
-                                                   cms_proof_profile,
-                                                   cms_output_profile,
-                                                   cms_devlink_profile,
-                                                   rendering_params,
-                                                   src_dev_link, cms_flags,
-                                                   cache_mem->non_gc_memory);
+        if (link_handle == NULL)
+            link_handle = gscms_get_link_proof_devlink(cms_input_profile,
+                                                       cms_proof_profile,
+                                                       cms_output_profile,
+                                                       cms_devlink_profile,
+                                                       rendering_params,
+                                                       src_dev_link, cms_flags,
+                                                       cache_mem->non_gc_memory);
     if (!gscms_is_threadsafe()) {
         if (include_softproof) {
             gx_monitor_leave(proof_profile->lock);
@@ -1263,11 +1469,25 @@ gsicc_get_link_profile(const gs_gstate *pgs, gx_device *dev,
             gx_monitor_leave(devlink_profile->lock);
         }
     }
-    } else {
+    } else if (link_handle == NULL) {
         link_handle = gscms_get_link(cms_input_profile, cms_output_profile,
                                      rendering_params, cms_flags,
                                      cache_mem->non_gc_memory);
     }
+    if (link_handle != NULL && use_diskcache) {
+        cached_link = gsicc_diskcache_put_link(cache_mem->non_gc_memory,
+                                               &disk_key, link_handle,
+                                               cms_flags);
+        if (cached_link != NULL) {
+            /* Render with the link from the disc cache, as later runs will */
+            gsicc_link_t old_link;
+
+            old_link.memory = cache_mem;
+            old_link.link_handle = link_handle;
+            gscms_release_link(&old_link);
+            link_handle = cached_link;
+        }
+    }
     if (!gscms_is_threadsafe()) {
         if (!src_dev_link) {
             gx_monitor_leave(gs_output_profile->lock);
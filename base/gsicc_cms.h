@@ -80,6 +80,8 @@ void *gscms_create(gs_memory_t *memory);
 void gscms_destroy(void *);
 void gscms_release_link(gsicc_link_t *icclink);
 void gscms_release_profile(void *profile, gs_memory_t *memory);
+int gscms_get_link_data(gcmmhlink_t link, unsigned char **buffer,
+                        unsigned int *size, gs_memory_t *memory);
 int gscms_transform_named_color(gsicc_link_t *icclink,  float tint_value,
                                 const char* ColorName,
                                 gx_color_value device_values[]);
@@ -939,6 +939,48 @@ gscms_release_profile(void *profile, gs_memory_t *memory)
     cmsCloseProfile(ctx, profile_handle);
 }
 
+/* Save a link as device link profile data, so that it can be stored and
+   reloaded later with gscms_get_profile_handle_mem and gscms_get_link,
+   without having to go through the profiles again.  The buffer is
+   allocated in non-gc memory and is owned by the caller. */
+int
+gscms_get_link_data(gcmmhlink_t link, unsigned char **buffer,
+                    unsigned int *size, gs_memory_t *memory)
+{
+    cmsContext ctx = gs_lib_ctx_get_cms_context(memory);
+    gsicc_lcms2mt_link_list_t *link_handle = (gsicc_lcms2mt_link_list_t *)(link);
+    cmsHPROFILE devlink;
+    cmsUInt32Number bytes;
+    unsigned char *data;
+
+    *buffer = NULL;
+    *size = 0;
+    if (link_handle == NULL || link_handle->hTransform == NULL)
+        return_error(gs_error_undefined);
+    devlink = cmsTransform2DeviceLink(ctx, link_handle->hTransform, 4.3,
+                                      gscms_get_accuracy(memory));
+    if (devlink == NULL)
+        return_error(gs_error_unknownerror);
+    if (!cmsSaveProfileToMem(ctx, devlink, NULL, &bytes)) {
+        cmsCloseProfile(ctx, devlink);
+        return_error(gs_error_unknownerror);
+    }
+    data = gs_alloc_bytes(memory->non_gc_memory, bytes, "gscms_get_link_data");
+    if (data == NULL) {
+        cmsCloseProfile(ctx, devlink);
+        return_error(gs_error_VMerror);
+    }
+    if (!cmsSaveProfileToMem(ctx, devlink, data, &bytes)) {
+        cmsCloseProfile(ctx, devlink);
+        gs_free_object(memory->non_gc_memory, data, "gscms_get_link_data");
+        return_error(gs_error_unknownerror);
+    }
+    cmsCloseProfile(ctx, devlink);
+    *buffer = data;
+    *size = bytes;
+    return 0;
+}
+
 /* Named color, color management */
 /* Get a device value for the named color.  Since there exist named color
    ICC profiles and littleCMS supports them, we will use
@@ -1486,6 +1486,7 @@ gsicc_new_device_profile_array(gx_device *dev)
     result->blackthresholdL = 90.0F;
     result->blackthresholdC = 0.0F;
     result->prebandthreshold = true;
+    result->tinttablesize = 0;   /* Default is to evaluate tint transforms exactly */
     result->supports_devn = false;
     result->overprint_control = gs_overprint_control_enable;  /* Default overprint if the device can */
     rc_init_free(result, memory->non_gc_memory, 1, rc_free_profile_array);
@@ -3100,6 +3101,31 @@ gs_seticcdirectory(const gs_gstate * pgs, gs_param_string * pval)
     return 0;
 }
 
+void
+gs_currenticclinkcachedir(const gs_gstate * pgs, gs_param_string * pval)
+{
+    const gs_lib_ctx_t *lib_ctx = pgs->memory->gs_lib_ctx;
+
+    if (lib_ctx->icclinkcachedir == NULL) {
+        pval->data = (const byte *)"";
+        pval->size = 0;
+        pval->persistent = true;
+    } else {
+        pval->data = (const byte *)(lib_ctx->icclinkcachedir);
+        pval->size = lib_ctx->icclinkcachedir_len;
+        pval->persistent = false;
+    }
+}
+
+int
+gs_seticclinkcachedir(const gs_gstate * pgs, gs_param_string * pval)
+{
+    if (gs_lib_ctx_set_icc_link_cache_dir(pgs->memory, (const char *)pval->data,
+                                          pval->size) < 0)
+        return gs_rethrow(gs_error_VMerror, "cannot allocate directory name");
+    return 0;
+}
+
 void
 gs_currentsrcgtagicc(const gs_gstate * pgs, gs_param_string * pval)
 {
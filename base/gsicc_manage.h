@@ -148,6 +148,8 @@ void gs_currentdefaultgrayicc(const gs_gstate * pgs, gs_param_string * pval);
 int gs_setdefaultgrayicc(const gs_gstate * pgs, gs_param_string * pval);
 void gs_currenticcdirectory(const gs_gstate * pgs, gs_param_string * pval);
 int gs_seticcdirectory(const gs_gstate * pgs, gs_param_string * pval);
+void gs_currenticclinkcachedir(const gs_gstate * pgs, gs_param_string * pval);
+int gs_seticclinkcachedir(const gs_gstate * pgs, gs_param_string * pval);
 void gs_currentsrcgtagicc(const gs_gstate * pgs, gs_param_string * pval);
 int gs_setsrcgtagicc(const gs_gstate * pgs, gs_param_string * pval);
 void gs_currentdefaultrgbicc(const gs_gstate * pgs, gs_param_string * pval);
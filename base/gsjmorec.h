@@ -34,7 +34,11 @@
  */
 
 #undef BLOCK_SMOOTHING_SUPPORTED
-#undef IDCT_SCALING_SUPPORTED
+/* IDCT_SCALING_SUPPORTED is left on, so that the DCTDecode filter can
+ * decode images at 1/2, 1/4 or 1/8 of their size (ScaleDenom). Note that
+ * libjpeg then also uses scaled IDCTs, rather than the upsampler, to
+ * expand subsampled chroma in full size decodes.
+ */
 #undef UPSAMPLE_SCALING_SUPPORTED
 #undef UPSAMPLE_MERGING_SUPPORTED
 #undef QUANT_1PASS_SUPPORTED
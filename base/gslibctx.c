@@ -70,6 +70,7 @@ gs_lib_ctx_get_real_stdio(FILE **in, FILE **out, FILE **err)
 }
 
 #include "gslibctx.h"
+#include "gxperf.h"
 #include "gsmemory.h"
 
 /*  This sets the directory to prepend to the ICC profile names specified for
@@ -109,6 +110,36 @@ gs_lib_ctx_set_icc_directory(const gs_memory_t *mem_gc, const char* pname,
     return 0;
 }
 
+/*  This sets the directory in which ICC links are stored so that they can
+    be shared between runs.  An empty name turns the disc cache off. */
+int
+gs_lib_ctx_set_icc_link_cache_dir(const gs_memory_t *mem_gc, const char* pname,
+                                  int dir_namelen)
+{
+    char *result = NULL;
+    gs_lib_ctx_t *p_ctx = mem_gc->gs_lib_ctx;
+    gs_memory_t *p_ctx_mem = p_ctx->memory;
+
+    if (p_ctx->icclinkcachedir != NULL &&
+        p_ctx->icclinkcachedir_len == dir_namelen &&
+        strncmp(pname, p_ctx->icclinkcachedir, dir_namelen) == 0)
+        return 0;
+    if (dir_namelen > 0) {
+        /* User param string.  Must allocate in non-gc memory */
+        result = (char*) gs_alloc_bytes(p_ctx_mem, dir_namelen+1,
+                                         "gs_lib_ctx_set_icc_link_cache_dir");
+        if (result == NULL)
+            return gs_error_VMerror;
+        memcpy(result, pname, dir_namelen);
+        result[dir_namelen] = 0;
+    }
+    gs_free_object(p_ctx_mem, p_ctx->icclinkcachedir,
+                   "gs_lib_ctx_set_icc_link_cache_dir");
+    p_ctx->icclinkcachedir = result;
+    p_ctx->icclinkcachedir_len = result == NULL ? 0 : dir_namelen;
+    return 0;
+}
+
 /* Sets/Gets the string containing the list of default devices we should try */
 int
 gs_lib_ctx_set_default_device_list(const gs_memory_t *mem, const char* dev_list_str,
@@ -363,6 +394,8 @@ core_create_failed:
     /* Initialize our default ICCProfilesDir */
     pio->profiledir = NULL;
     pio->profiledir_len = 0;
+    pio->icclinkcachedir = NULL;
+    pio->icclinkcachedir_len = 0;
     pio->icc_color_accuracy = MAX_COLOR_ACCURACY;
     if (gs_lib_ctx_set_icc_directory(mem, DEFAULT_DIR_ICC, strlen(DEFAULT_DIR_ICC)) < 0)
       goto Failure;
@@ -422,8 +455,11 @@ void gs_lib_ctx_fin(gs_memory_t *mem)
     ctx_mem = ctx->memory;
 
     sjpxd_destroy(mem);
+    gx_perf_log_finit(mem);
     gs_free_object(ctx_mem, ctx->profiledir,
         "gs_lib_ctx_fin");
+    gs_free_object(ctx_mem, ctx->icclinkcachedir,
+        "gs_lib_ctx_fin");
 
     gs_free_object(ctx_mem, ctx->default_device_list,
                 "gs_lib_ctx_fin");
@@ -194,10 +194,15 @@ typedef struct gs_lib_ctx_s
      * and one in the device */
     char *profiledir;               /* Directory used in searching for ICC profiles */
     int profiledir_len;             /* length of directory name (allows for Unicode) */
+    /* Optional directory in which ICC links are kept between runs (see
+     * gsicc_cache.c). NULL if links are not to be stored on disc. */
+    char *icclinkcachedir;
+    int icclinkcachedir_len;
     gs_fapi_server **fapi_servers;
     char *default_device_list;
     int gcsignal;
     void *sjpxd_private; /* optional for use of jpx codec */
+    struct gx_perf_s *perf; /* per-page performance log, NULL if off (see gxperf.c) */
 } gs_lib_ctx_t;
 
 enum {
@@ -233,6 +238,8 @@ int gs_lib_ctx_nts_adjust(gs_memory_t *mem, int adjust);
 
 int gs_lib_ctx_set_icc_directory(const gs_memory_t *mem_gc, const char* pname,
                                  int dir_namelen);
+int gs_lib_ctx_set_icc_link_cache_dir(const gs_memory_t *mem_gc, const char* pname,
+                                      int dir_namelen);
 
 
 /* Sets/Gets the string containing the list of device names we should search
@@ -1716,6 +1716,21 @@ gx_pattern_cache_lookup(gx_device_color * pdevc, const gs_gstate * pgs,
             int px = pgs->screen_phase[select].x;
             int py = pgs->screen_phase[select].y;
 
+            if (ctile->is_retained) {
+                /* First use of a tile kept from an earlier page. The
+                   instance id doesn't capture the position of the pattern,
+                   so check that it will be placed as it was before. */
+                const gs_pattern1_instance_t *pinst =
+                    (const gs_pattern1_instance_t *)pdevc->ccolor.pattern;
+
+                if (pinst == NULL || ctile->depth != dev->color_info.depth ||
+                    memcmp(&ctile->step_matrix, &pinst->step_matrix,
+                           sizeof(ctile->step_matrix)) != 0)
+                    return false;
+                ctile->is_retained = false;
+                pcache->reused++;
+            }
+            pcache->hits++;
             if (gx_dc_is_pattern1_color(pdevc)) {       /* colored */
                 pdevc->colors.pattern.p_tile = ctile;
 #           if 0 /* Debugged with Bug688308.ps and applying patterns after clist.
@@ -57,8 +57,11 @@ typedef struct gx_band_page_info_s {
     int64_t bfile_end_pos;		/* ftell at end of bfile */
     gx_band_params_t band_params;  /* parameters used when writing band list */
                                 /* (actual values, no 0s) */
+    int compress_method;	/* clist_compress_method_t for cfile and bfile */
+    bool compress_report;	/* report compression of each page */
 } gx_band_page_info_t;
 #define PAGE_INFO_NULL_VALUES\
-  { 0 }, 0, { 0 }, NULL, 0, 0, 0, 0, { BAND_PARAMS_INITIAL_VALUES }
+  { 0 }, 0, { 0 }, NULL, 0, 0, 0, 0, { BAND_PARAMS_INITIAL_VALUES },\
+  clist_compress_default, false
 
 #endif /* ndef gxband_INCLUDED */
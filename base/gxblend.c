@@ -29,6 +29,9 @@
 #ifdef WITH_CAL
 #include "cal.h"
 #endif
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 typedef int art_s32;
 
@@ -1571,6 +1574,223 @@ art_blend_pixel_16(uint16_t *gs_restrict dst, const uint16_t *gs_restrict backdr
                               pblend_procs, p14dev);
 }
 
+bool
+art_blend_span_valid(gs_blend_mode_t blend_mode)
+{
+    switch (blend_mode) {
+        case BLEND_MODE_Multiply:
+        case BLEND_MODE_Screen:
+        case BLEND_MODE_Overlay:
+        case BLEND_MODE_SoftLight:
+        case BLEND_MODE_HardLight:
+        case BLEND_MODE_ColorDodge:
+        case BLEND_MODE_ColorBurn:
+        case BLEND_MODE_Darken:
+        case BLEND_MODE_Lighten:
+        case BLEND_MODE_Difference:
+        case BLEND_MODE_Exclusion:
+            return true;
+        default:
+            return false;
+    }
+}
+
+#ifdef HAVE_SSE2
+/* The SSE2 versions below do 16 (or 8) values at a time with exactly the
+ * arithmetic of art_blend_pixel_8_inline (art_blend_pixel_16_inline), and
+ * return the number of values done; the caller does the rest. Modes that
+ * need a table lookup or a division per value are left to the scalar code.
+ */
+
+/* ((t = x + 0x80) + (t >> 8)) >> 8, for x <= 0xfe01 in 16 bit lanes */
+static inline __m128i
+art_blend_div255_sse2(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(0x80));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/* 8 values of the blend, in 16 bit lanes */
+static inline __m128i
+art_blend_8_sse2(__m128i b, __m128i s, gs_blend_mode_t blend_mode)
+{
+    const __m128i ff = _mm_set1_epi16(0xff);
+    __m128i t, u, sel;
+
+    switch (blend_mode) {
+        case BLEND_MODE_Multiply:
+            return art_blend_div255_sse2(_mm_mullo_epi16(b, s));
+        case BLEND_MODE_Screen:
+            t = _mm_mullo_epi16(_mm_sub_epi16(ff, b), _mm_sub_epi16(ff, s));
+            return _mm_sub_epi16(ff, art_blend_div255_sse2(t));
+        case BLEND_MODE_Overlay:
+        case BLEND_MODE_HardLight:
+            /* 2.b.s where the selector is < 0x80, else 0xfe01 - 2.(0xff-b).(0xff-s) */
+            sel = _mm_cmplt_epi16(blend_mode == BLEND_MODE_Overlay ? b : s,
+                                  _mm_set1_epi16(0x80));
+            t = _mm_slli_epi16(_mm_mullo_epi16(b, s), 1);
+            u = _mm_slli_epi16(_mm_mullo_epi16(_mm_sub_epi16(ff, b), _mm_sub_epi16(ff, s)), 1);
+            u = _mm_sub_epi16(_mm_set1_epi16((short)0xfe01), u);
+            t = _mm_or_si128(_mm_and_si128(sel, t), _mm_andnot_si128(sel, u));
+            return art_blend_div255_sse2(t);
+        case BLEND_MODE_Exclusion:
+        default:
+            /* (0xff-b).s + b.(0xff-s) never exceeds 0xfe01 */
+            t = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(ff, b), s),
+                              _mm_mullo_epi16(b, _mm_sub_epi16(ff, s)));
+            return art_blend_div255_sse2(t);
+    }
+}
+
+static int
+art_blend_span_8_sse2(byte *gs_restrict dst, const byte *gs_restrict backdrop,
+                      const byte *gs_restrict src, int n, gs_blend_mode_t blend_mode)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i;
+
+    switch (blend_mode) {
+        case BLEND_MODE_Multiply:
+        case BLEND_MODE_Screen:
+        case BLEND_MODE_Overlay:
+        case BLEND_MODE_HardLight:
+        case BLEND_MODE_Exclusion:
+        case BLEND_MODE_Darken:
+        case BLEND_MODE_Lighten:
+        case BLEND_MODE_Difference:
+            break;
+        default:
+            return 0;
+    }
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *)(backdrop + i));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i r;
+
+        switch (blend_mode) {
+            case BLEND_MODE_Darken:
+                r = _mm_min_epu8(b, s);
+                break;
+            case BLEND_MODE_Lighten:
+                r = _mm_max_epu8(b, s);
+                break;
+            case BLEND_MODE_Difference:
+                r = _mm_or_si128(_mm_subs_epu8(b, s), _mm_subs_epu8(s, b));
+                break;
+            default:
+                r = _mm_packus_epi16(
+                        art_blend_8_sse2(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(s, zero), blend_mode),
+                        art_blend_8_sse2(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(s, zero), blend_mode));
+                break;
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), r);
+    }
+    return i;
+}
+
+/* (x * s + (extra ? s : 0) + 0x8000) >> 16 for 8 unsigned 16 bit lanes, */
+/* where extra is a lane mask. The result always fits in 16 bits.        */
+static inline __m128i
+art_blend_mul16_sse2(__m128i x, __m128i s, __m128i extra)
+{
+    const __m128i half = _mm_set1_epi32(0x8000);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_mullo_epi16(x, s);
+    __m128i hi = _mm_mulhi_epu16(x, s);
+    __m128i add = _mm_and_si128(extra, s);
+    __m128i p0 = _mm_unpacklo_epi16(lo, hi);
+    __m128i p1 = _mm_unpackhi_epi16(lo, hi);
+
+    p0 = _mm_add_epi32(_mm_add_epi32(p0, _mm_unpacklo_epi16(add, zero)), half);
+    p1 = _mm_add_epi32(_mm_add_epi32(p1, _mm_unpackhi_epi16(add, zero)), half);
+    p0 = _mm_srli_epi32(p0, 16);
+    p1 = _mm_srli_epi32(p1, 16);
+    /* No unsigned 32 to 16 bit pack in SSE2, so bias into signed range */
+    p0 = _mm_sub_epi32(p0, half);
+    p1 = _mm_sub_epi32(p1, half);
+    return _mm_add_epi16(_mm_packs_epi32(p0, p1), _mm_set1_epi16((short)0x8000));
+}
+
+static int
+art_blend_span_16_sse2(uint16_t *gs_restrict dst, const uint16_t *gs_restrict backdrop,
+                       const uint16_t *gs_restrict src, int n, gs_blend_mode_t blend_mode)
+{
+    const __m128i ffff = _mm_set1_epi16((short)0xffff);
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    int i;
+
+    switch (blend_mode) {
+        case BLEND_MODE_Multiply:
+        case BLEND_MODE_Screen:
+        case BLEND_MODE_Darken:
+        case BLEND_MODE_Lighten:
+        case BLEND_MODE_Difference:
+            break;
+        default:
+            return 0;
+    }
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m128i b = _mm_loadu_si128((const __m128i *)(backdrop + i));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i r;
+
+        switch (blend_mode) {
+            case BLEND_MODE_Multiply:
+                /* (b + (b >> 15)) * s */
+                r = art_blend_mul16_sse2(b, s, _mm_srai_epi16(b, 15));
+                break;
+            case BLEND_MODE_Screen:
+                /* 0x10000 - (b + (b >> 15)) is (0xffff - b) + 1 - (b >> 15) */
+                r = art_blend_mul16_sse2(_mm_xor_si128(b, ffff), _mm_xor_si128(s, ffff),
+                                         _mm_xor_si128(_mm_srai_epi16(b, 15), ffff));
+                r = _mm_xor_si128(r, ffff);
+                break;
+            case BLEND_MODE_Darken:
+                r = _mm_xor_si128(_mm_min_epi16(_mm_xor_si128(b, bias), _mm_xor_si128(s, bias)), bias);
+                break;
+            case BLEND_MODE_Lighten:
+                r = _mm_xor_si128(_mm_max_epi16(_mm_xor_si128(b, bias), _mm_xor_si128(s, bias)), bias);
+                break;
+            case BLEND_MODE_Difference:
+            default:
+                r = _mm_or_si128(_mm_subs_epu16(b, s), _mm_subs_epu16(s, b));
+                break;
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), r);
+    }
+    return i;
+}
+#endif /* HAVE_SSE2 */
+
+void
+art_blend_span_8(byte *gs_restrict dst, const byte *gs_restrict backdrop,
+                 const byte *gs_restrict src, int n, gs_blend_mode_t blend_mode)
+{
+    int done = 0;
+
+#ifdef HAVE_SSE2
+    done = art_blend_span_8_sse2(dst, backdrop, src, n, blend_mode);
+#endif
+    /* No non-separable procs or device are needed for these modes */
+    if (done < n)
+        art_blend_pixel_8_inline(dst + done, backdrop + done, src + done, n - done,
+                                 blend_mode, NULL, NULL);
+}
+
+void
+art_blend_span_16(uint16_t *gs_restrict dst, const uint16_t *gs_restrict backdrop,
+                  const uint16_t *gs_restrict src, int n, gs_blend_mode_t blend_mode)
+{
+    int done = 0;
+
+#ifdef HAVE_SSE2
+    done = art_blend_span_16_sse2(dst, backdrop, src, n, blend_mode);
+#endif
+    if (done < n)
+        art_blend_pixel_16_inline(dst + done, backdrop + done, src + done, n - done,
+                                  blend_mode, NULL, NULL);
+}
+
 #ifdef UNUSED
 byte
 art_pdf_union_8(byte alpha1, byte alpha2)
@@ -4738,6 +4958,93 @@ mark_fill_rect(int w, int h, byte *gs_restrict dst_ptr, byte *gs_restrict src, i
                alpha_g_off, shape_off, shape);
 }
 
+/* Number of pixels blended at a time by the span based fill rectangles */
+#define MARK_FILL_SPAN 128
+
+/* Separable blend modes (see art_blend_span_valid) without overprint. The
+ * blend of the source colour with the backdrop is done for a run of pixels
+ * of each plane at a time by art_blend_span_8, then the pixels are composited
+ * exactly as art_pdf_composite_pixel_alpha_8_inline does. The source alpha
+ * is never 0 here (see mark_fill_rect_alpha0).
+ */
+static void
+mark_fill_rect_blend_span(int w, int h, byte *gs_restrict dst_ptr, byte *gs_restrict src, int num_comp, int num_spots, int first_blend_spot,
+               byte src_alpha, int rowstride, int planestride, bool additive, pdf14_device *pdev, gs_blend_mode_t blend_mode,
+               bool overprint, gx_color_index drawn_comps, int tag_off, gs_graphics_type_tag_t curr_tag,
+               int alpha_g_off, int shape_off, byte shape)
+{
+    byte backdrop[MARK_FILL_SPAN];
+    byte source[MARK_FILL_SPAN];
+    byte blend[(PDF14_MAX_PLANES) * MARK_FILL_SPAN];
+    /* Planes from first_comp_spot on are complemented for blending */
+    int first_comp_spot = additive ? num_comp - num_spots : 0;
+    int a_s = src[num_comp];
+    int i, j, k, n, x;
+
+    for (j = h; j > 0; --j) {
+        for (i = 0; i < w; i += n) {
+            n = min(w - i, MARK_FILL_SPAN);
+            for (k = 0; k < first_blend_spot; k++) {
+                const byte *plane = dst_ptr + k * planestride;
+
+                if (k < first_comp_spot)
+                    memcpy(backdrop, plane, n);
+                else
+                    for (x = 0; x < n; x++)
+                        backdrop[x] = 255 - plane[x];
+                memset(source, src[k], n);
+                art_blend_span_8(blend + k * MARK_FILL_SPAN, backdrop, source, n, blend_mode);
+            }
+            for (x = 0; x < n; x++, ++dst_ptr) {
+                int a_b = dst_ptr[num_comp * planestride];
+
+                if (a_b == 0) {
+                    /* dest alpha is zero, just use source. */
+                    for (k = 0; k < num_comp; k++)
+                        dst_ptr[k * planestride] = k < first_comp_spot ? src[k] : 255 - src[k];
+                    dst_ptr[num_comp * planestride] = a_s;
+                } else {
+                    /* Result alpha is Union of backdrop and source alpha */
+                    int tmp = (0xff - a_b) * (0xff - a_s) + 0x80;
+                    unsigned int a_r = 0xff - (((tmp >> 8) + tmp) >> 8);
+                    /* Compute a_s / a_r in 16.16 format */
+                    int src_scale = ((a_s << 16) + (a_r >> 1)) / a_r;
+
+                    for (k = 0; k < num_comp; k++) {
+                        int c_s = src[k];
+                        int c_b = dst_ptr[k * planestride];
+
+                        if (k >= first_comp_spot)
+                            c_b = 255 - c_b;
+                        if (k < first_blend_spot) {
+                            /* Mix the blend result with the source colour */
+                            tmp = a_b * (blend[k * MARK_FILL_SPAN + x] - c_s) + 0x80;
+                            c_s += ((tmp >> 8) + tmp) >> 8;
+                        }
+                        tmp = (c_b << 16) + src_scale * (c_s - c_b) + 0x8000;
+                        tmp >>= 16;
+                        dst_ptr[k * planestride] = k < first_comp_spot ? tmp : 255 - tmp;
+                    }
+                    dst_ptr[num_comp * planestride] = a_r;
+                }
+                if (tag_off) {
+                    /* Not a Normal blend mode, so we always OR */
+                    dst_ptr[tag_off] |= curr_tag;
+                }
+                if (alpha_g_off) {
+                    int tmp = (255 - dst_ptr[alpha_g_off]) * src_alpha + 0x80;
+                    dst_ptr[alpha_g_off] = 255 - ((tmp + (tmp >> 8)) >> 8);
+                }
+                if (shape_off) {
+                    int tmp = (255 - dst_ptr[shape_off]) * shape + 0x80;
+                    dst_ptr[shape_off] = 255 - ((tmp + (tmp >> 8)) >> 8);
+                }
+            }
+        }
+        dst_ptr += rowstride;
+    }
+}
+
 static void
 mark_fill_rect_sub4_fast(int w, int h, byte *gs_restrict dst_ptr, byte *gs_restrict src, int num_comp, int num_spots, int first_blend_spot,
                byte src_alpha, int rowstride, int planestride, bool additive, pdf14_device *pdev, gs_blend_mode_t blend_mode,
@@ -5148,12 +5455,16 @@ do_mark_fill_rectangle(gx_device * dev, int x, int y, int w, int h,
                     fn = mark_fill_rect_add_nospots_common_no_alpha_g;
             } else
                 fn = mark_fill_rect_add_nospots_common;
-        } else
+        } else if (art_blend_span_valid(blend_mode))
+            fn = mark_fill_rect_blend_span;
+        else
             fn = mark_fill_rect_add_nospots;
     } else if (!additive && num_spots == 0 && num_comp == 4 &&
         first_blend_spot == 0 && blend_mode == BLEND_MODE_Normal &&
         !overprint && tag_off == 0 && alpha_g_off == 0 && shape_off == 0)
         fn = mark_fill_rect_sub4_fast;
+    else if (art_blend_span_valid(blend_mode) && !overprint)
+        fn = mark_fill_rect_blend_span;
     else
         fn = mark_fill_rect;
 
@@ -5351,6 +5662,93 @@ mark_fill_rect16(int w, int h, uint16_t *gs_restrict dst_ptr, uint16_t *gs_restr
                alpha_g_off, shape_off, shape);
 }
 
+/* As mark_fill_rect_blend_span, compositing as art_pdf_composite_pixel_alpha_16_inline */
+static void
+mark_fill_rect16_blend_span(int w, int h, uint16_t *gs_restrict dst_ptr, uint16_t *gs_restrict src, int num_comp, int num_spots, int first_blend_spot,
+               uint16_t src_alpha_, int rowstride, int planestride, bool additive, pdf14_device *pdev, gs_blend_mode_t blend_mode,
+               bool overprint, gx_color_index drawn_comps, int tag_off, gs_graphics_type_tag_t curr_tag,
+               int alpha_g_off, int shape_off, uint16_t shape_)
+{
+    uint16_t backdrop[MARK_FILL_SPAN];
+    uint16_t source[MARK_FILL_SPAN];
+    uint16_t blend[(PDF14_MAX_PLANES) * MARK_FILL_SPAN];
+    /* Expand src_alpha and shape to be 0...0x10000 rather than 0...0xffff */
+    int src_alpha = src_alpha_ + (src_alpha_>>15);
+    int shape = shape_ + (shape_>>15);
+    /* Planes from first_comp_spot on are complemented for blending */
+    int first_comp_spot = additive ? num_comp - num_spots : 0;
+    int a_s = src[num_comp];
+    int i, j, k, n, x;
+
+    for (j = h; j > 0; --j) {
+        for (i = 0; i < w; i += n) {
+            n = min(w - i, MARK_FILL_SPAN);
+            for (k = 0; k < first_blend_spot; k++) {
+                const uint16_t *plane = dst_ptr + k * planestride;
+
+                if (k < first_comp_spot)
+                    memcpy(backdrop, plane, n * sizeof(uint16_t));
+                else
+                    for (x = 0; x < n; x++)
+                        backdrop[x] = 65535 - plane[x];
+                for (x = 0; x < n; x++)
+                    source[x] = src[k];
+                art_blend_span_16(blend + k * MARK_FILL_SPAN, backdrop, source, n, blend_mode);
+            }
+            for (x = 0; x < n; x++, ++dst_ptr) {
+                int a_b = dst_ptr[num_comp * planestride];
+
+                if (a_b == 0) {
+                    /* dest alpha is zero, just use source. */
+                    for (k = 0; k < num_comp; k++)
+                        dst_ptr[k * planestride] = k < first_comp_spot ? src[k] : 65535 - src[k];
+                    dst_ptr[num_comp * planestride] = a_s;
+                } else {
+                    unsigned int a_r;
+                    int tmp, src_scale;
+
+                    /* Result alpha is Union of backdrop and source alpha */
+                    a_b += a_b>>15; /* a_b in 0...0x10000 range */
+                    tmp = (0x10000 - a_b) * (0xffff - a_s) + 0x8000;
+                    a_r = 0xffff - (((unsigned int)tmp) >> 16); /* a_r in 0...0xffff range */
+                    /* Compute a_s / a_r in 16.16 format */
+                    src_scale = ((unsigned int)((a_s << 16) + (a_r >> 1))) / a_r;
+                    src_scale >>= 1; /* Lose a bit to avoid overflow */
+                    a_b >>= 1; /* Lose a bit to avoid overflow */
+
+                    for (k = 0; k < num_comp; k++) {
+                        int c_s = src[k];
+                        int c_b = dst_ptr[k * planestride];
+
+                        if (k >= first_comp_spot)
+                            c_b = 65535 - c_b;
+                        if (k < first_blend_spot) {
+                            /* Mix the blend result with the source colour */
+                            c_s += (a_b * (blend[k * MARK_FILL_SPAN + x] - c_s) + 0x4000) >> 15;
+                        }
+                        c_b += (src_scale * (c_s - c_b) + 0x4000) >> 15;
+                        dst_ptr[k * planestride] = k < first_comp_spot ? c_b : 65535 - c_b;
+                    }
+                    dst_ptr[num_comp * planestride] = a_r;
+                }
+                if (tag_off) {
+                    /* Not a Normal blend mode, so we always OR */
+                    dst_ptr[tag_off] |= curr_tag;
+                }
+                if (alpha_g_off) {
+                    int tmp = (65535 - dst_ptr[alpha_g_off]) * src_alpha + 0x8000;
+                    dst_ptr[alpha_g_off] = 65535 - (tmp >> 16);
+                }
+                if (shape_off) {
+                    int tmp = (65535 - dst_ptr[shape_off]) * shape + 0x8000;
+                    dst_ptr[shape_off] = 65535 - (tmp >> 16);
+                }
+            }
+        }
+        dst_ptr += rowstride;
+    }
+}
+
 static void
 mark_fill_rect16_sub4_fast(int w, int h, uint16_t *gs_restrict dst_ptr, uint16_t *gs_restrict src, int num_comp, int num_spots, int first_blend_spot,
                uint16_t src_alpha, int rowstride, int planestride, bool additive, pdf14_device *pdev, gs_blend_mode_t blend_mode,
@@ -5789,12 +6187,16 @@ do_mark_fill_rectangle16(gx_device * dev, int x, int y, int w, int h,
                     fn = mark_fill_rect16_add_nospots_common_no_alpha_g;
             } else
                 fn = mark_fill_rect16_add_nospots_common;
-        } else
+        } else if (art_blend_span_valid(blend_mode))
+            fn = mark_fill_rect16_blend_span;
+        else
             fn = mark_fill_rect16_add_nospots;
     } else if (!additive && num_spots == 0 && num_comp == 4 && num_spots == 0 &&
         first_blend_spot == 0 && blend_mode == BLEND_MODE_Normal &&
         !overprint && tag_off == 0 && alpha_g_off == 0 && shape_off == 0)
         fn = mark_fill_rect16_sub4_fast;
+    else if (art_blend_span_valid(blend_mode) && !overprint)
+        fn = mark_fill_rect16_blend_span;
     else
         fn = mark_fill_rect16;
 
@@ -144,6 +144,32 @@ art_blend_pixel_16(uint16_t *gs_restrict dst, const uint16_t *gs_restrict backdr
                    const pdf14_nonseparable_blending_procs_t * pblend_procs,
                    pdf14_device *p14dev);
 
+/**
+ * art_blend_span_valid: Check whether art_blend_span_8/16 handle a blend mode.
+ * @blend_mode: Blend mode.
+ *
+ * Return value: true for the separable blend modes other than Normal.
+ **/
+bool art_blend_span_valid(gs_blend_mode_t blend_mode);
+
+/**
+ * art_blend_span_8: Compute a separable PDF 1.4 blend function on a span.
+ * @dst: Where to store the results.
+ * @backdrop: Backdrop values.
+ * @src: Source values.
+ * @n: Number of values.
+ * @blend_mode: Blend mode, for which art_blend_span_valid is true.
+ *
+ * Separable blend modes treat every component alike, so this is the same
+ * as art_blend_pixel_8 on @n components, and gives identical results, but
+ * works on many values at a time where SIMD support is available.
+ **/
+void art_blend_span_8(byte *gs_restrict dst, const byte *gs_restrict backdrop,
+                      const byte *gs_restrict src, int n, gs_blend_mode_t blend_mode);
+
+void art_blend_span_16(uint16_t *gs_restrict dst, const uint16_t *gs_restrict backdrop,
+                       const uint16_t *gs_restrict src, int n, gs_blend_mode_t blend_mode);
+
 #ifdef UNUSED
 /**
  * art_pdf_union_8: Union together two alpha values.
@@ -37,6 +37,7 @@
 #include "gsimage.h"
 #include "gxhttile.h"
 #include "gsptype1.h"       /* for gx_dc_is_pattern1_color_with_trans */
+#include "gxperf.h"
 
 /* Forward references */
 static byte *compress_alpha_bits(const cached_char *, gs_memory_t *);
@@ -150,6 +151,7 @@ gx_lookup_cached_char(const gs_font * pfont, const cached_fm_pair * pair,
     gs_font_dir *dir = pfont->dir;
     uint chi = chars_head_index(glyph, pair);
     register cached_char *cc;
+    gx_perf_t *perf = gx_perf_log(pfont->memory);
 
     while ((cc = dir->ccache.table[chi & dir->ccache.table_mask]) != 0) {
         if (cc->code == glyph && cc_pair(cc) == pair &&
@@ -160,12 +162,16 @@ gx_lookup_cached_char(const gs_font * pfont, const cached_fm_pair * pair,
             if_debug4m('K', pfont->memory,
                        "[K]found "PRI_INTPTR" (depth=%d) for glyph=0x%lx, wmode=%d\n",
                        (intptr_t)cc, cc_depth(cc), (ulong)glyph, wmode);
+            if (perf != NULL)
+                gx_perf_count(perf, gx_perf_glyph_hit);
             return cc;
         }
         chi++;
     }
     if_debug3m('K', pfont->memory, "[K]not found: glyph=0x%lx, wmode=%d, depth=%d\n",
               (ulong) glyph, wmode, depth);
+    if (perf != NULL)
+        gx_perf_count(perf, gx_perf_glyph_miss);
     return 0;
 }
 
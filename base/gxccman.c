@@ -35,6 +35,7 @@
 #include "gxttfb.h"
 #include "gxfont42.h"
 #include "gxobj.h"
+#include "gxperf.h"
 
 /* Define the descriptors for the cache structures. */
 private_st_cached_fm_pair();
@@ -638,6 +639,8 @@ cached_char * cc, cached_fm_pair * pair, const gs_log2_scale_point * pscale)
         cc->linked = true;
         cc_set_pair(cc, pair);
         pair->num_chars++;
+        if (gx_perf_log(dir->memory) != NULL)
+            gx_perf_count(gx_perf_log(dir->memory), gx_perf_glyph_cached);
     }
     return 0;
 }
@@ -23,6 +23,7 @@
 #include "gsccolor.h"
 #include "gxfrac.h"
 #include "gscspace.h"
+#include "gsdevice.h"
 
 /* Cache for DeviceN color.  Note that currently this is a 1-entry cache. */
 struct gs_device_n_map_s {
@@ -33,6 +34,13 @@ struct gs_device_n_map_s {
     bool cache_valid;
     float tint[GS_CLIENT_COLOR_MAX_COMPONENTS];
     frac conc[GX_DEVICE_COLOR_MAX_COMPONENTS];
+    /*
+     * Sampled approximation of an expensive tint transform Function,
+     * built on first use if the device asks for it.
+     * See gx_apply_tint_transform in gscdevn.c.
+     */
+    int tint_table_size;	/* points per input, 0 = undecided, <0 = none */
+    float *tint_table;		/* in non-GC memory */
 };
 #define private_st_device_n_map() /* in gscdevn.c */\
   gs_private_st_ptrs1(st_device_n_map, gs_device_n_map, "gs_device_n_map",\
@@ -42,6 +50,13 @@ struct gs_device_n_map_s {
 int alloc_device_n_map(gs_device_n_map ** ppmap, gs_memory_t * mem,
                        client_name_t cname);
 
+/* Run the tint transform of a DeviceN or Separation map. */
+int gx_apply_tint_transform(gs_device_n_map *map, const float *in, float *out,
+                            const gs_gstate *pgs, gx_device *dev);
+
+/* Discard the sampled tint transform table, e.g. when the Function changes. */
+void gx_free_tint_table(gs_device_n_map *map);
+
 struct gs_device_n_colorant_s {
     rc_header rc;
     char *colorant_name;
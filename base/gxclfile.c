@@ -455,6 +455,12 @@ clist_set_memory_warning(clist_file_ptr cf, int bytes_left)
     return 0;			/* no-op */
 }
 
+static int
+clist_set_compression(clist_file_ptr cf, int method, bool report)
+{
+    return 0;			/* no-op: band files are never compressed */
+}
+
 static int
 clist_ferror_code(clist_file_ptr cf)
 {
@@ -559,6 +565,7 @@ static clist_io_procs_t clist_io_procs_file = {
     clist_fwrite_chars,
     clist_fread_chars,
     clist_set_memory_warning,
+    clist_set_compression,
     clist_ferror_code,
     clist_ftell,
     clist_rewind,
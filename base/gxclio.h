@@ -31,6 +31,17 @@
 
 typedef void *clist_file_ptr;	/* We can't do any better than this. */
 
+/*
+ * Methods for compressing the band list, for implementations that compress
+ * it at all.  clist_compress_default is whatever compressor this build was
+ * configured with (BAND_LIST_COMPRESSOR); clist_compress_fast trades some
+ * compression ratio for much cheaper compression and decompression.
+ */
+typedef enum {
+    clist_compress_default = 0,
+    clist_compress_fast
+} clist_compress_method_t;
+
 struct clist_io_procs_s {
 
     /* ---------------- Open/close/unlink ---------------- */
@@ -72,6 +83,14 @@ struct clist_io_procs_s {
      */
     int (*set_memory_warning)(clist_file_ptr cf, int bytes_left);
 
+    /*
+     * Select the compression method (a clist_compress_method_t) for a file
+     * opened for writing, and whether to report the amount and cost of
+     * compression for each page.  Implementations that don't compress
+     * ignore this.
+     */
+    int (*set_compression)(clist_file_ptr cf, int method, bool report);
+
     /*
      * clist_ferror_code returns a negative error code per gserrors.h, not a
      * Boolean; 0 means no error, 1 means low-memory warning.
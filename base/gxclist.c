@@ -198,6 +198,8 @@ clist_init_io_procs(gx_device_clist *pclist_dev, bool in_memory)
         pclist_dev->common.page_info.io_procs = core->clist_io_procs_memory;
     else
         pclist_dev->common.page_info.io_procs = core->clist_io_procs_file;
+    pclist_dev->common.page_info.compress_method = clist_compress_default;
+    pclist_dev->common.page_info.compress_report = false;
 }
 
 /* ------ Define the command set and syntax ------ */
@@ -637,7 +639,13 @@ clist_open_output_file(gx_device *dev)
                             true)) < 0 ||
         (code = cdev->page_info.io_procs->fopen(cdev->page_info.bfname, fmode, &cdev->page_info.bfile,
                             cdev->bandlist_memory, cdev->bandlist_memory,
-                            false)) < 0
+                            false)) < 0 ||
+        (code = cdev->page_info.io_procs->set_compression(cdev->page_info.cfile,
+                            cdev->page_info.compress_method,
+                            cdev->page_info.compress_report)) < 0 ||
+        (code = cdev->page_info.io_procs->set_compression(cdev->page_info.bfile,
+                            cdev->page_info.compress_method,
+                            cdev->page_info.compress_report)) < 0
         ) {
         clist_close_output_file(dev);
         cdev->permanent_error = code;
@@ -1391,6 +1399,7 @@ clist_make_accum_device(gs_memory_t *mem, gx_device *target, const char *dname,
         cwdev->graphics_type_tag = target->graphics_type_tag;		/* initialize to same as target */
         cwdev->interpolate_control = target->interpolate_control;	/* initialize to same as target */
         cwdev->non_strict_bounds = target->non_strict_bounds;	        /* initialize to same as target */
+        cwdev->shading_direct_fill = target->shading_direct_fill;	/* initialize to same as target */
 
         /* to be set by caller: cwdev->finalize = finalize; */
 
@@ -1502,6 +1511,8 @@ open_c:
     pdev->buffer_space = space;
     pclist_dev->common.orig_spec_op = dev_spec_op;
     clist_init_io_procs(pclist_dev, pdev->BLS_force_memory);
+    pcldev->page_info.compress_method = pdev->clist_compress_method;
+    pcldev->page_info.compress_report = pdev->clist_compress_report;
     clist_init_params(pclist_dev, base, space, target,
                       *buf_procs,
                       space_params->band,
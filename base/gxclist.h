@@ -395,6 +395,10 @@ typedef struct gx_device_clist_reader_s {
     int num_pages;
     void *offset_map; /* Just against collecting the map as garbage. */
     int num_render_threads;		/* number of threads being used */
+    int num_render_workers;		/* number rendering at once (< num_render_threads */
+                                        /* when BandReorderDepth > 0) */
+    struct gx_semaphore_s *render_sema;	/* limits rendering to num_render_workers */
+    long render_start_time[2];		/* realtime when the threads were set up */
     clist_render_thread_control_t *render_threads;	/* array of threads */
     byte *main_thread_data;		/* saved data pointer of main thread */
     int curr_render_thread;		/* index into array */
@@ -639,6 +643,8 @@ void clist_debug_set_ctm_imp(const gs_matrix *m);
     gs_memory_t *buffer_memory;   /* allocator for command list */\
     gs_memory_t *bandlist_memory; /* allocator for bandlist files */\
     uint clist_disable_mask;      /* mask of clist options to disable */\
+    int clist_compress_method;    /* clist_compress_method_t for the band list */\
+    bool clist_compress_report;   /* report band list compression per page */\
     gx_device_procs orig_procs	/* original (std_)procs */
 
 
@@ -649,6 +655,8 @@ void clist_debug_set_ctm_imp(const gs_matrix *m);
     0,       /* buffer_memory */\
     0,       /* bandlist_memory */\
     0,       /* clist_disable_mask */\
+    clist_compress_default, /* clist_compress_method */\
+    false,   /* clist_compress_report */\
     { NULL } /* orig_procs */
 
 typedef struct {
@@ -111,6 +111,20 @@ DECOMPRESSION.
    [Note: I expected to be able to use smaller buffer sizes for some cases,
     but this resulted in a high level of thrashing...RJJ]
 
+FAST COMPRESSION.
+
+   The stream compressor used above is chosen when Ghostscript is built
+   (BAND_LIST_COMPRESSOR).  A device can instead ask for 'clist_compress_fast'
+   with the set_compression procedure, which uses the small LZ77 block coder
+   below in place of the stream.  It stores each logical block as a sequence
+   of (literal run, back reference) pairs with byte-aligned lengths, and
+   needs no state beyond a hash table while compressing, so both directions
+   are a great deal cheaper than zlib at some cost in compression ratio.
+   The layout of the physical blocks is the same for both methods.  A block
+   that the coder would expand is stored as it is instead, and marked as
+   'stored' in its logical block, so that no block ever takes more than
+   MEMFILE_DATA_SIZE bytes and spans at most two physical blocks.
+
 LIMITATIONS.
 
    The most serious limitation is caused by the way 'memfile_fwrite' decides
@@ -163,6 +177,28 @@ static const int64_t COMPRESSION_THRESHOLD =
 /* Structure descriptor for GC */
 private_st_MEMFILE();
 
+/* Tuning and work area for clist_compress_fast */
+#define FAST_MIN_MATCH 4
+#define FAST_HASH_BITS 12
+#define FAST_HASH(p)\
+  ((((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | ((uint32_t)(p)[2] << 16) |\
+     ((uint32_t)(p)[3] << 24)) * 2654435761u) >> (32 - FAST_HASH_BITS))
+/* Incompressible data grows by one byte per 255, plus a few for the ends. */
+#define FAST_MAX_COMPRESSED (MEMFILE_DATA_SIZE + MEMFILE_DATA_SIZE / 255 + 16)
+
+/*
+ * Each compressed block is a series of sequences: a token byte holding the
+ * literal length in the high nibble and the match length (less
+ * FAST_MIN_MATCH) in the low nibble, further bytes of literal length if the
+ * nibble was 15 (each 255 byte means more follow), the literals, then a
+ * 2-byte little-endian match offset and further bytes of match length.  The
+ * last sequence has only literals and ends exactly at the end of the block.
+ */
+typedef struct memfile_fast_state_s {
+    ushort hash[1 << FAST_HASH_BITS];	/* block offsets of recent 4-byte strings */
+    byte buf[FAST_MAX_COMPRESSED];	/* compressed data being built or joined */
+} memfile_fast_state_t;
+
         /* forward references */
 static void memfile_free_mem(MEMFILE * f);
 static int memfile_init_empty(MEMFILE * f);
@@ -289,6 +325,9 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
             f->log_curr_pos = 0;
             f->raw_head = NULL;
             f->error_code = 0;
+            f->fast_state = NULL;
+            f->stat_decompressed = 0;
+            f->stat_decompress_ns = 0;
 
             if (f->log_head->phys_blk->data_limit != NULL) {
                 /* The file is compressed, so we need to copy the logical block */
@@ -310,6 +349,7 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
                     new_log_block[i].phys_blk = log_block->phys_blk;
                     new_log_block[i].phys_pdata = log_block->phys_pdata;
                     new_log_block[i].raw_block = NULL;
+                    new_log_block[i].stored = log_block->stored;
                     new_log_block[i].link = log_block->link == NULL ? NULL : new_log_block + i + 1;
                 }
                 f->log_head = new_log_block;
@@ -351,6 +391,11 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
     /* init an empty file, BEFORE allocating de/compress state */
     f->compress_state = 0;      /* make clean for GC, or alloc'n failure */
     f->decompress_state = 0;
+    f->compress_method = clist_compress_default;
+    f->fast_state = NULL;
+    f->report_compression = false;
+    f->stat_raw = f->stat_compressed = f->stat_decompressed = 0;
+    f->stat_compress_ns = f->stat_decompress_ns = 0;
     f->openlist = NULL;
     f->base_memfile = NULL;
     f->total_space = 0;
@@ -449,28 +494,29 @@ memfile_fclose(clist_file_ptr cf, const char *fname, bool delete)
                 return_error(gs_error_invalidfileaccess);
             }
             prev_f->openlist = f->openlist;     /* link around the one being fclosed */
+            /* Let the base memfile report what this reader decompressed */
+            f->base_memfile->stat_decompressed += f->stat_decompressed;
+            f->base_memfile->stat_decompress_ns += f->stat_decompress_ns;
             /* Now delete this MEMFILE reader instance */
             /* NB: we don't delete 'base' instances until we delete */
             /* If the file is compressed, free the logical blocks, but not */
             /* the phys_blk info (that is still used by the base memfile   */
             if (f->log_head->phys_blk->data_limit != NULL) {
-                LOG_MEMFILE_BLK *tmpbp, *bp = f->log_head;
-
-                while (bp != NULL) {
-                    tmpbp = bp->link;
-                    FREE(f, bp, "memfile_free_mem(log_blk)");
-                    bp = tmpbp;
-                }
+                /* memfile_fopen allocated the copy as a single array */
+                gs_free_object(f->data_memory, f->log_head, "memfile_fclose(log_blk)");
                 f->log_head = NULL;
 
-                /* Free any internal compressor state. */
-                if (f->compressor_initialized) {
+                /* Free any internal decompressor state. A reader instance */
+                /* has no compress_state, even though compressor_initialized */
+                /* was copied from the base memfile.                        */
+                if (f->decompress_state != NULL) {
                     if (f->decompress_state->templat->release != 0)
                         (*f->decompress_state->templat->release) (f->decompress_state);
-                    if (f->compress_state->templat->release != 0)
-                        (*f->compress_state->templat->release) (f->compress_state);
-                    f->compressor_initialized = false;
+                    gs_free_object(f->memory, f->decompress_state,
+                                   "memfile_fclose(decompress_state)");
+                    f->decompress_state = NULL;
                 }
+                f->compressor_initialized = false;
                 /* free the raw buffers                                           */
                 while (f->raw_head != NULL) {
                     RAW_BUFFER *tmpraw = f->raw_head->fwd;
@@ -478,6 +524,8 @@ memfile_fclose(clist_file_ptr cf, const char *fname, bool delete)
                     FREE(f, f->raw_head, "memfile_free_mem(raw)");
                     f->raw_head = tmpraw;
                 }
+                if (f->fast_state != NULL)
+                    FREE(f, f->fast_state, "memfile_free_mem(fast_state)");
             }
             /* deallocate the memfile object proper */
             gs_free_object(f->memory, f, "memfile_close_and_unlink(MEMFILE)");
@@ -605,6 +653,261 @@ finish:
     return code;
 }
 
+static int
+memfile_set_compression(clist_file_ptr cf, int method, bool report)
+{
+    MEMFILE *f = (MEMFILE *) cf;
+
+    if (method != clist_compress_default && method != clist_compress_fast)
+        return_error(gs_error_rangecheck);
+    /* Blocks already compressed must all use the same method */
+    if (f->phys_curr != NULL && method != f->compress_method)
+        return_error(gs_error_rangecheck);
+    f->compress_method = method;
+    f->report_compression = report;
+    return 0;
+}
+
+/* ---------------- Fast compression ---------------- */
+
+static int
+memfile_fast_state_alloc(MEMFILE * f)
+{
+    if (f->fast_state == NULL) {
+        f->fast_state = MALLOC(f, sizeof(*f->fast_state), "memfile fast_state");
+        if (f->fast_state == NULL) {
+            emprintf(f->memory, "memfile_fast_state_alloc: MALLOC failed\n");
+            return_error(gs_error_VMerror);
+        }
+        f->total_space += sizeof(*f->fast_state);
+    }
+    return 0;
+}
+
+static byte *
+fast_put_length(byte *op, uint len)
+{
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = (byte)len;
+    return op;
+}
+
+/* Compress len bytes from src into fs->buf, returning the compressed size. */
+static uint
+fast_compress(memfile_fast_state_t *fs, const byte *src, uint len)
+{
+    const byte *ip = src, *anchor = src;
+    const byte *const iend = src + len;
+    byte *op = fs->buf;
+    uint lit;
+
+    memset(fs->hash, 0, sizeof(fs->hash));
+    while (ip + FAST_MIN_MATCH <= iend) {
+        uint h = FAST_HASH(ip);
+        const byte *ref = src + fs->hash[h];
+
+        fs->hash[h] = (ushort)(ip - src);
+        if (ref < ip && !memcmp(ref, ip, FAST_MIN_MATCH)) {
+            const byte *mp = ip + FAST_MIN_MATCH;
+            uint off = ip - ref, mlen;
+            byte *token = op++;
+
+            while (mp < iend && *mp == mp[-(int)off])
+                mp++;
+            lit = ip - anchor;
+            mlen = mp - ip - FAST_MIN_MATCH;
+            *token = (byte)((min(lit, 15) << 4) | min(mlen, 15));
+            if (lit >= 15)
+                op = fast_put_length(op, lit - 15);
+            memcpy(op, anchor, lit);
+            op += lit;
+            *op++ = (byte)off;
+            *op++ = (byte)(off >> 8);
+            if (mlen >= 15)
+                op = fast_put_length(op, mlen - 15);
+            ip = anchor = mp;
+        } else {
+            /* Step faster through data that isn't matching */
+            ip += 1 + ((ip - anchor) >> 6);
+        }
+    }
+    lit = iend - anchor;
+    *op++ = (byte)(min(lit, 15) << 4);
+    if (lit >= 15)
+        op = fast_put_length(op, lit - 15);
+    memcpy(op, anchor, lit);
+    op += lit;
+    return op - fs->buf;
+}
+
+/*
+ * Decompress exactly len bytes into dest from the data between ip and
+ * iend.  Returns 0 on success, or -1 if the data runs out (or is invalid)
+ * first.
+ */
+static int
+fast_decompress(const byte *ip, const byte *iend, byte *dest, uint len)
+{
+    byte *op = dest;
+    byte *const oend = dest + len;
+
+    for (;;) {
+        uint token, count, off, b;
+
+        if (ip >= iend)
+            return -1;
+        token = *ip++;
+        count = token >> 4;
+        if (count == 15) {
+            do {
+                if (ip >= iend)
+                    return -1;
+                count += b = *ip++;
+            } while (b == 255);
+        }
+        if (count > (uint)(iend - ip) || count > (uint)(oend - op))
+            return -1;
+        memcpy(op, ip, count);
+        op += count;
+        ip += count;
+        if (op == oend)
+            return 0;
+        if (iend - ip < 2)
+            return -1;
+        off = ip[0] | (ip[1] << 8);
+        ip += 2;
+        count = token & 15;
+        if (count == 15) {
+            do {
+                if (ip >= iend)
+                    return -1;
+                count += b = *ip++;
+            } while (b == 255);
+        }
+        count += FAST_MIN_MATCH;
+        if (off == 0 || off > (uint)(op - dest) || count > (uint)(oend - op))
+            return -1;
+        if (off >= count) {
+            memcpy(op, op - off, count);
+            op += count;
+        } else {
+            /* Overlapping copy, replicating the last 'off' bytes */
+            const byte *ref = op - off;
+
+            while (count--)
+                *op++ = *ref++;
+        }
+    }
+}
+
+static int64_t
+memfile_time_ns(void)
+{
+    long t[2];
+
+    gp_get_realtime(t);
+    return (int64_t)t[0] * 1000000000 + t[1];
+}
+
+static int
+compress_log_blk_fast(MEMFILE * f, LOG_MEMFILE_BLK * bp)
+{
+    int ecode = 0;              /* accumulate low-memory warnings */
+    int code;
+    uint compressed_size, count;
+    const byte *data = (const byte *)bp->phys_blk->data;
+    PHYS_MEMFILE_BLK *newphys;
+
+    if ((code = memfile_fast_state_alloc(f)) < 0)
+        return code;
+    compressed_size = fast_compress(f->fast_state, data, MEMFILE_DATA_SIZE);
+    /* Keep data that doesn't compress as it is, so it fits in 2 blocks */
+    bp->stored = compressed_size >= MEMFILE_DATA_SIZE;
+    if (bp->stored)
+        compressed_size = MEMFILE_DATA_SIZE;
+    else
+        data = f->fast_state->buf;
+
+    /* Copy the result to the physical blocks, splitting it if necessary */
+    bp->phys_blk = f->phys_curr;
+    bp->phys_pdata = (char *)(f->wt.ptr) + 1;
+    count = min(compressed_size, (uint)(f->wt.limit - f->wt.ptr));
+    memcpy(f->wt.ptr + 1, data, count);
+    f->wt.ptr += count;
+    bp->phys_blk->data_limit = (char *)(f->wt.ptr);
+
+    if (count < compressed_size) {
+        newphys =
+            allocateWithReserve(f, sizeof(*newphys), &code, "memfile newphys",
+                        "compress_log_blk_fast : MALLOC for 'newphys' failed\n");
+        if (code < 0)
+            return code;
+        ecode |= code;  /* accumulate any low-memory warnings */
+        newphys->link = NULL;
+        bp->phys_blk->link = newphys;
+        f->phys_curr = newphys;
+        f->wt.ptr = (byte *) (newphys->data) - 1;
+        f->wt.limit = f->wt.ptr + MEMFILE_DATA_SIZE;
+        memcpy(f->wt.ptr + 1, data + count, compressed_size - count);
+        f->wt.ptr += compressed_size - count;
+        newphys->data_limit = (char *)(f->wt.ptr);
+    }
+#ifdef DEBUG
+    tot_compressed += compressed_size;
+#endif
+    if (f->report_compression)
+        f->stat_compressed += compressed_size;
+    return ecode;
+}
+
+static int
+decompress_log_blk_fast(MEMFILE * f, LOG_MEMFILE_BLK * bp, byte *dest)
+{
+    const byte *src = (const byte *)bp->phys_pdata;
+    const byte *src_end = (const byte *)bp->phys_blk->data_limit + 1;
+    PHYS_MEMFILE_BLK *next = bp->phys_blk->link;
+    int code;
+
+    if (bp->stored) {
+        /* The first part runs to the end of its physical block */
+        uint first = (const byte *)bp->phys_blk->data + MEMFILE_DATA_SIZE - src;
+
+        if (first >= MEMFILE_DATA_SIZE) {
+            memcpy(dest, src, MEMFILE_DATA_SIZE);
+            return 0;
+        }
+        if (next != NULL) {
+            memcpy(dest, src, first);
+            memcpy(dest + first, next->data, MEMFILE_DATA_SIZE - first);
+            return 0;
+        }
+        emprintf(f->memory, "Decompression of band list block failed!\n");
+        return_error(gs_error_Fatal);
+    }
+    /* Try the common case of the block not spanning physical blocks first */
+    if (fast_decompress(src, src_end, dest, MEMFILE_DATA_SIZE) == 0)
+        return 0;
+    if (next != NULL) {
+        /* Join the two parts of the data in the work area */
+        uint first = src_end - src;
+        uint second = (const byte *)next->data_limit + 1 - (const byte *)next->data;
+        byte *buf;
+
+        if ((code = memfile_fast_state_alloc(f)) < 0)
+            return code;
+        buf = f->fast_state->buf;
+        if (second > FAST_MAX_COMPRESSED - first)
+            second = FAST_MAX_COMPRESSED - first;
+        memcpy(buf, src, first);
+        memcpy(buf + first, next->data, second);
+        if (fast_decompress(buf, buf + first + second, dest, MEMFILE_DATA_SIZE) == 0)
+            return 0;
+    }
+    emprintf(f->memory, "Decompression of band list block failed!\n");
+    return_error(gs_error_Fatal);
+}
+
 static int
 compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp)
 {
@@ -614,6 +917,18 @@ compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp)
     long compressed_size;
     byte *start_ptr;
     PHYS_MEMFILE_BLK *newphys;
+    int64_t start_ns = 0;
+
+    if (f->report_compression) {
+        start_ns = memfile_time_ns();
+        f->stat_raw += MEMFILE_DATA_SIZE;
+    }
+    if (f->compress_method == clist_compress_fast) {
+        code = compress_log_blk_fast(f, bp);
+        if (f->report_compression)
+            f->stat_compress_ns += memfile_time_ns() - start_ns;
+        return code;
+    }
 
     /* compress this block */
     f->rd.ptr = (const byte *)(bp->phys_blk->data) - 1;
@@ -671,6 +986,10 @@ compress_log_blk(MEMFILE * f, LOG_MEMFILE_BLK * bp)
 #ifdef DEBUG
     tot_compressed += compressed_size;
 #endif
+    if (f->report_compression) {
+        f->stat_compressed += compressed_size;
+        f->stat_compress_ns += memfile_time_ns() - start_ns;
+    }
     return (status < 0 ? gs_note_error(gs_error_ioerror) : ecode);
 }                               /* end "compress_log_blk()"                                     */
 
@@ -706,6 +1025,7 @@ memfile_next_blk(MEMFILE * f)
         bp->link = newbp;
         newbp->link = NULL;
         newbp->raw_block = NULL;
+        newbp->stored = false;
         f->log_curr_blk = newbp;
 
         /* check if need to start compressing                             */
@@ -771,6 +1091,7 @@ memfile_next_blk(MEMFILE * f)
         bp->link = newbp;
         newbp->link = NULL;
         newbp->raw_block = NULL;
+        newbp->stored = false;
         /* Re-use the raw phys block for this new logical blk             */
         newbp->phys_blk = oldphys;
         f->pdata = oldphys->data;
@@ -842,6 +1163,7 @@ memfile_get_pdata(MEMFILE * f)
 {
     int code, i, num_raw_buffers, status;
     LOG_MEMFILE_BLK *bp = f->log_curr_blk;
+    int64_t start_ns = 0;
 
     if (bp->phys_blk->data_limit == NULL) {
         /* Not compressed, return this data pointer                       */
@@ -924,48 +1246,60 @@ memfile_get_pdata(MEMFILE * f)
             f->raw_head->log_blk = bp;
 
             /* Decompress the data into this raw block                     */
-            /* Initialize the decompressor                              */
-            if (f->decompress_state->templat->reinit != 0)
-                (*f->decompress_state->templat->reinit) (f->decompress_state);
-            /* Set pointers and call the decompress routine             */
-            f->wt.ptr = (byte *) (f->raw_head->data) - 1;
-            f->wt.limit = f->wt.ptr + MEMFILE_DATA_SIZE;
-            f->rd.ptr = (const byte *)(bp->phys_pdata) - 1;
-            f->rd.limit = (const byte *)bp->phys_blk->data_limit;
-#ifdef DEBUG
-            decomp_wt_ptr0 = f->wt.ptr;
-            decomp_wt_limit0 = f->wt.limit;
-            decomp_rd_ptr0 = f->rd.ptr;
-            decomp_rd_limit0 = f->rd.limit;
-#endif
-            status = (*f->decompress_state->templat->process)
-                (f->decompress_state, &(f->rd), &(f->wt), true);
-            if (status == 0) {  /* More input data needed */
-                /* switch to next block and continue decompress             */
-                int back_up = 0;        /* adjust pointer backwards     */
-
-                if (f->rd.ptr != f->rd.limit) {
-                    /* transfer remainder bytes from the previous block      */
-                    back_up = f->rd.limit - f->rd.ptr;
-                    for (i = 0; i < back_up; i++)
-                        *(bp->phys_blk->link->data - back_up + i) = *++f->rd.ptr;
-                }
-                f->rd.ptr = (const byte *)bp->phys_blk->link->data - back_up - 1;
-                f->rd.limit = (const byte *)bp->phys_blk->link->data_limit;
+            if (f->report_compression)
+                start_ns = memfile_time_ns();
+            if (f->compress_method == clist_compress_fast) {
+                code = decompress_log_blk_fast(f, bp, (byte *)f->raw_head->data);
+                if (code < 0)
+                    return code;
+            } else {
+                /* Initialize the decompressor                              */
+                if (f->decompress_state->templat->reinit != 0)
+                    (*f->decompress_state->templat->reinit) (f->decompress_state);
+                /* Set pointers and call the decompress routine             */
+                f->wt.ptr = (byte *) (f->raw_head->data) - 1;
+                f->wt.limit = f->wt.ptr + MEMFILE_DATA_SIZE;
+                f->rd.ptr = (const byte *)(bp->phys_pdata) - 1;
+                f->rd.limit = (const byte *)bp->phys_blk->data_limit;
 #ifdef DEBUG
-                decomp_wt_ptr1 = f->wt.ptr;
-                decomp_wt_limit1 = f->wt.limit;
-                decomp_rd_ptr1 = f->rd.ptr;
-                decomp_rd_limit1 = f->rd.limit;
+                decomp_wt_ptr0 = f->wt.ptr;
+                decomp_wt_limit0 = f->wt.limit;
+                decomp_rd_ptr0 = f->rd.ptr;
+                decomp_rd_limit0 = f->rd.limit;
 #endif
                 status = (*f->decompress_state->templat->process)
                     (f->decompress_state, &(f->rd), &(f->wt), true);
-                if (status == 0) {
-                    emprintf(f->memory,
-                             "Decompression required more than one full block!\n");
-                    return_error(gs_error_Fatal);
+                if (status == 0) {  /* More input data needed */
+                    /* switch to next block and continue decompress             */
+                    int back_up = 0;        /* adjust pointer backwards     */
+
+                    if (f->rd.ptr != f->rd.limit) {
+                        /* transfer remainder bytes from the previous block      */
+                        back_up = f->rd.limit - f->rd.ptr;
+                        for (i = 0; i < back_up; i++)
+                            *(bp->phys_blk->link->data - back_up + i) = *++f->rd.ptr;
+                    }
+                    f->rd.ptr = (const byte *)bp->phys_blk->link->data - back_up - 1;
+                    f->rd.limit = (const byte *)bp->phys_blk->link->data_limit;
+#ifdef DEBUG
+                    decomp_wt_ptr1 = f->wt.ptr;
+                    decomp_wt_limit1 = f->wt.limit;
+                    decomp_rd_ptr1 = f->rd.ptr;
+                    decomp_rd_limit1 = f->rd.limit;
+#endif
+                    status = (*f->decompress_state->templat->process)
+                        (f->decompress_state, &(f->rd), &(f->wt), true);
+                    if (status == 0) {
+                        emprintf(f->memory,
+                                 "Decompression required more than one full block!\n");
+                        return_error(gs_error_Fatal);
+                    }
                 }
             }
+            if (f->report_compression) {
+                f->stat_decompressed += MEMFILE_DATA_SIZE;
+                f->stat_decompress_ns += memfile_time_ns() - start_ns;
+            }
             bp->raw_block = f->raw_head;        /* point to raw block           */
         }
         /* end if( raw_block == NULL ) meaning need to decompress data    */
@@ -1149,6 +1483,20 @@ memfile_free_mem(MEMFILE * f)
     tot_swap_out = 0;
 #endif
 
+    /* Report on the compression of the page we are discarding */
+    if (f->report_compression && f->stat_raw > 0) {
+        outprintf(f->memory,
+                  "Band list %s compression: %"PRId64" bytes to %"PRId64" (%.1f%%) in %.3f ms, "
+                  "%"PRId64" bytes decompressed in %.3f ms\n",
+                  f->compress_method == clist_compress_fast ? "fast" : "default",
+                  f->stat_raw, f->stat_compressed,
+                  100.0 * f->stat_compressed / f->stat_raw,
+                  f->stat_compress_ns / 1e6,
+                  f->stat_decompressed, f->stat_decompress_ns / 1e6);
+    }
+    f->stat_raw = f->stat_compressed = f->stat_decompressed = 0;
+    f->stat_compress_ns = f->stat_decompress_ns = 0;
+
     /* Free up memory that was allocated for the memfile              */
     bp = f->log_head;
 
@@ -1199,6 +1547,10 @@ memfile_free_mem(MEMFILE * f)
         FREE(f, f->raw_head, "memfile_free_mem(raw)");
         f->raw_head = tmpraw;
     }
+    if (f->fast_state != NULL) {
+        FREE(f, f->fast_state, "memfile_free_mem(fast_state)");
+        f->fast_state = NULL;
+    }
 }
 
 static int
@@ -1240,6 +1592,7 @@ memfile_init_empty(MEMFILE * f)
     f->log_curr_blk->phys_blk = pphys;
     f->log_curr_blk->phys_pdata = NULL;
     f->log_curr_blk->raw_block = NULL;
+    f->log_curr_blk->stored = false;
 
     f->pdata = pphys->data;
     f->pdata_end = f->pdata + MEMFILE_DATA_SIZE;
@@ -1256,6 +1609,7 @@ clist_io_procs_t clist_io_procs_memory = {
     memfile_fwrite_chars,
     memfile_fread_chars,
     memfile_set_memory_warning,
+    memfile_set_compression,
     memfile_ferror_code,
     memfile_ftell,
     memfile_rewind,
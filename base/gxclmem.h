@@ -61,6 +61,8 @@ typedef struct LOG_MEMFILE_BLK {
     PHYS_MEMFILE_BLK *phys_blk;
     char *phys_pdata;
     RAW_BUFFER *raw_block;	/* or NULL */
+    bool stored;		/* fast compression: data didn't compress, */
+                        /* kept as is */
 } LOG_MEMFILE_BLK;
 
 struct MEMFILE_s {
@@ -120,6 +122,14 @@ struct MEMFILE_s {
     bool compressor_initialized;
     stream_state *compress_state;
     stream_state *decompress_state;					/******* READER INSTANCE *******/
+    int compress_method;	/* clist_compress_method_t, see gxclio.h */
+    struct memfile_fast_state_s *fast_state;	/* clist_compress_fast work area */	/******* READER INSTANCE *******/
+    bool report_compression;	/* print the statistics below for each page */
+    int64_t stat_raw;		/* bytes compressed */
+    int64_t stat_compressed;	/* bytes produced by compression */
+    int64_t stat_decompressed;	/* bytes decompressed, including by readers */	/******* READER INSTANCE *******/
+    int64_t stat_compress_ns;	/* time spent compressing */
+    int64_t stat_decompress_ns;	/* time spent decompressing */	/******* READER INSTANCE *******/
 };
 typedef struct MEMFILE_s MEMFILE;
 
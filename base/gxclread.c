@@ -31,6 +31,7 @@
 #include "gdevp14.h"
 #include "gsmemory.h"
 #include "gsicc_cache.h"
+#include "gxperf.h"
 /*
  * We really don't like the fact that gdevprn.h is included here, since
  * command lists are supposed to be usable for purposes other than printer
@@ -736,6 +737,8 @@ clist_get_bits_rectangle(gx_device *dev, const gs_int_rect * prect,
     int plane_index;
     int my;
     int code;
+    gx_perf_t *perf = gx_perf_log(dev->memory);
+    int64_t perf_start;
 
     if (prect->p.x < 0 || prect->q.x > dev->width ||
         y < 0 || end_y > dev->height
@@ -771,7 +774,10 @@ clist_get_bits_rectangle(gx_device *dev, const gs_int_rect * prect,
                                   &(crdev->color_usage_array[y/crdev->page_info.band_params.BandHeight]));
     if (code < 0)
         return code;
+    perf_start = perf ? gx_perf_now() : 0;
     code = clist_rasterize_lines(dev, y, line_count, bdev, &render_plane, &my);
+    if (perf)
+        gx_perf_add(perf, gx_perf_render, perf_start);
     if (code >= 0) {
         lines_rasterized = min(code, line_count);
         /* Return as much of the rectangle as falls within the rasterized lines. */
@@ -819,8 +825,11 @@ clist_get_bits_rectangle(gx_device *dev, const gs_int_rect * prect,
                 if (band_params.data[i])
                     band_params.data[i] += raster * lines_rasterized;
             line_count = end_y - y;
+            perf_start = perf ? gx_perf_now() : 0;
             code = clist_rasterize_lines(dev, y, line_count, bdev,
                                          &render_plane, &my);
+            if (perf)
+                gx_perf_add(perf, gx_perf_render, perf_start);
             if (code < 0)
                 break;
             lines_rasterized = min(code, line_count);
@@ -37,9 +37,11 @@
 #include "gsicc_manage.h"
 #include "gstrans.h"
 #include "gzht.h"		/* for gx_ht_cache_default_bits_size */
+#include "gxperf.h"
 
 /* Forward reference prototypes */
 static int clist_start_render_thread(gx_device *dev, int thread_index, int band);
+static long clist_elapsed_msec(const long start[2], const long end[2]);
 static void clist_render_thread(void* param);
 static void clist_render_thread_no_output_fn(void* param);
 
@@ -383,8 +385,20 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     int reserve_size = 2 * 1024 * 1024 + (gx_ht_cache_default_bits_size() * dev->color_info.num_components);
     clist_icctable_entry_t *curr_entry;
     bool deep = device_is_deep(dev);
-
-    crdev->num_render_threads = pdev->num_render_threads_requested;
+    int reorder_depth = 0;
+
+    /* With a band reorder buffer we set up more render threads than may run
+     * at once. The extra threads hold completed bands until the consumer is
+     * ready for them, so a worker that finishes a cheap band can move on to
+     * any later pending band instead of waiting behind an expensive one.
+     * Not needed without an output_fn since the process_fn then does its own
+     * band selection.
+     */
+    if (pdev->band_reorder_depth_requested > 0 && (options == NULL || options->output_fn != NULL))
+        reorder_depth = pdev->band_reorder_depth_requested;
+    crdev->num_render_workers = pdev->num_render_threads_requested;
+    crdev->num_render_threads = pdev->num_render_threads_requested + reorder_depth;
+    crdev->render_sema = NULL;
 
     if(gs_debug[':'] != 0)
         dmprintf1(mem, "%% %d rendering threads requested.\n", pdev->num_render_threads_requested);
@@ -406,6 +420,8 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     /* don't exceed our limit (allow for BGPrint and main thread) */
     if (crdev->num_render_threads > MAX_THREADS - 2)
         crdev->num_render_threads = MAX_THREADS - 2;
+    if (crdev->num_render_workers > crdev->num_render_threads)
+        crdev->num_render_workers = crdev->num_render_threads;
 
     /* Allocate and initialize an array of thread control structures */
     crdev->render_threads = (clist_render_thread_control_t *)
@@ -575,6 +591,23 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
         emprintf1(mem, "Rendering threads not started, code=%d.\n", code);
         return_error(code);
     }
+    if (crdev->num_render_workers > i)
+        crdev->num_render_workers = i;
+    /* If we have more threads than workers, the threads must take a turn on
+     * the render semaphore before rendering. If we can't get the semaphore,
+     * all the threads simply render at once.
+     */
+    if (crdev->num_render_workers < i) {
+        crdev->render_sema = gx_semaphore_label(gx_semaphore_alloc(mem), "Render");
+        if (crdev->render_sema != NULL) {
+            for (j = 0; j < crdev->num_render_workers; j++)
+                gx_semaphore_signal(crdev->render_sema);
+            for (j = 0; j < i; j++)
+                crdev->render_threads[j].sema_render = crdev->render_sema;
+        } else
+            crdev->num_render_workers = i;
+    }
+    gp_get_realtime(crdev->render_start_time);
     /* Free up any "reserve" memory we may have allocated, and start the
      * threads since we deferred that in the thread setup loop above.
      * We know if we get here we can start at least 1 thread.
@@ -589,8 +622,12 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     crdev->curr_render_thread = 0;
     crdev->next_band = band;
 
-    if(gs_debug[':'] != 0)
+    if(gs_debug[':'] != 0) {
         dmprintf1(mem, "%% Using %d rendering threads\n", i);
+        if (crdev->render_sema != NULL)
+            dmprintf2(mem, "%% %d rendering at once, band reorder depth %d\n",
+                      crdev->num_render_workers, i - crdev->num_render_workers);
+    }
 
     return code;
 }
@@ -675,6 +712,31 @@ clist_teardown_render_threads(gx_device *dev)
             if (thread->status == THREAD_BUSY)
                 gx_semaphore_wait(thread->sema_this);
         }
+        if (gx_perf_log(mem) != NULL) {
+            for (i = 0; i < crdev->num_render_threads; i++) {
+                clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
+
+                gx_perf_add_thread(gx_perf_log(mem), i, thread->bands_rendered,
+                                   thread->busy_time, thread->wait_time);
+            }
+        }
+        if (gs_debug[':'] != 0) {
+            long now[2], elapsed, busy = 0;
+
+            gp_get_realtime(now);
+            elapsed = clist_elapsed_msec(crdev->render_start_time, now);
+            for (i = 0; i < crdev->num_render_threads; i++) {
+                clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
+
+                dmprintf4(mem, "%% Thread %d rendered %d bands, busy %ld msec, waited %ld msec for a worker\n",
+                          i, thread->bands_rendered, thread->busy_time, thread->wait_time);
+                busy += thread->busy_time;
+            }
+            if (elapsed > 0 && crdev->num_render_workers > 0)
+                dmprintf3(mem, "%% %d rendering workers %d%% utilised over %ld msec\n",
+                          crdev->num_render_workers,
+                          (int)(busy * 100 / ((double)elapsed * crdev->num_render_workers)), elapsed);
+        }
         /* then free each thread's memory */
         for (i = (crdev->num_render_threads - 1); i >= 0; i--) {
             clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
@@ -708,6 +770,8 @@ clist_teardown_render_threads(gx_device *dev)
         }
         gs_free_object(mem, crdev->render_threads, "clist_teardown_render_threads");
         crdev->render_threads = NULL;
+        gx_semaphore_free(crdev->render_sema);
+        crdev->render_sema = NULL;
 
         /* Now re-open the clist temp files so we can write to them */
         if (cdev->page_info.cfile == NULL) {
@@ -782,11 +846,21 @@ clist_render_thread(void *data)
     int band_begin_line = band * band_height;
     int band_end_line = band_begin_line + band_height;
     int band_num_lines;
+    long realtime[2], realtime_end[2];
 #ifdef DEBUG
     long starttime[2], endtime[2];
 
     gp_get_usertime(starttime); /* thread start time */
 #endif
+    gp_get_realtime(realtime);
+    if (thread->sema_render != NULL) {
+        /* Wait for a worker to become free */
+        gx_semaphore_wait(thread->sema_render);
+        gp_get_realtime(realtime_end);
+        thread->wait_time += clist_elapsed_msec(realtime, realtime_end);
+        realtime[0] = realtime_end[0];
+        realtime[1] = realtime_end[1];
+    }
     if (band_end_line > dev->height)
         band_end_line = dev->height;
     band_num_lines = band_end_line - band_begin_line;
@@ -812,6 +886,12 @@ clist_render_thread(void *data)
     else
         thread->status = THREAD_DONE;    /* OK */
 
+    gp_get_realtime(realtime_end);
+    thread->busy_time += clist_elapsed_msec(realtime, realtime_end);
+    thread->bands_rendered++;
+    /* Let another thread render while our band waits to be collected */
+    if (thread->sema_render != NULL)
+        gx_semaphore_signal(thread->sema_render);
 #ifdef DEBUG
     gp_get_usertime(endtime);
     thread->cputime += (endtime[0] - starttime[0]) * 1000 +
@@ -845,12 +925,14 @@ clist_render_thread_no_output_fn(void* data)
     int band_begin_line = thread->band * band_height;
     int band_end_line = band_begin_line + band_height;
     int band_num_lines;
+    long realtime[2], realtime_end[2];
 
 #ifdef DEBUG
     long starttime[2], endtime[2];
 
     gp_get_usertime(starttime); /* thread start time */
 #endif
+    gp_get_realtime(realtime);
     /*
       As long there is no need for calling the bands 'in order' we can
       process multiple bands with one thread while there are free
@@ -893,10 +975,12 @@ clist_render_thread_no_output_fn(void* data)
           * same thread (normally by updating crdev_orig->next_band). */
         band_begin_line = crdev->next_band * band_height;
         band_end_line = band_begin_line + band_height;
+        thread->bands_rendered++;
         if (code < 0)
             break;
     }
-
+    gp_get_realtime(realtime_end);
+    thread->busy_time += clist_elapsed_msec(realtime, realtime_end);
 
 #ifdef DEBUG
     gp_get_usertime(endtime);
@@ -909,6 +993,13 @@ clist_render_thread_no_output_fn(void* data)
         thread->status = THREAD_DONE;    /* OK */
 }
 
+/* Milliseconds between two gp_get_realtime readings */
+static long
+clist_elapsed_msec(const long start[2], const long end[2])
+{
+    return (end[0] - start[0]) * 1000 + (end[1] - start[1]) / 1000000;
+}
+
 /*
  * Copy the raster data from the completed thread to the caller's
  * device (the main thread)
@@ -930,6 +1021,8 @@ clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_opti
     int band_height = crdev->page_info.band_params.BandHeight;
     int band_count = cdev->nbands;
     byte *tmp;                  /* for swapping data areas */
+    gx_perf_t *perf = gx_perf_log(dev->memory);
+    int64_t perf_start;
 
     /* We expect that the thread needed will be the 'current' thread */
     if (thread->band != band_needed) {
@@ -972,7 +1065,10 @@ clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_opti
         thread_cdev = (gx_device_clist_common *)thread->cdev;
     }
     /* Wait for this thread */
+    perf_start = perf ? gx_perf_now() : 0;
     gx_semaphore_wait(thread->sema_this);
+    if (perf)
+        gx_perf_add(perf, gx_perf_render, perf_start);
     gp_thread_finish(thread->thread);
     thread->thread = NULL;
     if (thread->status == THREAD_ERROR)
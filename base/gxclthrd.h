@@ -52,6 +52,8 @@ struct clist_render_thread_control_s {
     gs_memory_t *memory;	/* thread's 'chunk' memory allocator */
     gx_semaphore_t *sema_this;
     gx_semaphore_t *sema_group;
+    gx_semaphore_t *sema_render;	/* shared worker semaphore, NULL unless */
+                                        /* BandReorderDepth > 0 */
     gx_device *cdev;	/* clist device copy */
     gx_device *bdev;	/* this thread's buffer device */
     int band;
@@ -60,6 +62,11 @@ struct clist_render_thread_control_s {
     /* For process_page mode */
     gx_process_page_options_t *options;
     void *buffer;
+
+    /* Utilisation statistics, reported with -Z: */
+    int bands_rendered;
+    long busy_time;		/* msec spent rendering */
+    long wait_time;		/* msec spent waiting for a free worker */
 #ifdef DEBUG
     ulong cputime;
 #endif
@@ -27,6 +27,7 @@
 #include "gxcldev.h"
 #include "gxclpath.h"
 #include "gsparams.h"
+#include "gxperf.h"
 
 #include "valgrind.h"
 #include <limits.h>
@@ -305,6 +306,8 @@ cmd_write_buffer(gx_device_clist_writer * cldev, byte cmd_end)
     int nbands = cldev->nbands;
     gx_clist_state *pcls;
     int band;
+    gx_perf_t *perf = gx_perf_log(cldev->memory);
+    int64_t perf_start = perf ? gx_perf_now() : 0;
     int code = cmd_write_band(cldev, cldev->band_range_min,
                               cldev->band_range_max,
                               cldev->band_range_list,
@@ -330,6 +333,8 @@ cmd_write_buffer(gx_device_clist_writer * cldev, byte cmd_end)
     if (gs_debug_c('l'))
         cmd_print_stats(cldev->memory);
 #endif
+    if (perf)
+        gx_perf_add(perf, gx_perf_clist_write, perf_start);
     return_check_interrupt(cldev->memory, code != 0 ? code : warning);
 }
 
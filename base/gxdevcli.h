@@ -791,6 +791,7 @@ typedef struct gdev_pagelist_s {
         int interpolate_control;      /* default 1 (use image /Interpolate value), 0 is NOINTERPOLATE. */\
                                       /* > 1 limits interpolation, < 0 forces interpolation */\
         int non_strict_bounds;        /* If set, callers cannot rely on clipping fills etc to declared device bounds. */\
+        bool shading_direct_fill;     /* If set, mesh shadings evaluate the color at each pixel rather than subdividing. */\
         gx_page_device_procs page_procs;       /* must be last */\
                 /* end of std_device_body */\
         gx_device_procs procs	/* object procedures */
@@ -136,6 +136,7 @@
         0/* graphics_type_tag default GS_UNTOUCHED_TAG */,\
         1/* interpolate_control default 1, uses image /Interpolate flag, full device resolution */,\
         0/*non_strict_bounds - default is to be strict*/,\
+        0/*shading_direct_fill*/,\
         { ins, bp, ep }
 #define std_device_part3_()\
         std_device_part3_sc(gx_default_install, gx_default_begin_page, gx_default_end_page)
@@ -533,6 +533,16 @@ enum {
      */
     gxdso_hilevel_text_clip,
 
+    /* gxdso_shading_direct_fill:
+     *     data = NULL
+     *     size = 0
+     * Returns 1 if the device would like triangle and patch mesh shadings
+     * (types 4 to 7) to be rasterised by evaluating the color at each pixel
+     * center, rather than by subdividing the mesh into constant color areas
+     * until the smoothness tolerance is met. 0 otherwise.
+     */
+    gxdso_shading_direct_fill,
+
     /* Add new gxdso_ keys above this. */
     gxdso_pattern__LAST
 };
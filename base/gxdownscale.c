@@ -20,6 +20,7 @@
 #include "gdevprn.h"
 #include "assert_.h"
 #include "gsicc_cache.h"
+#include "gxperf.h"
 
 #ifdef WITH_CAL
 #include "cal_ets.h"
@@ -27,6 +28,10 @@
 #include "ets.h"
 #endif
 
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
 /* Nasty inline declaration, as gxht_thresh.h requires penum */
 void gx_ht_threshold_row_bit_sub(byte *contone,  byte *threshold_strip,
                              int contone_stride, byte *halftone,
@@ -1185,6 +1190,152 @@ static void down_core4_mfs(gx_downscaler_t *ds,
 }
 
 /* Grey (or planar) downscale code */
+
+#ifdef HAVE_SSE2
+/* SSE2 helpers for the 8 bit contone cores. These give exactly the same
+ * results as the C code; they just do the sums several pixels at a time.
+ * Each returns the number of output pixels it has dealt with, and the
+ * caller finishes off any remainder in the usual way. */
+
+/* Factor 2, 1 component: 16 output pixels per iteration. */
+static int
+down_core8_2_sse2(byte *outp, const byte *inp, int span, int awidth)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i round = _mm_set1_epi16(2);
+    int x;
+
+    for (x = 0; x + 16 <= awidth; x += 16)
+    {
+        __m128i a0 = _mm_loadu_si128((const __m128i *)inp);
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(inp + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i *)(inp + span));
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(inp + span + 16));
+        __m128i s0, s1;
+
+        /* Each 16 bit lane holds a horizontal pair; add the two halves */
+        s0 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, mask), _mm_srli_epi16(a0, 8)),
+                           _mm_add_epi16(_mm_and_si128(b0, mask), _mm_srli_epi16(b0, 8)));
+        s1 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, mask), _mm_srli_epi16(a1, 8)),
+                           _mm_add_epi16(_mm_and_si128(b1, mask), _mm_srli_epi16(b1, 8)));
+        s0 = _mm_srli_epi16(_mm_add_epi16(s0, round), 2);
+        s1 = _mm_srli_epi16(_mm_add_epi16(s1, round), 2);
+        _mm_storeu_si128((__m128i *)outp, _mm_packus_epi16(s0, s1));
+        inp += 32;
+        outp += 16;
+    }
+    return x;
+}
+
+/* Factor 4, 1 component: 16 output pixels per iteration. */
+static int
+down_core8_4_sse2(byte *outp, const byte *inp, int span, int awidth)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i round = _mm_set1_epi16(8);
+    __m128i sum[4];
+    int x, i, y;
+
+    for (x = 0; x + 16 <= awidth; x += 16)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            const byte *p = inp + i * 16;
+            __m128i acc = _mm_setzero_si128();
+
+            /* Vertical sums of horizontal pairs (at most 8*255) */
+            for (y = 0; y < 4; y++)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i *)p);
+                acc = _mm_add_epi16(acc, _mm_add_epi16(_mm_and_si128(v, mask), _mm_srli_epi16(v, 8)));
+                p += span;
+            }
+            /* Add adjacent pairs to give 4 sums of 4x4 pixels */
+            sum[i] = _mm_madd_epi16(acc, ones);
+        }
+        sum[0] = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(sum[0], sum[1]), round), 4);
+        sum[2] = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(sum[2], sum[3]), round), 4);
+        _mm_storeu_si128((__m128i *)outp, _mm_packus_epi16(sum[0], sum[2]));
+        inp += 64;
+        outp += 16;
+    }
+    return x;
+}
+
+/* Sum 'rows' lines of 'n' bytes, 'span' apart, into 'dst'. */
+static void
+down_vsum8_sse2(unsigned short *dst, const byte *inp, int span, int rows, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i, y;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        const byte *p = inp + i;
+        __m128i lo = zero, hi = zero;
+
+        for (y = rows; y > 0; y--)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)p);
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+            p += span;
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), lo);
+        _mm_storeu_si128((__m128i *)(dst + i + 8), hi);
+    }
+    for (; i < n; i++)
+    {
+        const byte *p = inp + i;
+        int value = 0;
+
+        for (y = rows; y > 0; y--)
+        {
+            value += *p;
+            p += span;
+        }
+        dst[i] = value;
+    }
+}
+
+/* Any factor, 'nc' chunky components. The columns are summed with SSE2
+ * into a local buffer a chunk at a time, and then each output component
+ * is made from 'factor' of those column sums. Always does the whole line. */
+#define DOWN_VSUM_CHUNK 384
+static int
+down_core_chunky_sse2(byte *outp, const byte *inp, int span, int awidth,
+                      int factor, int nc)
+{
+    unsigned short vsum[DOWN_VSUM_CHUNK];
+    int div = factor*factor;
+    int step = factor*nc;
+    int chunk = DOWN_VSUM_CHUNK / step;
+    int x, n, c, xx, value;
+    const unsigned short *s;
+
+    for (x = 0; x < awidth; x += n)
+    {
+        n = awidth - x;
+        if (n > chunk)
+            n = chunk;
+        down_vsum8_sse2(vsum, inp, span, factor, n * step);
+        inp += n * step;
+        for (s = vsum; s < vsum + n * step; s += step)
+        {
+            for (c = 0; c < nc; c++)
+            {
+                value = 0;
+                for (xx = 0; xx < step; xx += nc)
+                    value += s[xx + c];
+                *outp++ = (value+(div>>1))/div;
+            }
+        }
+    }
+    return awidth;
+}
+#endif /* HAVE_SSE2 */
+
 static void down_core16(gx_downscaler_t *ds,
                         byte            *outp,
                         byte            *in_buffer,
@@ -1253,6 +1404,7 @@ static void down_core8(gx_downscaler_t *ds,
     int   awidth = ds->awidth;
     int   factor = ds->factor;
     int   div    = factor*factor;
+    int   done   = 0;
 
     pad_white = (awidth - width) * factor;
     if (pad_white < 0)
@@ -1269,10 +1421,15 @@ static void down_core8(gx_downscaler_t *ds,
     }
 
     inp = in_buffer;
+#ifdef HAVE_SSE2
+    done = down_core_chunky_sse2(outp, inp, span, awidth, factor, 1);
+    outp += done;
+    inp += done * factor;
+#endif
     {
         /* Left to Right pass (no min feature size) */
         const int back = span * factor -1;
-        for (x = awidth; x > 0; x--)
+        for (x = awidth - done; x > 0; x--)
         {
             value = 0;
             for (xx = factor; xx > 0; xx--)
@@ -1301,6 +1458,7 @@ static void down_core8_2(gx_downscaler_t *ds,
     byte *inp;
     int   width  = ds->width;
     int   awidth = ds->awidth;
+    int   done   = 0;
 
     pad_white = (awidth - width) * 2;
     if (pad_white < 0)
@@ -1317,9 +1475,14 @@ static void down_core8_2(gx_downscaler_t *ds,
     }
 
     inp = in_buffer;
+#ifdef HAVE_SSE2
+    done = down_core8_2_sse2(outp, inp, span, awidth);
+    outp += done;
+    inp += done * 2;
+#endif
 
     /* Left to Right pass (no min feature size) */
-    for (x = awidth; x > 0; x--)
+    for (x = awidth - done; x > 0; x--)
     {
         *outp++ = (inp[0] + inp[1] + inp[span] + inp[span+1] + 2)>>2;
         inp += 2;
@@ -1338,6 +1501,7 @@ static void down_core8_3(gx_downscaler_t *ds,
     byte *inp;
     int   width  = ds->width;
     int   awidth = ds->awidth;
+    int   done   = 0;
 
     pad_white = (awidth - width) * 3;
     if (pad_white < 0)
@@ -1354,9 +1518,14 @@ static void down_core8_3(gx_downscaler_t *ds,
     }
 
     inp = in_buffer;
+#ifdef HAVE_SSE2
+    done = down_core_chunky_sse2(outp, inp, span, awidth, 3, 1);
+    outp += done;
+    inp += done * 3;
+#endif
 
     /* Left to Right pass (no min feature size) */
-    for (x = awidth; x > 0; x--)
+    for (x = awidth - done; x > 0; x--)
     {
         *outp++ = (inp[0     ] + inp[       1] + inp[       2] +
                    inp[span  ] + inp[span  +1] + inp[span  +2] +
@@ -1377,6 +1546,7 @@ static void down_core8_4(gx_downscaler_t *ds,
     byte *inp;
     int   width  = ds->width;
     int   awidth = ds->awidth;
+    int   done   = 0;
 
     pad_white = (awidth - width) * 4;
     if (pad_white < 0)
@@ -1393,9 +1563,14 @@ static void down_core8_4(gx_downscaler_t *ds,
     }
 
     inp = in_buffer;
+#ifdef HAVE_SSE2
+    done = down_core8_4_sse2(outp, inp, span, awidth);
+    outp += done;
+    inp += done * 4;
+#endif
 
     /* Left to Right pass (no min feature size) */
-    for (x = awidth; x > 0; x--)
+    for (x = awidth - done; x > 0; x--)
     {
         *outp++ = (inp[0     ] + inp[       1] + inp[       2] + inp[       3] +
                    inp[span  ] + inp[span  +1] + inp[span  +2] + inp[span  +3] +
@@ -1536,6 +1711,7 @@ static void down_core24(gx_downscaler_t *ds,
     int   awidth = ds->awidth;
     int   factor = ds->factor;
     int   div    = factor*factor;
+    int   done   = 0;
 
     pad_white = (awidth - width) * factor * 3;
     if (pad_white < 0)
@@ -1552,11 +1728,16 @@ static void down_core24(gx_downscaler_t *ds,
     }
 
     inp = in_buffer;
+#ifdef HAVE_SSE2
+    done = down_core_chunky_sse2(outp, inp, span, awidth, factor, 3);
+    outp += done;
+    inp += done * factor * 3;
+#endif
     {
         /* Left to Right pass (no min feature size) */
         const int back  = span * factor - 3;
         const int back2 = factor * 3 - 1;
-        for (x = awidth; x > 0; x--)
+        for (x = awidth - done; x > 0; x--)
         {
             /* R */
             value = 0;
@@ -1617,6 +1798,7 @@ static void down_core32(gx_downscaler_t *ds,
     int   awidth = ds->awidth;
     int   factor = ds->factor;
     int   div    = factor*factor;
+    int   done   = 0;
 
     pad_white = (awidth - width) * factor * 4;
     if (pad_white < 0)
@@ -1633,11 +1815,16 @@ static void down_core32(gx_downscaler_t *ds,
     }
 
     inp = in_buffer;
+#ifdef HAVE_SSE2
+    done = down_core_chunky_sse2(outp, inp, span, awidth, factor, 4);
+    outp += done;
+    inp += done * factor * 4;
+#endif
     {
         /* Left to Right pass (no min feature size) */
         const int back  = span * factor - 4;
         const int back2 = factor * 4 - 1;
-        for (x = awidth; x > 0; x--)
+        for (x = awidth - done; x > 0; x--)
         {
             /* C */
             value = 0;
@@ -2966,6 +3153,8 @@ int gx_downscaler_getbits(gx_downscaler_t *ds,
     int   y, y_end;
     byte *data_ptr;
     int   upfactor, downfactor;
+    gx_perf_t *perf = gx_perf_log(ds->dev->memory);
+    int64_t perf_start;
 
     gx_downscaler_decode_factor(ds->factor, &upfactor, &downfactor);
 
@@ -2978,7 +3167,11 @@ int gx_downscaler_getbits(gx_downscaler_t *ds,
             return code;
         if (ds->apply_cm) {
             data_ptr = out_data;
-            return ds->apply_cm(ds->apply_cm_arg, &data_ptr, ds->pre_cm, ds->width, 1, 0);
+            perf_start = perf ? gx_perf_now() : 0;
+            code = ds->apply_cm(ds->apply_cm_arg, &data_ptr, ds->pre_cm, ds->width, 1, 0);
+            if (perf)
+                gx_perf_add(perf, gx_perf_downscale, perf_start);
+            return code;
         }
         return 0;
     }
@@ -2995,6 +3188,8 @@ int gx_downscaler_getbits(gx_downscaler_t *ds,
         y++;
     } while (y < y_end);
 
+    /* The rendering (in get_line) is timed separately; time the rest. */
+    perf_start = perf ? gx_perf_now() : 0;
     if (ds->apply_cm) {
         if (ds->early_cm) {
             code = ds->apply_cm(ds->apply_cm_arg, ds->post_cm, ds->pre_cm, ds->dev->width, 1, 0);
@@ -3011,6 +3206,8 @@ int gx_downscaler_getbits(gx_downscaler_t *ds,
     } else
         (ds->down_core)(ds, out_data, ds->pre_cm[0], row, 0, ds->span);
 
+    if (perf)
+        gx_perf_add(perf, gx_perf_downscale, perf_start);
     return code;
 }
 
@@ -3029,6 +3226,8 @@ int gx_downscaler_get_bits_rectangle(gx_downscaler_t      *ds,
     int                   copy = (ds->dev->width * ds->src_bpc + 7)>>3;
     int                   i, j, n;
     int                   num_planes_to_downscale;
+    gx_perf_t            *perf = gx_perf_log(ds->dev->memory);
+    int64_t               perf_start;
 
     n = ds->dev->width;
     if (ds->dev->color_info.depth > ds->dev->color_info.num_components*8+8)
@@ -3067,6 +3266,7 @@ int gx_downscaler_get_bits_rectangle(gx_downscaler_t      *ds,
             return code;
         if (ds->apply_cm) {
             byte **buffer;
+            perf_start = perf ? gx_perf_now() : 0;
             if (saved.options & GB_RETURN_COPY) {
                 /* They will accept a copy. Let's use the buffer they supplied */
                 params->options &= ~GB_RETURN_POINTER;
@@ -3076,6 +3276,8 @@ int gx_downscaler_get_bits_rectangle(gx_downscaler_t      *ds,
             code = ds->apply_cm(ds->apply_cm_arg, buffer, params->data, ds->dev->width, rect.q.y - rect.p.y, params->raster);
             for (i = 0; i < ds->post_cm_num_comps; i++)
                 params->data[i] = buffer[i];
+            if (perf)
+                gx_perf_add(perf, gx_perf_downscale, perf_start);
         }
         return code;
     }
@@ -3109,6 +3311,7 @@ int gx_downscaler_get_bits_rectangle(gx_downscaler_t      *ds,
         return code;
     if (code < 0)
         return code;
+    perf_start = perf ? gx_perf_now() : 0;
     /* If we still haven't got enough, we've hit the end of the page; just
      * duplicate the last line we did get. */
     for (; i < downfactor; i++)
@@ -3165,6 +3368,8 @@ int gx_downscaler_get_bits_rectangle(gx_downscaler_t      *ds,
     for (plane=0; plane < num_planes_to_downscale; plane++)
         params->data[plane] = params2.data[plane];
 
+    if (perf)
+        gx_perf_add(perf, gx_perf_downscale, perf_start);
     return code;
 }
 
@@ -3245,7 +3450,8 @@ static int downscaler_process_fn(void *arg_, gx_device *dev, gx_device *bdev, co
     code = dev_proc(bdev, get_bits_rectangle)(bdev, &in_rect, &params);
     if (code < 0)
         return code;
-    raster_in = params.raster;
+    /* Returning a pointer leaves params.raster unset. */
+    raster_in = gx_device_raster(bdev, true);
     in_ptr = params.data[0];
 
     /* Where do we write it to? */
@@ -3253,7 +3459,7 @@ static int downscaler_process_fn(void *arg_, gx_device *dev, gx_device *bdev, co
         code = dev_proc(bdev, get_bits_rectangle)(buffer->bdev, &out_rect, &params);
         if (code < 0)
             return code;
-        raster_out = params.raster;
+        raster_out = gx_device_raster(buffer->bdev, true);
         out_ptr = params.data[0];
     } else {
         raster_out = raster_in;
@@ -3315,7 +3521,8 @@ int gx_downscaler_process_page(gx_device                 *dev,
     downscaler_process_page_arg_t arg = { 0 };
     gx_process_page_options_t my_options = { 0 };
     int num_comps = dev->color_info.num_components;
-    int src_bpc = dev->color_info.comp_bits[0];
+    /* Not comp_bits, which is only set for separable devices. */
+    int src_bpc = dev->color_info.depth / num_comps;
     int scaled_w;
     gx_downscale_core *core;
 
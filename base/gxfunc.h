@@ -38,6 +38,9 @@ void fn_common_free_params(gs_function_params_t * params, gs_memory_t * mem);
 /* Generic free implementation. */
 void fn_common_free(gs_function_t * pfn, bool free_params, gs_memory_t * mem);
 
+/* Generic evaluate_multiple implementation: evaluate each point in turn. */
+FN_EVALUATE_MULTIPLE_PROC(fn_common_evaluate_multiple);
+
 /* Check the values of m, n, Domain, and (if supplied) Range. */
 int fn_check_mnDR(const gs_function_params_t * params, int m, int n);
 
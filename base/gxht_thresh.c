@@ -71,6 +71,8 @@ static const byte bitreverse[] =
   0x27, 0xA7, 0x67, 0xE7, 0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7,
   0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF,
   0x3F, 0xBF, 0x7F, 0xFF};
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
 #endif
 
 #if RAW_HT_DUMP
@@ -102,27 +104,10 @@ gx_ht_threshold_row_byte(byte *contone, byte *threshold_strip, int contone_strid
 }
 #endif
 
-#ifndef HAVE_SSE2
-/* A simple case for use in the landscape mode. Could probably be coded up
-   faster */
-static void
-threshold_16_bit(byte *contone_ptr, byte *thresh_ptr, byte *ht_data)
-{
-    int j;
-
-    for (j = 2; j > 0; j--) {
-        byte h = 0;
-        byte bit_init = 0x80;
-        do {
-            if (*contone_ptr++ < *thresh_ptr++) {
-                h |=  bit_init;
-            }
-            bit_init >>= 1;
-        } while (bit_init != 0);
-        *ht_data++ = h;
-    }
-}
-#else
+/* Each of the kernels below thresholds 16 contone values against 16
+   threshold values, setting the bit (MSB first) in the 2 output bytes
+   wherever contone < threshold. */
+#if defined(HAVE_SSE2)
 /* Note this function has strict data alignment needs */
 static void
 threshold_16_SSE(byte *contone_ptr, byte *thresh_ptr, byte *ht_data)
@@ -176,9 +161,66 @@ threshold_16_SSE_unaligned(byte *contone_ptr, byte *thresh_ptr, byte *ht_data)
     ht_data[0] = bitreverse[sse_data[0]];
     ht_data[1] = bitreverse[sse_data[1]];
 }
+
+#define threshold_16 threshold_16_SSE
+#define threshold_16_unaligned threshold_16_SSE_unaligned
+
+#elif defined(__ARM_NEON)
+/* NEON loads have no alignment requirements, so one version serves
+   for both the aligned and unaligned cases. */
+static void
+threshold_16_NEON(byte *contone_ptr, byte *thresh_ptr, byte *ht_data)
+{
+    static const uint8_t bit_weights[16] =
+        { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+          0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+    uint8x16_t input1 = vld1q_u8(contone_ptr);
+    uint8x16_t input2 = vld1q_u8(thresh_ptr);
+    uint8x8_t result;
+
+    /* All ones where contone < threshold, masked down to the bit that
+       each lane contributes to its output byte. */
+    input1 = vandq_u8(vcltq_u8(input1, input2), vld1q_u8(bit_weights));
+    /* The bits within each half are distinct, so three rounds of
+       pairwise adds gather each half into a single byte. */
+    result = vpadd_u8(vget_low_u8(input1), vget_high_u8(input1));
+    result = vpadd_u8(result, result);
+    result = vpadd_u8(result, result);
+    ht_data[0] = vget_lane_u8(result, 0);
+    ht_data[1] = vget_lane_u8(result, 1);
+}
+
+#define threshold_16 threshold_16_NEON
+#define threshold_16_unaligned threshold_16_NEON
+
+#else
+/* Portable version. Free of branches so that the compiler has a chance
+   of doing something sensible with it. */
+static void
+threshold_16_bit(byte *contone_ptr, byte *thresh_ptr, byte *ht_data)
+{
+    int j;
+
+    for (j = 2; j > 0; j--) {
+        ht_data[0] = ((contone_ptr[0] < thresh_ptr[0]) << 7) |
+                     ((contone_ptr[1] < thresh_ptr[1]) << 6) |
+                     ((contone_ptr[2] < thresh_ptr[2]) << 5) |
+                     ((contone_ptr[3] < thresh_ptr[3]) << 4) |
+                     ((contone_ptr[4] < thresh_ptr[4]) << 3) |
+                     ((contone_ptr[5] < thresh_ptr[5]) << 2) |
+                     ((contone_ptr[6] < thresh_ptr[6]) << 1) |
+                      (contone_ptr[7] < thresh_ptr[7]);
+        contone_ptr += 8;
+        thresh_ptr += 8;
+        ht_data++;
+    }
+}
+
+#define threshold_16 threshold_16_bit
+#define threshold_16_unaligned threshold_16_bit
 #endif
 
-/* SSE2 and non-SSE2 implememntation of thresholding a row. Subtractive case
+/* Threshold a row, 16 pixels at a time. Subtractive case
    There is some code replication between the two of these (additive and subtractive)
    that I need to go back and determine how we can combine them without
    any performance loss. */
@@ -187,67 +229,6 @@ gx_ht_threshold_row_bit_sub(byte *contone,  byte *threshold_strip,  int contone_
                   byte *halftone, int dithered_stride, int width,
                   int num_rows, int offset_bits)
 {
-#ifndef HAVE_SSE2
-    int k, j;
-    byte *contone_ptr;
-    byte *thresh_ptr;
-    byte *halftone_ptr;
-    byte bit_init;
-
-    /* For the moment just do a very slow compare until we get
-       get this working.  This could use some serious optimization */
-    width -= offset_bits;
-    for (j = 0; j < num_rows; j++) {
-        byte h;
-        contone_ptr = contone;
-        thresh_ptr = threshold_strip + contone_stride * j;
-        halftone_ptr = halftone + dithered_stride * j;
-        /* First get the left remainder portion.  Put into MSBs of first byte */
-        bit_init = 0x80;
-        h = 0;
-        k = offset_bits;
-        if (k > 0) {
-            do {
-                if (*contone_ptr++ > *thresh_ptr++) {
-                    h |=  bit_init;
-                }
-                bit_init >>= 1;
-                if (bit_init == 0) {
-                    bit_init = 0x80;
-                    *halftone_ptr++ = h;
-                    h = 0;
-                }
-                k--;
-            } while (k > 0);
-            bit_init = 0x80;
-            *halftone_ptr++ = h;
-            h = 0;
-            if (offset_bits < 8)
-                *halftone_ptr++ = 0;
-        }
-        /* Now get the rest, which will be 16 bit aligned. */
-        k = width;
-        if (k > 0) {
-            do {
-                if (*contone_ptr++ > *thresh_ptr++) {
-                    h |=  bit_init;
-                }
-                bit_init >>= 1;
-                if (bit_init == 0) {
-                    bit_init = 0x80;
-                    *halftone_ptr++ = h;
-                    h = 0;
-                }
-                k--;
-            } while (k > 0);
-            if (bit_init != 0x80) {
-                *halftone_ptr++ = h;
-            }
-            if ((width & 15) < 8)
-                *halftone_ptr++ = 0;
-        }
-    }
-#else
     byte *contone_ptr;
     byte *thresh_ptr;
     byte *halftone_ptr;
@@ -263,12 +244,11 @@ gx_ht_threshold_row_bit_sub(byte *contone,  byte *threshold_strip,  int contone_
         halftone_ptr = halftone + dithered_stride * j;
         if (offset_bits > 0) {
             /* Since we allowed for 16 bits in our left remainder
-               we can go directly in to the destination.  threshold_16_SSE
-               requires 128 bit alignment.  contone_ptr and thresh_ptr
+               we can go directly in to the destination.  threshold_16
+               may require 128 bit alignment.  contone_ptr and thresh_ptr
                are set up so that after we move in by offset_bits elements
                then we are 128 bit aligned.  */
-            threshold_16_SSE_unaligned(thresh_ptr, contone_ptr,
-                                       halftone_ptr);
+            threshold_16_unaligned(thresh_ptr, contone_ptr, halftone_ptr);
             halftone_ptr += 2;
             thresh_ptr += offset_bits;
             contone_ptr += offset_bits;
@@ -277,82 +257,20 @@ gx_ht_threshold_row_bit_sub(byte *contone,  byte *threshold_strip,  int contone_
            over sets of 16 going directly into our HT buffer.  Sources and
            halftone_ptr buffers should be padded to allow 15 bit overrun */
         for (k = 0; k < num_tiles; k++) {
-            threshold_16_SSE(thresh_ptr, contone_ptr, halftone_ptr);
+            threshold_16(thresh_ptr, contone_ptr, halftone_ptr);
             thresh_ptr += 16;
             contone_ptr += 16;
             halftone_ptr += 2;
         }
     }
-#endif
 }
 
-/* SSE2 and non-SSE2 implememntation of thresholding a row. additive case  */
+/* Threshold a row, 16 pixels at a time. additive case  */
 void
 gx_ht_threshold_row_bit(byte *contone,  byte *threshold_strip,  int contone_stride,
                   byte *halftone, int dithered_stride, int width,
                   int num_rows, int offset_bits)
 {
-#ifndef HAVE_SSE2
-    int k, j;
-    byte *contone_ptr;
-    byte *thresh_ptr;
-    byte *halftone_ptr;
-    byte bit_init;
-
-    /* For the moment just do a very slow compare until we get
-       get this working.  This could use some serious optimization */
-    width -= offset_bits;
-    for (j = 0; j < num_rows; j++) {
-        byte h;
-        contone_ptr = contone;
-        thresh_ptr = threshold_strip + contone_stride * j;
-        halftone_ptr = halftone + dithered_stride * j;
-        /* First get the left remainder portion.  Put into MSBs of first byte */
-        bit_init = 0x80;
-        h = 0;
-        k = offset_bits;
-        if (k > 0) {
-            do {
-                if (*contone_ptr++ < *thresh_ptr++) {
-                    h |=  bit_init;
-                }
-                bit_init >>= 1;
-                if (bit_init == 0) {
-                    bit_init = 0x80;
-                    *halftone_ptr++ = h;
-                    h = 0;
-                }
-                k--;
-            } while (k > 0);
-            bit_init = 0x80;
-            *halftone_ptr++ = h;
-            h = 0;
-            if (offset_bits < 8)
-                *halftone_ptr++ = 0;
-        }
-        /* Now get the rest, which will be 16 bit aligned. */
-        k = width;
-        if (k > 0) {
-            do {
-                if (*contone_ptr++ < *thresh_ptr++) {
-                    h |=  bit_init;
-                }
-                bit_init >>= 1;
-                if (bit_init == 0) {
-                    bit_init = 0x80;
-                    *halftone_ptr++ = h;
-                    h = 0;
-                }
-                k--;
-            } while (k > 0);
-            if (bit_init != 0x80) {
-                *halftone_ptr++ = h;
-            }
-            if ((width & 15) < 8)
-                *halftone_ptr++ = 0;
-        }
-    }
-#else
     byte *contone_ptr;
     byte *thresh_ptr;
     byte *halftone_ptr;
@@ -368,12 +286,11 @@ gx_ht_threshold_row_bit(byte *contone,  byte *threshold_strip,  int contone_stri
         halftone_ptr = halftone + dithered_stride * j;
         if (offset_bits > 0) {
             /* Since we allowed for 16 bits in our left remainder
-               we can go directly in to the destination.  threshold_16_SSE
-               requires 128 bit alignment.  contone_ptr and thresh_ptr
+               we can go directly in to the destination.  threshold_16
+               may require 128 bit alignment.  contone_ptr and thresh_ptr
                are set up so that after we move in by offset_bits elements
                then we are 128 bit aligned.  */
-            threshold_16_SSE_unaligned(contone_ptr, thresh_ptr,
-                                       halftone_ptr);
+            threshold_16_unaligned(contone_ptr, thresh_ptr, halftone_ptr);
             halftone_ptr += 2;
             thresh_ptr += offset_bits;
             contone_ptr += offset_bits;
@@ -382,13 +299,12 @@ gx_ht_threshold_row_bit(byte *contone,  byte *threshold_strip,  int contone_stri
            over sets of 16 going directly into our HT buffer.  Sources and
            halftone_ptr buffers should be padded to allow 15 bit overrun */
         for (k = 0; k < num_tiles; k++) {
-            threshold_16_SSE(contone_ptr, thresh_ptr, halftone_ptr);
+            threshold_16(contone_ptr, thresh_ptr, halftone_ptr);
             thresh_ptr += 16;
             contone_ptr += 16;
             halftone_ptr += 2;
         }
     }
-#endif
 }
 
 /* This thresholds a buffer that is LAND_BITS wide by data_length tall.
@@ -465,11 +381,7 @@ gx_ht_threshold_landscape_sub(byte *contone_align, byte *thresh_align,
         j = LAND_BITS;
         do {
 #endif
-#ifdef HAVE_SSE2
-            threshold_16_SSE(thresh_ptr, contone_ptr, halftone_ptr);
-#else
-            threshold_16_bit(thresh_ptr, contone_ptr, halftone_ptr);
-#endif
+            threshold_16(thresh_ptr, contone_ptr, halftone_ptr);
             thresh_ptr += 16;
             position += 16;
             halftone_ptr += 2;
@@ -556,11 +468,7 @@ gx_ht_threshold_landscape(byte *contone_align, byte *thresh_align,
         j = LAND_BITS;
         do {
 #endif
-#ifdef HAVE_SSE2
-            threshold_16_SSE(contone_ptr, thresh_ptr, halftone_ptr);
-#else
-            threshold_16_bit(contone_ptr, thresh_ptr, halftone_ptr);
-#endif
+            threshold_16(contone_ptr, thresh_ptr, halftone_ptr);
             thresh_ptr += 16;
             position += 16;
             halftone_ptr += 2;
@@ -38,6 +38,13 @@ struct gx_pattern_cache_s {
     size_t bits_used;
     size_t max_bits;
     void (*free_all) (gx_pattern_cache *);
+    /* Statistics, for clients that want to report them. */
+    ulong hits;			/* lookups satisfied by the cache */
+    ulong misses;		/* tiles that had to be rendered */
+    ulong evictions;		/* tiles freed to make room for others */
+    ulong retained;		/* tiles kept at the end of a page */
+    ulong reused;		/* retained tiles used again on a later page */
+    size_t peak_bits;		/* high water mark of bits_used */
 };
 
 #define private_st_pattern_cache() /* in gxpcmap.c */\
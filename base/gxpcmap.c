@@ -303,6 +303,7 @@ gx_pattern_accum_alloc(gs_memory_t * mem, gs_memory_t * storage_memory,
     fdev->graphics_type_tag = tdev->graphics_type_tag;
     fdev->interpolate_control = tdev->interpolate_control;
     fdev->non_strict_bounds = tdev->non_strict_bounds;
+    fdev->shading_direct_fill = tdev->shading_direct_fill;
     gx_device_forward_fill_in_procs(fdev);
     return fdev;
 }
@@ -842,6 +843,12 @@ gx_pattern_alloc_cache(gs_memory_t * mem, uint num_tiles, ulong max_bits)
     pcache->bits_used = 0;
     pcache->max_bits = max_bits;
     pcache->free_all = pattern_cache_free_all;
+    pcache->hits = 0;
+    pcache->misses = 0;
+    pcache->evictions = 0;
+    pcache->retained = 0;
+    pcache->reused = 0;
+    pcache->peak_bits = 0;
     for (i = 0; i < num_tiles; tiles++, i++) {
         tiles->id = gx_no_bitmap_id;
         /* Clear the pointers to pacify the GC. */
@@ -868,6 +875,7 @@ gx_pattern_alloc_cache(gs_memory_t * mem, uint num_tiles, ulong max_bits)
         tiles->cdev = NULL;
         tiles->ttrans = NULL;
         tiles->num_planar_planes = 0;
+        tiles->is_retained = false;
     }
     return pcache;
 }
@@ -988,6 +996,7 @@ gx_pattern_cache_free_entry(gx_pattern_cache * pcache, gx_color_tile * ctile, bo
         pcache->tiles_used--;
         pcache->bits_used -= ctile->bits_used;
         ctile->id = gx_no_bitmap_id;
+        ctile->is_retained = false;
     }
 }
 
@@ -1045,8 +1054,15 @@ gx_pattern_cache_ensure_space(gs_gstate * pgs, size_t needed)
     /* By starting just after 'next', we attempt to first free the oldest entries */
     while (pcache->bits_used + needed > pcache->max_bits &&
            pcache->bits_used != 0) {
+        gx_color_tile *ctile;
+
         pcache->next = (pcache->next + 1) % pcache->num_tiles;
-        gx_pattern_cache_free_entry(pcache, &pcache->tiles[pcache->next], false);
+        ctile = &pcache->tiles[pcache->next];
+        if (ctile->id != gx_no_bitmap_id) {
+            gx_pattern_cache_free_entry(pcache, ctile, false);
+            if (ctile->id == gx_no_bitmap_id)
+                pcache->evictions++;
+        }
         /* since a pattern may be temporarily locked (stroke pattern for fill_stroke_path) */
         /* we may not have freed all entries even though we've scanned the entire cache.   */
         /* The following check for wrapping prevents infinite loop if stroke pattern was   */
@@ -1064,6 +1080,8 @@ gx_pattern_cache_update_used(gs_gstate *pgs, size_t used)
 
     pcache->bits_used += used;
     pcache->tiles_used++;
+    if (pcache->bits_used > pcache->peak_bits)
+        pcache->peak_bits = pcache->bits_used;
 }
 
 /*
@@ -1171,6 +1189,8 @@ gx_pattern_cache_add_entry(gs_gstate * pgs,
     }
     id = pinst->id;
     ctile = gx_pattern_cache_find_tile_for_id(pcache, id);
+    if (ctile->id != gx_no_bitmap_id && ctile->id != id)
+        pcache->evictions++;
     gx_pattern_cache_free_entry(pcache, ctile, false);         /* ensure that this cache slot is empty */
     ctile->id = id;
     ctile->num_planar_planes = pinst->num_planar_planes;
@@ -1183,6 +1203,7 @@ gx_pattern_cache_add_entry(gs_gstate * pgs,
     ctile->has_overlap = pinst->has_overlap;
     ctile->is_dummy = false;
     ctile->is_locked = false;
+    ctile->is_retained = false;
     ctile->blending_mode = 0;
     ctile->trans_group_popped = false;
     if (dev_proc(fdev, open_device) != pattern_clist_open_device) {
@@ -1297,6 +1318,7 @@ gx_pattern_cache_add_dummy_entry(gs_gstate *pgs,
     ctile->has_overlap = pinst->has_overlap;
     ctile->is_dummy = true;
     ctile->is_locked = false;
+    ctile->is_retained = false;
     memset(&ctile->tbits, 0 , sizeof(ctile->tbits));
     ctile->tbits.size = pinst->size;
     ctile->tbits.id = gs_no_bitmap_id;
@@ -1455,6 +1477,39 @@ gx_pattern_cache_flush(gx_pattern_cache * pcache)
     }
 }
 
+void
+gx_pattern_cache_flush_transient(gx_pattern_cache * pcache)
+{
+    uint i;
+
+    if (pcache == 0)            /* no cache created yet */
+        return;
+    for (i = 0; i < pcache->num_tiles; ++i) {
+        gx_color_tile *ctile = &pcache->tiles[i];
+
+        if (ctile->id == gx_no_bitmap_id)
+            continue;
+        ctile->is_locked = false;		/* force freeing */
+        if (ctile->is_dummy || ctile->cdev != NULL || ctile->ttrans != NULL)
+            gx_pattern_cache_free_entry(pcache, ctile, true);
+        else if (!ctile->is_retained) {
+            ctile->is_retained = true;
+            pcache->retained++;
+        }
+    }
+}
+
+int
+gx_pattern_cache_set_max_bits(gs_gstate * pgs, size_t max_bits)
+{
+    int code = ensure_pattern_cache(pgs);
+
+    if (code < 0)
+        return code;
+    pgs->pattern_cache->max_bits = max_bits;
+    return 0;
+}
+
 /* blank the pattern accumulator device assumed to be in the graphics
    state */
 int
@@ -1519,6 +1574,7 @@ gx_pattern_load(gx_device_color * pdc, const gs_gstate * pgs,
 
     if (gx_pattern_cache_lookup(pdc, pgs, dev, select))
         return 0;
+    pgs->pattern_cache->misses++;
 
     /* Get enough space in the cache for this pattern (estimated if it is a clist) */
     gx_pattern_cache_ensure_space((gs_gstate *)pgs, gx_pattern_size_estimate(pinst, has_tags));
@@ -222,7 +222,8 @@ struct gx_color_tile_s {
                                    device which, is not planar but the target
                                    is */
     byte is_locked;		/* stroke patterns cannot be freed during fill_stroke_path */
-    byte pad[2];		/* structure members alignment. */
+    byte is_retained;		/* kept from an earlier page, not yet used on this one */
+    byte pad[1];		/* structure members alignment. */
     /* The following is neither key nor value. */
     uint index;			/* the index of the tile within the cache (for GC) */
 };
@@ -332,6 +333,17 @@ void gx_pattern_cache_winnow(gx_pattern_cache *,
 
 void gx_pattern_cache_flush(gx_pattern_cache * pcache);
 
+/*
+ * Free the entries that cannot be kept from one page to the next (command
+ * list tiles, tiles with transparency and device managed patterns), and
+ * mark the remainder as retained so that a later page using the same
+ * pattern instance id can pick them up without rendering them again.
+ */
+void gx_pattern_cache_flush_transient(gx_pattern_cache * pcache);
+
+/* Set the number of bytes the Pattern cache may use, creating it if needed. */
+int gx_pattern_cache_set_max_bits(gs_gstate * pgs, size_t max_bits);
+
 bool gx_pattern_tile_is_clist(gx_color_tile *ptile);
 
 /* Return true if pattern-clist device (not pattern accumulator) */
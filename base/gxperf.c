@@ -0,0 +1,247 @@
+/* Copyright (C) 2001-2025 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  39 Mesa Street, Suite 108A, San Francisco,
+   CA 94129, USA, for further information.
+*/
+
+
+/* Per-page performance log (the PerfLog device parameter) */
+#include "memory_.h"
+#include "gx.h"
+#include "gserrors.h"
+#include "gp.h"
+#include "gxsync.h"
+#include "gxdevcli.h"
+#include "gxperf.h"
+
+/* The number of rendering threads listed individually in a record */
+#define PERF_MAX_THREADS 64
+
+/* Accumulated for the current page, by any thread, under the lock */
+typedef struct perf_page_s {
+    int64_t wall[gx_perf_num_stages];
+    long calls[gx_perf_num_stages];
+    ulong counts[gx_perf_num_counts];
+    int num_threads;
+    struct {
+        int bands;
+        long busy_msec, wait_msec;
+    } thread[PERF_MAX_THREADS];
+} perf_page_t;
+
+struct gx_perf_s {
+    gs_memory_t *memory;	/* allocator for this structure */
+    gx_monitor_t *lock;		/* serialises access to 'acc' */
+    gp_file *file;
+    char *fname;
+    long page;			/* number of records written */
+    perf_page_t acc;
+    /* Page-level stages: wall clock, and process user time */
+    int64_t interp_start, interp_cpu_start;
+    int64_t interp_wall, interp_cpu;
+    int64_t output_start, output_cpu_start;
+};
+
+int64_t
+gx_perf_now(void)
+{
+    long t[2];
+
+    gp_get_realtime(t);
+    return (int64_t)t[0] * 1000000000 + t[1];
+}
+
+static int64_t
+perf_cpu_now(void)
+{
+    long t[2];
+
+    gp_get_usertime(t);
+    return (int64_t)t[0] * 1000000000 + t[1];
+}
+
+static void
+perf_reset_page(gx_perf_t *perf)
+{
+    perf->acc.num_threads = 0;
+    memset(perf->acc.wall, 0, sizeof(perf->acc.wall));
+    memset(perf->acc.calls, 0, sizeof(perf->acc.calls));
+    memset(perf->acc.counts, 0, sizeof(perf->acc.counts));
+    perf->interp_start = gx_perf_now();
+    perf->interp_cpu_start = perf_cpu_now();
+}
+
+void
+gx_perf_add(gx_perf_t *perf, gx_perf_stage_t stage, int64_t start)
+{
+    int64_t elapsed = gx_perf_now() - start;
+
+    gx_monitor_enter(perf->lock);
+    perf->acc.wall[stage] += elapsed;
+    perf->acc.calls[stage]++;
+    gx_monitor_leave(perf->lock);
+}
+
+void
+gx_perf_count(gx_perf_t *perf, gx_perf_count_t event)
+{
+    gx_monitor_enter(perf->lock);
+    perf->acc.counts[event]++;
+    gx_monitor_leave(perf->lock);
+}
+
+void
+gx_perf_add_thread(gx_perf_t *perf, int index, int bands,
+                   long busy_msec, long wait_msec)
+{
+    if (index < 0 || index >= PERF_MAX_THREADS)
+        return;
+    gx_monitor_enter(perf->lock);
+    /* Entries past num_threads are left over from earlier pages. */
+    for (; perf->acc.num_threads <= index; perf->acc.num_threads++) {
+        perf->acc.thread[perf->acc.num_threads].bands = 0;
+        perf->acc.thread[perf->acc.num_threads].busy_msec = 0;
+        perf->acc.thread[perf->acc.num_threads].wait_msec = 0;
+    }
+    perf->acc.thread[index].bands += bands;
+    perf->acc.thread[index].busy_msec += busy_msec;
+    perf->acc.thread[index].wait_msec += wait_msec;
+    gx_monitor_leave(perf->lock);
+}
+
+void
+gx_perf_page_output_begin(gx_perf_t *perf)
+{
+    int64_t now = gx_perf_now(), cpu = perf_cpu_now();
+
+    perf->interp_wall = now - perf->interp_start;
+    perf->interp_cpu = cpu - perf->interp_cpu_start;
+    perf->output_start = now;
+    perf->output_cpu_start = cpu;
+}
+
+#define SECS(ns) ((double)(ns) / 1e9)
+
+void
+gx_perf_page_output_end(gx_perf_t *perf, gx_device *dev, bool background)
+{
+    int64_t output_wall = gx_perf_now() - perf->output_start;
+    int64_t output_cpu = perf_cpu_now() - perf->output_cpu_start;
+    int64_t encode;
+    gs_memory_status_t status;
+    gp_file *f = perf->file;
+    perf_page_t acc;
+    int i;
+
+    /* Take the page's totals, and start the next page, in one step, as
+       rendering threads may still be adding to them */
+    gx_monitor_enter(perf->lock);
+    acc = perf->acc;
+    perf->page++;
+    perf_reset_page(perf);
+    gx_monitor_leave(perf->lock);
+
+    /* Rendering and downscaling happen inside the device's print_page */
+    encode = output_wall - acc.wall[gx_perf_render] - acc.wall[gx_perf_downscale];
+    if (encode < 0 || background)
+        encode = 0;
+    gs_memory_status(dev->memory->non_gc_memory, &status);
+
+    gp_fprintf(f, "{\"page\":%ld,\"device\":\"%s\",\"background\":%s,",
+               perf->page, dev->dname, background ? "true" : "false");
+    gp_fprintf(f, "\"interp\":{\"wall\":%.6f,\"cpu\":%.6f},",
+               SECS(perf->interp_wall), SECS(perf->interp_cpu));
+    gp_fprintf(f, "\"clist_write\":{\"wall\":%.6f,\"calls\":%ld},",
+               SECS(acc.wall[gx_perf_clist_write]), acc.calls[gx_perf_clist_write]);
+    gp_fprintf(f, "\"render\":{\"wall\":%.6f,\"calls\":%ld,\"threads\":[",
+               SECS(acc.wall[gx_perf_render]), acc.calls[gx_perf_render]);
+    for (i = 0; i < acc.num_threads; i++)
+        gp_fprintf(f, "%s{\"bands\":%d,\"busy\":%.3f,\"wait\":%.3f}",
+                   i > 0 ? "," : "", acc.thread[i].bands,
+                   acc.thread[i].busy_msec / 1e3, acc.thread[i].wait_msec / 1e3);
+    gp_fprintf(f, "]},\"downscale\":{\"wall\":%.6f,\"calls\":%ld},",
+               SECS(acc.wall[gx_perf_downscale]), acc.calls[gx_perf_downscale]);
+    gp_fprintf(f, "\"glyph_cache\":{\"hits\":%lu,\"misses\":%lu,\"cached\":%lu},",
+               acc.counts[gx_perf_glyph_hit], acc.counts[gx_perf_glyph_miss],
+               acc.counts[gx_perf_glyph_cached]);
+    gp_fprintf(f, "\"output\":{\"wall\":%.6f,\"cpu\":%.6f,\"encode\":%.6f},",
+               SECS(output_wall), SECS(output_cpu), SECS(encode));
+    gp_fprintf(f, "\"memory\":{\"allocated\":%"PRIu64",\"used\":%"PRIu64",\"peak\":%"PRIu64"}}\n",
+               (uint64_t)status.allocated, (uint64_t)status.used, (uint64_t)status.max_used);
+    gp_fflush(f);
+}
+
+void
+gx_perf_log_finit(gs_memory_t *mem)
+{
+    gs_lib_ctx_t *ctx = mem->gs_lib_ctx;
+    gx_perf_t *perf = ctx->perf;
+
+    if (perf == NULL)
+        return;
+    ctx->perf = NULL;
+    if (perf->file != NULL)
+        gp_fclose(perf->file);
+    if (perf->lock != NULL)
+        gx_monitor_free(perf->lock);
+    gs_free_object(perf->memory, perf->fname, "gx_perf_log_finit(fname)");
+    gs_free_object(perf->memory, perf, "gx_perf_log_finit");
+}
+
+int
+gx_perf_set_log(gs_memory_t *mem, const byte *fname, uint size)
+{
+    gs_lib_ctx_t *ctx = mem->gs_lib_ctx;
+    gs_memory_t *cmem = ctx->memory;
+    gx_perf_t *perf = ctx->perf;
+
+    if (perf != NULL && size == strlen(perf->fname) &&
+        !memcmp(perf->fname, fname, size))
+        return 0;
+    gx_perf_log_finit(mem);
+    if (size == 0)
+        return 0;
+
+    perf = (gx_perf_t *)gs_alloc_bytes(cmem, sizeof(*perf), "gx_perf_set_log");
+    if (perf == NULL)
+        return_error(gs_error_VMerror);
+    memset(perf, 0, sizeof(*perf));
+    perf->memory = cmem;
+    perf->fname = (char *)gs_alloc_bytes(cmem, size + 1, "gx_perf_set_log(fname)");
+    perf->lock = gx_monitor_label(gx_monitor_alloc(cmem), "PerfLog");
+    if (perf->fname == NULL || perf->lock == NULL) {
+        ctx->perf = perf;
+        gx_perf_log_finit(mem);
+        return_error(gs_error_VMerror);
+    }
+    memcpy(perf->fname, fname, size);
+    perf->fname[size] = 0;
+    /* Append, so that a log shared by several jobs keeps all their pages */
+    perf->file = gp_fopen(mem, perf->fname, "a");
+    if (perf->file == NULL) {
+        emprintf1(mem, "Could not open PerfLog file %s\n", perf->fname);
+        ctx->perf = perf;
+        gx_perf_log_finit(mem);
+        return_error(gs_error_invalidfileaccess);
+    }
+    perf_reset_page(perf);
+    ctx->perf = perf;
+    return 0;
+}
+
+const char *
+gx_perf_log_name(const gs_memory_t *mem)
+{
+    gx_perf_t *perf = mem->gs_lib_ctx->perf;
+
+    return perf == NULL ? "" : perf->fname;
+}
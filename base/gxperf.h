@@ -0,0 +1,98 @@
+/* Copyright (C) 2001-2025 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  39 Mesa Street, Suite 108A, San Francisco,
+   CA 94129, USA, for further information.
+*/
+
+
+/* Per-page performance log (the PerfLog device parameter) */
+
+#ifndef gxperf_INCLUDED
+#  define gxperf_INCLUDED
+
+#include "std.h"
+#include "stdint_.h"
+#include "gsmemory.h"
+#include "gslibctx.h"
+
+#ifndef gx_device_DEFINED
+#  define gx_device_DEFINED
+typedef struct gx_device_s gx_device;
+#endif
+
+/*
+ * When a printer device is given a PerfLog file name, one JSON object per
+ * page is appended to that file, giving the time spent in each stage of
+ * producing the page.  The log belongs to the library instance, so the
+ * code that does the work (band list writing, band rendering, downscaling)
+ * can find it through any memory pointer without the device being passed
+ * down.  When no log is open gx_perf_log() is NULL, and instrumented code
+ * must test for that before reading the clock, so the cost when logging
+ * is off is one pointer test per instrumented call.
+ */
+
+/* The stages timed by the code doing the work, rather than by the page. */
+typedef enum {
+    gx_perf_clist_write,	/* flushing band list buffers to the band files */
+    gx_perf_render,		/* the page's thread waiting for bands to be rendered */
+    gx_perf_downscale,		/* downscaling and post-render colour conversion */
+    gx_perf_num_stages
+} gx_perf_stage_t;
+
+/* Events counted by the interpreter thread. */
+typedef enum {
+    gx_perf_glyph_hit,		/* character found in the font cache */
+    gx_perf_glyph_miss,		/* character not found in the font cache */
+    gx_perf_glyph_cached,	/* character rendered and added to the cache */
+    gx_perf_num_counts
+} gx_perf_count_t;
+
+typedef struct gx_perf_s gx_perf_t;
+
+/* Return the log for this instance, or NULL if logging is off. */
+#define gx_perf_log(mem) ((mem)->gs_lib_ctx->perf)
+
+/* Return a monotonic-enough time stamp in nanoseconds. */
+int64_t gx_perf_now(void);
+
+/* Add the time since 'start' (from gx_perf_now) to a stage. Thread safe. */
+void gx_perf_add(gx_perf_t *perf, gx_perf_stage_t stage, int64_t start);
+
+/* Count an event. Thread safe. */
+void gx_perf_count(gx_perf_t *perf, gx_perf_count_t event);
+
+/* Record one rendering thread's statistics for the current page. */
+void gx_perf_add_thread(gx_perf_t *perf, int index, int bands,
+                        long busy_msec, long wait_msec);
+
+/*
+ * Open (or, with a zero length name, close) the log. Opening a file that
+ * is already the log does nothing.
+ */
+int gx_perf_set_log(gs_memory_t *mem, const byte *fname, uint size);
+
+/* Return the name of the current log, or "" if there is none. */
+const char *gx_perf_log_name(const gs_memory_t *mem);
+
+/*
+ * The page-level stages are timed by the output_page procedure: call
+ * gx_perf_page_output_begin on entry, and gx_perf_page_output_end once
+ * the page has been printed; the latter writes the page's record and
+ * starts timing the next page's interpretation.
+ */
+void gx_perf_page_output_begin(gx_perf_t *perf);
+void gx_perf_page_output_end(gx_perf_t *perf, gx_device *dev, bool background);
+
+/* Close the log and free its state; called when the instance ends. */
+void gx_perf_log_finit(gs_memory_t *mem);
+
+#endif /* gxperf_INCLUDED */
@@ -30,6 +30,7 @@
 #include "gxshade.h"
 #include "gxshade4.h"
 #include "gsicc_cache.h"
+#include "gxdevsop.h"
 
 /* Initialize the fill state for triangle shading. */
 int
@@ -113,6 +114,7 @@ gs_shading_FfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
         if (pfs.icclink != NULL) gsicc_release_link(pfs.icclink);
         return code;
     }
+    pfs.direct_fill = (dev_proc(dev, dev_spec_op)(dev, gxdso_shading_direct_fill, NULL, 0) > 0);
     reserve_colors(&pfs, C, 3); /* Can't fail */
     va.c = ca = C[0];
     vb.c = cb = C[1];
@@ -187,6 +189,7 @@ gs_shading_LfGt_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
     code = init_patch_fill_state(&pfs);
     if (code < 0)
         goto out;
+    pfs.direct_fill = (dev_proc(dev, dev_spec_op)(dev, gxdso_shading_direct_fill, NULL, 0) > 0);
     reserve_colors(&pfs, &cn, 1); /* Can't fail. */
     next.c = cn;
     shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params,
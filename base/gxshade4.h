@@ -133,6 +133,7 @@ struct patch_fill_state_s {
     bool monotonic_color;
     bool linear_color;
     bool unlinear;
+    bool direct_fill; /* Evaluate the color at each pixel, see gxdso_shading_direct_fill. */
     bool inside;
     int color_stack_size;
     int color_stack_step;
@@ -141,6 +142,7 @@ struct patch_fill_state_s {
     byte *color_stack_limit;
     gs_memory_t *memory; /* Where color_buffer is allocated. */
     gs_color_index_cache_t *pcic;
+    gx_device_color *function_colors; /* The Function sampled over its Domain, for direct_fill. */
 } ;
 
 /* Define a structure for mesh or patch vertex. */
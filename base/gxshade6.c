@@ -295,7 +295,9 @@ init_patch_fill_state(patch_fill_state_t *pfs)
     pfs->color_stack = NULL;
     pfs->color_stack_limit = NULL;
     pfs->unlinear = !is_linear_color_applicable(pfs);
+    pfs->direct_fill = false; /* Mesh shadings ask the device, see gxdso_shading_direct_fill. */
     pfs->pcic = NULL;
+    pfs->function_colors = NULL;
     return alloc_patch_fill_memory(pfs, pfs->pgs->memory, pcs);
 }
 
@@ -310,6 +312,8 @@ term_patch_fill_state(patch_fill_state_t *pfs)
         gs_free_object(pfs->memory, pfs->color_stack, "term_patch_fill_state");
     if (pfs->pcic != NULL)
         gs_color_index_cache_destroy(pfs->pcic);
+    if (pfs->function_colors != NULL)
+        gs_free_object(pfs->memory, pfs->function_colors, "term_patch_fill_state");
     return b;
 }
 
@@ -461,6 +465,7 @@ gs_shading_Cp_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
         if (state.icclink != NULL) gsicc_release_link(state.icclink);
         return code;
     }
+    state.direct_fill = (dev_proc(dev, dev_spec_op)(dev, gxdso_shading_direct_fill, NULL, 0) > 0);
 
     curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
     shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params, pgs);
@@ -549,6 +554,7 @@ gs_shading_Tpp_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
     code = init_patch_fill_state(&state);
     if(code < 0)
         return code;
+    state.direct_fill = (dev_proc(dev, dev_spec_op)(dev, gxdso_shading_direct_fill, NULL, 0) > 0);
     curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
     shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params, pgs);
     while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
@@ -2534,6 +2540,214 @@ constant_color_triangle(patch_fill_state_t *pfs,
     return code;
 }
 
+/* The x coordinate of the edge p0-p1 (p0->y < p1->y) at the scanline y. */
+static inline fixed
+edge_x_at(const gs_fixed_point *p0, const gs_fixed_point *p1, fixed y)
+{
+    return p0->x + (fixed)((int64_t)(p1->x - p0->x) * (y - p0->y) / (p1->y - p0->y));
+}
+
+/* The number of Function samples for direct_color_triangle. */
+#define DIRECT_FUNCTION_SAMPLES 1024
+
+static int
+direct_function_colors(patch_fill_state_t *pfs, patch_color_t *c)
+{   /* Sample a Function of one argument over its Domain once per shading,
+       and map the samples to device colors, so that direct_color_triangle
+       looks up a table rather than evaluates and remaps at each pixel.
+       With 1024 samples the step is below the device color precision
+       for any Function which doesn't jump. */
+    const float *domain = pfs->Function->params.Domain;
+    const int n = pfs->Function->params.n;
+    const gs_color_space *pcs = pfs->direct_space;
+    gx_device_color *dc = (gx_device_color *)gs_alloc_byte_array(pfs->memory,
+                DIRECT_FUNCTION_SAMPLES, sizeof(gx_device_color), "direct_function_colors");
+    float *t = (float *)gs_alloc_byte_array(pfs->memory,
+                DIRECT_FUNCTION_SAMPLES * (1 + n), sizeof(float), "direct_function_colors");
+    float *values;
+    bool batch;
+    int i, code = 0;
+
+    if (dc == NULL || t == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto out;
+    }
+    values = t + DIRECT_FUNCTION_SAMPLES;
+    /* Evaluate all samples with one call. If that fails, evaluate
+       them one by one, which ignores the errors as other fills do. */
+    for (i = 0; i < DIRECT_FUNCTION_SAMPLES; i++)
+        t[i] = domain[0] + (domain[1] - domain[0]) * i / (DIRECT_FUNCTION_SAMPLES - 1);
+    batch = (gs_function_evaluate_multiple(pfs->Function, t, values,
+                                           DIRECT_FUNCTION_SAMPLES) >= 0);
+    for (i = 0; i < DIRECT_FUNCTION_SAMPLES; i++) {
+        c->t[0] = t[i];
+        if (batch) {
+            memcpy(c->cc.paint.values, values + i * n, n * sizeof(float));
+            pcs->type->restrict_color(&c->cc, pcs);
+        } else
+            patch_resolve_color_inline(c, pfs);
+        code = patch_color_to_device_color_inline(pfs, c, &dc[i], NULL);
+        if (code < 0)
+            goto out;
+        dc[i].tag = device_current_tag(pfs->dev);
+    }
+    pfs->function_colors = dc;
+    dc = NULL;
+out:
+    gs_free_object(pfs->memory, t, "direct_function_colors");
+    gs_free_object(pfs->memory, dc, "direct_function_colors");
+    return code;
+}
+
+static int
+direct_color_triangle(patch_fill_state_t *pfs,
+        const shading_vertex_t *p0, const shading_vertex_t *p1, const shading_vertex_t *p2)
+{
+    /* Scan-convert the triangle and evaluate the color along each scanline,
+       interpolating the color (or the Function argument) linearly
+       with barycentric coordinates. A Function is looked up at each pixel
+       in the table of device colors. Other colors are remapped at a step,
+       within which the color changes less than the device can show,
+       or less than the smoothness tolerance with a halftone.
+       Pixel runs with an equal device color are painted with a single
+       rectangle. The pixel center rule is same as in gx_default_fill_trapezoid,
+       so that triangles sharing a side neither overlap nor leave a gap. */
+    const shading_vertex_t *v[3], *vv;
+    const bool function = (pfs->Function != NULL);
+    const int n = (function ? pfs->n_color_args : pfs->num_components);
+    const gx_device_color *table = NULL;
+    double t0 = 0, t_scale = 0;
+    double dadx[GS_CLIENT_COLOR_MAX_COMPONENTS], dady[GS_CLIENT_COLOR_MAX_COMPONENTS];
+    double amin[GS_CLIENT_COLOR_MAX_COMPONENTS], amax[GS_CLIENT_COLOR_MAX_COMPONENTS];
+    double a[GS_CLIENT_COLOR_MAX_COMPONENTS];
+    const float *a0, *a1, *a2;
+    float *pa;
+    patch_color_t *c[1];
+    gx_device_color dc, run_dc;
+    const gx_device_color *pdc, *prun;
+    double x0, y0, x10, y10, x20, y20, det, slope = 0;
+    int iy, iy1, ixmin, ixmax, step = 1, i, k, code = 0;
+    byte *color_stack_ptr;
+
+    v[0] = p0; v[1] = p1; v[2] = p2;
+    for (i = 0; i < 2; i++) {
+        for (k = 0; k < 2 - i; k++)
+            if (v[k]->p.y > v[k + 1]->p.y)
+                vv = v[k], v[k] = v[k + 1], v[k + 1] = vv;
+    }
+    iy = fixed2int_pixround(max(v[0]->p.y, pfs->rect.p.y));
+    iy1 = fixed2int_pixround(min(v[2]->p.y, pfs->rect.q.y));
+    if (iy >= iy1)
+        return 0;
+    ixmin = fixed2int_pixround(pfs->rect.p.x);
+    ixmax = fixed2int_pixround(pfs->rect.q.x);
+    x0 = fixed2float(v[0]->p.x);
+    y0 = fixed2float(v[0]->p.y);
+    x10 = fixed2float(v[1]->p.x) - x0;
+    y10 = fixed2float(v[1]->p.y) - y0;
+    x20 = fixed2float(v[2]->p.x) - x0;
+    y20 = fixed2float(v[2]->p.y) - y0;
+    det = x10 * y20 - x20 * y10;
+    if (det == 0)
+        return 0; /* Zero area. */
+    a0 = (function ? v[0]->c->t : v[0]->c->cc.paint.values);
+    a1 = (function ? v[1]->c->t : v[1]->c->cc.paint.values);
+    a2 = (function ? v[2]->c->t : v[2]->c->cc.paint.values);
+    for (k = 0; k < n; k++) {
+        double a10 = a1[k] - a0[k], a20 = a2[k] - a0[k];
+
+        dadx[k] = (a10 * y20 - a20 * y10) / det;
+        dady[k] = (a20 * x10 - a10 * x20) / det;
+        /* Pixel centers are inside the triangle, but rounding errors
+           must not extrapolate the color out of the vertex colors. */
+        amin[k] = min(a0[k], min(a1[k], a2[k]));
+        amax[k] = max(a0[k], max(a1[k], a2[k]));
+        if (!function)
+            slope = max(slope, any_abs(dadx[k]) / pfs->color_domain.paint.values[k]);
+    }
+    if (slope > 0) {
+        /* With a halftone the tolerance is same as for constant color areas,
+           but the area boundaries follow the color contours. */
+        double precision = (gx_get_cmap_procs(pfs->pgs, pfs->dev)->is_halftoned(pfs->pgs, pfs->dev) ?
+                                pfs->smoothness : 0.25 / min_linear_grades);
+
+        step = (int)min(precision / slope, max_int);
+        step = max(step, 1);
+    }
+    color_stack_ptr = reserve_colors_inline(pfs, c, 1);
+    if (color_stack_ptr == NULL)
+        return_error(gs_error_unregistered); /* Must not happen. */
+    if (function && n == 1 &&
+            pfs->Function->params.Domain[1] > pfs->Function->params.Domain[0]) {
+        if (pfs->function_colors == NULL)
+            code = direct_function_colors(pfs, c[0]);
+        table = pfs->function_colors;
+        t0 = pfs->Function->params.Domain[0];
+        t_scale = (DIRECT_FUNCTION_SAMPLES - 1) /
+                (pfs->Function->params.Domain[1] - pfs->Function->params.Domain[0]);
+    }
+    pa = (function ? c[0]->t : c[0]->cc.paint.values);
+    for (; iy < iy1 && code >= 0; iy++) {
+        fixed y = int2fixed(iy) + fixed_half;
+        fixed xa = edge_x_at(&v[0]->p, &v[2]->p, y), xb;
+        int ix, ix1, run_x;
+
+        if (y < v[1]->p.y)
+            xb = edge_x_at(&v[0]->p, &v[1]->p, y);
+        else
+            xb = edge_x_at(&v[1]->p, &v[2]->p, y);
+        if (xa > xb) {
+            fixed t = xa; xa = xb; xb = t;
+        }
+        ix = max(fixed2int_pixround(xa), ixmin);
+        ix1 = min(fixed2int_pixround(xb), ixmax);
+        if (ix >= ix1)
+            continue;
+        /* Sample at the middle of the step. */
+        for (k = 0; k < n; k++)
+            a[k] = a0[k] + dadx[k] * (ix + step * 0.5 - x0) + dady[k] * (fixed2float(y) - y0);
+        pdc = prun = NULL;
+        for (run_x = ix; ix < ix1; ix += step) {
+            for (k = 0; k < n; k++) {
+                pa[k] = (float)(a[k] < amin[k] ? amin[k] : a[k] > amax[k] ? amax[k] : a[k]);
+                a[k] += dadx[k] * step;
+            }
+            if (table != NULL) {
+                double u = (pa[0] - t0) * t_scale + 0.5;
+                int j = (u < 0 ? 0 : u >= DIRECT_FUNCTION_SAMPLES ? DIRECT_FUNCTION_SAMPLES - 1 : (int)u);
+
+                if (&table[j] == pdc)
+                    continue;
+                pdc = &table[j];
+            } else {
+                if (function)
+                    patch_resolve_color_inline(c[0], pfs);
+                code = patch_color_to_device_color_inline(pfs, c[0], &dc, NULL);
+                if (code < 0)
+                    break;
+                dc.tag = device_current_tag(pfs->dev);
+                pdc = &dc;
+            }
+            if (prun == NULL) {
+                run_dc = *pdc;
+                prun = &run_dc;
+            } else if (!gx_device_color_equal(pdc, prun)) {
+                code = gx_fill_rectangle_device_rop(run_x, iy, ix - run_x, 1,
+                                prun, pfs->dev, pfs->pgs->log_op);
+                if (code < 0)
+                    break;
+                run_x = ix;
+                run_dc = *pdc;
+            }
+        }
+        if (code >= 0 && prun != NULL)
+            code = gx_fill_rectangle_device_rop(run_x, iy, ix1 - run_x, 1,
+                                prun, pfs->dev, pfs->pgs->log_op);
+    }
+    release_colors_inline(pfs, color_stack_ptr, 1);
+    return code;
+}
+
 static inline int
 constant_color_quadrangle_aux(patch_fill_state_t *pfs, const quadrangle_patch *p, bool self_intersecting,
         patch_color_t *c[3])
@@ -2842,6 +3056,13 @@ triangle_by_4(patch_fill_state_t *pfs,
     p12.c = c[1];
     p20.c = c[2];
     code = try_device_linear_color(pfs, false, p0, p1, p2);
+    if (pfs->direct_fill && (code == 2 || (code == 1 && pfs->Function != NULL))) {
+        /* Don't decompose, evaluate the color at each pixel instead.
+           When the device can't interpolate colors linearly,
+           or the Function makes the color unlinear. */
+        code = direct_color_triangle(pfs, p0, p1, p2);
+        goto out;
+    }
     switch(code) {
         case 0: /* The area is filled. */
             goto out;
@@ -3020,6 +3241,7 @@ gx_init_patch_fill_state_for_clist(gx_device *dev, patch_fill_state_t *pfs, gs_m
     pfs->monotonic_color = true;
     pfs->linear_color = true;
     pfs->unlinear = false; /* Because it is used when fill_linear_color_triangle was called. */
+    pfs->direct_fill = false;
     pfs->inside = false;
     pfs->color_stack_size = 0;
     pfs->color_stack_step = dev->color_info.num_components;
@@ -3027,6 +3249,7 @@ gx_init_patch_fill_state_for_clist(gx_device *dev, patch_fill_state_t *pfs, gs_m
     pfs->color_stack = NULL; /* fixme */
     pfs->color_stack_limit = NULL; /* fixme */
     pfs->pcic = NULL; /* Will do someday. */
+    pfs->function_colors = NULL;
     pfs->trans_device = NULL;
     pfs->icclink = NULL;
     return alloc_patch_fill_memory(pfs, memory, NULL);
@@ -3367,6 +3590,34 @@ quadrangle_color_change(const patch_fill_state_t *pfs, const quadrangle_patch *p
     return color_change_general;
 }
 
+static inline double
+quadrangle_color_twist(const patch_fill_state_t *pfs, const quadrangle_patch *p)
+{   /* The norm of the bilinear term of the color interpolation,
+       relative to the color domain or to the Function domain. */
+    if (pfs->Function != NULL) {
+        const float *domain = pfs->Function->params.Domain;
+        double m = 0;
+        int i;
+
+        for (i = 0; i < pfs->n_color_args; i++) {
+            double d = (double)p->p[0][0]->c->t[i] - p->p[0][1]->c->t[i]
+                     - p->p[1][0]->c->t[i] + p->p[1][1]->c->t[i];
+            double span = domain[2 * i + 1] - domain[2 * i];
+
+            if (span > 0)
+                m = max(m, any_abs(d) / span);
+        }
+        return m;
+    } else {
+        patch_color_t d0001, d1011, d;
+
+        color_diff(pfs, p->p[0][0]->c, p->p[0][1]->c, &d0001);
+        color_diff(pfs, p->p[1][0]->c, p->p[1][1]->c, &d1011);
+        color_diff(pfs, &d0001, &d1011, &d);
+        return color_norm(pfs, &d);
+    }
+}
+
 static int
 fill_quadrangle(patch_fill_state_t *pfs, const quadrangle_patch *p, bool big)
 {
@@ -3441,7 +3692,17 @@ fill_quadrangle(patch_fill_state_t *pfs, const quadrangle_patch *p, bool big)
             return (QUADRANGLES || !pfs->maybe_self_intersecting ?
                         constant_color_quadrangle : triangles4)(pfs, p,
                             pfs->maybe_self_intersecting);
-        if (!pfs->monotonic_color) {
+        if (pfs->direct_fill) {
+            /* The triangles evaluate the color at each pixel,
+               so divide only while the bilinear term of the color
+               interpolation is significant. */
+            if (quadrangle_color_twist(pfs, p) <= pfs->smoothness)
+                return triangles4(pfs, p, true);
+            if (is_big_u && (!is_big_v || size_u > size_v))
+                divide_u = true;
+            else
+                divide_v = true;
+        } else if (!pfs->monotonic_color) {
             bool not_monotonic_by_u = false, not_monotonic_by_v = false;
 
             code = is_quadrangle_color_monotonic(pfs, p, &not_monotonic_by_u, &not_monotonic_by_v);
@@ -3454,7 +3715,7 @@ fill_quadrangle(patch_fill_state_t *pfs, const quadrangle_patch *p, bool big)
             if (!divide_u && !divide_v)
                 pfs->monotonic_color = true;
         }
-        if (pfs->monotonic_color && !pfs->linear_color) {
+        if (!pfs->direct_fill && pfs->monotonic_color && !pfs->linear_color) {
             if (divide_v && divide_u) {
                 if (size_u > size_v)
                     divide_v = false;
@@ -3491,7 +3752,7 @@ fill_quadrangle(patch_fill_state_t *pfs, const quadrangle_patch *p, bool big)
             if (!divide_u && !divide_v)
                 pfs->linear_color = true;
         }
-        if (!pfs->linear_color) {
+        if (pfs->direct_fill || !pfs->linear_color) {
             /* go to divide. */
         } else switch(quadrangle_color_change(pfs, p, is_big_u, is_big_v, size_u, size_v, &divide_u, &divide_v)) {
             case color_change_small:
@@ -106,6 +106,11 @@ typedef struct jpeg_decompress_data_s {
                                          * so we use a function at the interpreter level
                                          */
     void *device;                       /* The device we need to send PassThrough data to */
+    int scale_denom;            /* 1, 2, 4 or 8: decode at 1/scale_denom of */
+                                /* the size and replicate the samples back */
+                                /* up, for images the device will shrink */
+    uint rows_out;              /* # of full size rows output, if scaled */
+    int rows_to_repeat;         /* # of times to output the same row again */
 } jpeg_decompress_data;
 
 #define private_st_jpeg_decompress_data()	/* in zfdctd.c */\
@@ -106,6 +106,8 @@ s_DCTD_init(stream_state * st)
     ss->data.decompress->skip = 0;
     ss->data.decompress->input_eod = false;
     ss->data.decompress->faked_eoi = false;
+    ss->data.decompress->rows_out = 0;
+    ss->data.decompress->rows_to_repeat = 0;
     ss->phase = 0;
     return 0;
 }
@@ -171,6 +173,34 @@ update_jpeg_header_height(JOCTET *d, size_t len, int height)
     }
 }
 
+/* Are there more rows to output? */
+static inline bool
+dctd_more_rows(jpeg_decompress_data *jddp)
+{
+    if (jddp->scale_denom > 1)
+        return jddp->rows_out < jddp->dinfo.image_height;
+    return jddp->dinfo.output_height > jddp->dinfo.output_scanline;
+}
+
+/* Replicate the samples of a row decoded at 1/scale_denom of the width to
+ * make a full width row, in place. Working from the right, we never
+ * overwrite a sample before it has been copied. */
+static void
+dctd_expand_row(jpeg_decompress_data *jddp, byte *row)
+{
+    int nc = jddp->dinfo.output_components;
+    int shift = jddp->scale_denom == 8 ? 3 : jddp->scale_denom == 4 ? 2 : 1;
+    int x, c;
+
+    for (x = jddp->dinfo.image_width - 1; x >= 0; x--) {
+        const byte *src = row + (x >> shift) * nc;
+        byte *dst = row + x * nc;
+
+        for (c = 0; c < nc; c++)
+            dst[c] = src[c];
+    }
+}
+
 /* Process a buffer */
 static int
 s_DCTD_process(stream_state * st, stream_cursor_read * pr,
@@ -280,6 +310,14 @@ s_DCTD_process(stream_state * st, stream_cursor_read * pr,
                 /* out_color_space will default to JCS_CMYK */
                 break;
             }
+
+            /* We decode at a reduced size only if we know how tall the
+             * image is, to replicate the rows back up. */
+            if (jddp->scale_denom > 1 && jddp->dinfo.image_height > 0) {
+                jddp->dinfo.scale_num = 1;
+                jddp->dinfo.scale_denom = jddp->scale_denom;
+            } else
+                jddp->scale_denom = 1;
             ss->phase = 2;
             /* falls through */
         case 2:		/* start_decompress */
@@ -294,13 +332,19 @@ s_DCTD_process(stream_state * st, stream_cursor_read * pr,
                     (jddp->PassThroughfn)(jddp->device, Buf, pr->ptr - (Buf - 1));
                 return 0;
             }
+            if (jddp->scale_denom > 1 &&
+                jddp->dinfo.output_width == jddp->dinfo.image_width &&
+                jddp->dinfo.output_height == jddp->dinfo.image_height)
+                jddp->scale_denom = 1;  /* too small to scale */
+            /* We always output the full size image */
             ss->scan_line_size =
-                jddp->dinfo.output_width * jddp->dinfo.output_components;
+                jddp->dinfo.image_width * jddp->dinfo.output_components;
             if_debug4m('w', ss->memory, "[wdd]width=%u, components=%d, scan_line_size=%u, min_out_size=%u\n",
                        jddp->dinfo.output_width,
                        jddp->dinfo.output_components,
                        ss->scan_line_size, jddp->templat.min_out_size);
-            if (ss->scan_line_size > (uint) jddp->templat.min_out_size) {
+            if (ss->scan_line_size > (uint) jddp->templat.min_out_size ||
+                jddp->scale_denom > 1) {
                 /* Create a spare buffer for oversize scanline */
                 jddp->scanline_buffer =
                     gs_alloc_bytes_immovable(gs_memory_stable(jddp->memory),
@@ -338,7 +382,7 @@ s_DCTD_process(stream_state * st, stream_cursor_read * pr,
                 if ((jddp->bytes_in_scanline != 0) || /* no room for complete scan */
                     ((jddp->bytes_in_scanline == 0) && (tomove > 0) && /* 1 scancopy completed */
                      (avail < tomove) && /* still room for 1 more scan */
-                     (jddp->dinfo.output_height > jddp->dinfo.output_scanline))) /* more scans to do */
+                     dctd_more_rows(jddp))) /* more scans to do */
                 {
                      if (jddp->PassThrough && jddp->PassThroughfn) {
                         (jddp->PassThroughfn)(jddp->device, Buf, pr->ptr - (Buf - 1));
@@ -347,10 +391,17 @@ s_DCTD_process(stream_state * st, stream_cursor_read * pr,
                 }
             }
             /* while not done with image, decode 1 scan, otherwise fall into phase 4 */
-            while (jddp->dinfo.output_height > jddp->dinfo.output_scanline) {
+            while (dctd_more_rows(jddp)) {
                 int read;
                 byte *samples;
 
+                if (jddp->rows_to_repeat > 0) {
+                    /* Output the same scaled up row again */
+                    jddp->rows_to_repeat--;
+                    jddp->rows_out++;
+                    jddp->bytes_in_scanline = ss->scan_line_size;
+                    goto dumpbuffer;
+                }
                 if (jddp->scanline_buffer != NULL)
                     samples = jddp->scanline_buffer;
                 else {
@@ -397,6 +448,12 @@ s_DCTD_process(stream_state * st, stream_cursor_read * pr,
                     }
                     return 0;	/* need more data */
                 }
+                if (jddp->scale_denom > 1) {
+                    dctd_expand_row(jddp, samples);
+                    jddp->rows_to_repeat = min(jddp->scale_denom,
+                                               jddp->dinfo.image_height - jddp->rows_out) - 1;
+                    jddp->rows_out++;
+                }
                 if (jddp->scanline_buffer != NULL) {
                     jddp->bytes_in_scanline = ss->scan_line_size;
                     goto dumpbuffer;
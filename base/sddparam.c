@@ -63,6 +63,17 @@ s_DCTD_put_params(gs_param_list * plist, stream_DCT_state * pdct)
         (code = s_DCT_put_huffman_tables(plist, pdct, false)) < 0 ||
         (code = s_DCT_put_quantization_tables(plist, pdct, false)) < 0
         )
-        DO_NOTHING;
-    return code;
+        return code;
+    /* Not an Adobe parameter: for callers which know the image will be
+     * drawn at a fraction of its size. */
+    code = param_read_int(plist, "ScaleDenom", &pdct->data.decompress->scale_denom);
+    if (code < 0)
+        return code;
+    switch (pdct->data.decompress->scale_denom) {
+        case 1: case 2: case 4: case 8:
+            break;
+        default:
+            return_error(gs_error_rangecheck);
+    }
+    return 0;
 }
@@ -24,6 +24,10 @@
 #include "siscale.h"
 #include "gxfrac.h"
 
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
 /*
  *    Image scaling code is based on public domain code from
  *      Graphics Gems III (pp. 414-424), Academic Press, 1992.
@@ -67,6 +71,9 @@ typedef struct stream_IScale_state_s {
     byte *tmp;
     CLIST *contrib;
     CONTRIB *items;
+    short *items16;             /* horizontal weights for the SSE2 code, */
+    /* items16_stride per output pixel, zero padded; or NULL */
+    int items16_stride;
     /* The following are updated dynamically. */
     int src_y;
     uint src_offset, src_size;
@@ -85,10 +92,10 @@ typedef struct stream_IScale_state_s {
     zoom_x_fn *zoom_x;
 } stream_IScale_state;
 
-gs_private_st_ptrs6(st_IScale_state, stream_IScale_state,
+gs_private_st_ptrs7(st_IScale_state, stream_IScale_state,
     "ImageScaleEncode/Decode state",
     iscale_state_enum_ptrs, iscale_state_reloc_ptrs,
-    dst, src, tmp, contrib, items, dst_items);
+    dst, src, tmp, contrib, items, items16, dst_items);
 
 /* ------ Digital filter definition ------ */
 
@@ -478,6 +485,287 @@ zoom_x2(byte * gs_restrict tmp, const void /*PixelIn */ * gs_restrict src,
     }
 }
 
+#ifdef HAVE_SSE2
+/*
+ * SSE2 versions of the filters. These form exactly the same integer sums
+ * as the C code, several products at a time with pmaddwd, so the results
+ * are identical. pmaddwd needs 16 bit weights: the horizontal ones are
+ * copied into items16 by do_init when they fit, and the vertical ones
+ * (which are scaled up for 16 bit output) are split into 15 bit halves.
+ */
+
+/* Add the 4 lanes of v. */
+static inline int
+sse2_hsum_epi32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4e));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xb1));
+    return _mm_cvtsi128_si32(v);
+}
+
+/* One output pixel of zoom_x, done the C way. */
+static void
+zoom_x_pixel(byte * gs_restrict tp, const void * gs_restrict src,
+             int sizeofPixelIn, int Colors, const CLIST * gs_restrict clp,
+             const CONTRIB * gs_restrict items)
+{
+    int c, j;
+
+    for (c = 0; c < Colors; ++c) {
+        const CONTRIB *gs_restrict cp = items + clp->index;
+        int k = clp->first_pixel + c;
+        int weight = 0;
+
+        if (sizeofPixelIn == 1)
+            for (j = clp->n; j > 0; k += Colors, ++cp, --j)
+                weight += ((const byte *)src)[k] * cp->weight;
+        else
+            for (j = clp->n; j > 0; k += Colors, ++cp, --j)
+                weight += ((const bits16 *)src)[k] * cp->weight;
+        weight = (weight + CONTRIB_ROUND)>>CONTRIB_SHIFT;
+        tp[c] = (byte)CLAMP(weight, 0, 255);
+    }
+}
+
+/*
+ * Apply filter to zoom horizontally from src to tmp, for 1, 3 or 4
+ * components of 8 or 16 bits. Gray works through 8 contributors at a
+ * time; colour works through pairs of contributors, interleaving the
+ * components of the two pixels so that each 32 bit lane accumulates one
+ * component. 16 bit samples are biased by 0x8000 to make them signed, and
+ * the bias is put back as 0x8000 times the sum of the weights.
+ */
+static void
+zoom_x_sse2(stream_IScale_state * ss, byte * gs_restrict tmp,
+            const void /*PixelIn */ * gs_restrict src, int skip, int tmp_width)
+{
+    int Colors = ss->params.spp_interp;
+    int sizeofPixelIn = ss->sizeofPixelIn;
+    const CLIST *gs_restrict clp = ss->contrib + skip;
+    const short *gs_restrict wp0 = ss->items16 + skip * ss->items16_stride;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    const __m128i round = _mm_set1_epi32(CONTRIB_ROUND);
+
+    tmp += Colors * skip;
+    for ( ; tmp_width != 0; --tmp_width, ++clp, wp0 += ss->items16_stride, tmp += Colors ) {
+        int n = clp->n;
+        const short *gs_restrict wp = wp0;
+        __m128i acc = zero;
+        int wsum = 0;
+        uint reach;
+        int j, v;
+
+        /* Don't let the vector loads run off the end of the source row. */
+        if (Colors == 1)
+            reach = (clp->first_pixel + ((n + 7) & ~7)) * sizeofPixelIn;
+        else
+            reach = (clp->first_pixel + (((n + 1) & ~1) - 2) * Colors + 8) * sizeofPixelIn;
+        if (reach > ss->src_size) {
+            zoom_x_pixel(tmp, src, sizeofPixelIn, Colors, clp, ss->items);
+            continue;
+        }
+        if (Colors == 1) {
+            if (sizeofPixelIn == 1) {
+                const byte *gs_restrict pp = (const byte *)src + clp->first_pixel;
+
+                for (j = 0; j < n; j += 8, pp += 8, wp += 8) {
+                    __m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pp), zero);
+
+                    acc = _mm_add_epi32(acc, _mm_madd_epi16(p, _mm_loadu_si128((const __m128i *)wp)));
+                }
+            } else {
+                const bits16 *gs_restrict pp = (const bits16 *)src + clp->first_pixel;
+                const __m128i ones = _mm_set1_epi16(1);
+                __m128i wacc = zero;
+
+                for (j = 0; j < n; j += 8, pp += 8, wp += 8) {
+                    __m128i p = _mm_xor_si128(_mm_loadu_si128((const __m128i *)pp), bias);
+                    __m128i w = _mm_loadu_si128((const __m128i *)wp);
+
+                    acc = _mm_add_epi32(acc, _mm_madd_epi16(p, w));
+                    wacc = _mm_add_epi32(wacc, _mm_madd_epi16(w, ones));
+                }
+                wsum = sse2_hsum_epi32(wacc);
+            }
+            v = sse2_hsum_epi32(acc) + (int)((uint)wsum << 15);
+            v = (v + CONTRIB_ROUND)>>CONTRIB_SHIFT;
+            *tmp = (byte)CLAMP(v, 0, 255);
+            continue;
+        }
+        if (sizeofPixelIn == 1) {
+            const byte *gs_restrict pp = (const byte *)src + clp->first_pixel;
+
+            for (j = 0; j < n; j += 2, pp += 2 * Colors, wp += 2) {
+                __m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pp), zero);
+                int pair;
+
+                p = _mm_unpacklo_epi16(p, Colors == 3 ? _mm_srli_si128(p, 6) : _mm_srli_si128(p, 8));
+                memcpy(&pair, wp, sizeof(pair));
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(p, _mm_set1_epi32(pair)));
+            }
+        } else {
+            const bits16 *gs_restrict pp = (const bits16 *)src + clp->first_pixel;
+
+            for (j = 0; j < n; j += 2, pp += 2 * Colors, wp += 2) {
+                __m128i p = _mm_xor_si128(_mm_loadu_si128((const __m128i *)pp), bias);
+                int pair;
+
+                p = _mm_unpacklo_epi16(p, Colors == 3 ? _mm_srli_si128(p, 6) : _mm_srli_si128(p, 8));
+                memcpy(&pair, wp, sizeof(pair));
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(p, _mm_set1_epi32(pair)));
+                wsum += wp[0] + wp[1];
+            }
+            acc = _mm_add_epi32(acc, _mm_set1_epi32((int)((uint)wsum << 15)));
+        }
+        acc = _mm_srai_epi32(_mm_add_epi32(acc, round), CONTRIB_SHIFT);
+        acc = _mm_packs_epi32(acc, acc);
+        v = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+        tmp[0] = (byte)v;
+        tmp[1] = (byte)(v >> 8);
+        tmp[2] = (byte)(v >> 16);
+        if (Colors == 4)
+            tmp[3] = (byte)(v >> 24);
+    }
+}
+
+/*
+ * Set up items16 for zoom_x_sse2, if it can be used. Failing to allocate
+ * it isn't an error: we just use the C code.
+ */
+static void
+zoom_x_sse2_init(stream_IScale_state * ss, int WidthOut)
+{
+    int i, j, stride = 0;
+
+    if ((ss->sizeofPixelIn != 1 && ss->sizeofPixelIn != 2) ||
+        (ss->params.spp_interp != 1 && ss->params.spp_interp != 3 &&
+         ss->params.spp_interp != 4))
+        return;
+    for (i = 0; i < WidthOut; ++i) {
+        const CONTRIB *cp = ss->items + ss->contrib[i].index;
+
+        for (j = 0; j < ss->contrib[i].n; ++j)
+            if (cp[j].weight < -32768 || cp[j].weight > 32767)
+                return;
+        if (ss->contrib[i].n > stride)
+            stride = ss->contrib[i].n;
+    }
+    /* Gray reads 8 weights at a time, colour 2; pad to 8 for both. */
+    stride = (stride + 7) & ~7;
+    ss->items16 = (short *)gs_alloc_byte_array(ss->memory, (size_t)WidthOut * stride,
+                                               sizeof(short), "image_scale contrib16[*]");
+    if (ss->items16 == NULL)
+        return;
+    ss->items16_stride = stride;
+    memset(ss->items16, 0, (size_t)WidthOut * stride * sizeof(short));
+    for (i = 0; i < WidthOut; ++i) {
+        const CONTRIB *cp = ss->items + ss->contrib[i].index;
+
+        for (j = 0; j < ss->contrib[i].n; ++j)
+            ss->items16[i * stride + j] = (short)cp[j].weight;
+    }
+}
+
+/*
+ * Apply filter to zoom vertically from tmp to dst, 8 samples at a time.
+ * Rows are taken in pairs, and each weight w is split as
+ * (w & 0x7fff) + (w >> 15) * 0x8000 so that both parts fit pmaddwd.
+ * Returns false if there are too many rows for this, in which case the
+ * caller uses the C code.
+ */
+#define ZOOM_Y_SSE2_MAX_N 16
+static bool
+zoom_y_sse2(void /*PixelOut */ * gs_restrict dst,
+            const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
+            int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items,
+            int sizeofPixelOut, int MaxValueOut)
+{
+    int kn = Stride * Colors;
+    int width = WidthOut * Colors;
+    int cn = contrib->n;
+    int npairs = (cn + 1) >> 1;
+    const CONTRIB *gs_restrict cbp = items + contrib->index;
+    __m128i wlo[ZOOM_Y_SSE2_MAX_N / 2], whi[ZOOM_Y_SSE2_MAX_N / 2];
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(CONTRIB_ROUND);
+    const __m128i vmax = _mm_set1_epi32(MaxValueOut);
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+    bool need_hi = false;
+    int i, j;
+
+    if (cn > ZOOM_Y_SSE2_MAX_N || width < 8)
+        return false;
+    for (j = 0; j < npairs; ++j) {
+        int w0 = cbp[2 * j].weight;
+        int w1 = (2 * j + 1 < cn ? cbp[2 * j + 1].weight : 0);
+
+        wlo[j] = _mm_set1_epi32((int)((w0 & 0x7fff) | ((uint)(w1 & 0x7fff) << 16)));
+        whi[j] = _mm_set1_epi32((int)(((uint)(w0 >> 15) & 0xffff) | ((uint)(w1 >> 15) << 16)));
+        if ((w0 >> 15) != 0 || (w1 >> 15) != 0)
+            need_hi = true;
+    }
+
+    skip *= Colors;
+    tmp += contrib->first_pixel + skip;
+    for (i = 0; i + 8 <= width; i += 8) {
+        const byte *gs_restrict pp = tmp + i;
+        __m128i lo0 = zero, lo1 = zero, hi0 = zero, hi1 = zero;
+        __m128i s0, s1;
+
+        for (j = 0; j < npairs; ++j, pp += 2 * kn) {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pp), zero);
+            __m128i b = (2 * j + 1 < cn ?
+                         _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(pp + kn)), zero) :
+                         zero);
+            __m128i ab0 = _mm_unpacklo_epi16(a, b);
+            __m128i ab1 = _mm_unpackhi_epi16(a, b);
+
+            lo0 = _mm_add_epi32(lo0, _mm_madd_epi16(ab0, wlo[j]));
+            lo1 = _mm_add_epi32(lo1, _mm_madd_epi16(ab1, wlo[j]));
+            if (need_hi) {
+                hi0 = _mm_add_epi32(hi0, _mm_madd_epi16(ab0, whi[j]));
+                hi1 = _mm_add_epi32(hi1, _mm_madd_epi16(ab1, whi[j]));
+            }
+        }
+        s0 = _mm_add_epi32(lo0, _mm_slli_epi32(hi0, 15));
+        s1 = _mm_add_epi32(lo1, _mm_slli_epi32(hi1, 15));
+        s0 = _mm_srai_epi32(_mm_add_epi32(s0, round), CONTRIB_SHIFT);
+        s1 = _mm_srai_epi32(_mm_add_epi32(s1, round), CONTRIB_SHIFT);
+        if (sizeofPixelOut == 1) {
+            s0 = _mm_packs_epi32(s0, s1);
+            _mm_storel_epi64((__m128i *)((byte *)dst + skip + i), _mm_packus_epi16(s0, s0));
+        } else {
+            __m128i m;
+
+            /* Clamp to 0..MaxValueOut, then pack as unsigned. */
+            s0 = _mm_andnot_si128(_mm_srai_epi32(s0, 31), s0);
+            s1 = _mm_andnot_si128(_mm_srai_epi32(s1, 31), s1);
+            m = _mm_cmpgt_epi32(s0, vmax);
+            s0 = _mm_or_si128(_mm_and_si128(m, vmax), _mm_andnot_si128(m, s0));
+            m = _mm_cmpgt_epi32(s1, vmax);
+            s1 = _mm_or_si128(_mm_and_si128(m, vmax), _mm_andnot_si128(m, s1));
+            s0 = _mm_packs_epi32(_mm_sub_epi32(s0, bias32), _mm_sub_epi32(s1, bias32));
+            _mm_storeu_si128((__m128i *)((bits16 *)dst + skip + i), _mm_xor_si128(s0, bias16));
+        }
+    }
+    for (; i < width; ++i) {
+        const byte *gs_restrict pp = tmp + i;
+        int weight = 0;
+
+        for (j = 0; j < cn; ++j, pp += kn)
+            weight += *pp * cbp[j].weight;
+        weight = (weight + CONTRIB_ROUND)>>CONTRIB_SHIFT;
+        if (sizeofPixelOut == 1)
+            ((byte *)dst)[skip + i] = (byte)CLAMP(weight, 0, 0xff);
+        else
+            ((bits16 *)dst)[skip + i] = (bits16)CLAMP(weight, 0, MaxValueOut);
+    }
+    return true;
+}
+#endif /* HAVE_SSE2 */
+
 /*
  * Apply filter to zoom vertically from tmp to dst.
  * This is simpler because we can treat all columns identically
@@ -591,6 +879,10 @@ static void zoom_y1(void /*PixelOut */ * gs_restrict dst,
                  const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
                  int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items)
 {
+#ifdef HAVE_SSE2
+    if (zoom_y_sse2(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items, 1, 0xff))
+        return;
+#endif
     switch(contrib->n) {
         case 4:
             zoom_y1_4(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items);
@@ -712,6 +1004,10 @@ zoom_y2(void /*PixelOut */ * gs_restrict dst,
        const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
        int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items)
 {
+#ifdef HAVE_SSE2
+    if (zoom_y_sse2(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items, 2, 0xffff))
+        return;
+#endif
     switch (contrib->n) {
         case 4:
             zoom_y2_4(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items);
@@ -834,6 +1130,10 @@ zoom_y2_frac(void /*PixelOut */ * gs_restrict dst,
              const byte * gs_restrict tmp, int skip, int WidthOut, int Stride,
             int Colors, const CLIST * gs_restrict contrib, const CONTRIB * gs_restrict items)
 {
+#ifdef HAVE_SSE2
+    if (zoom_y_sse2(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items, 2, frac_1))
+        return;
+#endif
     switch (contrib->n) {
         case 4:
             zoom_y2_frac_4(dst, tmp, skip, WidthOut, Stride, Colors, contrib, items);
@@ -905,6 +1205,7 @@ s_IScale_set_defaults(stream_state * st)
     ss->tmp = 0;
     ss->contrib = 0;
     ss->items = 0;
+    ss->items16 = 0;
 }
 
 typedef struct filter_defn_s {
@@ -939,6 +1240,7 @@ do_init(stream_state        *st,
     ss->src_y_offset = ss->params.src_y_offset;
     ss->dst_size = limited_WidthOut * ss->sizeofPixelOut * ss->params.spp_interp;
     ss->dst_offset = 0;
+    ss->items16 = 0;            /* see zoom_x_sse2_init */
 
     /* create intermediate image to hold horizontal zoom */
     ss->max_support  = vert->contrib_pixels((double)limited_EntireHeightOut /
@@ -998,6 +1300,10 @@ do_init(stream_state        *st,
                       ss->params.spp_interp, 255. / ss->params.MaxValueIn,
                       horiz->filter_width, horiz->filter, horiz->min_scale);
 
+#ifdef HAVE_SSE2
+    zoom_x_sse2_init(ss, limited_WidthOut);
+#endif
+
     /* Prepare the weights for the first output row. */
     calculate_dst_contrib(ss, 0);
 
@@ -1163,7 +1469,14 @@ s_IScale_process(stream_state * st, stream_cursor_read * pr,
             if_debug3('w', "[w]zoom_x y = %d to tmp row %d%s\n",
                       ss->src_y, (ss->src_y % ss->max_support),
                       ss->params.Active ? "" : " (Inactive)");
-            if (ss->params.Active)
+            if (ss->params.Active) {
+#ifdef HAVE_SSE2
+                if (ss->items16 != NULL)
+                    zoom_x_sse2(ss, ss->tmp + (ss->src_y % ss->max_support) *
+                                limited_WidthOut * ss->params.spp_interp,
+                                row, limited_LeftMarginOut, limited_PatchWidthOut);
+                else
+#endif
                 ss->zoom_x(/* Where to scale to (dst line address in tmp buffer) */
                        ss->tmp + (ss->src_y % ss->max_support) *
                        limited_WidthOut * ss->params.spp_interp,
@@ -1172,6 +1485,7 @@ s_IScale_process(stream_state * st, stream_cursor_read * pr,
                        limited_PatchWidthOut, /* How many pixels to produce */
                        ss->params.spp_interp, /* Color count */
                        ss->contrib, ss->items);
+            }
             pr->ptr += rcount;
             ++(ss->src_y);
             goto top;
@@ -1198,6 +1512,8 @@ s_IScale_release(stream_state * st)
     ss->dst = 0;
     gs_free_object(mem, ss->items, "image_scale contrib[*]");
     ss->items = 0;
+    gs_free_object(mem, ss->items16, "image_scale contrib16[*]");
+    ss->items16 = 0;
     gs_free_object(mem, ss->dst_items, "image_scale contrib_dst[*]");
     ss->dst_items = 0;
     gs_free_object(mem, ss->contrib, "image_scale contrib");
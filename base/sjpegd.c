@@ -44,6 +44,7 @@ gs_jpeg_create_decompress(stream_DCT_state * st)
         return_error(gs_jpeg_log_error(st));
 
     jpeg_stream_data_common_init(st->data.decompress);
+    st->data.decompress->scale_denom = 1;
 
     if (gs_jpeg_mem_init (st->memory, (j_common_ptr)&st->data.decompress->dinfo) < 0)
         return_error(gs_error_VMerror);
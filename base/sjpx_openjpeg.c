@@ -55,6 +55,16 @@ void sjpxd_destroy(gs_memory_t *mem)
 #endif
 }
 
+#if !defined(SHARE_JPX) || (SHARE_JPX == 0)
+/* The number of codecs with worker threads. Those threads allocate and
+ * free between jobs, outside our lock, so while any such codec exists
+ * opj_memory must stay set. */
+static int opj_threaded_codecs;
+#endif
+
+/* OpenJPEG's worker threads allocate too, so we always use the thread
+ * safe allocator; the same one must be used for all of a codec's
+ * allocations. */
 static int opj_lock(gs_memory_t *mem)
 {
 #if !defined(SHARE_JPX) || (SHARE_JPX == 0)
@@ -63,8 +73,8 @@ static int opj_lock(gs_memory_t *mem)
     gs_lib_ctx_t *ctx = mem->gs_lib_ctx;
 
     ret = gx_monitor_enter((gx_monitor_t *)ctx->sjpxd_private);
-    assert(opj_memory == NULL);
-    opj_memory = mem->non_gc_memory;
+    assert(opj_memory == NULL || opj_threaded_codecs > 0);
+    opj_memory = mem->thread_safe_memory != NULL ? mem->thread_safe_memory : mem->non_gc_memory;
     return ret;
 #else
     return 0;
@@ -77,7 +87,8 @@ static int opj_unlock(gs_memory_t *mem)
     gs_lib_ctx_t *ctx = mem->gs_lib_ctx;
 
     assert(opj_memory != NULL);
-    opj_memory = NULL;
+    if (opj_threaded_codecs == 0)
+        opj_memory = NULL;
     return gx_monitor_leave((gx_monitor_t *)ctx->sjpxd_private);
 #else
     return 0;
@@ -259,6 +270,9 @@ s_opjd_init(stream_state * ss)
     state->sign_comps = NULL;
     state->stream = NULL;
     state->row_data = NULL;
+    state->full_width = state->full_height = 0;
+    if (ss->memory->thread_safe_memory == NULL)
+        state->threads = 0;
 
     return 0;
 }
@@ -281,6 +295,16 @@ s_opjd_set_codec_format(stream_state * ss, OPJ_CODEC_FORMAT format)
     if (state->codec == NULL)
         return_error(gs_error_VMerror);
 
+    /* Always set this, so that OPJ_NUM_THREADS can't give OpenJPEG threads
+     * we don't know about. Without thread support in the library asking
+     * for threads fails, and we decode on this thread. */
+    if (!opj_codec_set_threads(state->codec, state->threads > 1 ? state->threads : 0))
+        state->threads = 0;
+#if !defined(SHARE_JPX) || (SHARE_JPX == 0)
+    if (state->threads > 1)
+        opj_threaded_codecs++;
+#endif
+
     /* catch events using our callbacks */
     opj_set_error_handler(state->codec, sjpx_error_callback, stderr);
     opj_set_info_handler(state->codec, sjpx_info_callback, stderr);
@@ -312,6 +336,75 @@ s_opjd_set_codec_format(stream_state * ss, OPJ_CODEC_FORMAT format)
     return 0;
 }
 
+/* Called with the lock held */
+static void
+s_opjd_destroy_codec(stream_jpxd_state * const state)
+{
+    opj_destroy_codec(state->codec);
+    state->codec = NULL;
+#if !defined(SHARE_JPX) || (SHARE_JPX == 0)
+    if (state->threads > 1)
+        opj_threaded_codecs--;
+#endif
+}
+
+static OPJ_CODEC_FORMAT
+s_opjd_codec_format(stream_jpxd_state * const state)
+{
+    /* state->sb.size is non-zero after successful
+       accumulate_input(); 1 is probably extremely rare */
+    if (state->sb.data[0] == 0xFF && ((state->sb.size == 1) || (state->sb.data[1] == 0x4F)))
+        return OPJ_CODEC_J2K;
+    return OPJ_CODEC_JP2;
+}
+
+/* Throw the codec away and start again on the same data */
+static int
+s_opjd_restart(stream_jpxd_state * const state)
+{
+    int code;
+
+    opj_image_destroy(state->image);
+    state->image = NULL;
+    opj_stream_destroy(state->stream);
+    state->stream = NULL;
+    s_opjd_destroy_codec(state);
+    state->sb.pos = 0;
+
+    code = s_opjd_set_codec_format((stream_state *)state, s_opjd_codec_format(state));
+    if (code < 0)
+        return code;
+#if OPJ_VERSION_MAJOR >= 2 && OPJ_VERSION_MINOR >= 1
+    opj_stream_set_user_data(state->stream, &(state->sb), NULL);
+#else
+    opj_stream_set_user_data(state->stream, &(state->sb));
+#endif
+    opj_stream_set_user_data_length(state->stream, state->sb.size);
+    return 0;
+}
+
+/* Ask OpenJPEG to discard up to state->reduce resolution levels, as many
+ * as every component has. Returns the number it will discard. */
+static int
+set_reduce(stream_jpxd_state * const state)
+{
+    opj_codestream_info_v2_t *info;
+    int reduce = state->reduce, compno;
+
+    info = opj_get_cstr_info(state->codec);
+    if (info == NULL || info->m_default_tile_info.tccp_info == NULL)
+        reduce = 0;
+    else {
+        for (compno = 0; compno < info->nbcomps; compno++)
+            reduce = min(reduce, (int)info->m_default_tile_info.tccp_info[compno].numresolutions - 1);
+    }
+    if (info != NULL)
+        opj_destroy_cstr_info(&info);
+    if (reduce > 0 && !opj_set_decoded_resolution_factor(state->codec, reduce))
+        reduce = 0;
+    return reduce;
+}
+
 static void
 ycc_to_rgb_8(unsigned char *row, unsigned long row_size)
 {
@@ -415,17 +508,37 @@ static int decode_image(stream_jpxd_state * const state)
     	return ERRC;
     }
 
+    /* check dimension and prec */
+    if (state->image->numcomps == 0)
+        return ERRC;
+
+    if (state->reduce > 0)
+    {
+        /* We still return the full size image, so note its size now */
+        for (compno = 0; compno < state->image->numcomps; compno++)
+        {
+            state->full_width = max(state->full_width, (int)state->image->comps[compno].w);
+            state->full_height = max(state->full_height, (int)state->image->comps[compno].h);
+        }
+        state->reduce = set_reduce(state);
+    }
+
     /* decode the stream and fill the image structure */
     if (!opj_decode(state->codec, state->stream, state->image))
     {
+        if (state->reduce > 0)
+        {
+            /* Some tile has fewer resolution levels than the header
+               said; decode it all. */
+            state->reduce = 0;
+            if (s_opjd_restart(state) < 0)
+                return ERRC;
+            return decode_image(state);
+        }
         dlprintf("openjpeg: failed to decode image!\n");
         return ERRC;
     }
 
-    /* check dimension and prec */
-    if (state->image->numcomps == 0)
-        return ERRC;
-
     state->width = state->image->comps[0].w;
     state->height = state->image->comps[0].h;
     state->bpp = state->image->comps[0].prec;
@@ -442,6 +555,13 @@ static int decode_image(stream_jpxd_state * const state)
                 state->image->comps[compno].dy != state->image->comps[0].dy)
             state->samescale = false;
     }
+    if (state->reduce > 0)
+    {
+        /* Sample the reduced image back up to the full size */
+        state->width = state->full_width;
+        state->height = state->full_height;
+        state->samescale = false;
+    }
 
     /* find alpha component and regular colour component by channel definition */
     for (compno = 0; compno < state->image->numcomps; compno++)
@@ -533,6 +653,22 @@ static int decode_image(stream_jpxd_state * const state)
     return 0;
 }
 
+/* The offset in a component's data of the sample for output pixel (x, y),
+ * when the component is subsampled, or the resolution has been reduced. */
+static inline int sample_offset(stream_jpxd_state * const state, int compno, int x, int y)
+{
+    opj_image_comp_t *comp = &state->image->comps[compno];
+    unsigned int cx = (x / comp->dx) >> state->reduce;
+    unsigned int cy = (y / comp->dy) >> state->reduce;
+
+    /* Rounding can take the last row or column just past the data */
+    if (cx >= comp->w)
+        cx = comp->w - 1;
+    if (cy >= comp->h)
+        cy = comp->h - 1;
+    return cy * comp->w + cx;
+}
+
 static int process_one_trunk(stream_jpxd_state * const state, stream_cursor_write * pw)
 {
     /* read data from image to pw */
@@ -640,10 +776,7 @@ static int process_one_trunk(stream_jpxd_state * const state, stream_cursor_writ
                 {
                     for (i = 0; i < state->width; i++)
                     {
-                        int dx = state->image->comps[state->alpha_comp].dx;
-                        int dy = state->image->comps[state->alpha_comp].dy;
-                        int w = state->image->comps[state->alpha_comp].w;
-                        int in_offset_scaled = (y_offset/dy * w) + i / dx;
+                        int in_offset_scaled = sample_offset(state, state->alpha_comp, i, y_offset);
                         for (b=0; b<bytepp1; b++)
                             *row++ = (((state->image->comps[state->alpha_comp].data[in_offset_scaled] << shift_bit) >> (8*(bytepp1-b-1))))
                                                                      + (b==0 ? state->sign_comps[state->alpha_comp] : 0);
@@ -655,10 +788,7 @@ static int process_one_trunk(stream_jpxd_state * const state, stream_cursor_writ
                     {
                         for (compno=0; compno<img_numcomps; compno++)
                         {
-                            int dx = state->image->comps[compno].dx;
-                            int dy = state->image->comps[compno].dy;
-                            int w = state->image->comps[compno].w;
-                            int in_offset_scaled = (y_offset/dy * w) + i / dx;
+                            int in_offset_scaled = sample_offset(state, compno, i, y_offset);
                             for (b=0; b<bytepp1; b++)
                                 *row++ = (((state->image->comps[compno].data[in_offset_scaled] << shift_bit) >> (8*(bytepp1-b-1))))
                                                                                 + (b==0 ? state->sign_comps[compno] : 0);
@@ -677,10 +807,7 @@ static int process_one_trunk(stream_jpxd_state * const state, stream_cursor_writ
                 {
                     for (b=0; b<ppbyte1; b++)
                     {
-                        int dx = state->image->comps[compno].dx;
-                        int dy = state->image->comps[compno].dy;
-                        int w = state->image->comps[compno].w;
-                        int in_offset_scaled = (y_offset/dy * w) + i / dx;
+                        int in_offset_scaled = sample_offset(state, compno, i, y_offset);
                         bt = bt<<state->bpp;
                         bt += state->image->comps[compno].data[in_offset_scaled] + state->sign_comps[compno];
                     }
@@ -750,12 +877,7 @@ s_opjd_process(stream_state * ss, stream_cursor_read * pr,
         }
 
         if (state->codec == NULL) {
-            /* state->sb.size is non-zero after successful
-               accumulate_input(); 1 is probably extremely rare */
-            if (state->sb.data[0] == 0xFF && ((state->sb.size == 1) || (state->sb.data[1] == 0x4F)))
-                code = s_opjd_set_codec_format(ss, OPJ_CODEC_J2K);
-            else
-                code = s_opjd_set_codec_format(ss, OPJ_CODEC_JP2);
+            code = s_opjd_set_codec_format(ss, s_opjd_codec_format(state));
             if (code < 0)
             {
                 (void)opj_unlock(ss->memory);
@@ -820,6 +942,8 @@ s_opjd_set_defaults(stream_state * ss) {
     state->PassThrough = 0;
     state->PassThroughfn = NULL;
     state->device = (void *)NULL;
+    state->threads = 0;
+    state->reduce = 0;
 }
 
 /* stream release.
@@ -850,7 +974,7 @@ s_opjd_release(stream_state *ss)
 
     /* free decoder handle */
     if (state->codec)
-	opj_destroy_codec(state->codec);
+        s_opjd_destroy_codec(state);
 
     (void)opj_unlock(ss->memory);
 
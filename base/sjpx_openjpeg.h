@@ -79,6 +79,13 @@ typedef struct stream_jpxd_state_s
                                          * so we use a function at the interpreter level
                                          */
     void *device;                       /* The device we need to send PassThrough data to */
+
+    int threads;                        /* OpenJPEG decoding threads, 0 or 1 for none */
+    int reduce;                         /* Resolution levels to discard. The image is
+                                         * sampled back up to its full size, so this
+                                         * only loses detail finer than the device
+                                         * can show. */
+    int full_width, full_height;        /* The image size before reduction */
 } stream_jpxd_state;
 
 extern const stream_template s_jpxd_template;
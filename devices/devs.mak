@@ -289,7 +289,7 @@ $(DEVOBJ)gdevcbjc.$(OBJ) : $(DEVSRC)gdevcbjc.c $(AK)\
 # Support for writing PostScript (high- or low-level).
 $(DEVOBJ)gdevpsu.$(OBJ) : $(DEVVECSRC)gdevpsu.c $(GX) $(GDEV) $(math__h) $(time__h)\
  $(stat__h) $(unistd__h)\
- $(gdevpsu_h) $(gscdefs_h) $(gxdevice_h)\
+ $(gdevpsu_h) $(gscdefs_h) $(gpmisc_h) $(gxdevice_h)\
  $(spprint_h) $(stream_h) $(DEVS_MAK) $(MAKEDIRS)
 	$(DEVCC) $(DEVO_)gdevpsu.$(OBJ) $(C_) $(DEVVECSRC)gdevpsu.c
 
@@ -782,7 +782,7 @@ $(DEVGEN)opdfread.h : $(DEVGEN)opdfread_$(DEBUG_OPDFREAD).h
 $(DEVOBJ)gdevpdf.$(OBJ) : $(DEVVECSRC)gdevpdf.c $(GDEVH)\
  $(fcntl__h) $(memory__h) $(string__h) $(time__h) $(unistd__h) $(gp_h)\
  $(gdevpdfg_h) $(gdevpdfo_h) $(gdevpdfx_h) $(smd5_h) $(sarc4_h)\
- $(gdevpdfb_h) $(gscms_h) $(DEVS_MAK) $(MAKEDIRS)
+ $(gdevpdfb_h) $(gpmisc_h) $(gscms_h) $(DEVS_MAK) $(MAKEDIRS)
 	$(DEVCC) $(DEVO_)gdevpdf.$(OBJ) $(C_) $(DEVVECSRC)gdevpdf.c
 
 $(DEVOBJ)gdevpdfb.$(OBJ) : $(DEVVECSRC)gdevpdfb.c\
@@ -809,7 +809,7 @@ $(DEVOBJ)gdevpdfd.$(OBJ) : $(DEVVECSRC)gdevpdfd.c $(math__h) $(memory__h)\
 
 $(DEVOBJ)gdevpdfe.$(OBJ) : $(DEVVECSRC)gdevpdfe.c\
  $(gx_h) $(gserrors_h) $(string__h) $(time__h) $(stream_h) $(gp_h) $(smd5_h) $(gscdefs_h)\
- $(gdevpdfx_h) $(gdevpdfg_h) $(gdevpdfo_h) $(gdevpdtf_h) $(ConvertUTF_h) $(DEVS_MAK) $(MAKEDIRS)
+ $(gdevpdfx_h) $(gdevpdfg_h) $(gdevpdfo_h) $(gdevpdtf_h) $(gpmisc_h) $(ConvertUTF_h) $(DEVS_MAK) $(MAKEDIRS)
 	$(DEVCC) $(DEVO_)gdevpdfe.$(OBJ) $(C_) $(DEVVECSRC)gdevpdfe.c
 
 $(DEVOBJ)gdevpdfg.$(OBJ) : $(DEVVECSRC)gdevpdfg.c $(GXERR) $(math__h) $(string__h)\
@@ -1245,32 +1245,40 @@ $(DEVOBJ)gdevxcf.$(OBJ) : $(DEVSRC)gdevxcf.c $(PDEVH) $(math__h)\
 psd_=$(DEVOBJ)gdevpsd.$(OBJ) $(GLOBJ)gdevdevn.$(OBJ) $(GLOBJ)gsequivc.$(OBJ)
 gdevpsd_h=$(DEVSRC)gdevpsd.h
 
-$(DD)psdrgb.dev : $(psd_) $(GLD)page.dev $(GDEV) $(DEVS_MAK) $(MAKEDIRS)
+$(DD)psdrgb.dev : $(psd_) $(GLD)page.dev $(GLD)rle.dev $(GDEV) $(DEVS_MAK) $(MAKEDIRS)
 	$(SETDEV) $(DD)psdrgb $(psd_)
+	$(ADDMOD) $(DD)psdrgb -include $(GLD)rle
 
-$(DD)psdrgbtags.dev : $(psd_) $(GLD)page.dev $(GDEV) $(DEVS_MAK) $(MAKEDIRS)
+$(DD)psdrgbtags.dev : $(psd_) $(GLD)page.dev $(GLD)rle.dev $(GDEV) $(DEVS_MAK) $(MAKEDIRS)
 	$(SETDEV) $(DD)psdrgbtags $(psd_)
+	$(ADDMOD) $(DD)psdrgbtags -include $(GLD)rle
 
-$(DD)psdcmyk.dev : $(psd_) $(GLD)page.dev $(GDEV) $(DEVS_MAK) $(MAKEDIRS)
+$(DD)psdcmyk.dev : $(psd_) $(GLD)page.dev $(GLD)rle.dev $(GDEV) $(DEVS_MAK) $(MAKEDIRS)
 	$(SETDEV) $(DD)psdcmyk $(psd_)
+	$(ADDMOD) $(DD)psdcmyk -include $(GLD)rle
 
-$(DD)psdcmyktags.dev : $(psd_) $(GLD)page.dev $(GDEV) $(DEVS_MAK) $(MAKEDIRS)
+$(DD)psdcmyktags.dev : $(psd_) $(GLD)page.dev $(GLD)rle.dev $(GDEV) $(DEVS_MAK) $(MAKEDIRS)
 	$(SETDEV) $(DD)psdcmyktags $(psd_)
+	$(ADDMOD) $(DD)psdcmyktags -include $(GLD)rle
 
-$(DD)psdrgb16.dev : $(DEVS_MAK) $(psd_) $(GLD)page.dev $(GDEV)
+$(DD)psdrgb16.dev : $(DEVS_MAK) $(psd_) $(GLD)page.dev $(GLD)rle.dev $(GDEV)
 	$(SETDEV) $(DD)psdrgb16 $(psd_)
+	$(ADDMOD) $(DD)psdrgb16 -include $(GLD)rle
 
-$(DD)psdcmyk16.dev : $(DEVS_MAK) $(psd_) $(GLD)page.dev $(GDEV)
+$(DD)psdcmyk16.dev : $(DEVS_MAK) $(psd_) $(GLD)page.dev $(GLD)rle.dev $(GDEV)
 	$(SETDEV) $(DD)psdcmyk16 $(psd_)
+	$(ADDMOD) $(DD)psdcmyk16 -include $(GLD)rle
 
-$(DD)psdcmyktags16.dev : $(DEVS_MAK) $(psd_) $(GLD)page.dev $(GDEV)
+$(DD)psdcmyktags16.dev : $(DEVS_MAK) $(psd_) $(GLD)page.dev $(GLD)rle.dev $(GDEV)
 	$(SETDEV) $(DD)psdcmyktags16 $(psd_)
+	$(ADDMOD) $(DD)psdcmyktags16 -include $(GLD)rle
 
 $(DEVOBJ)gdevpsd.$(OBJ) : $(DEVSRC)gdevpsd.c $(PDEVH) $(math__h)\
  $(gdevdcrd_h) $(gscrd_h) $(gscrdp_h) $(gsparam_h) $(gxlum_h)\
  $(gstypes_h) $(gxdcconv_h) $(gdevdevn_h) $(gxdevsop_h) $(gsequivc_h)\
  $(gscms_h) $(gsicc_cache_h) $(gsicc_manage_h) $(gxgetbit_h)\
- $(gdevppla_h) $(gxiodev_h) $(gdevpsd_h) $(gxdevsop_h) $(DEVS_MAK) $(MAKEDIRS)
+ $(gdevppla_h) $(gxiodev_h) $(gdevpsd_h) $(gxdevsop_h) $(strimpl_h)\
+ $(stream_h) $(srlx_h) $(gp_h) $(DEVS_MAK) $(MAKEDIRS)
 	$(DEVCC) $(DEVO_)gdevpsd.$(OBJ) $(C_) $(DEVSRC)gdevpsd.c
 
 ### ----------------------- The permutation device --------------------- ###
@@ -1309,7 +1317,8 @@ $(DD)jpegcmyk.dev : $(jpeg_) $(GLD)sdcte.dev $(GLD)page.dev\
 
 $(DEVOBJ)gdevjpeg.$(OBJ) : $(DEVSRC)gdevjpeg.c $(PDEVH)\
  $(stdio__h) $(jpeglib__h)\
- $(sdct_h) $(sjpeg_h) $(stream_h) $(strimpl_h) $(DEVS_MAK) $(MAKEDIRS)
+ $(sdct_h) $(sjpeg_h) $(stream_h) $(strimpl_h) $(gxdownscale_h)\
+ $(gxdevsop_h) $(DEVS_MAK) $(MAKEDIRS)
 	$(DEVCC) $(DEVO_)gdevjpeg.$(OBJ) $(C_) $(DEVSRC)gdevjpeg.c
 
 ### ------------------------- MIFF file format ------------------------- ###
@@ -1644,13 +1653,15 @@ tiffgray_=$(DEVOBJ)gdevtsep.$(OBJ) $(GLOBJ)gsequivc.$(OBJ) $(DEVOBJ)minftrsz.$(O
 tiffsep_=$(tiffgray_) $(GLOBJ)gdevdevn.$(OBJ) $(GLOBJ)gsequivc.$(OBJ) \
 $(GLOBJ)gdevppla.$(OBJ)
 
-$(DD)tiffs.dev : $(libtiff_dev) $(tiffs_) $(GLD)page.dev\
- $(minftrsz_) $(GDEV) $(DEVS_MAK) $(MAKEDIRS)
+$(DD)tiffs.dev : $(libtiff_dev) $(tiffs_) $(GLD)page.dev $(GLD)cfe.dev\
+ $(GLD)lzwe.dev $(GLD)rle.dev $(GLD)szlibe.dev $(minftrsz_) $(GDEV) $(DEVS_MAK) $(MAKEDIRS)
 	$(SETMOD) $(DD)tiffs $(tiffs_)
-	$(ADDMOD) $(DD)tiffs -include $(GLD)page $(tiff_i_)
+	$(ADDMOD) $(DD)tiffs -include $(GLD)page $(GLD)cfe $(GLD)lzwe $(GLD)rle
+	$(ADDMOD) $(DD)tiffs -include $(GLD)szlibe $(tiff_i_)
 
 $(DEVOBJ)gdevtifs.$(OBJ) : $(DEVSRC)gdevtifs.c $(PDEVH) $(stdint__h) $(stdio__h) $(time__h)\
  $(gdevtifs_h) $(gscdefs_h) $(gstypes_h) $(stream_h) $(strmio_h) $(gstiffio_h)\
+ $(strimpl_h) $(scfx_h) $(slzwx_h) $(srlx_h) $(szlibx_h) $(gxclist_h)\
  $(gsicc_cache_h) $(gdevkrnlsclass_h) $(gscms_h) $(DEVS_MAK) $(MAKEDIRS)
 	$(DEVCC) $(I_)$(DEVI_) $(II)$(TI_)$(_I) $(DEVO_)gdevtifs.$(OBJ) $(C_) $(DEVSRC)gdevtifs.c
 
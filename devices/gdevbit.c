@@ -264,6 +264,7 @@ const gx_device_bit gs_bitrgbtags_device =
         GS_UNKNOWN_TAG,         /* this device supports tags */
         1,			/* default interpolate_control */
         0,                      /* default non_srict_bounds */
+        0,                      /* default shading_direct_fill */
         {
             gx_default_install,
             gx_default_begin_page,
@@ -289,7 +290,10 @@ const gx_device_bit gs_bitrgbtags_device =
         NULL,  /* file */
         false, /* bg_print_requested */
         0,     /* bg_print *  */
+        1,     /* bg_print_queue_depth */
+        0,     /* bg_print_max_memory */
         0,     /* num_render_threads_requested */
+        0,     /* band_reorder_depth_requested */
         NULL,  /* saved_pages_list */
         {0}    /* save_procs_while_delaying_erasepage */
     };
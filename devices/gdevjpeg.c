@@ -22,6 +22,7 @@
 #include "sdct.h"
 #include "sjpeg.h"
 #include "gxdownscale.h"
+#include "gxdevsop.h"
 
 /* Structure for the JPEG-writing device. */
 typedef struct gx_device_jpeg_s {
@@ -48,6 +49,7 @@ static dev_proc_get_params(jpeg_get_params);
 static dev_proc_get_initial_matrix(jpeg_get_initial_matrix);
 static dev_proc_put_params(jpeg_put_params);
 static dev_proc_print_page(jpeg_print_page);
+static dev_proc_dev_spec_op(jpeg_dev_spec_op);
 static dev_proc_map_color_rgb(jpegcmyk_map_color_rgb);
 static dev_proc_map_cmyk_color(jpegcmyk_map_cmyk_color);
 static dev_proc_decode_color(jpegcmyk_decode_color);
@@ -72,6 +74,7 @@ jpeg_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, get_initial_matrix, jpeg_get_initial_matrix);
     set_dev_proc(dev, get_params, jpeg_get_params);
     set_dev_proc(dev, put_params, jpeg_put_params);
+    set_dev_proc(dev, dev_spec_op, jpeg_dev_spec_op);
 }
 
 const gx_device_jpeg gs_jpeg_device =
@@ -95,6 +98,7 @@ jpeggray_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, get_initial_matrix, jpeg_get_initial_matrix);
     set_dev_proc(dev, get_params, jpeg_get_params);
     set_dev_proc(dev, put_params, jpeg_put_params);
+    set_dev_proc(dev, dev_spec_op, jpeg_dev_spec_op);
     set_dev_proc(dev, encode_color, gx_default_8bit_map_gray_color);
     set_dev_proc(dev, decode_color, gx_default_8bit_map_color_gray);
 }
@@ -123,6 +127,7 @@ jpegcmyk_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, map_color_rgb, jpegcmyk_map_color_rgb);
     set_dev_proc(dev, get_params, jpeg_get_params);
     set_dev_proc(dev, put_params, jpeg_put_params);
+    set_dev_proc(dev, dev_spec_op, jpeg_dev_spec_op);
     set_dev_proc(dev, map_cmyk_color, jpegcmyk_map_cmyk_color);
 
     set_dev_proc(dev, encode_color, jpegcmyk_map_cmyk_color);
@@ -183,6 +188,22 @@ jpegcmyk_decode_color(gx_device * dev, gx_color_index color,
     return 0;
 }
 
+static int
+jpeg_dev_spec_op(gx_device *dev, int op, void *data, int datasize)
+{
+    /* Keep bands whole multiples of the MCU height (after downscaling),
+     * so they can be encoded in parallel (see jpeg_band_parallel_setup). */
+    if (op == gxdso_adjust_bandheight) {
+        int factor = ((gx_device_jpeg *)dev)->downscale.downscale_factor;
+        int mcu = dev->color_info.depth == 24 ? 16 : 8;
+
+        if (factor >= 1 && factor <= 8 && datasize >= mcu * factor)
+            return datasize / (mcu * factor) * (mcu * factor);
+        return gx_downscaler_adjust_bandheight(factor, datasize);
+    }
+    return gdev_prn_dev_spec_op(dev, op, data, datasize);
+}
+
 /* Get parameters. */
 static int
 jpeg_get_params(gx_device * dev, gs_param_list * plist)
@@ -390,78 +411,51 @@ jpeg_get_initial_matrix(gx_device *dev, gs_matrix *pmat)
 
 }
 
-/* Send the page to the file. */
+/* Set up the DCT encoder state for an image 'height' rows high. On failure
+ * any IJG state that was created has been destroyed again. */
 static int
-jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
+jpeg_init_state(gx_device_jpeg *jdev, gs_memory_t *mem, stream_DCT_state *state,
+                jpeg_compress_data *jcdp, int height, uint restart_interval)
 {
-    gx_device_jpeg *jdev = (gx_device_jpeg *) pdev;
-    gs_memory_t *mem = pdev->memory;
-    int line_size = gdev_mem_bytes_per_scan_line((gx_device *) pdev);
-    byte *in = gs_alloc_bytes(mem, line_size, "jpeg_print_page(in)");
-    jpeg_compress_data *jcdp = gs_alloc_struct_immovable(mem, jpeg_compress_data,
-      &st_jpeg_compress_data, "jpeg_print_page(jpeg_compress_data)");
-    byte *fbuf = 0;
-    uint fbuf_size;
-    byte *jbuf = 0;
-    uint jbuf_size;
-    int lnum;
+    gx_device_printer *pdev = (gx_device_printer *)jdev;
     int code;
-    stream_DCT_state state;
-    stream fstrm, jstrm;
-    gx_downscaler_t ds;
-
-    if (jcdp == 0 || in == 0) {
-        code = gs_note_error(gs_error_VMerror);
-        goto fail;
-    }
-    code = gx_downscaler_init(&ds, (gx_device *)jdev, 8, 8,
-                              jdev->color_info.depth/8,
-                              &jdev->downscale, NULL, 0);
-    if (code < 0) {
-        gs_free_object(mem, jcdp, "jpeg_print_page(jpeg_compress_data)");
-        jcdp = NULL;
-        goto fail;
-    }
 
     /* Create the DCT encoder state. */
     jcdp->templat = s_DCTE_template;
-    s_init_state((stream_state *)&state, &jcdp->templat, 0);
-    if (state.templat->set_defaults) {
-        state.memory = mem;
-        (*state.templat->set_defaults) ((stream_state *) & state);
-        state.memory = NULL;
-    }
-    state.QFactor = 1.0;	/* disable quality adjustment in zfdcte.c */
-    state.ColorTransform = 1;	/* default for RGB */
+    s_init_state((stream_state *)state, &jcdp->templat, 0);
+    if (state->templat->set_defaults) {
+        state->memory = mem;
+        (*state->templat->set_defaults) ((stream_state *) state);
+        state->memory = NULL;
+    }
+    state->QFactor = 1.0;	/* disable quality adjustment in zfdcte.c */
+    state->ColorTransform = 1;	/* default for RGB */
     /* We insert no markers, allowing the IJG library to emit */
     /* the format it thinks best. */
-    state.NoMarker = true;	/* do not insert our own Adobe marker */
-    state.Markers.data = 0;
-    state.Markers.size = 0;
-    state.data.compress = jcdp;
+    state->NoMarker = true;	/* do not insert our own Adobe marker */
+    state->Markers.data = 0;
+    state->Markers.size = 0;
+    state->data.compress = jcdp;
     /* Add in ICC profile */
-    state.icc_profile = NULL; /* In case it is not set here */
+    state->icc_profile = NULL; /* In case it is not set here */
     if (pdev->icc_struct != NULL &&
         pdev->icc_struct->device_profile[GS_DEFAULT_DEVICE_PROFILE] != NULL) {
         cmm_profile_t *icc_profile = pdev->icc_struct->device_profile[GS_DEFAULT_DEVICE_PROFILE];
         if (icc_profile->num_comps == pdev->color_info.num_components &&
             !(pdev->icc_struct->usefastcolor)) {
-            state.icc_profile = icc_profile;
+            state->icc_profile = icc_profile;
         }
     }
-    /* We need state.memory for gs_jpeg_create_compress().... */
-    jcdp->memory = state.jpeg_memory = state.memory = mem;
-    if ((code = gs_jpeg_create_compress(&state)) < 0)
-    {
-        gx_downscaler_fin(&ds);
-        goto fail;
-    }
+    /* We need state->memory for gs_jpeg_create_compress().... */
+    jcdp->memory = state->jpeg_memory = state->memory = mem;
+    if ((code = gs_jpeg_create_compress(state)) < 0)
+        return code;
     /* ....but we need it to be NULL so we don't try to free
      * the stack based state...
      */
-    state.memory = NULL;
+    state->memory = NULL;
     jcdp->cinfo.image_width = gx_downscaler_scale(pdev->width, jdev->downscale.downscale_factor);
-    jcdp->cinfo.image_height = gx_downscaler_scale(pdev->height, jdev->downscale.downscale_factor);
+    jcdp->cinfo.image_height = height;
     switch (pdev->color_info.depth) {
         case 32:
             jcdp->cinfo.input_components = 4;
@@ -477,33 +471,379 @@ jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
             break;
     }
     /* Set compression parameters. */
-    if ((code = gs_jpeg_set_defaults(&state)) < 0)
-        goto done;
+    if ((code = gs_jpeg_set_defaults(state)) < 0)
+        goto fail;
     if (jdev->JPEGQ > 0) {
-        code = gs_jpeg_set_quality(&state, jdev->JPEGQ, TRUE);
+        code = gs_jpeg_set_quality(state, jdev->JPEGQ, TRUE);
         if (code < 0)
-            goto done;
+            goto fail;
     } else if (jdev->QFactor > 0.0) {
-        code = gs_jpeg_set_linear_quality(&state,
+        code = gs_jpeg_set_linear_quality(state,
                                           (int)(min(jdev->QFactor, 100.0)
                                                 * 100.0 + 0.5),
                                           TRUE);
         if (code < 0)
-            goto done;
+            goto fail;
     }
-    jcdp->cinfo.restart_interval = 0;
+    jcdp->cinfo.restart_interval = restart_interval;
     jcdp->cinfo.density_unit = 1;	/* dots/inch (no #define or enum) */
     jcdp->cinfo.X_density = (UINT16)pdev->HWResolution[0];
     jcdp->cinfo.Y_density = (UINT16)pdev->HWResolution[1];
-    /* Create the filter. */
     /* Make sure we get at least a full scan line of input. */
-    state.scan_line_size = jcdp->cinfo.input_components *
+    state->scan_line_size = jcdp->cinfo.input_components *
         jcdp->cinfo.image_width;
     jcdp->templat.min_in_size =
-        max(s_DCTE_template.min_in_size, state.scan_line_size);
+        max(s_DCTE_template.min_in_size, state->scan_line_size);
     /* Make sure we can write the user markers in a single go. */
     jcdp->templat.min_out_size =
-        max(s_DCTE_template.min_out_size, state.Markers.size);
+        max(s_DCTE_template.min_out_size, state->Markers.size);
+    return 0;
+  fail:
+    gs_jpeg_destroy(state);
+    return code;
+}
+
+/* ------ Band parallel output ------ */
+
+/*
+ * When the page is rendered from a band list by rendering threads, each
+ * band is encoded on the thread that rendered it as a complete little JPEG
+ * whose height is a whole number of MCU rows, with a restart interval that
+ * divides the band. Restart markers reset the entropy coder, so the bands'
+ * entropy coded data can be joined with RSTn markers between them. The
+ * first band supplies the headers (with the height patched to that of the
+ * page), and the markers within each band are renumbered to follow on from
+ * those of the band before.
+ */
+typedef struct jpeg_band_arg_s {
+    gx_device_jpeg *jdev;
+    gp_file *file;
+    int width, height;		/* of the (downscaled) image */
+    int band_rows;		/* image rows per band */
+    uint restart_interval;	/* in MCUs */
+    int intervals_per_band;
+} jpeg_band_arg_t;
+
+typedef struct jpeg_band_buffer_s {
+    gs_memory_t *memory;
+    int band;			/* -1 if the band is off the page */
+    byte *data;			/* the band encoded as a JPEG */
+    size_t data_size, data_used;
+    size_t header_size;		/* bytes up to the end of the SOS segment */
+} jpeg_band_buffer_t;
+
+static void
+jpeg_band_free_buffer(void *arg_, gx_device *dev, gs_memory_t *mem, void *buffer_)
+{
+    jpeg_band_buffer_t *buffer = (jpeg_band_buffer_t *)buffer_;
+
+    if (buffer == NULL)
+        return;
+    gs_free_object(mem, buffer->data, "jpeg_band_free_buffer(data)");
+    gs_free_object(mem, buffer, "jpeg_band_free_buffer");
+}
+
+static int
+jpeg_band_init_buffer(void *arg_, gx_device *dev, gs_memory_t *mem, int w, int h, void **pbuffer)
+{
+    jpeg_band_arg_t *arg = (jpeg_band_arg_t *)arg_;
+    jpeg_band_buffer_t *buffer;
+
+    buffer = (jpeg_band_buffer_t *)gs_alloc_bytes(mem, sizeof(*buffer), "jpeg_band_init_buffer");
+    *pbuffer = buffer;
+    if (buffer == NULL)
+        return_error(gs_error_VMerror);
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->memory = mem;
+    /* A guess; we grow it if the band doesn't fit. */
+    buffer->data_size = (size_t)arg->width * dev->color_info.num_components *
+                        arg->band_rows / 4 + 4096;
+    buffer->data = gs_alloc_bytes(mem, buffer->data_size, "jpeg_band_init_buffer(data)");
+    if (buffer->data == NULL) {
+        jpeg_band_free_buffer(arg_, dev, mem, buffer);
+        *pbuffer = NULL;
+        return_error(gs_error_VMerror);
+    }
+    return 0;
+}
+
+/* Run the encoder over the input, making the output buffer bigger as needed. */
+static int
+jpeg_band_encode(jpeg_band_buffer_t *buffer, stream_DCT_state *state,
+                 stream_cursor_read *r, bool last)
+{
+    stream_cursor_write w;
+    int status;
+
+    for (;;) {
+        stream_cursor_write_init(&w, buffer->data + buffer->data_used,
+                                 buffer->data_size - buffer->data_used);
+        status = state->templat->process((stream_state *)state, r, &w, last);
+        buffer->data_used = w.ptr + 1 - buffer->data;
+        if (status != 1)
+            return status;
+        {
+            size_t new_size = buffer->data_size + buffer->data_size / 2;
+            byte *new_data = gs_resize_object(buffer->memory, buffer->data, new_size,
+                                              "jpeg_band_encode");
+
+            if (new_data == NULL)
+                return_error(gs_error_VMerror);
+            buffer->data = new_data;
+            buffer->data_size = new_size;
+        }
+    }
+}
+
+/* Find the end of the headers, patch the height, renumber the restarts. */
+static int
+jpeg_band_fixup(jpeg_band_arg_t *arg, jpeg_band_buffer_t *buffer)
+{
+    byte *data = buffer->data;
+    size_t len = buffer->data_used;
+    size_t pos = 2, sof = 0, i;
+    int marker = 0, offset;
+
+    if (len < 4 || data[0] != 0xff || data[1] != 0xd8 /* SOI */ ||
+        data[len - 2] != 0xff || data[len - 1] != JPEG_EOI)
+        return_error(gs_error_ioerror);
+    while (marker != 0xda) {		/* SOS */
+        if (pos + 4 > len || data[pos] != 0xff)
+            return_error(gs_error_ioerror);
+        marker = data[pos + 1];
+        if (marker >= 0xc0 && marker <= 0xc3)	/* SOF0..SOF3 */
+            sof = pos;
+        pos += 2 + ((data[pos + 2] << 8) | data[pos + 3]);
+    }
+    if (sof == 0 || pos > len - 2)
+        return_error(gs_error_ioerror);
+    buffer->header_size = pos;
+    if (buffer->band == 0) {
+        data[sof + 5] = (byte)(arg->height >> 8);
+        data[sof + 6] = (byte)arg->height;
+    }
+    /* 0xFF in the entropy coded data is always followed by a zero byte
+     * unless it starts a marker. */
+    offset = (buffer->band * arg->intervals_per_band) & 7;
+    if (offset != 0) {
+        for (i = pos; i < len - 3; i++) {
+            if (data[i] == 0xff && data[i + 1] >= JPEG_RST0 && data[i + 1] < JPEG_RST0 + 8) {
+                data[i + 1] = JPEG_RST0 + ((data[i + 1] - JPEG_RST0 + offset) & 7);
+                i++;
+            }
+        }
+    }
+    return 0;
+}
+
+static int
+jpeg_band_process(void *arg_, gx_device *dev, gx_device *bdev, const gs_int_rect *rect, void *buffer_)
+{
+    jpeg_band_arg_t *arg = (jpeg_band_arg_t *)arg_;
+    jpeg_band_buffer_t *buffer = (jpeg_band_buffer_t *)buffer_;
+    gs_memory_t *mem = buffer->memory;
+    jpeg_compress_data *jcdp;
+    stream_DCT_state state;
+    stream_cursor_read r;
+    gs_get_bits_params_t params;
+    gs_int_rect my_rect;
+    int h = rect->q.y - rect->p.y;
+    int y, status = 0, code;
+    uint raster;
+    byte *src;
+
+    buffer->band = -1;
+    buffer->data_used = 0;
+    if (rect->p.y >= arg->height)
+        return 0;
+    /* A downscaled band may end with a partial row past the image. */
+    if (h > arg->height - rect->p.y)
+        h = arg->height - rect->p.y;
+    if (h <= 0 || rect->p.y % arg->band_rows != 0 ||
+        rect->q.x - rect->p.x < arg->width)
+        return_error(gs_error_rangecheck);
+    buffer->band = rect->p.y / arg->band_rows;
+
+    params.options = GB_COLORS_NATIVE | GB_ALPHA_NONE | GB_PACKING_CHUNKY | GB_RETURN_POINTER | GB_ALIGN_ANY | GB_OFFSET_0 | GB_RASTER_ANY;
+    my_rect.p.x = 0;
+    my_rect.p.y = 0;
+    my_rect.q.x = rect->q.x - rect->p.x;
+    my_rect.q.y = h;
+    code = dev_proc(bdev, get_bits_rectangle)(bdev, &my_rect, &params);
+    if (code < 0)
+        return code;
+    /* Returning a pointer leaves params.raster alone. */
+    raster = gx_device_raster(bdev, true);
+    src = params.data[0];
+
+    jcdp = gs_alloc_struct_immovable(mem, jpeg_compress_data,
+      &st_jpeg_compress_data, "jpeg_band_process(jpeg_compress_data)");
+    if (jcdp == NULL)
+        return_error(gs_error_VMerror);
+    code = jpeg_init_state(arg->jdev, mem, &state, jcdp, h, arg->restart_interval);
+    if (code < 0) {
+        gs_free_object(mem, jcdp, "jpeg_band_process(jpeg_compress_data)");
+        return code;
+    }
+    if (state.templat->init)
+        (*state.templat->init) ((stream_state *)&state);
+
+    for (y = 0; y < h && status == 0; y++, src += raster) {
+        stream_cursor_read_init(&r, src, state.scan_line_size);
+        status = jpeg_band_encode(buffer, &state, &r, false);
+    }
+    if (status == 0) {
+        stream_cursor_read_init(&r, src, 0);
+        status = jpeg_band_encode(buffer, &state, &r, true);
+    }
+    if (status == EOFC)
+        code = jpeg_band_fixup(arg, buffer);
+    else if (status == ERRC || status >= 0)
+        code = gs_note_error(gs_error_ioerror);
+    else
+        code = status;
+
+    gs_jpeg_destroy(&state);
+    gs_free_object(mem, jcdp, "jpeg_band_process(jpeg_compress_data)");
+    return code;
+}
+
+static int
+jpeg_band_output(void *arg_, gx_device *dev, void *buffer_)
+{
+    jpeg_band_arg_t *arg = (jpeg_band_arg_t *)arg_;
+    jpeg_band_buffer_t *buffer = (jpeg_band_buffer_t *)buffer_;
+    size_t start = buffer->header_size;
+    size_t len = buffer->data_used - 2 - start;	/* drop the EOI */
+
+    if (buffer->band < 0)
+        return 0;
+    if (buffer->band == 0) {
+        start = 0;
+        len += buffer->header_size;
+    } else {
+        byte rst[2];
+
+        rst[0] = 0xff;
+        rst[1] = JPEG_RST0 + ((buffer->band * arg->intervals_per_band - 1) & 7);
+        if (gp_fwrite(rst, 1, 2, arg->file) != 2)
+            return_error(gs_error_ioerror);
+    }
+    if (gp_fwrite(buffer->data + start, 1, len, arg->file) != len)
+        return_error(gs_error_ioerror);
+    return 0;
+}
+
+/*
+ * Decide whether the page can be encoded band by band on the rendering
+ * threads, and if so fill in *arg.
+ */
+static bool
+jpeg_band_parallel_setup(gx_device_jpeg *jdev, gp_file *file, jpeg_band_arg_t *arg)
+{
+    gx_device_printer *pdev = (gx_device_printer *)jdev;
+    int factor = jdev->downscale.downscale_factor;
+    int band_height, mcu, mcus_per_row, band_mcu_rows, r;
+
+    if (!PRINTER_IS_CLIST(pdev) || pdev->num_render_threads_requested < 1 ||
+        factor < 1 || factor > 8)
+        return false;
+    band_height = clist_band_height((gx_device_clist_common *)pdev);
+    if (band_height <= 0 || band_height % factor != 0)
+        return false;
+    arg->band_rows = band_height / factor;
+    arg->width = gx_downscaler_scale(pdev->width, factor);
+    arg->height = gx_downscaler_scale(pdev->height, factor);
+    if (arg->width <= 0 || arg->height <= 0 ||
+        arg->width > JPEG_MAX_DIMENSION || arg->height > JPEG_MAX_DIMENSION)
+        return false;
+    /* The IJG defaults subsample the chroma of colour images 2x2. */
+    mcu = pdev->color_info.depth == 24 ? 16 : 8;
+    if (arg->band_rows % mcu != 0)
+        return false;
+    band_mcu_rows = arg->band_rows / mcu;
+    mcus_per_row = (arg->width + mcu - 1) / mcu;
+    /* Use as few restarts as possible; the interval is at most 65535 MCUs. */
+    for (r = band_mcu_rows; r > 0; r--)
+        if (band_mcu_rows % r == 0 && (long)r * mcus_per_row <= 65535)
+            break;
+    if (r == 0)
+        return false;
+    arg->jdev = jdev;
+    arg->file = file;
+    arg->restart_interval = r * mcus_per_row;
+    arg->intervals_per_band = band_mcu_rows / r;
+    return true;
+}
+
+static int
+jpeg_band_print_page(gx_device_jpeg *jdev, jpeg_band_arg_t *arg)
+{
+    gx_process_page_options_t process = { 0 };
+    int factor = jdev->downscale.downscale_factor;
+    static const byte eoi[2] = { 0xff, JPEG_EOI };
+    int code;
+
+    process.init_buffer_fn = jpeg_band_init_buffer;
+    process.free_buffer_fn = jpeg_band_free_buffer;
+    process.process_fn = jpeg_band_process;
+    process.output_fn = jpeg_band_output;
+    process.arg = arg;
+
+    if (factor == 1)
+        code = dev_proc(jdev, process_page)((gx_device *)jdev, &process);
+    else
+        code = gx_downscaler_process_page((gx_device *)jdev, &process, factor);
+    if (code >= 0 && gp_fwrite(eoi, 1, 2, arg->file) != 2)
+        code = gs_note_error(gs_error_ioerror);
+    return code;
+}
+
+/* Send the page to the file. */
+static int
+jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
+{
+    gx_device_jpeg *jdev = (gx_device_jpeg *) pdev;
+    gs_memory_t *mem = pdev->memory;
+    int line_size = gdev_mem_bytes_per_scan_line((gx_device *) pdev);
+    byte *in = gs_alloc_bytes(mem, line_size, "jpeg_print_page(in)");
+    jpeg_compress_data *jcdp = gs_alloc_struct_immovable(mem, jpeg_compress_data,
+      &st_jpeg_compress_data, "jpeg_print_page(jpeg_compress_data)");
+    byte *fbuf = 0;
+    uint fbuf_size;
+    byte *jbuf = 0;
+    uint jbuf_size;
+    int lnum;
+    int code;
+    stream_DCT_state state;
+    stream fstrm, jstrm;
+    gx_downscaler_t ds;
+    jpeg_band_arg_t band_arg;
+
+    if (jpeg_band_parallel_setup(jdev, prn_stream, &band_arg)) {
+        gs_free_object(mem, jcdp, "jpeg_print_page(jpeg_compress_data)");
+        gs_free_object(mem, in, "jpeg_print_page(in)");
+        return jpeg_band_print_page(jdev, &band_arg);
+    }
+    if (jcdp == 0 || in == 0) {
+        code = gs_note_error(gs_error_VMerror);
+        goto fail;
+    }
+    code = gx_downscaler_init(&ds, (gx_device *)jdev, 8, 8,
+                              jdev->color_info.depth/8,
+                              &jdev->downscale, NULL, 0);
+    if (code < 0) {
+        gs_free_object(mem, jcdp, "jpeg_print_page(jpeg_compress_data)");
+        jcdp = NULL;
+        goto fail;
+    }
+
+    code = jpeg_init_state(jdev, mem, &state, jcdp,
+                           gx_downscaler_scale(pdev->height, jdev->downscale.downscale_factor), 0);
+    if (code < 0) {
+        gx_downscaler_fin(&ds);
+        goto fail;
+    }
 
     /* Set up the streams. */
     fbuf_size = max(512 /* arbitrary */ , jcdp->templat.min_out_size);
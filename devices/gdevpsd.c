@@ -37,6 +37,9 @@
 #include "gdevpsd.h"
 #include "gxdevsop.h"
 #include "gsicc_cms.h"
+#include "stream.h"
+#include "strimpl.h"
+#include "srlx.h"
 
 #ifndef MAX_CHAN
 #   define MAX_CHAN 15
@@ -1216,6 +1219,7 @@ psd_setup(psd_write_ctx *xc, gx_devn_prn_device *dev, gp_file *file, int w, int
             pdev_psd->color_model == psd_DEVICE_RGBT);
 
     xc->f = file;
+    xc->compression = 0;
 
 #define NUM_CMYK_COMPONENTS 4
     for (i = 0; i < GX_DEVICE_COLOR_MAX_COMPONENTS; i++) {
@@ -1598,7 +1602,7 @@ psd_write_header(psd_write_ctx* xc, gx_devn_prn_device* pdev)
     psd_write_32(xc, 0); 	/* No layer or mask information */
 
     /* Compression: 0=None, 1=RLE/PackBits, 2=Deflate 3=Defalte+Prediction */
-    psd_write_16(xc, 0);
+    psd_write_16(xc, (bits16)xc->compression);
 
     return code;
 }
@@ -1750,6 +1754,294 @@ cleanup:
     return code;
 }
 
+/* ------ Band parallel output ------ */
+
+/*
+ * When the page is rendered from a band list by rendering threads, each
+ * thread splits its band into channels and PackBits compresses them, so the
+ * main thread only has to append the results to one scratch file per
+ * channel. Compressed image data starts with the byte count of every row of
+ * every channel, so the counts are kept in memory and written once the page
+ * is done, followed by the channel files.
+ */
+typedef struct psd_band_arg_s {
+    psd_write_ctx *xc;
+    gp_file *chan_file[GX_DEVICE_COLOR_MAX_COMPONENTS];
+    char chan_name[GX_DEVICE_COLOR_MAX_COMPONENTS][gp_file_name_sizeof];
+    bits16 *counts;		/* num_channels * height row byte counts, big endian */
+} psd_band_arg_t;
+
+typedef struct psd_band_buffer_s {
+    gs_memory_t *memory;
+    int y, h;			/* image rows held, 0 if off the page */
+    int max_h;
+    byte *line;			/* one channel row, ready to be packed */
+    bits16 *counts;		/* num_channels * max_h row byte counts */
+    size_t chan_size[GX_DEVICE_COLOR_MAX_COMPONENTS];
+    byte *data;			/* the packed channels, one after another */
+    size_t data_size, data_used;
+} psd_band_buffer_t;
+
+static void
+psd_band_free_buffer(void *arg_, gx_device *dev, gs_memory_t *mem, void *buffer_)
+{
+    psd_band_buffer_t *buffer = (psd_band_buffer_t *)buffer_;
+
+    if (buffer == NULL)
+        return;
+    gs_free_object(mem, buffer->data, "psd_band_free_buffer(data)");
+    gs_free_object(mem, buffer->counts, "psd_band_free_buffer(counts)");
+    gs_free_object(mem, buffer->line, "psd_band_free_buffer(line)");
+    gs_free_object(mem, buffer, "psd_band_free_buffer");
+}
+
+static int
+psd_band_init_buffer(void *arg_, gx_device *dev, gs_memory_t *mem, int w, int h, void **pbuffer)
+{
+    psd_band_arg_t *arg = (psd_band_arg_t *)arg_;
+    psd_write_ctx *xc = arg->xc;
+    psd_band_buffer_t *buffer;
+
+    buffer = (psd_band_buffer_t *)gs_alloc_bytes(mem, sizeof(*buffer), "psd_band_init_buffer");
+    *pbuffer = buffer;
+    if (buffer == NULL)
+        return_error(gs_error_VMerror);
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->memory = mem;
+    buffer->max_h = h;
+    /* A guess; we grow it if the band doesn't compress this well. */
+    buffer->data_size = (size_t)xc->width * h * xc->num_channels / 2 + 1024;
+    buffer->line = gs_alloc_bytes(mem, xc->width, "psd_band_init_buffer(line)");
+    buffer->counts = (bits16 *)gs_alloc_bytes(mem, sizeof(bits16) * xc->num_channels * h,
+                                              "psd_band_init_buffer(counts)");
+    buffer->data = gs_alloc_bytes(mem, buffer->data_size, "psd_band_init_buffer(data)");
+    if (buffer->line == NULL || buffer->counts == NULL || buffer->data == NULL) {
+        psd_band_free_buffer(arg_, dev, mem, buffer);
+        *pbuffer = NULL;
+        return_error(gs_error_VMerror);
+    }
+    return 0;
+}
+
+/* PackBits one row from buffer->line onto the end of the band's data. */
+static int
+psd_band_pack_row(psd_band_buffer_t *buffer, int width)
+{
+    stream_RLE_state state;
+    stream_cursor_read r;
+    stream_cursor_write w;
+    int status, code;
+
+    s_init_state((stream_state *)&state, &s_RLE_template, buffer->memory);
+    s_RLE_template.set_defaults((stream_state *)&state);
+    state.omitEOD = true;
+    state.record_size = width;
+    code = s_RLE_template.init((stream_state *)&state);
+    if (code < 0)
+        return code;
+
+    stream_cursor_read_init(&r, buffer->line, width);
+    for (;;) {
+        stream_cursor_write_init(&w, buffer->data + buffer->data_used,
+                                 buffer->data_size - buffer->data_used);
+        status = s_RLE_template.process((stream_state *)&state, &r, &w, true);
+        buffer->data_used = w.ptr + 1 - buffer->data;
+        if (status != 1)
+            break;
+        /* The output is full: make the buffer bigger and carry on. */
+        {
+            size_t new_size = buffer->data_size + buffer->data_size / 2;
+            byte *new_data = gs_resize_object(buffer->memory, buffer->data, new_size,
+                                              "psd_band_pack_row");
+
+            if (new_data == NULL)
+                return_error(gs_error_VMerror);
+            buffer->data = new_data;
+            buffer->data_size = new_size;
+        }
+    }
+    /* The encoder reports the end of the data as EOFC. */
+    if (status < 0 && status != EOFC)
+        return_error(gs_error_ioerror);
+    return 0;
+}
+
+static int
+psd_band_process(void *arg_, gx_device *dev, gx_device *bdev, const gs_int_rect *rect, void *buffer_)
+{
+    psd_band_arg_t *arg = (psd_band_arg_t *)arg_;
+    psd_write_ctx *xc = arg->xc;
+    psd_band_buffer_t *buffer = (psd_band_buffer_t *)buffer_;
+    gs_get_bits_params_t params;
+    gs_int_rect my_rect;
+    int h = rect->q.y - rect->p.y;
+    int chan_idx, y, i, code;
+    uint raster;
+
+    buffer->y = rect->p.y;
+    buffer->h = 0;
+    buffer->data_used = 0;
+    if (h > xc->height - rect->p.y)
+        h = xc->height - rect->p.y;
+    if (h <= 0)
+        return 0;
+    if (h > buffer->max_h || rect->q.x - rect->p.x < xc->width)
+        return_error(gs_error_rangecheck);
+
+    params.options = GB_COLORS_NATIVE | GB_ALPHA_NONE | GB_PACKING_PLANAR | GB_RETURN_POINTER | GB_ALIGN_ANY | GB_OFFSET_0 | GB_RASTER_ANY;
+    my_rect.p.x = 0;
+    my_rect.p.y = 0;
+    my_rect.q.x = rect->q.x - rect->p.x;
+    my_rect.q.y = h;
+    code = dev_proc(bdev, get_bits_rectangle)(bdev, &my_rect, &params);
+    if (code < 0)
+        return code;
+    /* Returning a pointer leaves params.raster alone. */
+    raster = gx_device_raster_plane(bdev, NULL);
+
+    /* The same conversions as psd_write_image_data. */
+    for (chan_idx = 0; chan_idx < xc->num_channels; chan_idx++) {
+        int data_pos = xc->chnl_to_position[chan_idx];
+        size_t start = buffer->data_used;
+
+        for (y = 0; y < h; y++) {
+            size_t row_start = buffer->data_used;
+
+            if (data_pos < 0) {
+                memset(buffer->line, 255, xc->width);
+            } else {
+                const byte *unpacked = params.data[data_pos] + (size_t)y * raster;
+
+                if (xc->base_num_channels == 3 && chan_idx < 3)
+                    memcpy(buffer->line, unpacked, xc->width);
+                else
+                    for (i = 0; i < xc->width; ++i)
+                        buffer->line[i] = 255 - unpacked[i];
+            }
+            code = psd_band_pack_row(buffer, xc->width);
+            if (code < 0)
+                return code;
+            buffer->counts[chan_idx * buffer->max_h + y] =
+                (bits16)(buffer->data_used - row_start);
+        }
+        buffer->chan_size[chan_idx] = buffer->data_used - start;
+    }
+    buffer->h = h;
+    return 0;
+}
+
+static int
+psd_band_output(void *arg_, gx_device *dev, void *buffer_)
+{
+    psd_band_arg_t *arg = (psd_band_arg_t *)arg_;
+    psd_write_ctx *xc = arg->xc;
+    psd_band_buffer_t *buffer = (psd_band_buffer_t *)buffer_;
+    const byte *data = buffer->data;
+    int chan_idx, y;
+
+    for (chan_idx = 0; chan_idx < xc->num_channels && buffer->h > 0; chan_idx++) {
+        size_t size = buffer->chan_size[chan_idx];
+
+        if (gp_fwrite(data, 1, size, arg->chan_file[chan_idx]) != size)
+            return_error(gs_error_ioerror);
+        data += size;
+        for (y = 0; y < buffer->h; y++)
+            assign_u16(arg->counts[(size_t)chan_idx * xc->height + buffer->y + y],
+                       buffer->counts[chan_idx * buffer->max_h + y]);
+    }
+    return 0;
+}
+
+/* Can the page be written by psd_band_write_image_data? */
+static bool
+psd_band_parallel_ok(psd_write_ctx *xc, gx_device_printer *pdev)
+{
+    psd_device *psd_dev = (psd_device *)pdev;
+    int chan_idx;
+
+    if (!PRINTER_IS_CLIST(pdev) || pdev->num_render_threads_requested < 1 ||
+        psd_dev->devn_params.bitspercomponent != 8 ||
+        psd_dev->downscale.downscale_factor != 1 ||
+        psd_dev->downscale.trap_w != 0 || psd_dev->downscale.trap_h != 0)
+        return false;
+    /* Each packed row's byte count must fit in 16 bits. */
+    if (xc->width + (xc->width + 127) / 128 > 65535)
+        return false;
+    /* The serial code leaves channels past CMYK with no data as a gap. */
+    for (chan_idx = NUM_CMYK_COMPONENTS; chan_idx < xc->num_channels; chan_idx++)
+        if (xc->chnl_to_position[chan_idx] < 0)
+            return false;
+    return true;
+}
+
+static int
+psd_band_write_image_data(psd_write_ctx *xc, gx_device_printer *pdev)
+{
+    gs_memory_t *mem = pdev->memory;
+    gx_process_page_options_t process = { 0 };
+    psd_band_arg_t *arg;
+    size_t num_counts = (size_t)xc->num_channels * xc->height;
+    int chan_idx, code = 0;
+
+    arg = (psd_band_arg_t *)gs_alloc_bytes(mem, sizeof(*arg), "psd_band_write_image_data");
+    if (arg == NULL)
+        return_error(gs_error_VMerror);
+    memset(arg, 0, sizeof(*arg));
+    arg->xc = xc;
+    arg->counts = (bits16 *)gs_alloc_bytes(mem, sizeof(bits16) * num_counts,
+                                           "psd_band_write_image_data(counts)");
+    if (arg->counts == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto done;
+    }
+    for (chan_idx = 0; chan_idx < xc->num_channels; chan_idx++) {
+        arg->chan_file[chan_idx] = gp_open_scratch_file_rm(mem, gp_scratch_file_name_prefix,
+                                                           arg->chan_name[chan_idx], "w+b");
+        if (arg->chan_file[chan_idx] == NULL) {
+            code = gs_note_error(gs_error_invalidfileaccess);
+            goto done;
+        }
+    }
+
+    process.init_buffer_fn = psd_band_init_buffer;
+    process.free_buffer_fn = psd_band_free_buffer;
+    process.process_fn = psd_band_process;
+    process.output_fn = psd_band_output;
+    process.arg = arg;
+    code = dev_proc(pdev, process_page)((gx_device *)pdev, &process);
+    if (code < 0)
+        goto done;
+
+    /* The row byte counts, then the channels' data. */
+    if (gp_fwrite(arg->counts, sizeof(bits16), num_counts, xc->f) != num_counts) {
+        code = gs_note_error(gs_error_ioerror);
+        goto done;
+    }
+    for (chan_idx = 0; chan_idx < xc->num_channels; chan_idx++) {
+        gp_file *f = arg->chan_file[chan_idx];
+        byte tmp[4096];
+        int n;
+
+        gp_fseek(f, 0, SEEK_SET);
+        while ((n = gp_fread(tmp, 1, sizeof(tmp), f)) > 0)
+            if (gp_fwrite(tmp, 1, n, xc->f) != n) {
+                code = gs_note_error(gs_error_ioerror);
+                goto done;
+            }
+    }
+
+done:
+    for (chan_idx = 0; chan_idx < xc->num_channels; chan_idx++) {
+        if (arg->chan_file[chan_idx] != NULL)
+            gp_fclose(arg->chan_file[chan_idx]);
+        if (arg->chan_name[chan_idx][0])
+            gp_unlink(mem, arg->chan_name[chan_idx]);
+    }
+    gs_free_object(mem, arg->counts, "psd_band_write_image_data(counts)");
+    gs_free_object(mem, arg, "psd_band_write_image_data");
+    return code;
+}
+
 bool
 psd_allow_multiple_pages (gx_device_printer *pdev)
 {
@@ -1791,10 +2083,16 @@ psd_print_page(gx_device_printer *pdev, gp_file *file)
         code = psd_setup(&xc, devn_dev, file,
                   gx_downscaler_scale(pdev->width, psd_dev->downscale.downscale_factor),
                   gx_downscaler_scale(pdev->height, psd_dev->downscale.downscale_factor));
+        if (code >= 0 && psd_band_parallel_ok(&xc, pdev))
+            xc.compression = 1;
         if (code >= 0)
             code = psd_write_header(&xc, devn_dev);
-        if (code >= 0)
-            code = psd_write_image_data(&xc, pdev);
+        if (code >= 0) {
+            if (xc.compression)
+                code = psd_band_write_image_data(&xc, pdev);
+            else
+                code = psd_write_image_data(&xc, pdev);
+        }
     }
     return code;
 }
@@ -33,6 +33,8 @@ typedef struct {
     int chnl_to_position[GX_DEVICE_COLOR_MAX_COMPONENTS];
     /* byte offset of image data */
     int image_data_off;
+    /* 0 for raw image data, 1 for PackBits */
+    int compression;
 } psd_write_ctx;
 
 int psd_setup(psd_write_ctx *xc, gx_devn_prn_device *dev, gp_file *file, int w, int h);
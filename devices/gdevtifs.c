@@ -27,7 +27,12 @@
 #include "gxdownscale.h"
 #include "scommon.h"
 #include "stream.h"
+#include "strimpl.h"
 #include "strmio.h"
+#include "slzwx.h"
+#include "srlx.h"
+#include "scfx.h"
+#include "szlibx.h"
 #include "gsicc_cache.h"
 #include "gscms.h"
 #include "gstiffio.h"
@@ -423,6 +428,339 @@ int tiff_set_fields_for_printer(gx_device_printer *pdev,
     return 0;
 }
 
+/* ------ Band parallel strip encoding ------ */
+
+/*
+ * When the page is a band list rendered by several threads, each band is
+ * split into whole strips, and the strips are compressed on the rendering
+ * thread with our own encoders. The main thread then only has to hand the
+ * compressed strips to libtiff, in band order, with TIFFWriteRawStrip.
+ * The encoders produce data that decodes to the same pixels as libtiff's
+ * own, so only the strip layout (one or more strips per band) differs from
+ * the serial path.
+ */
+
+typedef struct tiff_band_arg_s {
+    TIFF *tif;
+    uint16_t compression;
+    uint32_t width;		/* TIFF image width, in pixels */
+    uint32_t height;		/* TIFF image length */
+    uint32_t rows_per_strip;
+    tmsize_t scanline;		/* bytes per TIFF row */
+    bool reverse_bits;		/* FillOrder is LSB2MSB */
+} tiff_band_arg_t;
+
+typedef struct tiff_band_buffer_s {
+    gs_memory_t *memory;
+    uint32_t first_strip;	/* index of the band's first strip */
+    int num_strips;		/* number of strips in this band */
+    int max_strips;
+    size_t *strip_size;		/* [max_strips] */
+    byte *rows;			/* uncompressed rows of one strip */
+    byte *data;			/* compressed strips, end to end */
+    size_t data_size;
+    size_t data_used;
+} tiff_band_buffer_t;
+
+static void
+tiff_band_free_buffer(void *arg_, gx_device *dev, gs_memory_t *mem, void *buffer_)
+{
+    tiff_band_buffer_t *buffer = (tiff_band_buffer_t *)buffer_;
+
+    if (buffer == NULL)
+        return;
+    gs_free_object(mem, buffer->data, "tiff_band_free_buffer(data)");
+    gs_free_object(mem, buffer->rows, "tiff_band_free_buffer(rows)");
+    gs_free_object(mem, buffer->strip_size, "tiff_band_free_buffer(strip_size)");
+    gs_free_object(mem, buffer, "tiff_band_free_buffer");
+}
+
+static int
+tiff_band_init_buffer(void *arg_, gx_device *dev, gs_memory_t *mem, int w, int h, void **pbuffer)
+{
+    tiff_band_arg_t *arg = (tiff_band_arg_t *)arg_;
+    tiff_band_buffer_t *buffer;
+    size_t rows_size = (size_t)arg->scanline * arg->rows_per_strip;
+
+    buffer = (tiff_band_buffer_t *)gs_alloc_bytes(mem, sizeof(*buffer), "tiff_band_init_buffer");
+    *pbuffer = buffer;
+    if (buffer == NULL)
+        return_error(gs_error_VMerror);
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->memory = mem;
+    buffer->max_strips = (h + arg->rows_per_strip - 1) / arg->rows_per_strip;
+    /* Room for the band uncompressed; we grow it if a strip expands. */
+    buffer->data_size = rows_size * buffer->max_strips + 1024;
+    buffer->strip_size = (size_t *)gs_alloc_bytes(mem, sizeof(size_t) * buffer->max_strips,
+                                                  "tiff_band_init_buffer(strip_size)");
+    buffer->rows = gs_alloc_bytes(mem, rows_size, "tiff_band_init_buffer(rows)");
+    buffer->data = gs_alloc_bytes(mem, buffer->data_size, "tiff_band_init_buffer(data)");
+    if (buffer->strip_size == NULL || buffer->rows == NULL || buffer->data == NULL) {
+        tiff_band_free_buffer(arg_, dev, mem, buffer);
+        *pbuffer = NULL;
+        return_error(gs_error_VMerror);
+    }
+    return 0;
+}
+
+/* Compress one strip of rows onto the end of the band's data. */
+static int
+tiff_band_encode_strip(tiff_band_arg_t *arg, tiff_band_buffer_t *buffer, int rows)
+{
+    union {
+        stream_state st;
+        stream_LZW_state lzw;
+        stream_RLE_state rle;
+        stream_CFE_state cfe;
+        stream_zlib_state zlib;
+    } state;
+    const stream_template *templat;
+    stream_cursor_read r;
+    stream_cursor_write w;
+    size_t in_size = (size_t)arg->scanline * rows;
+    int status, code = 0;
+
+    switch (arg->compression) {
+        case COMPRESSION_NONE:
+            if (buffer->data_size - buffer->data_used < in_size)
+                return_error(gs_error_unregistered);
+            memcpy(buffer->data + buffer->data_used, buffer->rows, in_size);
+            buffer->data_used += in_size;
+            return 0;
+        case COMPRESSION_LZW:
+            templat = &s_LZWE_template;
+            break;
+        case COMPRESSION_PACKBITS:
+            templat = &s_RLE_template;
+            break;
+        case COMPRESSION_CCITTFAX4:
+            templat = &s_CFE_template;
+            break;
+        case COMPRESSION_ADOBE_DEFLATE:
+            templat = &s_zlibE_template;
+            break;
+        default:
+            return_error(gs_error_rangecheck);
+    }
+
+    s_init_state(&state.st, templat, buffer->memory);
+    if (templat->set_defaults)
+        templat->set_defaults(&state.st);
+    if (templat == &s_RLE_template) {
+        /* PackBits runs may not cross rows, and there is no EOD. */
+        state.rle.omitEOD = true;
+        state.rle.record_size = arg->scanline;
+    } else if (templat == &s_CFE_template) {
+        state.cfe.K = -1;
+        state.cfe.Columns = arg->width;
+        state.cfe.Rows = rows;
+        state.cfe.BlackIs1 = true;
+        state.cfe.EndOfBlock = true;
+    }
+    code = templat->init(&state.st);
+    if (code < 0)
+        return code;
+
+    stream_cursor_read_init(&r, buffer->rows, in_size);
+    for (;;) {
+        stream_cursor_write_init(&w, buffer->data + buffer->data_used,
+                                 buffer->data_size - buffer->data_used);
+        status = templat->process(&state.st, &r, &w, true);
+        buffer->data_used = w.ptr + 1 - buffer->data;
+        if (status != 1)
+            break;
+        /* The output is full: make the buffer bigger and carry on. */
+        {
+            size_t new_size = buffer->data_size + buffer->data_size / 2;
+            byte *new_data = gs_resize_object(buffer->memory, buffer->data, new_size,
+                                              "tiff_band_encode_strip");
+
+            if (new_data == NULL) {
+                code = gs_note_error(gs_error_VMerror);
+                break;
+            }
+            buffer->data = new_data;
+            buffer->data_size = new_size;
+        }
+    }
+    /* Some encoders report the end of the data as EOFC. */
+    if (code >= 0 && status < 0 && status != EOFC)
+        code = gs_note_error(gs_error_ioerror);
+    if (templat->release)
+        templat->release(&state.st);
+    return code;
+}
+
+static int
+tiff_band_process(void *arg_, gx_device *dev, gx_device *bdev, const gs_int_rect *rect, void *buffer_)
+{
+    tiff_band_arg_t *arg = (tiff_band_arg_t *)arg_;
+    tiff_band_buffer_t *buffer = (tiff_band_buffer_t *)buffer_;
+    gs_get_bits_params_t params;
+    gs_int_rect my_rect;
+    int w = rect->q.x - rect->p.x;
+    int h = rect->q.y - rect->p.y;
+    int src_size = (w * dev->color_info.depth + 7) >> 3;
+    int copy_size = min(src_size, arg->scanline);
+    int y, row, code;
+    uint raster;
+    byte last_mask = 0xff;
+    byte *src;
+
+    buffer->num_strips = 0;
+    buffer->data_used = 0;
+    if (rect->p.y >= arg->height)
+        return 0;
+    /* A downscaled band may end with a partial row past the image. */
+    if (h > arg->height - rect->p.y)
+        h = arg->height - rect->p.y;
+    if (h <= 0 || w <= 0)
+        return 0;
+    if (rect->p.y % arg->rows_per_strip != 0)
+        return_error(gs_error_unregistered);
+    buffer->first_strip = rect->p.y / arg->rows_per_strip;
+    /* Clear the bits past the end of each row. */
+    if ((arg->width * dev->color_info.depth) & 7)
+        last_mask = 0xff << (8 - ((arg->width * dev->color_info.depth) & 7));
+
+    params.options = GB_COLORS_NATIVE | GB_ALPHA_NONE | GB_PACKING_CHUNKY | GB_RETURN_POINTER | GB_ALIGN_ANY | GB_OFFSET_0 | GB_RASTER_ANY;
+    my_rect.p.x = 0;
+    my_rect.p.y = 0;
+    my_rect.q.x = w;
+    my_rect.q.y = h;
+    code = dev_proc(bdev, get_bits_rectangle)(bdev, &my_rect, &params);
+    if (code < 0)
+        return code;
+    /* Returning a pointer leaves params.raster alone. */
+    raster = gx_device_raster(bdev, true);
+    src = params.data[0];
+
+    for (y = 0; y < h; y += arg->rows_per_strip) {
+        int rows = min(arg->rows_per_strip, h - y);
+        size_t start = buffer->data_used;
+        byte *dst = buffer->rows;
+
+        if (buffer->num_strips >= buffer->max_strips)
+            return_error(gs_error_unregistered);
+        /* Rows are padded (or cut) to the TIFF width, as in the serial path. */
+        for (row = 0; row < rows; row++) {
+            memcpy(dst, src, copy_size);
+            if (copy_size < arg->scanline)
+                memset(dst + copy_size, 0, arg->scanline - copy_size);
+            dst[arg->scanline - 1] &= last_mask;
+            dst += arg->scanline;
+            src += raster;
+        }
+        code = tiff_band_encode_strip(arg, buffer, rows);
+        if (code < 0)
+            return code;
+        buffer->strip_size[buffer->num_strips++] = buffer->data_used - start;
+    }
+    return 0;
+}
+
+static int
+tiff_band_output(void *arg_, gx_device *dev, void *buffer_)
+{
+    tiff_band_arg_t *arg = (tiff_band_arg_t *)arg_;
+    tiff_band_buffer_t *buffer = (tiff_band_buffer_t *)buffer_;
+    byte *data = buffer->data;
+    int i;
+
+    if (arg->reverse_bits)
+        TIFFReverseBits(data, buffer->data_used);
+    for (i = 0; i < buffer->num_strips; i++) {
+        if (TIFFWriteRawStrip(arg->tif, buffer->first_strip + i, data,
+                              buffer->strip_size[i]) < 0)
+            return_error(gs_error_ioerror);
+        data += buffer->strip_size[i];
+    }
+    return 0;
+}
+
+/*
+ * Decide whether the page can be written with band parallel strips, and if
+ * so fill in *arg and set the strip size to suit the bands. 'factor' is the
+ * integer downscale factor applied to the bands before they reach us.
+ */
+static bool
+tiff_band_parallel_setup(gx_device_printer *dev, TIFF *tif, int factor,
+                         tiff_band_arg_t *arg)
+{
+    int bpc = dev->color_info.depth / dev->color_info.num_components;
+    int band_height, band_rows;
+    uint32_t rows;
+    uint16_t fill_order = FILLORDER_MSB2LSB;
+
+    if (!PRINTER_IS_CLIST(dev) || dev->num_render_threads_requested < 1 || bpc > 8)
+        return false;
+    band_height = clist_band_height((gx_device_clist_common *)dev);
+    if (band_height <= 0 || band_height % factor != 0)
+        return false;
+    band_rows = band_height / factor;
+
+    TIFFGetField(tif, TIFFTAG_COMPRESSION, &arg->compression);
+    switch (arg->compression) {
+        case COMPRESSION_NONE:
+        case COMPRESSION_LZW:
+        case COMPRESSION_PACKBITS:
+#ifdef ZIP_SUPPORT
+        case COMPRESSION_ADOBE_DEFLATE:
+#endif
+            break;
+        case COMPRESSION_CCITTFAX4:
+            if (dev->color_info.depth != 1)
+                return false;
+            break;
+        default:
+            return false;
+    }
+    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &arg->width);
+    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &arg->height);
+    TIFFGetField(tif, TIFFTAG_FILLORDER, &fill_order);
+    if (!TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &rows) || rows < 1)
+        rows = 1;
+
+    /* Use the largest strip that divides the band and honours MaxStripSize. */
+    if (rows >= band_rows)
+        rows = band_rows;
+    else
+        while (band_rows % rows != 0)
+            rows--;
+    TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, rows);
+
+    arg->tif = tif;
+    arg->rows_per_strip = rows;
+    arg->scanline = TIFFScanlineSize(tif);
+    arg->reverse_bits = fill_order == FILLORDER_LSB2MSB;
+    return true;
+}
+
+static int
+tiff_band_print_page(gx_device_printer *dev, tiff_band_arg_t *arg, int factor)
+{
+    gx_process_page_options_t process = { 0 };
+    int code;
+
+    code = TIFFCheckpointDirectory(arg->tif);
+    if (code < 0)
+        return code;
+
+    process.init_buffer_fn = tiff_band_init_buffer;
+    process.free_buffer_fn = tiff_band_free_buffer;
+    process.process_fn = tiff_band_process;
+    process.output_fn = tiff_band_output;
+    process.arg = arg;
+
+    if (factor == 1)
+        code = dev_proc(dev, process_page)((gx_device *)dev, &process);
+    else
+        code = gx_downscaler_process_page((gx_device *)dev, &process, factor);
+    if (code >= 0)
+        code = TIFFWriteDirectory(arg->tif);
+    return code;
+}
+
 int
 tiff_print_page(gx_device_printer *dev, TIFF *tif, int min_feature_size)
 {
@@ -435,6 +773,11 @@ tiff_print_page(gx_device_printer *dev, TIFF *tif, int min_feature_size)
     void *min_feature_data = NULL;
     int line_lag = 0;
     int filtered_count;
+    tiff_band_arg_t band_arg;
+
+    if ((bpc != 1 || min_feature_size <= 1) &&
+        tiff_band_parallel_setup(dev, tif, 1, &band_arg))
+        return tiff_band_print_page(dev, &band_arg, 1);
 
     data = gs_alloc_bytes(dev->memory, max_size, "tiff_print_page(data)");
     if (data == NULL)
@@ -524,6 +867,17 @@ tiff_downscale_and_print_page(gx_device_printer *dev, TIFF *tif,
     int factor = params->downscale_factor;
     int height = dev->height/factor;
     gx_downscaler_t ds;
+    tiff_band_arg_t band_arg;
+
+    /* The band parallel path has no error diffusion, trapping, or colour
+     * management, and only integer factors keep the bands aligned. */
+    if (bpc == 8 && tfdev->icclink == NULL && factor >= 1 && factor <= 8 &&
+        params->min_feature_size <= 1 && params->trap_w == 0 &&
+        params->trap_h == 0 && params->ets == 0 &&
+        !params->do_skew_detection &&
+        fax_adjusted_width(dev->width / factor, aw) == dev->width / factor &&
+        tiff_band_parallel_setup(dev, tif, factor, &band_arg))
+        return tiff_band_print_page(dev, &band_arg, factor);
 
     code = TIFFCheckpointDirectory(tif);
     if (code < 0)
@@ -581,6 +935,9 @@ static struct compression_string {
     { COMPRESSION_CCITTFAX4, "g4" },
     { COMPRESSION_LZW, "lzw" },
     { COMPRESSION_PACKBITS, "pack" },
+#ifdef ZIP_SUPPORT
+    { COMPRESSION_ADOBE_DEFLATE, "deflate" },
+#endif
 
     { 0, NULL }
 };
@@ -618,9 +975,11 @@ int tiff_compression_allowed(uint16_t compression, byte depth)
                           compression == COMPRESSION_CCITTFAX3 ||
                           compression == COMPRESSION_CCITTFAX4 ||
                           compression == COMPRESSION_LZW ||
-                          compression == COMPRESSION_PACKBITS))
+                          compression == COMPRESSION_PACKBITS ||
+                          compression == COMPRESSION_ADOBE_DEFLATE))
            || ((depth == 8 || depth == 16) && (compression == COMPRESSION_NONE ||
                           compression == COMPRESSION_LZW ||
-                          compression == COMPRESSION_PACKBITS)));
+                          compression == COMPRESSION_PACKBITS ||
+                          compression == COMPRESSION_ADOBE_DEFLATE)));
 
 }
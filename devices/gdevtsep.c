@@ -107,6 +107,11 @@ tiffscaled_spec_op(gx_device *dev_, int op, void *data, int datasize)
     if (op == gxdso_supports_iccpostrender) {
         return true;
     }
+    /* Keep bands whole multiples of the factor, so they can be downscaled
+     * and written in parallel (see tiff_downscale_and_print_page). */
+    if (op == gxdso_adjust_bandheight)
+        return gx_downscaler_adjust_bandheight(((gx_device_tiff *)dev_)->downscale.downscale_factor,
+                                               datasize);
     return gdev_prn_dev_spec_op(dev_, op, data, datasize);
 }
 
@@ -26,6 +26,7 @@
 #include "gdevpdfx.h"
 #include "gdevpdfg.h"		/* only for pdf_reset_graphics */
 #include "gdevpdfo.h"
+#include "gpmisc.h"
 #include "smd5.h"
 #include "sarc4.h"
 #include "sbrotlix.h"
@@ -192,9 +193,18 @@ static RELOC_PTRS_WITH(device_pdfwrite_reloc_ptrs, gx_device_pdf *pdev)
     {
         int i, j;
 
-        for (i = 0; i < NUM_RESOURCE_TYPES; ++i)
+        for (i = 0; i < NUM_RESOURCE_TYPES; ++i) {
             for (j = 0; j < NUM_RESOURCE_CHAINS; ++j)
                 RELOC_PTR(gx_device_pdf, resources[i].chains[j]);
+            /* The index isn't enumerated, because the chains keep its resources. */
+            if (pdev->resource_index != NULL) {
+                pdf_resource_index_t *pindex = &pdev->resource_index[i];
+
+                for (j = 0; j < (int)pindex->size; ++j)
+                    if (pindex->entries[j].pres != NULL)
+                        RELOC_VAR(pindex->entries[j].pres);
+            }
+        }
         if (pdev->outline_levels) {
             for (i = 0; i <= pdev->outline_depth; ++i) {
                 RELOC_PTR(gx_device_pdf, outline_levels[i].first.action);
@@ -348,6 +358,9 @@ pdf_close_temp_file(gx_device_pdf *pdev, pdf_temp_file_t *ptf, int code)
 static int
 pdf_close_files(gx_device_pdf * pdev, int code)
 {
+    gs_free_object(pdev->pdf_memory->non_gc_memory, pdev->asides_ids, "pdf_close_files");
+    pdev->asides_ids = NULL;
+    pdev->num_asides_ids = pdev->max_asides_ids = 0;
     code = pdf_close_temp_file(pdev, &pdev->ObjStm, code);
     code = pdf_close_temp_file(pdev, &pdev->streams, code);
     code = pdf_close_temp_file(pdev, &pdev->asides, code);
@@ -453,13 +466,23 @@ pdf_initialize_ids(gx_device_pdf * pdev)
         timesign = 'Z';
         timeoffset = 0;
 #else
-        time(&t);
-        tms = *gmtime(&t);
-        tms.tm_isdst = -1;
-        timeoffset = (int)difftime(t, mktime(&tms)); /* tz+dst in seconds */
-        timesign = (timeoffset == 0 ? 'Z' : timeoffset < 0 ? '-' : '+');
-        timeoffset = any_abs(timeoffset) / 60;
-        tms = *localtime(&t);
+        int64_t epoch;
+
+        if (gp_source_date_epoch(&epoch)) {
+            /* Reproducible output is always dated in UTC. */
+            t = (time_t)epoch;
+            tms = *gmtime(&t);
+            timesign = 'Z';
+            timeoffset = 0;
+        } else {
+            time(&t);
+            tms = *gmtime(&t);
+            tms.tm_isdst = -1;
+            timeoffset = (int)difftime(t, mktime(&tms)); /* tz+dst in seconds */
+            timesign = (timeoffset == 0 ? 'Z' : timeoffset < 0 ? '-' : '+');
+            timeoffset = any_abs(timeoffset) / 60;
+            tms = *localtime(&t);
+        }
 #endif
 
         gs_snprintf(buf, sizeof(buf), "(D:%04d%02d%02d%02d%02d%02d%c%02d\'%02d\')",
@@ -502,7 +525,15 @@ pdf_compute_fileID(gx_device_pdf * pdev)
     secs_ns[0] = 0;
     secs_ns[1] = 0;
 #else
-    gp_get_realtime(secs_ns);
+    {
+        int64_t epoch;
+
+        if (gp_source_date_epoch(&epoch)) {
+            secs_ns[0] = (long)epoch;
+            secs_ns[1] = 0;
+        } else
+            gp_get_realtime(secs_ns);
+    }
 #endif
     sputs(s, (byte *)secs_ns, sizeof(secs_ns), &ignore);
 #ifdef CLUSTER
@@ -831,7 +862,15 @@ pdf_open(gx_device * dev)
 #ifdef CLUSTER
     memset(&pdev->uuid_time, 0, sizeof(pdev->uuid_time));
 #else
-    gp_get_realtime(pdev->uuid_time);
+    {
+        int64_t epoch;
+
+        if (gp_source_date_epoch(&epoch)) {
+            pdev->uuid_time[0] = (long)epoch;
+            pdev->uuid_time[1] = 0;
+        } else
+            gp_get_realtime(pdev->uuid_time);
+    }
 #endif
     pdev->vec_procs = &pdf_vector_procs;
     pdev->fill_options = pdev->stroke_options = gx_path_type_optimize;
@@ -913,6 +952,7 @@ pdf_open(gx_device * dev)
         for (i = 0; i < NUM_RESOURCE_TYPES; ++i)
             for (j = 0; j < NUM_RESOURCE_CHAINS; ++j)
                 pdev->resources[i].chains[j] = 0;
+        pdev->resource_index = NULL;
     }
     pdev->outline_levels = (pdf_outline_level_t *)gs_alloc_bytes(mem, INITIAL_MAX_OUTLINE_DEPTH * sizeof(pdf_outline_level_t), "outline_levels array");
     if (pdev->outline_levels == NULL) {
@@ -1067,6 +1107,60 @@ pdf_print_orientation(gx_device_pdf * pdev, pdf_page_t *page)
     }
 }
 
+/*
+ * With StreamResources, copy the objects written aside so far into the
+ * output file, so that the asides file doesn't grow with the document,
+ * and make their xref positions positions in the output file. The asides
+ * file is then rewritten from its start.
+ */
+static int
+pdf_flush_asides(gx_device_pdf * pdev)
+{
+    stream *s = pdev->strm;
+    gp_file *rfile = pdev->asides.file;
+    gp_file *tfile = pdev->xref.file;
+    gs_offset_t resource_pos, res_end, pos;
+    int64_t tpos;
+    int i, code;
+
+    if (!pdf_streams_resources(pdev) || s == NULL || s == pdev->asides.strm ||
+        pdev->asides.save_strm != NULL)
+        return 0;
+    sflush(pdev->asides.strm);
+    res_end = gp_ftell(rfile);
+    if (res_end <= 0)
+        return 0;
+    resource_pos = stell(s);
+    if (gp_fseek(rfile, 0L, SEEK_SET) != 0)
+        return_error(gs_error_ioerror);
+    code = pdf_copy_data(s, rfile, res_end, NULL);
+    if (code < 0)
+        return code;
+    if (sseek(pdev->asides.strm, 0) < 0)
+        return_error(gs_error_ioerror);
+
+    tpos = gp_ftell(tfile);
+    for (i = 0; i < pdev->num_asides_ids; i++) {
+        /* With doubleXref the position follows the ObjStm number. */
+        int64_t entry = (pdev->asides_ids[i] - pdev->FirstObjectNumber) * sizeof(pos) *
+                        (pdev->doubleXref ? 2 : 1) + (pdev->doubleXref ? sizeof(pos) : 0);
+
+        if (gp_fseek(tfile, entry, SEEK_SET) != 0 ||
+            gp_fread(&pos, sizeof(pos), 1, tfile) != 1)
+            return_error(gs_error_ioerror);
+        if (pos & ASIDES_BASE_POSITION) {
+            pos = (pos & ~ASIDES_BASE_POSITION) + resource_pos;
+            if (gp_fseek(tfile, entry, SEEK_SET) != 0)
+                return_error(gs_error_ioerror);
+            gp_fwrite(&pos, sizeof(pos), 1, tfile);
+        }
+    }
+    pdev->num_asides_ids = 0;
+    if (gp_fseek(tfile, tpos, SEEK_SET) != 0)
+        return_error(gs_error_ioerror);
+    return 0;
+}
+
 /* Close the current page. */
 static int
 pdf_close_page(gx_device_pdf * pdev, int num_copies)
@@ -1171,6 +1265,9 @@ pdf_close_page(gx_device_pdf * pdev, int num_copies)
         if(pdf_ferror(pdev))
             return(gs_note_error(gs_error_ioerror));
     }
+    code = pdf_flush_asides(pdev);
+    if (code < 0)
+        return code;
     pdf_reset_page(pdev);
     return (pdf_ferror(pdev) ? gs_note_error(gs_error_ioerror) : 0);
 }
@@ -3885,6 +3982,7 @@ error_cleanup:
     if (code >= 0)
         code = code1;
 
+    pdf_free_resource_indices(pdev);
     if (code >= 0) {
         int i, j;
 
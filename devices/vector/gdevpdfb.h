@@ -138,6 +138,7 @@ const gx_device_pdf PDF_DEVICE_IDENT =
  {
      {
          {0}}},	/* resources */
+ 0,				/* resource_index */
  {0},			/* cs_Patterns */
  {0},			/* Identity_ToUnicode_CMaps */
  0,				/* last_resource */
@@ -260,7 +261,11 @@ const gx_device_pdf PDF_DEVICE_IDENT =
  NULL,                     /* PendingOC */
  true,                  /* ToUnicodeForStdEnc */
  true,                  /* EmbedSubstituteFonts */
- false                  /* Use Brotli */
+ false,                 /* Use Brotli */
+ false,                 /* StreamResources */
+ NULL,                  /* asides_ids */
+ 0,                     /* num_asides_ids */
+ 0                      /* max_asides_ids */
 };
 
 #else
@@ -26,6 +26,7 @@
 #include "gdevpdfx.h"
 #include "gdevpdfg.h"
 #include "gdevpdfo.h"
+#include "gpmisc.h"
 
 /* These two tables map PDFDocEncoding character codes (0x00->0x20 and 0x80->0xAD)
  * to their equivalent UTF-16BE value. That allows us to convert a PDFDocEncoding
@@ -223,8 +224,17 @@ pdf_xmp_time(char *buf, int buf_length)
     memset(&t, 0, sizeof(t));
     memset(&tms, 0, sizeof(tms));
 #else
-    time(&t);
-    tms = *localtime(&t);
+    {
+        int64_t epoch;
+
+        if (gp_source_date_epoch(&epoch)) {
+            t = (time_t)epoch;
+            tms = *gmtime(&t);
+        } else {
+            time(&t);
+            tms = *localtime(&t);
+        }
+    }
 #endif
     gs_snprintf(buf1, sizeof(buf1),
             "%04d-%02d-%02d",
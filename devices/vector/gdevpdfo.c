@@ -408,6 +408,29 @@ static int cos_value_hash(cos_value_t *pcv0, gs_md5_state_t *md5, gs_md5_byte_t
     return 0;
 }
 
+/*
+ * Compute a digest of an object's contents. Objects which cos_procs->equal
+ * reports as equal have equal digests, because both hash the same data.
+ * Return 1 if the digest is computed, or 0 for an object type which
+ * can't be compared.
+ */
+int
+cos_object_digest(const cos_object_t *pco, gx_device_pdf *pdev, byte digest[16])
+{
+    gs_md5_state_t md5;
+    int code;
+
+    if (cos_type(pco) != cos_type_dict && cos_type(pco) != cos_type_array &&
+        cos_type(pco) != cos_type_stream)
+        return 0;
+    gs_md5_init(&md5);
+    code = pco->cos_procs->hash(pco, &md5, (gs_md5_byte_t *)digest, pdev);
+    if (code < 0)
+        return code;
+    gs_md5_finish(&md5, (gs_md5_byte_t *)digest);
+    return 1;
+}
+
 /* ---------------- Specific object types ---------------- */
 
 /* ------ Generic objects ------ */
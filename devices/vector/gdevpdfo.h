@@ -337,6 +337,9 @@ int cos_stream_contents_write(const cos_stream_t *, gx_device_pdf *);
 /* Find the total length of a stream. */
 int64_t cos_stream_length(const cos_stream_t *pcs);
 
+/* Compute a digest of an object's contents, equal for equal objects. */
+int cos_object_digest(const cos_object_t *pco, gx_device_pdf *pdev, byte digest[16]);
+
 /* Write/delete definitions of named objects. */
 /* This is a special-purpose facility for pdf_close. */
 int cos_dict_objects_write(const cos_dict_t *, gx_device_pdf *);
@@ -711,6 +711,36 @@ pdf_stell(gx_device_pdf * pdev)
     return pos;
 }
 
+/*
+ * With StreamResources, remember the objects whose xref positions are in
+ * the asides file, so that pdf_flush_asides can make them positions in the
+ * output file when it moves the asides there. If the list can't grow,
+ * stop streaming; the asides which remain are copied by pdf_close.
+ */
+static void
+pdf_record_aside_object(gx_device_pdf *pdev, int64_t id)
+{
+    if (!pdf_streams_resources(pdev) || pdev->strm != pdev->asides.strm)
+        return;
+    if (pdev->num_asides_ids == pdev->max_asides_ids) {
+        gs_memory_t *mem = pdev->pdf_memory->non_gc_memory;
+        int new_max = max(pdev->max_asides_ids * 2, 256);
+        int64_t *ids = (int64_t *)gs_alloc_byte_array(mem, new_max, sizeof(int64_t),
+                                                      "pdf_record_aside_object");
+
+        if (ids == NULL) {
+            pdev->max_asides_ids = -1;
+            return;
+        }
+        if (pdev->num_asides_ids > 0)
+            memcpy(ids, pdev->asides_ids, pdev->num_asides_ids * sizeof(int64_t));
+        gs_free_object(mem, pdev->asides_ids, "pdf_record_aside_object");
+        pdev->asides_ids = ids;
+        pdev->max_asides_ids = new_max;
+    }
+    pdev->asides_ids[pdev->num_asides_ids++] = id;
+}
+
 /* Allocate an ID for a future object.
  * pdf_obj_ref below allocates an object and assigns it a position assuming
  * it will be written at the current location in the PDF file. But we want
@@ -762,6 +792,7 @@ pdf_obj_ref(gx_device_pdf * pdev)
         pos = pdf_stell(pdev);
         gp_fwrite(&pos, sizeof(pos), 1, pdev->xref.file);
     }
+    pdf_record_aside_object(pdev, id);
     return id;
 }
 
@@ -833,6 +864,7 @@ pdf_open_obj(gx_device_pdf * pdev, int64_t id, pdf_resource_type_t type)
         }
         if (gp_fseek(tfile, tpos, SEEK_SET) != 0)
 	        return_error(gs_error_ioerror);
+        pdf_record_aside_object(pdev, id);
     }
     if (pdev->ForOPDFRead && pdev->ProduceDSC) {
         switch(type) {
@@ -1377,6 +1409,9 @@ const gs_memory_struct_type_t *const pdf_resource_type_structs[] = {
     PDF_RESOURCE_TYPE_STRUCTS
 };
 
+static void pdf_unindex_resource(gx_device_pdf *pdev, pdf_resource_t *pres,
+                                 pdf_resource_type_t rtype);
+
 /* Cancel a resource (do not write it into PDF). */
 int
 pdf_cancel_resource(gx_device_pdf * pdev, pdf_resource_t *pres, pdf_resource_type_t rtype)
@@ -1428,6 +1463,7 @@ pdf_forget_resource(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_resource_ty
             *pprev = pres->prev;
             break;
         }
+    pdf_unindex_resource(pdev, pres1, rtype);
 
     for (i = (gs_id_hash(pres1->rid) % NUM_RESOURCE_CHAINS); i < NUM_RESOURCE_CHAINS; i++) {
         pprev = pchain + i;
@@ -1527,9 +1563,145 @@ pdf_find_resource_by_resource_id(gx_device_pdf * pdev, pdf_resource_type_t rtype
     return 0;
 }
 
-/* Find same resource. */
-int
-pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
+/* ------ Content index ------ */
+
+#define RESOURCE_INDEX_INITIAL_SIZE 64
+
+static inline uint
+pdf_resource_index_slot(const pdf_resource_index_t *pindex, uint64_t digest)
+{
+    return (uint)(digest ^ (digest >> 32)) & (pindex->size - 1);
+}
+
+/* Get the digest of a resource's object, as a 64 bit key. */
+static int
+pdf_resource_digest(gx_device_pdf *pdev, cos_object_t *pco, uint64_t *pdigest)
+{
+    byte digest[16];
+    uint64_t key = 0;
+    int code, i;
+
+    if (pco == NULL)
+        return 0;
+    code = cos_object_digest(pco, pdev, digest);
+    if (code <= 0)
+        return code;
+    for (i = 0; i < 8; i++)
+        key = (key << 8) | digest[i];
+    *pdigest = key;
+    return 1;
+}
+
+static int
+pdf_resize_resource_index(gx_device_pdf *pdev, pdf_resource_index_t *pindex, uint size)
+{
+    gs_memory_t *mem = pdev->pdf_memory->non_gc_memory;
+    pdf_resource_index_entry_t *old_entries = pindex->entries;
+    uint old_size = pindex->size, i;
+
+    pindex->entries = (pdf_resource_index_entry_t *)gs_alloc_byte_array(mem, size,
+                        sizeof(pdf_resource_index_entry_t), "pdf_resize_resource_index");
+    if (pindex->entries == NULL) {
+        pindex->entries = old_entries;
+        return_error(gs_error_VMerror);
+    }
+    memset(pindex->entries, 0, size * sizeof(pdf_resource_index_entry_t));
+    pindex->size = size;
+    for (i = 0; i < old_size; i++) {
+        if (old_entries[i].pres != NULL) {
+            uint k = pdf_resource_index_slot(pindex, old_entries[i].digest);
+
+            while (pindex->entries[k].pres != NULL)
+                k = (k + 1) & (size - 1);
+            pindex->entries[k] = old_entries[i];
+        }
+    }
+    gs_free_object(mem, old_entries, "pdf_resize_resource_index");
+    return 0;
+}
+
+static int
+pdf_index_resource(gx_device_pdf *pdev, pdf_resource_t *pres, pdf_resource_type_t rtype,
+                   uint64_t digest)
+{
+    pdf_resource_index_t *pindex = &pdev->resource_index[rtype];
+    uint k;
+
+    if (pres->indexed) {
+        if (pres->digest == digest)
+            return 0;
+        pdf_unindex_resource(pdev, pres, rtype); /* The object has changed. */
+    }
+    if ((pindex->count + 1) * 4 > pindex->size * 3) {
+        int code = pdf_resize_resource_index(pdev, pindex, (pindex->size == 0 ?
+                        RESOURCE_INDEX_INITIAL_SIZE : pindex->size * 2));
+
+        if (code < 0)
+            return code;
+    }
+    k = pdf_resource_index_slot(pindex, digest);
+    while (pindex->entries[k].pres != NULL)
+        k = (k + 1) & (pindex->size - 1);
+    pindex->entries[k].digest = digest;
+    pindex->entries[k].pres = pres;
+    pindex->count++;
+    pres->digest = digest;
+    pres->indexed = true;
+    return 0;
+}
+
+/* Remove a resource from the index, when it is removed from the chains. */
+static void
+pdf_unindex_resource(gx_device_pdf *pdev, pdf_resource_t *pres, pdf_resource_type_t rtype)
+{
+    pdf_resource_index_t *pindex;
+    uint mask, k, j;
+
+    if (!pres->indexed)
+        return;
+    pres->indexed = false;
+    if (pdev->resource_index == NULL)
+        return; /* Already freed by pdf_close. */
+    pindex = &pdev->resource_index[rtype];
+    mask = pindex->size - 1;
+    k = pdf_resource_index_slot(pindex, pres->digest);
+    while (pindex->entries[k].pres != pres) {
+        if (pindex->entries[k].pres == NULL)
+            return; /* Must not happen. */
+        k = (k + 1) & mask;
+    }
+    /* Shift back the following entries of the cluster,
+       so that no probe sequence crosses a free slot. */
+    for (j = (k + 1) & mask; pindex->entries[j].pres != NULL; j = (j + 1) & mask) {
+        uint home = pdf_resource_index_slot(pindex, pindex->entries[j].digest);
+
+        if (((j - home) & mask) >= ((j - k) & mask)) {
+            pindex->entries[k] = pindex->entries[j];
+            k = j;
+        }
+    }
+    pindex->entries[k].pres = NULL;
+    pindex->count--;
+}
+
+void
+pdf_free_resource_indices(gx_device_pdf *pdev)
+{
+    gs_memory_t *mem = pdev->pdf_memory->non_gc_memory;
+    int rtype;
+
+    if (pdev->resource_index == NULL)
+        return;
+    for (rtype = 0; rtype < NUM_RESOURCE_TYPES; rtype++)
+        gs_free_object(mem, pdev->resource_index[rtype].entries,
+                       "pdf_free_resource_indices");
+    gs_free_object(mem, pdev->resource_index, "pdf_free_resource_indices");
+    pdev->resource_index = NULL;
+}
+
+/* Find same resource by comparing with all resources of the type. */
+static int
+pdf_find_same_resource_by_scan(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
         int (*eq)(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1))
 {
     pdf_resource_t **pchain = pdev->resources[rtype].chains;
@@ -1563,6 +1735,75 @@ pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_reso
     return 0;
 }
 
+/* Find same resource. */
+/* Only the resources which this function kept as unique are compared,
+   and only those with an equal content digest. If no same resource is
+   found, *ppres is indexed, so its object must not change afterwards.
+   If the digest can't be computed, *ppres is kept as unique but isn't
+   indexed. */
+int
+pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
+        int (*eq)(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1))
+{
+    pdf_resource_index_t *pindex;
+    cos_object_t *pco0 = (*ppres)->object;
+    uint64_t digest;
+    uint k;
+    int code;
+
+    if (pdev->resource_index == NULL) {
+        gs_memory_t *mem = pdev->pdf_memory->non_gc_memory;
+
+        pdev->resource_index = (pdf_resource_index_t *)gs_alloc_byte_array(mem,
+                        NUM_RESOURCE_TYPES, sizeof(pdf_resource_index_t), "pdf_find_same_resource");
+        if (pdev->resource_index == NULL)
+            return_error(gs_error_VMerror);
+        memset(pdev->resource_index, 0, NUM_RESOURCE_TYPES * sizeof(pdf_resource_index_t));
+    }
+    pindex = &pdev->resource_index[rtype];
+    pindex->lookups++;
+    code = pdf_resource_digest(pdev, pco0, &digest);
+    if (code < 0)
+        return 0;   /* Like cos_stream_equal, treat a hashing failure as no match. */
+    if (code == 0) {
+        pindex->scans++;
+        code = pdf_find_same_resource_by_scan(pdev, rtype, ppres, eq);
+        if (code > 0)
+            pindex->found++;
+        return code;
+    }
+    if (pindex->size > 0) {
+        for (k = pdf_resource_index_slot(pindex, digest); pindex->entries[k].pres != NULL;
+             k = (k + 1) & (pindex->size - 1)) {
+            pdf_resource_t *pres = pindex->entries[k].pres;
+            cos_object_t *pco1 = pres->object;
+
+            if (pindex->entries[k].digest != digest || pres == *ppres)
+                continue;
+            if (pco1 == NULL || cos_type(pco0) != cos_type(pco1))
+                continue;	    /* don't compare different types */
+            pindex->compares++;
+            code = pco0->cos_procs->equal(pco0, pco1, pdev);
+            if (code < 0)
+                return code;
+            if (code == 0) {
+                pindex->collisions++;
+                continue;
+            }
+            code = eq(pdev, *ppres, pres);
+            if (code < 0)
+                return code;
+            if (code > 0) {
+                pindex->found++;
+                *ppres = pres;
+                return 1;
+            }
+        }
+    }
+    code = pdf_index_resource(pdev, *ppres, rtype, digest);
+    return (code < 0 ? code : 0);
+}
+
 void
 pdf_drop_resource_from_chain(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_resource_type_t rtype)
 {
@@ -1591,6 +1832,7 @@ pdf_drop_resource_from_chain(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_re
             *pprev = pres->prev;
             break;
         }
+    pdf_unindex_resource(pdev, pres1, rtype);
 
     for (i = (gs_id_hash(pres1->rid) % NUM_RESOURCE_CHAINS); i < NUM_RESOURCE_CHAINS; i++) {
         pprev = pchain + i;
@@ -1624,6 +1866,7 @@ pdf_drop_resources(gx_device_pdf * pdev, pdf_resource_type_t rtype,
         pprev = pchain + i;
         for (; (pres = *pprev) != 0; ) {
             if (cond(pdev, pres)) {
+                pdf_unindex_resource(pdev, pres, rtype);
                 *pprev = pres->next;
                 pres->next = pres; /* A temporary mark - see below */
             } else
@@ -1653,6 +1896,8 @@ pdf_print_resource_statistics(gx_device_pdf * pdev)
 
     for (rtype = 0; rtype < NUM_RESOURCE_TYPES; rtype++) {
         pdf_resource_t **pchain = pdev->resources[rtype].chains;
+        const pdf_resource_index_t *pindex =
+            (pdev->resource_index ? &pdev->resource_index[rtype] : NULL);
         pdf_resource_t *pres;
         const char *name = pdf_resource_type_names[rtype];
         int i, n = 0;
@@ -1662,6 +1907,12 @@ pdf_print_resource_statistics(gx_device_pdf * pdev)
         }
         dmprintf3(pdev->pdf_memory, "Resource type %d (%s) has %d instances.\n", rtype,
                 (name ? name : ""), n);
+        if (pindex != NULL && pindex->lookups > 0) {
+            dmprintf4(pdev->pdf_memory, "    %u indexed in %u slots, %"PRId64" lookups found %"PRId64" same resources,\n",
+                      pindex->count, pindex->size, pindex->lookups, pindex->found);
+            dmprintf3(pdev->pdf_memory, "    %"PRId64" comparisons, %"PRId64" digest collisions, %"PRId64" full scans.\n",
+                      pindex->compares, pindex->collisions, pindex->scans);
+        }
     }
 }
 
@@ -2076,6 +2327,7 @@ pdf_free_resource_objects(gx_device_pdf *pdev, pdf_resource_type_t rtype)
                     cos_free(pres->object, "pdf_free_resource_objects");
                     pres->object = 0;
                 }
+                pdf_unindex_resource(pdev, pres, rtype);
                 *prev = pres->next;
             }
         }
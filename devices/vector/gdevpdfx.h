@@ -198,6 +198,8 @@ typedef enum {
     bool global;                /* ps2write only */\
     char rname[1/*R*/ + (sizeof(int64_t) * 8 / 3 + 1) + 1/*\0*/];\
     uint64_t where_used;                /* 1 bit per level of content stream */\
+    uint64_t digest;                /* content digest, valid if indexed */\
+    bool indexed;                /* in the content index, see pdf_find_same_resource */\
     cos_object_t *object
 typedef struct pdf_resource_s pdf_resource_t;
 struct pdf_resource_s {
@@ -286,6 +288,33 @@ struct pdf_article_s {
  * long lists.
  */
 #define NUM_RESOURCE_CHAINS 16
+
+/* Besides that, the resources which pdf_find_same_resource kept as unique
+ * are indexed by a digest of their contents, so that looking for a same
+ * resource only compares the resources with an equal digest. The tables
+ * are open addressed, allocated from non-GC memory on first use, and their
+ * pointers are relocated by the device's GC procedures. The indexed
+ * resources are always in the chains, which keep them alive.
+ * The tables are kept out of the device structure, because the offsets of
+ * the parameters after it (see pdf_param_items) must fit in a short.
+ */
+typedef struct pdf_resource_index_entry_s {
+    uint64_t digest;
+    pdf_resource_t *pres;        /* NULL if the slot is free */
+} pdf_resource_index_entry_t;
+
+typedef struct pdf_resource_index_s {
+    pdf_resource_index_entry_t *entries;
+    uint size;                        /* a power of 2, or 0 */
+    uint count;
+    /* Statistics for pdf_print_resource_statistics. */
+    int64_t lookups;                /* calls of pdf_find_same_resource */
+    int64_t found;                /* lookups which found a same resource */
+    int64_t compares;                /* calls of cos_procs->equal */
+    int64_t collisions;                /* compares of unequal objects */
+    int64_t scans;                /* lookups for unindexable objects */
+} pdf_resource_index_t;
+
 typedef struct pdf_resource_list_s {
     pdf_resource_t *chains[NUM_RESOURCE_CHAINS];
 } pdf_resource_list_t;
@@ -737,6 +766,7 @@ struct gx_device_pdf_s {
     int num_pages;
     uint64_t used_mask;                /* for where_used: page level = 1 */
     pdf_resource_list_t resources[NUM_RESOURCE_TYPES];
+    pdf_resource_index_t *resource_index; /* [NUM_RESOURCE_TYPES], non-GC, or NULL */
     /* cs_Patterns[0] is colored; 1,3,4 are uncolored + Gray,RGB,CMYK */
     pdf_resource_t *cs_Patterns[5];
     pdf_resource_t *Identity_ToUnicode_CMaps[2]; /* WMode = 0,1 */
@@ -993,8 +1023,17 @@ struct gx_device_pdf_s {
     bool ToUnicodeForStdEnc;        /* Should we emit ToUnicode CMaps when a simple font has only standard glyph names. Defaults to true */
     bool EmbedSubstituteFonts;      /* When we use a substitute font to replace a missing font, should we embed it in the output */
     bool UseBrotli;                 /* Use Brotli compression in place of Flate */
+    bool StreamResources;           /* If true, copy the objects written aside into the output file at the end of each page */
+    int64_t *asides_ids;            /* For StreamResources, the objects written aside since the last copy (non-GC) */
+    int num_asides_ids;
+    int max_asides_ids;             /* Allocated size of asides_ids, or -1 after an allocation failure */
 };
 
+/* Whether pdf_close_page copies the asides into the output file, see StreamResources. */
+#define pdf_streams_resources(pdev)\
+  ((pdev)->StreamResources && !(pdev)->Linearise && !(pdev)->ForOPDFRead &&\
+   (pdev)->max_asides_ids >= 0)
+
 #define is_in_page(pdev)\
   ((pdev)->contents_id != 0)
 
@@ -1218,6 +1257,9 @@ void pdf_drop_resources(gx_device_pdf * pdev, pdf_resource_type_t rtype,
 /* Print resource statistics. */
 void pdf_print_resource_statistics(gx_device_pdf * pdev);
 
+/* Free the content indices of the resources. */
+void pdf_free_resource_indices(gx_device_pdf * pdev);
+
 /* Cancel a resource (do not write it into PDF). */
 int pdf_cancel_resource(gx_device_pdf * pdev, pdf_resource_t *pres,
         pdf_resource_type_t rtype);
@@ -1355,7 +1397,6 @@ void pdf_remove_masked_image_converter(gx_device_pdf *pdev, pdf_lcvd_t *cvd, boo
 #define PDF_MAX_PRODUCER 200        /* adhoc */
 /* Generate the default Producer string. */
 void pdf_store_default_Producer(char buf[PDF_MAX_PRODUCER]);
-
 /* Define the strings for filter names and parameters. */
 typedef struct pdf_filter_names_s {
     const char *ASCII85Decode;
@@ -21,6 +21,7 @@
 #include "unistd_.h"
 #include "gx.h"
 #include "gscdefs.h"
+#include "gpmisc.h"
 #include "gxdevice.h"
 #include "gdevpsu.h"
 #include "spprint.h"
@@ -192,13 +193,21 @@ psw_begin_file_header(gp_file *f, const gx_device *dev, const gs_rect *pbbox,
     {
         time_t t;
         struct tm tms;
+#ifndef CLUSTER
+        int64_t epoch;
+#endif
 
 #ifdef CLUSTER
         memset(&t, 0, sizeof(t));
         memset(&tms, 0, sizeof(tms));
 #else
-        time(&t);
-        tms = *localtime(&t);
+        if (gp_source_date_epoch(&epoch)) {
+            t = (time_t)epoch;
+            tms = *gmtime(&t);
+        } else {
+            time(&t);
+            tms = *localtime(&t);
+        }
 #endif
         fprintf(f, "%%%%CreationDate: %d/%02d/%02d %02d:%02d:%02d\n",
                 tms.tm_year + 1900, tms.tm_mon + 1, tms.tm_mday,
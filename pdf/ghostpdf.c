@@ -40,9 +40,11 @@
 #include "pdf_xref.h"
 #include "pdf_device.h"
 #include "pdf_mark.h"
+#include "pdf_prefetch.h"
 
 #include "gsstate.h"        /* For gs_gstate */
 #include "gsicc_manage.h"  /* For gsicc_init_iccmanager() */
+#include "gp.h"            /* For gp_map_file() */
 
 #if PDFI_LEAK_CHECK
 #include "gsmchunk.h"
@@ -898,6 +900,24 @@ int pdfi_finish_pdf_file(pdf_context *ctx)
     return 0;
 }
 
+/* Undo pdfi_map_input, putting back the stream we were originally given */
+static void pdfi_unmap_input(pdf_context *ctx)
+{
+    if (ctx->mapped_stream == NULL)
+        return;
+
+    if (ctx->main_stream && ctx->main_stream->s == ctx->mapped_stream)
+        ctx->main_stream->s = ctx->mapped_source;
+
+    sclose(ctx->mapped_stream);
+    gs_free_object(ctx->memory, ctx->mapped_stream, "pdfi_unmap_input");
+    gp_unmap_file(ctx->mapped_input, ctx->mapped_input_size);
+    ctx->mapped_stream = NULL;
+    ctx->mapped_source = NULL;
+    ctx->mapped_input = NULL;
+    ctx->mapped_input_size = 0;
+}
+
 int pdfi_close_pdf_file(pdf_context *ctx)
 {
     if (ctx->Root) {
@@ -917,6 +937,8 @@ int pdfi_close_pdf_file(pdf_context *ctx)
         }
     }
 
+    pdfi_unmap_input(ctx);
+
     if (ctx->main_stream) {
         if (ctx->main_stream->s) {
             sfclose(ctx->main_stream->s);
@@ -1396,6 +1418,50 @@ exit:
     return code;
 }
 
+/* With -dPDFMapInput, map the whole of the input file into memory and
+ * read it through a string stream, so that the tokeniser, the xref and
+ * object stream parsing and the filters all read straight from the file
+ * contents rather than through the file stream buffer. If the file cannot
+ * be mapped we just carry on with the stream we were given. Nothing checks
+ * that the file stays the same (see gp_map_file), so the documentation for
+ * the switch requires that it doesn't change.
+ */
+static void pdfi_map_input(pdf_context *ctx, stream *stm)
+{
+    gs_offset_t size = 0;
+    byte *data;
+    stream *s;
+
+    if (!ctx->args.mapinput || stm->file == NULL || stm->file_offset != 0)
+        return;
+
+    data = gp_map_file(stm->file, &size);
+    if (data == NULL)
+        return;
+
+    /* A string stream can't be larger than max_uint */
+    if (size > max_uint || stm->file_limit < size) {
+        gp_unmap_file(data, size);
+        return;
+    }
+
+    s = file_alloc_stream(ctx->memory, "pdfi_map_input");
+    if (s == NULL) {
+        gp_unmap_file(data, size);
+        return;
+    }
+    sread_string(s, data, (uint)size);
+    s->close_at_eod = false;
+    if (stm->file_name.data != NULL)
+        (void)ssetfilename(s, stm->file_name.data, stm->file_name.size - 1);
+
+    ctx->mapped_input = data;
+    ctx->mapped_input_size = size;
+    ctx->mapped_stream = s;
+    ctx->mapped_source = stm;
+    ctx->main_stream->s = s;
+}
+
 int pdfi_set_input_stream(pdf_context *ctx, stream *stm)
 {
     byte *Buffer = NULL;
@@ -1416,6 +1482,7 @@ int pdfi_set_input_stream(pdf_context *ctx, stream *stm)
         return_error(gs_error_VMerror);
     memset(ctx->main_stream, 0x00, sizeof(pdf_c_stream));
     ctx->main_stream->s = stm;
+    pdfi_map_input(ctx, stm);
 
     Buffer = gs_alloc_bytes(ctx->memory, BUF_SIZE, "PDF interpreter - allocate working buffer for file validation");
     if (Buffer == NULL) {
@@ -1964,6 +2031,7 @@ pdf_context *pdfi_create_context(gs_memory_t *mem)
     ctx->args.preservemarkedcontent = true;
     ctx->args.preserveembeddedfiles = true;
     ctx->args.preservedocview = true;
+    ctx->args.prefetchmemory = PDFI_PREFETCH_DEFAULT_MEMORY;
     /* NOTE: For testing certain annotations on cluster, might want to set this to false */
     ctx->args.printed = false; /* True if OutputFile is set, false otherwise see pdftop.c, pdf_impl_set_param() */
 
@@ -1991,12 +2059,11 @@ pdf_context *pdfi_create_context(gs_memory_t *mem)
 #if REFCNT_DEBUG
     ctx->UID = 1;
 #endif
-#if CACHE_STATISTICS
     ctx->hits = 0;
     ctx->misses = 0;
     ctx->compressed_hits = 0;
     ctx->compressed_misses = 0;
-#endif
+    ctx->evictions = 0;
 #ifdef DEBUG
     ctx->args.verbose_errors = ctx->args.verbose_warnings = 1;
 #endif
@@ -2061,6 +2128,7 @@ pdfi_purge_obj_cache(pdf_context *ctx)
         }
         ctx->cache_LRU = ctx->cache_MRU = NULL;
         ctx->cache_entries = 0;
+        ctx->cache_size = 0;
     }
 }
 #endif
@@ -2072,21 +2140,46 @@ pdfi_purge_obj_cache(pdf_context *ctx)
  */
 int pdfi_clear_context(pdf_context *ctx)
 {
-#if CACHE_STATISTICS
-    float compressed_hit_rate = 0.0, hit_rate = 0.0;
-
-    if (ctx->compressed_hits > 0 || ctx->compressed_misses > 0)
-        compressed_hit_rate = (float)ctx->compressed_hits / (float)(ctx->compressed_hits + ctx->compressed_misses);
-    if (ctx->hits > 0 || ctx->misses > 0)
-        hit_rate = (float)ctx->hits / (float)(ctx->hits + ctx->misses);
-
-    outprintf(ctx->memory, "Number of normal object cache hits: %"PRIi64"\n", ctx->hits);
-    outprintf(ctx->memory, "Number of normal object cache misses: %"PRIi64"\n", ctx->misses);
-    outprintf(ctx->memory, "Number of compressed object cache hits: %"PRIi64"\n", ctx->compressed_hits);
-    outprintf(ctx->memory, "Number of compressed object cache misses: %"PRIi64"\n", ctx->compressed_misses);
-    outprintf(ctx->memory, "Normal object cache hit rate: %f\n", hit_rate);
-    outprintf(ctx->memory, "Compressed object cache hit rate: %f\n", compressed_hit_rate);
-#endif
+    /* We get called both when closing a file and when freeing the context,
+     * only report once, while there is something to report.
+     */
+    if ((ctx->args.objectcachestats || CACHE_STATISTICS) && (ctx->hits + ctx->misses) > 0) {
+        float compressed_hit_rate = 0.0, hit_rate = 0.0;
+
+        if (ctx->compressed_hits > 0 || ctx->compressed_misses > 0)
+            compressed_hit_rate = (float)ctx->compressed_hits / (float)(ctx->compressed_hits + ctx->compressed_misses);
+        if (ctx->hits > 0 || ctx->misses > 0)
+            hit_rate = (float)ctx->hits / (float)(ctx->hits + ctx->misses);
+
+        outprintf(ctx->memory, "Number of normal object cache hits: %"PRIi64"\n", ctx->hits);
+        outprintf(ctx->memory, "Number of normal object cache misses: %"PRIi64"\n", ctx->misses);
+        outprintf(ctx->memory, "Number of compressed object cache hits: %"PRIi64"\n", ctx->compressed_hits);
+        outprintf(ctx->memory, "Number of compressed object cache misses: %"PRIi64"\n", ctx->compressed_misses);
+        outprintf(ctx->memory, "Number of object cache evictions: %"PRIi64"\n", ctx->evictions);
+        outprintf(ctx->memory, "Normal object cache hit rate: %f\n", hit_rate);
+        outprintf(ctx->memory, "Compressed object cache hit rate: %f\n", compressed_hit_rate);
+        if (ctx->args.objectcachesize > 0)
+            outprintf(ctx->memory, "Object cache peak size: %"PRIi64" of %"PRIi64" bytes\n",
+                      ctx->cache_peak_size, ctx->args.objectcachesize);
+        else
+            outprintf(ctx->memory, "Object cache limited to %d entries\n", MAX_OBJECT_CACHE_SIZE);
+
+        ctx->hits = ctx->misses = 0;
+        ctx->compressed_hits = ctx->compressed_misses = 0;
+        ctx->evictions = 0;
+        ctx->cache_peak_size = 0;
+    }
+    if (ctx->args.patterncachestats && (ctx->pattern_hits + ctx->pattern_misses) > 0) {
+        outprintf(ctx->memory, "Number of pattern cache hits: %"PRIu64"\n", ctx->pattern_hits);
+        outprintf(ctx->memory, "Number of pattern tiles rendered: %"PRIu64"\n", ctx->pattern_misses);
+        outprintf(ctx->memory, "Number of pattern cache evictions: %"PRIu64"\n", ctx->pattern_evictions);
+        outprintf(ctx->memory, "Number of pattern tiles kept at end of page: %"PRIu64"\n", ctx->pattern_retained);
+        outprintf(ctx->memory, "Number of kept pattern tiles used on a later page: %"PRIu64"\n", ctx->pattern_reused);
+        outprintf(ctx->memory, "Pattern cache peak size: %"PRIu64" bytes\n", ctx->pattern_peak_size);
+
+        ctx->pattern_hits = ctx->pattern_misses = ctx->pattern_evictions = 0;
+        ctx->pattern_retained = ctx->pattern_reused = ctx->pattern_peak_size = 0;
+    }
     if (ctx->PathSegments != NULL) {
         gs_free_object(ctx->memory, ctx->PathSegments, "pdfi_clear_context");
         ctx->PathSegments = NULL;
@@ -2162,6 +2255,8 @@ int pdfi_clear_context(pdf_context *ctx)
         ctx->filename = NULL;
     }
 
+    pdfi_unmap_input(ctx);
+
     if (ctx->main_stream) {
         gs_free_object(ctx->memory, ctx->main_stream, "pdfi_clear_context, free main PDF stream");
         ctx->main_stream = NULL;
@@ -2254,6 +2349,7 @@ int pdfi_clear_context(pdf_context *ctx)
 #endif
         ctx->cache_LRU = ctx->cache_MRU = NULL;
         ctx->cache_entries = 0;
+        ctx->cache_size = 0;
     }
 
     /* We can't free the font directory before the graphics library fonts fonts are freed, as they reference the font_dir.
@@ -89,7 +89,7 @@ typedef enum pdf_type3_d_type_e {
 
 #define INITIAL_STACK_SIZE 32
 #define MAX_STACK_SIZE 524288
-#define MAX_OBJECT_CACHE_SIZE 200
+#define MAX_OBJECT_CACHE_SIZE 200     /* Used unless -dPDFObjectCacheSize= is set */
 #define INITIAL_LOOP_TRACKER_SIZE 32
 
 typedef struct pdf_transfer_s {
@@ -174,6 +174,16 @@ typedef struct cmd_args_s {
 
     bool ignoretounicode;
     bool nonativefontmap;
+    int64_t objectcachesize;    /* -dPDFObjectCacheSize=, bytes. 0 means limit by object count */
+    bool objectcachestats;      /* -dPDFObjectCacheStats, report cache use at end of file */
+    bool mapinput;              /* -dPDFMapInput, read the input file through a memory mapping */
+    int prefetchthreads;        /* -dPDFPrefetchThreads=, threads decoding images ahead. 0 is off */
+    int64_t prefetchmemory;     /* -dPDFPrefetchMemory=, bytes the decoded images may use */
+    int jpxthreads;             /* -dPDFJPXThreads=, OpenJPEG threads per JPXDecode image */
+    bool jpxreduce;             /* -dPDFJPXReduce, decode JPX images at no more than device resolution */
+    bool dctreduce;             /* -dPDFDCTReduce, decode DCT images at no more than device resolution */
+    int64_t patterncachesize;   /* -dPDFPatternCacheSize=, bytes. Non-zero keeps tiles between pages */
+    bool patterncachestats;     /* -dPDFPatternCacheStats, report pattern cache use at end of file */
 } cmd_args_t;
 
 typedef struct encryption_state_s {
@@ -331,6 +341,8 @@ typedef struct search_paths_s
     bool search_here_first;
 } search_paths_t;
 
+typedef struct pdfi_prefetch_s pdfi_prefetch_t;
+
 typedef struct pdf_context_s
 {
     pdf_obj_common;
@@ -421,6 +433,21 @@ typedef struct pdf_context_s
 
     /* Length of the main file */
     gs_offset_t main_stream_length;
+
+    /* If the input file is memory mapped (-dPDFMapInput) main_stream->s is
+     * a string stream over the mapping, and the stream we were given is
+     * kept in mapped_source so it can be put back before it is closed.
+     */
+    byte *mapped_input;
+    gs_offset_t mapped_input_size;
+    stream *mapped_stream;
+    stream *mapped_source;
+
+    /* Images being decoded ahead of the interpreter (-dPDFPrefetchThreads),
+     * only set while a page is being interpreted. See pdf_prefetch.h.
+     */
+    pdfi_prefetch_t *prefetch;
+
     /* offset to the xref table */
     gs_offset_t startxref;
 
@@ -465,6 +492,8 @@ typedef struct pdf_context_s
 
     /* The object cache */
     uint32_t cache_entries;
+    uint64_t cache_size;        /* Estimated bytes held by the cache entries */
+    uint64_t cache_peak_size;
     pdf_obj_cache_entry *cache_LRU;
     pdf_obj_cache_entry *cache_MRU;
 
@@ -513,12 +542,21 @@ typedef struct pdf_context_s
 #if REFCNT_DEBUG
     uint64_t ref_UID;
 #endif
-#if CACHE_STATISTICS
+    /* Object cache statistics, reported by pdfi_clear_context if
+     * -dPDFObjectCacheStats is set (or CACHE_STATISTICS is defined) */
     uint64_t hits;
     uint64_t misses;
     uint64_t compressed_hits;
     uint64_t compressed_misses;
-#endif
+    uint64_t evictions;
+    /* Pattern cache statistics, collected at the end of each page and
+     * reported by pdfi_clear_context if -dPDFPatternCacheStats is set */
+    uint64_t pattern_hits;
+    uint64_t pattern_misses;
+    uint64_t pattern_evictions;
+    uint64_t pattern_retained;
+    uint64_t pattern_reused;
+    uint64_t pattern_peak_size;
 #if PDFI_LEAK_CHECK
     gs_memory_status_t memstat;
 #endif
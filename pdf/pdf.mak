@@ -157,6 +157,11 @@ $(PDFOBJ)pdf_image.$(OBJ): $(PDFSRC)pdf_image.c $(PDFINCLUDES) \
     $(PDF_MAK) $(MAKEDIRS)
 	$(PDFCCC) $(PDFSRC)pdf_image.c $(PDFO_)pdf_image.$(OBJ)
 
+$(PDFOBJ)pdf_prefetch.$(OBJ): $(PDFSRC)pdf_prefetch.c $(PDFINCLUDES) \
+	$(stream_h) $(strimpl_h) $(gxsync_h) $(gsmchunk_h) $(szlibx_h) $(spngpx_h) $(spdiffx_h) \
+	$(PDF_MAK) $(MAKEDIRS)
+	$(PDFCCC) $(PDFSRC)pdf_prefetch.c $(PDFO_)pdf_prefetch.$(OBJ)
+
 $(PDFOBJ)pdf_page.$(OBJ): $(PDFSRC)pdf_page.c $(PDFINCLUDES) \
 	$(gscoord_h) $(gspaint_h) $(gsstate_h) $(gspath2_h) $(PDF_MAK) $(MAKEDIRS)
 	$(PDFCCC) $(PDFSRC)pdf_page.c $(PDFO_)pdf_page.$(OBJ)
@@ -307,6 +312,7 @@ PDF_OBJS=\
     $(PDFOBJ)pdf_gstate.$(OBJ)\
     $(PDFOBJ)pdf_stack.$(OBJ)\
     $(PDFOBJ)pdf_image.$(OBJ)\
+    $(PDFOBJ)pdf_prefetch.$(OBJ)\
     $(PDFOBJ)pdf_page.$(OBJ)\
     $(PDFOBJ)pdf_annot.$(OBJ)\
     $(PDFOBJ)pdf_mark.$(OBJ)\
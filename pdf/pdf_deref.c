@@ -30,6 +30,7 @@
 #include "pdf_array.h"
 #include "pdf_deref.h"
 #include "pdf_repair.h"
+#include "pdf_font_types.h"
 
 /* Start with the object caching functions */
 /* Disable object caching (for easier debugging with reference counting)
@@ -37,6 +38,107 @@
  */
 /*#define DISABLE CACHE*/
 
+/* Limit on how deeply we descend into direct objects when estimating the
+ * size of an object for the cache. Anything deeper is simply not counted.
+ */
+#define CACHE_SIZE_MAX_DEPTH 32
+
+/* Estimate the memory used by an object, for the size limited object cache.
+ * Direct objects inside dictionaries and arrays are counted as part of their
+ * parent, indirect objects are cached (and counted) in their own right. This
+ * doesn't attempt to account for font programs, or graphics library objects
+ * hanging off the pdfi objects, so it is only ever an estimate.
+ */
+static uint64_t pdfi_obj_cache_size(pdf_obj *o, int depth)
+{
+    uint64_t size = 0, i;
+
+    if (o == NULL || o < PDF_TOKEN_AS_OBJ(TOKEN__LAST_KEY) || depth > CACHE_SIZE_MAX_DEPTH)
+        return 0;
+
+    switch (pdfi_type_of(o)) {
+        case PDF_DICT:
+        {
+            pdf_dict *d = (pdf_dict *)o;
+
+            size = sizeof(pdf_dict) + d->size * sizeof(pdf_dict_entry);
+            for (i = 0; i < d->entries; i++) {
+                size += pdfi_obj_cache_size(d->list[i].key, depth + 1);
+                if (d->list[i].value != NULL && d->list[i].value > PDF_TOKEN_AS_OBJ(TOKEN__LAST_KEY) &&
+                    d->list[i].value->object_num == 0)
+                    size += pdfi_obj_cache_size(d->list[i].value, depth + 1);
+            }
+            break;
+        }
+        case PDF_ARRAY:
+        {
+            pdf_array *a = (pdf_array *)o;
+
+            size = sizeof(pdf_array) + a->size * sizeof(pdf_obj *);
+            for (i = 0; i < a->size; i++) {
+                if (a->values[i] != NULL && a->values[i] > PDF_TOKEN_AS_OBJ(TOKEN__LAST_KEY) &&
+                    a->values[i]->object_num == 0)
+                    size += pdfi_obj_cache_size(a->values[i], depth + 1);
+            }
+            break;
+        }
+        case PDF_STRING:
+        case PDF_NAME:
+            size = sizeof(pdf_string) + ((pdf_string *)o)->length;
+            break;
+        case PDF_BUFFER:
+            size = sizeof(pdf_buffer) + ((pdf_buffer *)o)->length;
+            break;
+        case PDF_STREAM:
+            size = sizeof(pdf_stream) + pdfi_obj_cache_size((pdf_obj *)((pdf_stream *)o)->stream_dict, depth + 1);
+            break;
+        case PDF_FONT:
+            /* The font dictionary is replaced in the cache by the font, so count it here */
+            size = sizeof(pdf_font) + pdfi_obj_cache_size((pdf_obj *)((pdf_font *)o)->PDF_font, depth + 1);
+            break;
+        case PDF_INT:
+        case PDF_REAL:
+            size = sizeof(pdf_num);
+            break;
+        default:
+            size = sizeof(pdf_obj);
+            break;
+    }
+    return size;
+}
+
+/* Remove an entry from the cache, wherever it is in the list */
+static void pdfi_remove_cache_entry(pdf_context *ctx, pdf_obj_cache_entry *entry)
+{
+    if (entry->previous)
+        ((pdf_obj_cache_entry *)entry->previous)->next = entry->next;
+    else
+        ctx->cache_LRU = entry->next;
+    if (entry->next)
+        ((pdf_obj_cache_entry *)entry->next)->previous = entry->previous;
+    else
+        ctx->cache_MRU = entry->previous;
+    ctx->xref_table->xref[entry->o->object_num].cache = NULL;
+    pdfi_countdown(entry->o);
+    ctx->cache_entries--;
+    ctx->cache_size -= entry->size;
+    gs_free_object(ctx->memory, entry, "pdfi_remove_cache_entry");
+}
+
+/* Remove the least-recently-used entry from the cache */
+static int pdfi_evict_cache_LRU(pdf_context *ctx)
+{
+    if (ctx->cache_LRU == NULL)
+        return_error(gs_error_unknownerror);
+
+#if DEBUG_CACHE
+    dbgmprintf(ctx->memory, "Cache full, evicting LRU\n");
+#endif
+    pdfi_remove_cache_entry(ctx, ctx->cache_LRU);
+    ctx->evictions++;
+    return 0;
+}
+
 /* given an object, create a cache entry for it. If we have too many entries
  * then delete the leat-recently-used cache entry. Make the new entry be the
  * most-recently-used entry. The actual entries are attached to the xref table
@@ -44,11 +146,15 @@
  * cache entry by seeing that the xref table for the object number has a non-NULL
  * 'cache' member.
  * So we need to update the xref as well if we add or delete cache entries.
+ * If -dPDFObjectCacheSize= is set then 'too many' is measured by the estimated
+ * size of the cached objects, otherwise by the number of entries.
  */
 static int pdfi_add_to_cache(pdf_context *ctx, pdf_obj *o)
 {
 #ifndef DISABLE_CACHE
     pdf_obj_cache_entry *entry;
+    uint64_t size = 0;
+    int code;
 
     if (o < PDF_TOKEN_AS_OBJ(TOKEN__LAST_KEY))
         return 0;
@@ -63,22 +169,20 @@ static int pdfi_add_to_cache(pdf_context *ctx, pdf_obj *o)
     if (o->object_num > ctx->xref_table->xref_size)
         return_error(gs_error_rangecheck);
 
-    if (ctx->cache_entries == MAX_OBJECT_CACHE_SIZE)
-    {
-#if DEBUG_CACHE
-        dbgmprintf(ctx->memory, "Cache full, evicting LRU\n");
-#endif
-        if (ctx->cache_LRU) {
-            entry = ctx->cache_LRU;
-            ctx->cache_LRU = entry->next;
-            if (entry->next)
-                ((pdf_obj_cache_entry *)entry->next)->previous = NULL;
-            ctx->xref_table->xref[entry->o->object_num].cache = NULL;
-            pdfi_countdown(entry->o);
-            ctx->cache_entries--;
-            gs_free_object(ctx->memory, entry, "pdfi_add_to_cache, free LRU");
-        } else
-            return_error(gs_error_unknownerror);
+    if (ctx->args.objectcachesize > 0) {
+        size = sizeof(pdf_obj_cache_entry) + pdfi_obj_cache_size(o, 0);
+        /* Don't let one object empty the whole cache */
+        if (size > ctx->args.objectcachesize)
+            return 0;
+        while (ctx->cache_size + size > ctx->args.objectcachesize) {
+            code = pdfi_evict_cache_LRU(ctx);
+            if (code < 0)
+                return code;
+        }
+    } else if (ctx->cache_entries == MAX_OBJECT_CACHE_SIZE) {
+        code = pdfi_evict_cache_LRU(ctx);
+        if (code < 0)
+            return code;
     }
     entry = (pdf_obj_cache_entry *)gs_alloc_bytes(ctx->memory, sizeof(pdf_obj_cache_entry), "pdfi_add_to_cache");
     if (entry == NULL)
@@ -87,6 +191,10 @@ static int pdfi_add_to_cache(pdf_context *ctx, pdf_obj *o)
     memset(entry, 0x00, sizeof(pdf_obj_cache_entry));
 
     entry->o = o;
+    entry->size = size;
+    ctx->cache_size += size;
+    if (ctx->cache_size > ctx->cache_peak_size)
+        ctx->cache_peak_size = ctx->cache_size;
     pdfi_countup(o);
     if (ctx->cache_MRU) {
         entry->previous = ctx->cache_MRU;
@@ -140,6 +248,8 @@ int replace_cache_entry(pdf_context *ctx, pdf_obj *o)
     xref_entry *entry;
     pdf_obj_cache_entry *cache_entry;
     pdf_obj *old_cached_obj = NULL;
+    uint64_t size;
+    int code;
 
     /* Limited error checking here, we assume that things like the
      * validity of the object (eg not a free oobject) have already been handled.
@@ -151,6 +261,30 @@ int replace_cache_entry(pdf_context *ctx, pdf_obj *o)
     if (cache_entry == NULL) {
         return(pdfi_add_to_cache(ctx, o));
     } else {
+        pdfi_promote_cache_entry(ctx, cache_entry);
+        if (ctx->args.objectcachesize > 0) {
+            size = sizeof(pdf_obj_cache_entry) + pdfi_obj_cache_size(o, 0);
+            /* As in pdfi_add_to_cache, an object over the whole budget isn't
+             * cached, so the entry for the object it replaces goes too.
+             */
+            if (size > ctx->args.objectcachesize) {
+                pdfi_remove_cache_entry(ctx, cache_entry);
+                return 0;
+            }
+            /* Make room before the entry grows. It is now the MRU, so the
+             * other entries all go before it would.
+             */
+            while (ctx->cache_size - cache_entry->size + size > ctx->args.objectcachesize) {
+                code = pdfi_evict_cache_LRU(ctx);
+                if (code < 0)
+                    return code;
+            }
+            ctx->cache_size += size - cache_entry->size;
+            cache_entry->size = size;
+            if (ctx->cache_size > ctx->cache_peak_size)
+                ctx->cache_peak_size = ctx->cache_size;
+        }
+
         /* NOTE: We grab the object without decrementing, to avoid triggering
          * a warning message for freeing an object that's in the cache
          */
@@ -160,7 +294,6 @@ int replace_cache_entry(pdf_context *ctx, pdf_obj *o)
         /* Put new entry in the cache */
         cache_entry->o = o;
         pdfi_countup(o);
-        pdfi_promote_cache_entry(ctx, cache_entry);
 
         /* Now decrement the old cache entry, if any */
         pdfi_countdown(old_cached_obj);
@@ -637,9 +770,7 @@ static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, p
     }
 
     if (compressed_entry->cache == NULL) {
-#if CACHE_STATISTICS
         ctx->compressed_misses++;
-#endif
         code = pdfi_seek(ctx, ctx->main_stream, compressed_entry->u.uncompressed.offset, SEEK_SET);
         if (code < 0)
             goto exit;
@@ -671,9 +802,7 @@ static int pdfi_deref_compressed(pdf_context *ctx, uint64_t obj, uint64_t gen, p
         if (code < 0)
             goto exit;
     } else {
-#if CACHE_STATISTICS
         ctx->compressed_hits++;
-#endif
         compressed_object = (pdf_stream *)compressed_entry->cache->o;
         pdfi_countup(compressed_object);
         pdfi_promote_cache_entry(ctx, compressed_entry->cache);
@@ -982,9 +1111,7 @@ static int pdfi_dereference_main(pdf_context *ctx, uint64_t obj, uint64_t gen, p
     if (entry->cache != NULL){
         pdf_obj_cache_entry *cache_entry = entry->cache;
 
-#if CACHE_STATISTICS
         ctx->hits++;
-#endif
         *object = cache_entry->o;
         pdfi_countup(*object);
 
@@ -1000,9 +1127,7 @@ static int pdfi_dereference_main(pdf_context *ctx, uint64_t obj, uint64_t gen, p
             if (code < 0 || *object == NULL)
                 goto error;
         } else {
-#if CACHE_STATISTICS
             ctx->misses++;
-#endif
             ctx->encryption.decrypt_strings = true;
 
             code = pdfi_seek(ctx, ctx->main_stream, entry->u.uncompressed.offset, SEEK_SET);
@@ -64,7 +64,7 @@ extern const uint file_default_buffer_size;
 static void pdfi_close_filter_chain(pdf_context *ctx, stream *s, stream *target);
 
 /* Utility routine to create a pdf_c_stream object */
-static int pdfi_alloc_stream(pdf_context *ctx, stream *source, stream *original, pdf_c_stream **new_stream)
+int pdfi_alloc_stream(pdf_context *ctx, stream *source, stream *original, pdf_c_stream **new_stream)
 {
     *new_stream = NULL;
     *new_stream = (pdf_c_stream *)gs_alloc_bytes(ctx->memory, sizeof(pdf_c_stream), "pdfi_alloc_stream");
@@ -472,6 +472,36 @@ static int PS_JPXD_PassThrough(void *d, byte *Buffer, int Size)
     return 0;
 }
 
+/* With -dPDFJPXReduce or -dPDFDCTReduce, the number of times the size of
+ * an image can be halved while still leaving at least one sample per device
+ * pixel, going by the image size and the current transformation.
+ */
+static int
+pdfi_image_reduce(pdf_context *ctx, pdf_dict *dict)
+{
+    const gs_matrix *ctm = &ctm_only(ctx->pgs);
+    int64_t Width, Height;
+    double ratio;
+    int reduce = 0;
+
+    /* High level devices want the image as it is */
+    if (dict == NULL || ctx->device_state.HighLevelDevice)
+        return 0;
+    if (pdfi_dict_get_int(ctx, dict, "Width", &Width) < 0 ||
+        pdfi_dict_get_int(ctx, dict, "Height", &Height) < 0 ||
+        Width <= 0 || Height <= 0)
+        return 0;
+
+    /* The CTM maps the unit square to the image's area on the device */
+    ratio = min(Width / max(hypot(ctm->xx, ctm->xy), 1.0),
+                Height / max(hypot(ctm->yx, ctm->yy), 1.0));
+    while (ratio >= 2.0 && reduce < 32) {
+        ratio /= 2.0;
+        reduce++;
+    }
+    return reduce;
+}
+
 /*
  * dict -- the dict that contained the decoder (i.e. the image dict)
  * decode -- the decoder dict
@@ -591,6 +621,12 @@ pdfi_JPX_filter(pdf_context *ctx, pdf_dict *dict, pdf_dict *decode,
         state.device = (void *)NULL;
     }
 
+#if defined(USE_OPENJPEG_JP2)
+    state.threads = ctx->args.jpxthreads;
+    if (ctx->args.jpxreduce && !state.PassThrough)
+        state.reduce = pdfi_image_reduce(ctx, dict);
+#endif
+
     code = pdfi_filter_open(min_size, &s_filter_read_procs, (const stream_template *)&s_jpxd_template,
                             (const stream_state *)&state, ctx->memory->non_gc_memory, new_stream);
     if (code < 0)
@@ -672,6 +708,10 @@ static int pdfi_DCT_filter(pdf_context *ctx, pdf_dict *stream_dict, pdf_dict *de
         return code;
     jddp->Height = (int)floor(Height);
 
+    /* libjpeg can decode at 1/2, 1/4 or 1/8 of the size */
+    if (ctx->args.dctreduce && !jddp->PassThrough)
+        jddp->scale_denom = 1 << min(pdfi_image_reduce(ctx, stream_dict), 3);
+
     jddp->templat = s_DCTD_template;
 
     code = pdfi_filter_open(min_size, &s_filter_read_procs, (const stream_template *)&jddp->templat, (const stream_state *)&dcts, ctx->memory->non_gc_memory, new_stream);
@@ -1655,6 +1695,40 @@ int pdfi_read_bytes(pdf_context *ctx, byte *Buffer, uint32_t size, uint32_t coun
     return bytes;
 }
 
+/* If the input file is memory mapped (-dPDFMapInput), return a pointer to
+ * the 'len' bytes of the file at 'offset', or NULL if the file is not mapped
+ * or the bytes are not all in it.
+ */
+const byte *pdfi_mapped_bytes(pdf_context *ctx, gs_offset_t offset, int64_t len)
+{
+    if (ctx->mapped_input == NULL || ctx->main_stream == NULL ||
+        ctx->main_stream->s != ctx->mapped_stream)
+        return NULL;
+    if (offset < 0 || len < 0 || offset > ctx->mapped_input_size - len)
+        return NULL;
+    return ctx->mapped_input + offset;
+}
+
+/* Does "endstream" start within the 'len' bytes at 'data', which must be
+ * in the mapped input file? */
+static bool pdfi_mapped_has_endstream(pdf_context *ctx, const byte *data, int64_t len)
+{
+    const byte *end = ctx->mapped_input + ctx->mapped_input_size - 9;
+    const byte *p = data, *limit = data + len;
+
+    if (limit > end + 1)
+        limit = end + 1;
+    while (p < limit) {
+        p = memchr(p, 'e', limit - p);
+        if (p == NULL)
+            break;
+        if (memcmp(p, "endstream", 9) == 0)
+            return true;
+        p++;
+    }
+    return false;
+}
+
 /* Read bytes from stream object into buffer.
  * Handles both plain streams and filtered streams.
  * Buffer gets allocated here, and must be freed by caller.
@@ -1767,6 +1841,24 @@ retry:
             }
         }
     } else {
+        const byte *data = NULL;
+
+        /* If the file is memory mapped, copy straight from the mapping when
+         * we can tell that the SubFileDecode filter below would deliver
+         * exactly the same bytes: either it reads Length bytes, or it reads
+         * up to the first "endstream" and there is none in the data.
+         */
+        if (stream_obj->length_valid && buflen <= stream_obj->Length) {
+            data = pdfi_mapped_bytes(ctx, pdfi_stream_offset(ctx, stream_obj), buflen);
+            if (data != NULL && ToRead == 0 && pdfi_mapped_has_endstream(ctx, data, buflen))
+                data = NULL;
+        }
+        if (data != NULL) {
+            memcpy(Buffer, data, buflen);
+            code = 0;
+            goto exit;
+        }
+
         if (ToRead && stream_obj->length_valid)
             code = pdfi_apply_SubFileDecode_filter(ctx, stream_obj->Length, NULL, ctx->main_stream, &SubFileStream, false);
         else
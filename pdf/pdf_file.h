@@ -78,6 +78,9 @@
  * in effect at the time we created the new stream.
  */
 
+/* Wrap a stream in a new pdf_c_stream, which closes the chain of streams down to 'original' */
+int pdfi_alloc_stream(pdf_context *ctx, stream *source, stream *original, pdf_c_stream **new_stream);
+
 int pdfi_filter(pdf_context *ctx, pdf_stream *stream_obj, pdf_c_stream *source, pdf_c_stream **new_stream, bool inline_image);
 /* pdfi_filter_no_decryption is a special function used by the xref parsing when dealing with XRefStms and should not be used
  * for anything else. The pdfi_filter routine will apply decryption as required.
@@ -99,6 +102,8 @@ int pdfi_open_memory_stream_from_stream(pdf_context *ctx, unsigned int size, byt
 int pdfi_open_memory_stream_from_filtered_stream(pdf_context *ctx, pdf_stream *stream_dict, byte **Buffer, pdf_c_stream **new_pdf_stream, bool retain_ownership);
 int pdfi_open_memory_stream_from_memory(pdf_context *ctx, unsigned int size, byte *Buffer, pdf_c_stream **new_pdf_stream, bool retain_ownership);
 int pdfi_stream_to_buffer(pdf_context *ctx, pdf_stream *stream_dict, byte **buf, int64_t *bufferlen);
+/* With -dPDFMapInput, the 'len' bytes of the file at 'offset', or NULL if they are not mapped */
+const byte *pdfi_mapped_bytes(pdf_context *ctx, gs_offset_t offset, int64_t len);
 
 int pdfi_apply_Arc4_filter(pdf_context *ctx, pdf_string *Key, pdf_c_stream *source, pdf_c_stream **new_stream);
 int pdfi_apply_AES_filter(pdf_context *ctx, pdf_string *Key, bool use_padding, pdf_c_stream *source, pdf_c_stream **new_stream);
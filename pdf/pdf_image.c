@@ -31,6 +31,7 @@
 #include "pdf_misc.h"
 #include "pdf_optcontent.h"
 #include "pdf_mark.h"
+#include "pdf_prefetch.h"
 #include "stream.h"     /* for stell() */
 #include "gsicc_cache.h"
 
@@ -1682,7 +1683,7 @@ static int
 pdfi_do_image(pdf_context *ctx, pdf_dict *page_dict, pdf_dict *stream_dict, pdf_stream *image_stream,
               pdf_c_stream *source, bool inline_image)
 {
-    pdf_c_stream *new_stream = NULL, *SFD_stream = NULL;
+    pdf_c_stream *new_stream = NULL, *SFD_stream = NULL, *prefetched = NULL;
     int code = 0, code1 = 0;
     int comps = 0;
     gs_color_space  *pcs = NULL;
@@ -2084,18 +2085,28 @@ pdfi_do_image(pdf_context *ctx, pdf_dict *page_dict, pdf_dict *stream_dict, pdf_
             goto cleanupExit;
     }
     /* Setup the data stream for the image data */
-    if (!inline_image) {
-        pdfi_seek(ctx, source, stream_offset, SEEK_SET);
+    if (!inline_image)
+        (void)pdfi_prefetch_open(ctx, image_stream, &prefetched);
 
-        code = pdfi_apply_SubFileDecode_filter(ctx, 0, "endstream", source, &SFD_stream, false);
+    if (prefetched != NULL) {
+        /* Being decoded by a prefetch thread */
+        code = pdfi_alloc_stream(ctx, prefetched->s, prefetched->s, &new_stream);
         if (code < 0)
             goto cleanupExit;
-        source = SFD_stream;
-    }
+    } else {
+        if (!inline_image) {
+            pdfi_seek(ctx, source, stream_offset, SEEK_SET);
 
-    code = pdfi_filter(ctx, image_stream, source, &new_stream, inline_image);
-    if (code < 0)
-        goto cleanupExit;
+            code = pdfi_apply_SubFileDecode_filter(ctx, 0, "endstream", source, &SFD_stream, false);
+            if (code < 0)
+                goto cleanupExit;
+            source = SFD_stream;
+        }
+
+        code = pdfi_filter(ctx, image_stream, source, &new_stream, inline_image);
+        if (code < 0)
+            goto cleanupExit;
+    }
 
     /* This duplicates the code in gs_img.ps; if we have an imagemask, with 1 bit per component (is there any other kind ?)
      * and the image is to be interpolated, and we are nto sending it to a high level device. Then check the scaling.
@@ -2204,6 +2215,8 @@ pdfi_do_image(pdf_context *ctx, pdf_dict *page_dict, pdf_dict *stream_dict, pdf_
         pdfi_close_file(ctx, new_stream);
     if (SFD_stream)
         pdfi_close_file(ctx, SFD_stream);
+    if (prefetched)
+        pdfi_prefetch_close(ctx, prefetched);
     if (mask_buffer)
         gs_free_object(ctx->memory, mask_buffer, "pdfi_do_image (mask_buffer)");
 
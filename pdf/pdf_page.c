@@ -35,6 +35,7 @@
 #include "pdf_check.h"
 #include "pdf_mark.h"
 #include "pdf_font.h"
+#include "pdf_prefetch.h"
 
 #include "gscoord.h"        /* for gs_concat() and others */
 #include "gspaint.h"        /* For gs_erasepage() */
@@ -876,6 +877,28 @@ static int setup_page_DefaultSpaces(pdf_context *ctx, pdf_dict *page_dict)
     return(pdfi_setup_DefaultSpaces(ctx, page_dict));
 }
 
+/* When running under PostScript the pattern cache belongs to the PostScript
+ * graphics state, so we collect its statistics at the end of each page,
+ * rather than at the end of the file.
+ */
+static void pdfi_gather_pattern_stats(pdf_context *ctx)
+{
+    gx_pattern_cache *pcache = gstate_pattern_cache(ctx->pgs);
+
+    if (pcache == NULL)
+        return;
+    ctx->pattern_hits += pcache->hits;
+    ctx->pattern_misses += pcache->misses;
+    ctx->pattern_evictions += pcache->evictions;
+    ctx->pattern_retained += pcache->retained;
+    ctx->pattern_reused += pcache->reused;
+    if (pcache->peak_bits > ctx->pattern_peak_size)
+        ctx->pattern_peak_size = pcache->peak_bits;
+    pcache->hits = pcache->misses = pcache->evictions = 0;
+    pcache->retained = pcache->reused = 0;
+    pcache->peak_bits = pcache->bits_used;
+}
+
 int pdfi_page_render(pdf_context *ctx, uint64_t page_num, bool init_graphics)
 {
     int code, code1=0;
@@ -885,6 +908,7 @@ int pdfi_page_render(pdf_context *ctx, uint64_t page_num, bool init_graphics)
     bool page_dict_error = false;
     bool need_pdf14 = false; /* true if the device is needed and was successfully pushed */
     int trans_depth = 0; /* -1 means special mode for transparency simulation */
+    bool keep_patterns = false; /* true if pattern tiles can be kept for later pages */
 
     if (page_num > ctx->num_pages)
         return_error(gs_error_rangecheck);
@@ -1017,6 +1041,20 @@ int pdfi_page_render(pdf_context *ctx, uint64_t page_num, bool init_graphics)
         }
     }
 
+    /* With -dPDFPatternCacheSize pattern tiles are kept from one page to the
+     * next. The pattern instance id covers the pattern object, the CTM and
+     * the number of colorants, but not the rest of the colour state, so we
+     * only keep (or use) tiles from pages where that is the default.
+     */
+    if (ctx->args.patterncachesize > 0) {
+        keep_patterns = !need_pdf14 && ctx->page.DefaultGray_cs == NULL &&
+                        ctx->page.DefaultRGB_cs == NULL && ctx->page.DefaultCMYK_cs == NULL;
+        if (gx_pattern_cache_set_max_bits(ctx->pgs, (size_t)ctx->args.patterncachesize) < 0)
+            keep_patterns = false;
+        if (!keep_patterns)
+            gx_pattern_cache_flush(gstate_pattern_cache(ctx->pgs));
+    }
+
     /* Init a base_pgs graphics state for Patterns
      * (this has to be after transparency device pushed, if applicable)
      */
@@ -1026,7 +1064,9 @@ int pdfi_page_render(pdf_context *ctx, uint64_t page_num, bool init_graphics)
     if (!ctx->args.QUIET)
         outprintf(ctx->memory, "Page %"PRId64"\n", page_num + 1);
 
+    (void)pdfi_prefetch_begin(ctx, page_dict);
     code = pdfi_process_one_page(ctx, page_dict);
+    pdfi_prefetch_end(ctx);
 
     if (need_pdf14 && ctx->page.has_transparency && page_group_known) {
         code1 = pdfi_trans_end_group(ctx);
@@ -1062,8 +1102,13 @@ exit3:
 
     /* Flush any pattern tiles. We don't want to (potentially) return to PostScript
      * with any pattern tiles referencing our objects, in case the garbager runs.
+     * Plain bitmap tiles don't, so we can keep those if we've been asked to.
      */
-    gx_pattern_cache_flush(gstate_pattern_cache(ctx->pgs));
+    if (keep_patterns)
+        gx_pattern_cache_flush_transient(gstate_pattern_cache(ctx->pgs));
+    else
+        gx_pattern_cache_flush(gstate_pattern_cache(ctx->pgs));
+    pdfi_gather_pattern_stats(ctx);
     /* We could be smarter, but for now.. purge for each page */
     pdfi_purge_cache_resource_font(ctx);
 
@@ -0,0 +1,821 @@
+/* Copyright (C) 2001-2025 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  39 Mesa Street, Suite 108A, San Francisco,
+   CA 94129, USA, for further information.
+*/
+
+/* Decoding image data on worker threads ahead of the interpreter */
+
+#include "ghostpdf.h"
+#include "pdf_types.h"
+#include "pdf_stack.h"
+#include "pdf_dict.h"
+#include "pdf_array.h"
+#include "pdf_file.h"
+#include "pdf_misc.h"
+#include "pdf_loop_detect.h"
+#include "pdf_prefetch.h"
+#include "stream.h"
+#include "strimpl.h"
+#include "gxsync.h"
+#include "gsmchunk.h"
+#include "szlibx.h"     /* Flate */
+#include "spngpx.h"     /* PNG Predictor */
+#include "spdiffx.h"    /* Horizontal differencing predictor */
+
+/* The size of the buffers between the filters run by the worker threads */
+#define PREFETCH_BUFFER_SIZE 4096
+/* How much a worker decodes before making it available to the interpreter */
+#define PREFETCH_CHUNK_SIZE 65536
+/* The buffer size of the streams which read the decoded data */
+#define PREFETCH_READ_BUFFER_SIZE 16384
+/* Images which inflate to more than this times /Length are left alone */
+#define PREFETCH_MAX_RATIO 8
+/* Bytes read beyond /Length, from an unmapped file, looking for "endstream" */
+#define PREFETCH_LENGTH_SLACK 64
+
+typedef enum {
+    prefetch_pending,   /* waiting for a worker */
+    prefetch_running,   /* being decoded */
+    prefetch_done,      /* decoded data available */
+    prefetch_failed,    /* error, or out of budget */
+    prefetch_dropped    /* the interpreter got there first: read the stream as usual */
+} prefetch_state_t;
+
+typedef struct pdfi_prefetch_job_s {
+    gs_offset_t offset;         /* offset of the stream data, identifies the job */
+    const byte *data;           /* the encoded data (in the mapping, or 'copy') */
+    uint data_size;
+    bool find_endstream;        /* data runs to the end of the mapped file */
+    byte *copy;                 /* encoded data read from an unmapped file */
+    uint copy_alloc;
+    int64_t Predictor, Colors, BPC, Columns;
+    uint expected_size;         /* the image data size, if known, else 0 */
+    uint reserved;              /* budget held for 'decoded' */
+    byte *decoded;              /* only the worker changes this, and only with the lock */
+    uint decoded_size, decoded_alloc;
+    prefetch_state_t state;
+    bool opened;                /* the interpreter is reading 'decoded' */
+    bool waiting;               /* the interpreter is waiting for 'progress' */
+    gx_semaphore_t *progress;   /* signalled when more data is decoded, or the state changes */
+} pdfi_prefetch_job_t;
+
+typedef struct pdfi_prefetch_worker_s {
+    pdfi_prefetch_t *pf;
+    gs_memory_t *memory;        /* the thread's own allocator for the filters */
+    gp_thread_id thread;
+} pdfi_prefetch_worker_t;
+
+struct pdfi_prefetch_s {
+    gs_memory_t *memory;        /* thread safe allocator for the jobs and data */
+    gx_monitor_t *lock;         /* protects the job states and sizes, next_job and used */
+    pdfi_prefetch_job_t *jobs;
+    int num_jobs, max_jobs;
+    int next_job;
+    int64_t budget, used;
+    pdfi_prefetch_worker_t *workers;
+    int num_workers;
+};
+
+/* ------ Worker threads ------ */
+
+/* Reserve (or with a negative size, release) memory from the budget. */
+static bool
+prefetch_reserve(pdfi_prefetch_t *pf, int64_t size)
+{
+    bool ok = true;
+
+    gx_monitor_enter(pf->lock);
+    if (size > 0 && pf->used + size > pf->budget)
+        ok = false;
+    else
+        pf->used += size;
+    gx_monitor_leave(pf->lock);
+    return ok;
+}
+
+/* Wake the interpreter if it is waiting for this job. Called with the lock. */
+static void
+prefetch_wake(pdfi_prefetch_job_t *job)
+{
+    if (job->waiting) {
+        job->waiting = false;
+        gx_semaphore_signal(job->progress);
+    }
+}
+
+/* Emulate the "endstream" SubFileDecode filter applied to stream data
+ * in the normal way: the data ends at the first "endstream".
+ */
+static uint
+prefetch_find_endstream(const byte *data, uint size)
+{
+    const byte *p = data, *limit;
+
+    if (size < 9)
+        return size;
+    limit = data + size - 8;
+    while (p < limit) {
+        p = memchr(p, 'e', limit - p);
+        if (p == NULL)
+            break;
+        if (memcmp(p, "endstream", 9) == 0)
+            return p - data;
+        p++;
+    }
+    return size;
+}
+
+static stream *
+prefetch_push_filter(gs_memory_t *mem, const stream_template *templat,
+                     const stream_state *params, stream *source)
+{
+    stream *fs = s_alloc(mem, "prefetch_push_filter(stream)");
+    byte *buf = gs_alloc_bytes(mem, PREFETCH_BUFFER_SIZE, "prefetch_push_filter(buf)");
+    stream_state *st = s_alloc_state(mem, templat->stype, "prefetch_push_filter(state)");
+
+    if (fs == NULL || buf == NULL || st == NULL) {
+        gs_free_object(mem, st, "prefetch_push_filter(state)");
+        gs_free_object(mem, buf, "prefetch_push_filter(buf)");
+        gs_free_object(mem, fs, "prefetch_push_filter(stream)");
+        return NULL;
+    }
+    memcpy(st, params, gs_struct_type_size(templat->stype));
+    s_init_state(st, templat, mem);
+    s_std_init(fs, buf, PREFETCH_BUFFER_SIZE, &s_filter_read_procs, s_mode_read);
+    fs->procs.process = templat->process;
+    fs->state = st;
+    fs->strm = source;
+    /* We close the filters ourselves, after reaching the end */
+    fs->close_at_eod = false;
+    if (templat->init != NULL && (*templat->init)(st) < 0) {
+        gs_free_object(mem, st, "prefetch_push_filter(state)");
+        gs_free_object(mem, buf, "prefetch_push_filter(buf)");
+        gs_free_object(mem, fs, "prefetch_push_filter(stream)");
+        return NULL;
+    }
+    return fs;
+}
+
+/* Make room for more decoded data, when the buffer is full. The interpreter may be reading the old buffer, so it is only replaced
+ * with the lock held.
+ */
+static int
+prefetch_grow(pdfi_prefetch_t *pf, pdfi_prefetch_job_t *job, uint encoded_size)
+{
+    uint new_alloc;
+    byte *p, *old;
+
+    if (job->decoded_alloc > job->decoded_size)
+        return 0;
+    if (job->decoded_alloc >= max_uint / 2)
+        return_error(gs_error_limitcheck);
+    if (job->decoded_alloc != 0)
+        new_alloc = job->decoded_alloc * 2;
+    else if (job->expected_size != 0)
+        new_alloc = job->expected_size;
+    else
+        new_alloc = encoded_size < max_uint / 8 ? max(encoded_size * 4, PREFETCH_CHUNK_SIZE) : max_uint / 2;
+    new_alloc = max(new_alloc, job->decoded_size + PREFETCH_CHUNK_SIZE);
+    if (new_alloc > job->reserved) {
+        if (!prefetch_reserve(pf, new_alloc - job->reserved))
+            return_error(gs_error_VMerror);
+        job->reserved = new_alloc;
+    }
+    p = gs_alloc_bytes(pf->memory, new_alloc, "prefetch_decode(decoded)");
+    if (p == NULL)
+        return_error(gs_error_VMerror);
+    old = job->decoded;
+    if (old != NULL)
+        memcpy(p, old, job->decoded_size);
+    gx_monitor_enter(pf->lock);
+    job->decoded = p;
+    job->decoded_alloc = new_alloc;
+    gx_monitor_leave(pf->lock);
+    gs_free_object(pf->memory, old, "prefetch_decode(decoded)");
+    return 0;
+}
+
+/* Decode one job's data, in the same way as pdfi_Flate_filter and
+ * pdfi_Predictor_filter. The filters are allocated from the worker's own
+ * allocator, the decoded data from the thread safe one.
+ */
+static int
+prefetch_decode(pdfi_prefetch_t *pf, gs_memory_t *mem, pdfi_prefetch_job_t *job)
+{
+    stream *s, *fs, *top;
+    stream_zlib_state zls;
+    stream_PNGP_state pps;
+    stream_PDiff_state ppds;
+    uint size = job->data_size, n;
+    int status, code = 0;
+
+    if (job->find_endstream)
+        size = prefetch_find_endstream(job->data, size);
+
+    s = s_alloc(mem, "prefetch_decode(source)");
+    if (s == NULL)
+        return_error(gs_error_VMerror);
+    sread_string(s, job->data, size);
+
+    memset(&zls, 0, sizeof(zls));
+    (*s_zlibD_template.set_defaults)((stream_state *)&zls);
+    top = fs = prefetch_push_filter(mem, &s_zlibD_template, (stream_state *)&zls, s);
+    if (fs != NULL && job->Predictor == 2) {
+        memset(&ppds, 0, sizeof(ppds));
+        ppds.Colors = (int)job->Colors;
+        ppds.BitsPerComponent = (int)job->BPC;
+        ppds.Columns = (int)job->Columns;
+        top = prefetch_push_filter(mem, &s_PDiffD_template, (stream_state *)&ppds, fs);
+    } else if (fs != NULL && job->Predictor >= 10) {
+        memset(&pps, 0, sizeof(pps));
+        pps.Colors = (int)job->Colors;
+        pps.BitsPerComponent = (int)job->BPC;
+        pps.Columns = (uint)job->Columns;
+        pps.Predictor = (int)job->Predictor;
+        top = prefetch_push_filter(mem, &s_PNGPD_template, (stream_state *)&pps, fs);
+    }
+    if (top == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        if (fs != NULL)
+            s_close_filters(&fs, s);
+        goto exit;
+    }
+
+    do {
+        code = prefetch_grow(pf, job, size);
+        if (code < 0)
+            break;
+        status = sgets(top, job->decoded + job->decoded_size,
+                       min(job->decoded_alloc - job->decoded_size, PREFETCH_CHUNK_SIZE), &n);
+        if (status < 0 && status != EOFC)
+            code = gs_note_error(gs_error_ioerror);
+        gx_monitor_enter(pf->lock);
+        job->decoded_size += n;
+        prefetch_wake(job);
+        gx_monitor_leave(pf->lock);
+    } while (code == 0 && status != EOFC);
+
+    s_close_filters(&top, s);
+ exit:
+    sclose(s);
+    gs_free_object(mem, s, "prefetch_decode(source)");
+    return code;
+}
+
+static void
+prefetch_worker(void *arg)
+{
+    pdfi_prefetch_worker_t *worker = (pdfi_prefetch_worker_t *)arg;
+    pdfi_prefetch_t *pf = worker->pf;
+    pdfi_prefetch_job_t *job;
+    byte *discard;
+    int code;
+
+    while (1) {
+        gx_monitor_enter(pf->lock);
+        while (pf->next_job < pf->num_jobs && pf->jobs[pf->next_job].state != prefetch_pending)
+            pf->next_job++;
+        if (pf->next_job >= pf->num_jobs) {
+            gx_monitor_leave(pf->lock);
+            break;
+        }
+        job = &pf->jobs[pf->next_job++];
+        job->state = prefetch_running;
+        gx_monitor_leave(pf->lock);
+
+        code = prefetch_decode(pf, worker->memory, job);
+
+        discard = NULL;
+        gx_monitor_enter(pf->lock);
+        job->state = code < 0 ? prefetch_failed : prefetch_done;
+        if (code < 0 && !job->opened) {
+            /* Nobody will read it, so give the memory to the other jobs */
+            discard = job->decoded;
+            job->decoded = NULL;
+            job->decoded_size = job->decoded_alloc = 0;
+            pf->used -= job->reserved;
+            job->reserved = 0;
+        }
+        prefetch_wake(job);
+        gx_monitor_leave(pf->lock);
+        gs_free_object(pf->memory, discard, "prefetch_decode(decoded)");
+    }
+}
+
+/* ------ Reading the decoded data ------ */
+
+typedef struct stream_prefetch_state_s {
+    stream_state_common;
+    pdfi_prefetch_t *pf;
+    pdfi_prefetch_job_t *job;
+    uint pos;
+} stream_prefetch_state;
+
+gs_private_st_simple(st_prefetch_state, stream_prefetch_state, "prefetch stream state");
+
+/* Copy out what the worker has decoded, waiting for it if we have caught up. */
+static int
+s_prefetch_process(stream_state *st, stream_cursor_read *pr,
+                   stream_cursor_write *pw, bool last)
+{
+    stream_prefetch_state *const ss = (stream_prefetch_state *)st;
+    pdfi_prefetch_t *pf = ss->pf;
+    pdfi_prefetch_job_t *job = ss->job;
+    uint count = pw->limit - pw->ptr;
+    int status;
+
+    gx_monitor_enter(pf->lock);
+    while (job->state == prefetch_running && ss->pos == job->decoded_size) {
+        job->waiting = true;
+        gx_monitor_leave(pf->lock);
+        gx_semaphore_wait(job->progress);
+        gx_monitor_enter(pf->lock);
+    }
+    if (count > job->decoded_size - ss->pos)
+        count = job->decoded_size - ss->pos;
+    memcpy(pw->ptr + 1, job->decoded + ss->pos, count);
+    pw->ptr += count;
+    ss->pos += count;
+    if (ss->pos < job->decoded_size)
+        status = 1;
+    else if (job->state == prefetch_running)
+        status = 0;
+    else
+        status = job->state == prefetch_done ? EOFC : ERRC;
+    gx_monitor_leave(pf->lock);
+    return status;
+}
+
+static const stream_template s_prefetch_template = {
+    &st_prefetch_state, NULL, s_prefetch_process, 1, 1
+};
+
+/* ------ Finding the images ------ */
+
+/* Read the encoded data of a stream from an unmapped file. We read a
+ * little more than /Length, and end it at "endstream" as the normal path
+ * does; if /Length is too short to reach "endstream" we leave the image
+ * to the normal path.
+ */
+static int
+prefetch_read_data(pdf_context *ctx, pdfi_prefetch_t *pf, pdf_stream *stream_obj,
+                   pdfi_prefetch_job_t *job)
+{
+    gs_offset_t savedoffset = pdfi_tell(ctx->main_stream);
+    int64_t Length = pdfi_stream_length(ctx, stream_obj);
+    uint alloc, n;
+    int code;
+
+    if (Length <= 0 || Length > max_int - PREFETCH_LENGTH_SLACK)
+        return 0;
+    alloc = (uint)Length + PREFETCH_LENGTH_SLACK;
+    if (!prefetch_reserve(pf, alloc))
+        return 0;
+    job->copy = gs_alloc_bytes(pf->memory, alloc, "prefetch_read_data");
+    if (job->copy == NULL) {
+        prefetch_reserve(pf, -(int64_t)alloc);
+        return 0;
+    }
+    job->copy_alloc = alloc;
+
+    code = pdfi_seek(ctx, ctx->main_stream, job->offset, SEEK_SET);
+    if (code >= 0) {
+        code = pdfi_read_bytes(ctx, job->copy, 1, alloc, ctx->main_stream);
+        if (code >= 0) {
+            n = prefetch_find_endstream(job->copy, (uint)code);
+            if (n < (uint)code) {
+                job->data = job->copy;
+                job->data_size = n;
+            }
+            code = 0;
+        }
+    }
+    pdfi_seek(ctx, ctx->main_stream, savedoffset, SEEK_SET);
+    if (job->data == NULL) {
+        gs_free_object(pf->memory, job->copy, "prefetch_read_data");
+        job->copy = NULL;
+        job->copy_alloc = 0;
+        prefetch_reserve(pf, -(int64_t)alloc);
+    }
+    return code;
+}
+
+/* Return the number of colour components for an image colour space, or 0
+ * if it isn't one of the simple cases.
+ */
+static int
+prefetch_colour_components(pdf_context *ctx, pdf_obj *space)
+{
+    pdf_obj *family = NULL, *ICC = NULL;
+    pdf_dict *ICC_dict = NULL;
+    int64_t N = 0;
+    int comps = 0;
+
+    if (pdfi_type_of(space) == PDF_ARRAY) {
+        if (pdfi_array_get_type(ctx, (pdf_array *)space, 0, PDF_NAME, &family) < 0)
+            return 0;
+        if (pdfi_name_is((pdf_name *)family, "Indexed") || pdfi_name_is((pdf_name *)family, "I"))
+            comps = 1;
+        else if (pdfi_name_is((pdf_name *)family, "ICCBased") &&
+                 pdfi_array_get_type(ctx, (pdf_array *)space, 1, PDF_STREAM, &ICC) >= 0 &&
+                 pdfi_dict_from_obj(ctx, ICC, &ICC_dict) >= 0 &&
+                 pdfi_dict_get_int_def(ctx, ICC_dict, "N", &N, 0) >= 0 &&
+                 (N == 1 || N == 3 || N == 4))
+            comps = (int)N;
+        else if (pdfi_array_size((pdf_array *)space) == 1)
+            comps = prefetch_colour_components(ctx, family);
+        pdfi_countdown(ICC);
+        pdfi_countdown(family);
+    } else if (pdfi_type_of(space) == PDF_NAME) {
+        pdf_name *n = (pdf_name *)space;
+
+        if (pdfi_name_is(n, "DeviceGray") || pdfi_name_is(n, "CalGray"))
+            comps = 1;
+        else if (pdfi_name_is(n, "DeviceRGB") || pdfi_name_is(n, "CalRGB") || pdfi_name_is(n, "Lab"))
+            comps = 3;
+        else if (pdfi_name_is(n, "DeviceCMYK"))
+            comps = 4;
+    }
+    return comps;
+}
+
+/* Work out the size of an image's data from its dictionary, so that the
+ * workers can decode it into a buffer of the right size. 0 if we can't.
+ */
+static uint
+prefetch_image_size(pdf_context *ctx, pdf_dict *image_dict)
+{
+    int64_t Width, Height, BPC, row;
+    pdf_obj *space = NULL;
+    bool ImageMask = false;
+    int comps = 0;
+
+    if (pdfi_dict_get_int_def(ctx, image_dict, "Width", &Width, 0) < 0 ||
+        pdfi_dict_get_int_def(ctx, image_dict, "Height", &Height, 0) < 0 ||
+        pdfi_dict_get_int_def(ctx, image_dict, "BitsPerComponent", &BPC, 8) < 0)
+        return 0;
+    if (pdfi_dict_knownget_bool(ctx, image_dict, "ImageMask", &ImageMask) > 0 && ImageMask) {
+        comps = 1;
+        BPC = 1;
+    } else if (pdfi_dict_knownget(ctx, image_dict, "ColorSpace", &space) > 0) {
+        comps = prefetch_colour_components(ctx, space);
+        pdfi_countdown(space);
+    }
+    if (comps == 0 || Width <= 0 || Height <= 0 || BPC <= 0 || BPC > 16 ||
+        Width > max_int || Height > max_int)
+        return 0;
+    row = (Width * comps * BPC + 7) / 8;
+    if (row > max_uint / Height)
+        return 0;
+    return (uint)(row * Height);
+}
+
+/* Add a job for an image stream if it's one we can decode. Errors are
+ * ignored: the image will then be read, and the error reported, as usual.
+ */
+static void
+prefetch_add(pdf_context *ctx, pdfi_prefetch_t *pf, pdf_stream *stream_obj)
+{
+    pdf_dict *stream_dict = NULL;
+    pdf_obj *Filter = NULL, *decode = NULL;
+    pdfi_prefetch_job_t job;
+    gs_offset_t offset = pdfi_stream_offset(ctx, stream_obj);
+    bool known = false;
+    int i, code;
+
+    if (pf->num_jobs >= pf->max_jobs)
+        return;
+    for (i = 0; i < pf->num_jobs; i++)
+        if (pf->jobs[i].offset == offset)
+            return;
+    if (pdfi_dict_from_obj(ctx, (pdf_obj *)stream_obj, &stream_dict) < 0)
+        return;
+    /* External (/F) streams are opened by pdfi_filter, not read from the file */
+    if (pdfi_dict_known(ctx, stream_dict, "F", &known) < 0 || known)
+        return;
+
+    memset(&job, 0, sizeof(job));
+    job.offset = offset;
+    job.Predictor = 1;
+
+    code = pdfi_dict_knownget_type(ctx, stream_dict, "Filter", PDF_NAME, &Filter);
+    if (code <= 0 || !pdfi_name_is((pdf_name *)Filter, "FlateDecode"))
+        goto exit;
+    code = pdfi_dict_knownget(ctx, stream_dict, "DecodeParms", &decode);
+    if (code == 0)
+        code = pdfi_dict_knownget(ctx, stream_dict, "DP", &decode);
+    if (code < 0)
+        goto exit;
+    if (decode != NULL && pdfi_type_of(decode) == PDF_DICT) {
+        /* The same checks as pdfi_Predictor_filter */
+        pdf_dict *d = (pdf_dict *)decode;
+
+        if (pdfi_dict_get_int_def(ctx, d, "Predictor", &job.Predictor, 1) < 0 ||
+            pdfi_dict_get_int_def(ctx, d, "Colors", &job.Colors, 1) < 0 ||
+            pdfi_dict_get_int_def(ctx, d, "BitsPerComponent", &job.BPC, 8) < 0 ||
+            pdfi_dict_get_int_def(ctx, d, "Columns", &job.Columns, 1) < 0)
+            goto exit;
+        if (job.Predictor == 0)
+            job.Predictor = 1;
+        if (job.Predictor != 1) {
+            if ((job.Predictor != 2 && (job.Predictor < 10 || job.Predictor > 15)) ||
+                job.Colors < 1 || job.Colors > s_PNG_max_Colors ||
+                job.BPC < 1 || job.BPC > 16 || (job.BPC & (job.BPC - 1)) != 0 ||
+                job.Columns < 1 || job.Columns > max_int)
+                goto exit;
+        }
+    }
+
+    /* Don't start on anything which will not fit. When we know the size
+     * the interpreter can read the data as it is decoded, so it must not
+     * run out of budget part way.
+     */
+    job.expected_size = prefetch_image_size(ctx, stream_dict);
+    /* Inflating very compressible data costs less than buffering it */
+    if (job.expected_size / PREFETCH_MAX_RATIO > pdfi_stream_length(ctx, stream_obj))
+        goto exit;
+    if (job.expected_size != 0) {
+        if (!prefetch_reserve(pf, job.expected_size))
+            goto exit;
+        job.reserved = job.expected_size;
+    }
+
+    if (ctx->mapped_input != NULL) {
+        job.data = pdfi_mapped_bytes(ctx, offset, 0);
+        if (job.data == NULL || ctx->mapped_input_size - offset > max_uint)
+            goto exit;
+        job.data_size = (uint)(ctx->mapped_input_size - offset);
+        job.find_endstream = true;
+    } else {
+        if (prefetch_read_data(ctx, pf, stream_obj, &job) < 0 || job.data == NULL)
+            goto exit;
+    }
+
+    job.progress = gx_semaphore_label(gx_semaphore_alloc(pf->memory), "prefetch job");
+    if (job.progress == NULL) {
+        gs_free_object(pf->memory, job.copy, "prefetch_read_data");
+        prefetch_reserve(pf, -(int64_t)job.copy_alloc);
+        goto exit;
+    }
+    job.state = prefetch_pending;
+    pf->jobs[pf->num_jobs++] = job;
+    job.reserved = 0;
+
+ exit:
+    if (job.reserved != 0)
+        prefetch_reserve(pf, -(int64_t)job.reserved);
+    pdfi_countdown(Filter);
+    pdfi_countdown(decode);
+}
+
+static void
+prefetch_add_XObjects(pdf_context *ctx, pdfi_prefetch_t *pf, pdf_dict *xobject_dict)
+{
+    pdf_obj *Key = NULL, *Value = NULL, *SMask = NULL;
+    pdf_dict *Value_dict = NULL;
+    pdf_name *Subtype = NULL;
+    uint64_t index;
+    int code;
+
+    if (pdfi_loop_detector_mark(ctx) < 0)
+        return;
+    code = pdfi_dict_first(ctx, xobject_dict, &Key, &Value, &index);
+    while (code >= 0) {
+        if (pdfi_type_of(Value) == PDF_STREAM &&
+            pdfi_dict_from_obj(ctx, Value, &Value_dict) >= 0 &&
+            pdfi_dict_knownget_type(ctx, Value_dict, "Subtype", PDF_NAME, (pdf_obj **)&Subtype) > 0 &&
+            pdfi_name_is(Subtype, "Image")) {
+            prefetch_add(ctx, pf, (pdf_stream *)Value);
+            if (pdfi_dict_knownget_type(ctx, Value_dict, "SMask", PDF_STREAM, &SMask) > 0)
+                prefetch_add(ctx, pf, (pdf_stream *)SMask);
+        }
+        pdfi_countdown(Subtype);
+        Subtype = NULL;
+        pdfi_countdown(SMask);
+        SMask = NULL;
+        pdfi_countdown(Key);
+        Key = NULL;
+        pdfi_countdown(Value);
+        Value = NULL;
+
+        (void)pdfi_loop_detector_cleartomark(ctx);
+        if (pf->num_jobs >= pf->max_jobs || pdfi_loop_detector_mark(ctx) < 0)
+            return;
+        code = pdfi_dict_next(ctx, xobject_dict, &Key, &Value, &index);
+    }
+    (void)pdfi_loop_detector_cleartomark(ctx);
+}
+
+/* ------ Interface ------ */
+
+int
+pdfi_prefetch_begin(pdf_context *ctx, pdf_dict *page_dict)
+{
+    gs_memory_t *mem = ctx->memory->thread_safe_memory;
+    pdf_dict *Resources = NULL, *XObject = NULL;
+    pdfi_prefetch_t *pf;
+    int i, code;
+
+    if (ctx->args.prefetchthreads <= 0 || ctx->prefetch != NULL || mem == NULL)
+        return 0;
+    /* Decrypting needs pdfi_filter; see pdf_prefetch.h */
+    if (ctx->encryption.is_encrypted)
+        return 0;
+
+    code = pdfi_dict_knownget_type(ctx, page_dict, "Resources", PDF_DICT, (pdf_obj **)&Resources);
+    if (code > 0)
+        code = pdfi_dict_knownget_type(ctx, Resources, "XObject", PDF_DICT, (pdf_obj **)&XObject);
+    if (code <= 0 || pdfi_dict_entries(XObject) == 0)
+        goto exit;
+
+    pf = (pdfi_prefetch_t *)gs_alloc_bytes(mem, sizeof(*pf), "pdfi_prefetch_begin");
+    if (pf == NULL)
+        goto exit;
+    memset(pf, 0, sizeof(*pf));
+    pf->memory = mem;
+    pf->budget = ctx->args.prefetchmemory;
+    /* Room for each image and its SMask */
+    pf->max_jobs = (int)min(pdfi_dict_entries(XObject) * 2, 4096);
+    pf->jobs = (pdfi_prefetch_job_t *)gs_alloc_byte_array(mem, pf->max_jobs, sizeof(pdfi_prefetch_job_t),
+                                                          "pdfi_prefetch_begin(jobs)");
+    pf->lock = gx_monitor_label(gx_monitor_alloc(mem), "pdfi_prefetch");
+    ctx->prefetch = pf;
+    if (pf->jobs == NULL || pf->lock == NULL)
+        goto fail;
+
+    prefetch_add_XObjects(ctx, pf, XObject);
+    if (pf->num_jobs == 0)
+        goto fail;
+
+    pf->workers = (pdfi_prefetch_worker_t *)gs_alloc_byte_array(mem, ctx->args.prefetchthreads,
+                                                                sizeof(pdfi_prefetch_worker_t),
+                                                                "pdfi_prefetch_begin(workers)");
+    if (pf->workers == NULL)
+        goto fail;
+    for (i = 0; i < ctx->args.prefetchthreads && i < pf->num_jobs; i++) {
+        pdfi_prefetch_worker_t *worker = &pf->workers[i];
+
+        worker->pf = pf;
+        if (gs_memory_chunk_wrap(&worker->memory, mem) < 0)
+            break;
+        if (gp_thread_start(prefetch_worker, worker, &worker->thread) < 0) {
+            gs_memory_chunk_release(worker->memory);
+            break;
+        }
+        pf->num_workers++;
+    }
+    if (pf->num_workers == 0)
+        goto fail;
+    goto exit;
+
+ fail:
+    pdfi_prefetch_end(ctx);
+ exit:
+    pdfi_countdown(XObject);
+    pdfi_countdown(Resources);
+    return 0;
+}
+
+void
+pdfi_prefetch_end(pdf_context *ctx)
+{
+    pdfi_prefetch_t *pf = ctx->prefetch;
+    gs_memory_t *mem;
+    int i;
+
+    if (pf == NULL)
+        return;
+    mem = pf->memory;
+    ctx->prefetch = NULL;
+
+    /* Stop the workers taking any more jobs, then wait for them */
+    if (pf->lock != NULL) {
+        gx_monitor_enter(pf->lock);
+        for (i = 0; i < pf->num_jobs; i++)
+            if (pf->jobs[i].state == prefetch_pending)
+                pf->jobs[i].state = prefetch_dropped;
+        gx_monitor_leave(pf->lock);
+    }
+    for (i = 0; i < pf->num_workers; i++) {
+        gp_thread_finish(pf->workers[i].thread);
+        gs_memory_chunk_release(pf->workers[i].memory);
+    }
+
+    for (i = 0; i < pf->num_jobs; i++) {
+        pdfi_prefetch_job_t *job = &pf->jobs[i];
+
+        gs_free_object(mem, job->decoded, "pdfi_prefetch_end(decoded)");
+        gs_free_object(mem, job->copy, "pdfi_prefetch_end(copy)");
+        gx_semaphore_free(job->progress);
+    }
+    if (pf->lock != NULL)
+        gx_monitor_free(pf->lock);
+    gs_free_object(mem, pf->workers, "pdfi_prefetch_end(workers)");
+    gs_free_object(mem, pf->jobs, "pdfi_prefetch_end(jobs)");
+    gs_free_object(mem, pf, "pdfi_prefetch_end");
+}
+
+int
+pdfi_prefetch_open(pdf_context *ctx, pdf_stream *stream_obj, pdf_c_stream **new_stream)
+{
+    pdfi_prefetch_t *pf = ctx->prefetch;
+    pdfi_prefetch_job_t *job = NULL;
+    stream_prefetch_state *ss;
+    gs_offset_t offset;
+    stream *s;
+    byte *buf;
+    uint release = 0;
+    bool ok;
+    int i, code;
+
+    *new_stream = NULL;
+    if (pf == NULL)
+        return 0;
+
+    offset = pdfi_stream_offset(ctx, stream_obj);
+    for (i = 0; i < pf->num_jobs; i++) {
+        if (pf->jobs[i].offset == offset) {
+            job = &pf->jobs[i];
+            break;
+        }
+    }
+    if (job == NULL)
+        return 0;
+
+    gx_monitor_enter(pf->lock);
+    if (job->state == prefetch_pending) {
+        job->state = prefetch_dropped;
+        release = job->reserved;
+        job->reserved = 0;
+    }
+    /* Without the size, a job might still run out of budget, so we can
+     * only use the data once it has all been decoded.
+     */
+    while (job->state == prefetch_running && job->expected_size == 0) {
+        job->waiting = true;
+        gx_monitor_leave(pf->lock);
+        gx_semaphore_wait(job->progress);
+        gx_monitor_enter(pf->lock);
+    }
+    ok = job->state == prefetch_running || job->state == prefetch_done;
+    if (ok)
+        job->opened = true;
+    gx_monitor_leave(pf->lock);
+    if (release != 0)
+        prefetch_reserve(pf, -(int64_t)release);
+    if (!ok)
+        return 0;
+
+    s = s_alloc(ctx->memory, "pdfi_prefetch_open(stream)");
+    buf = gs_alloc_bytes(ctx->memory, PREFETCH_READ_BUFFER_SIZE, "pdfi_prefetch_open(buf)");
+    ss = (stream_prefetch_state *)s_alloc_state(ctx->memory, &st_prefetch_state, "pdfi_prefetch_open(state)");
+    if (s == NULL || buf == NULL || ss == NULL) {
+        code = gs_note_error(gs_error_VMerror);
+        goto error;
+    }
+    s_init_state((stream_state *)ss, &s_prefetch_template, ctx->memory);
+    ss->pf = pf;
+    ss->job = job;
+    ss->pos = 0;
+    s_std_init(s, buf, PREFETCH_READ_BUFFER_SIZE, &s_filter_read_procs, s_mode_read);
+    s->procs.process = s_prefetch_process;
+    s->state = (stream_state *)ss;
+    s->close_at_eod = false;
+    code = pdfi_alloc_stream(ctx, s, s, new_stream);
+    if (code < 0)
+        goto error;
+    return 1;
+
+ error:
+    /* Once opened the data is kept until the end of the page, which is harmless */
+    gs_free_object(ctx->memory, ss, "pdfi_prefetch_open(state)");
+    gs_free_object(ctx->memory, buf, "pdfi_prefetch_open(buf)");
+    gs_free_object(ctx->memory, s, "pdfi_prefetch_open(stream)");
+    return code;
+}
+
+void
+pdfi_prefetch_close(pdf_context *ctx, pdf_c_stream *stream)
+{
+    byte *buf;
+
+    if (stream == NULL)
+        return;
+    if (stream->s != NULL) {
+        buf = stream->s->cbuf;
+        sclose(stream->s);
+        gs_free_object(ctx->memory, buf, "pdfi_prefetch_close(buf)");
+        gs_free_object(ctx->memory, stream->s, "pdfi_prefetch_close(stream)");
+    }
+    gs_free_object(ctx->memory, stream, "pdfi_prefetch_close");
+}
@@ -0,0 +1,50 @@
+/* Copyright (C) 2001-2025 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  39 Mesa Street, Suite 108A, San Francisco,
+   CA 94129, USA, for further information.
+*/
+
+/* Decoding image data on worker threads ahead of the interpreter */
+
+#ifndef PDF_PREFETCH
+#define PDF_PREFETCH
+
+/* The default for -dPDFPrefetchMemory, in bytes */
+#define PDFI_PREFETCH_DEFAULT_MEMORY (64 * 1024 * 1024)
+
+/*
+ * With -dPDFPrefetchThreads=n, pdfi_prefetch_begin looks through the page's
+ * image XObjects (and their soft masks) before the page is interpreted, and
+ * starts up to n threads which decode the ones it can handle into memory,
+ * within -dPDFPrefetchMemory bytes. When the interpreter reaches an image,
+ * pdfi_prefetch_open hands back a stream which reads the decoded data,
+ * waiting for the thread if it has not got that far yet; if no thread has
+ * started on the image it is dropped and the image is read as usual.
+ * pdfi_prefetch_end stops the threads and frees the data when the page is
+ * finished.
+ *
+ * Only FlateDecode streams (with or without a predictor) in unencrypted
+ * files are decoded ahead; anything else, or any error before the
+ * interpreter starts reading, leaves the image to the usual filter chain,
+ * so the results are the same either way.
+ */
+int pdfi_prefetch_begin(pdf_context *ctx, pdf_dict *page_dict);
+void pdfi_prefetch_end(pdf_context *ctx);
+
+/* Returns 1, and a stream which reads the decoded data, if the stream
+ * object's data is being (or has been) decoded ahead, 0 if it is not.
+ * The stream must be closed with pdfi_prefetch_close.
+ */
+int pdfi_prefetch_open(pdf_context *ctx, pdf_stream *stream_obj, pdf_c_stream **new_stream);
+void pdfi_prefetch_close(pdf_context *ctx, pdf_c_stream *stream);
+
+#endif
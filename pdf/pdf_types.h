@@ -250,6 +250,7 @@ typedef struct pdf_obj_cache_entry_s {
     void *next;
     void *previous;
     pdf_obj *o;
+    uint64_t size;      /* Estimated memory used by 'o', see pdfi_add_to_cache */
 }pdf_obj_cache_entry;
 
 /* The compressed and uncompressed xref entries are identical, they only differ
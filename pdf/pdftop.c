@@ -732,6 +732,78 @@ pdf_impl_set_param(pl_interp_implementation_t *impl,
             if (code < 0)
                 return code;
         }
+        if (argis(param, "PDFObjectCacheSize")) {
+            if (pvalue.type == gs_param_type_int)
+                ctx->args.objectcachesize = pvalue.value.i;
+            else {
+                code = plist_value_get_int64(&pvalue, &ctx->args.objectcachesize);
+                if (code < 0)
+                    return code;
+            }
+            if (ctx->args.objectcachesize < 0)
+                return_error(gs_error_rangecheck);
+        }
+        if (argis(param, "PDFObjectCacheStats")) {
+            code = plist_value_get_bool(&pvalue, &ctx->args.objectcachestats);
+            if (code < 0)
+                return code;
+        }
+        if (argis(param, "PDFMapInput")) {
+            code = plist_value_get_bool(&pvalue, &ctx->args.mapinput);
+            if (code < 0)
+                return code;
+        }
+        if (argis(param, "PDFPrefetchThreads")) {
+            code = plist_value_get_int(&pvalue, &ctx->args.prefetchthreads);
+            if (code < 0)
+                return code;
+            if (ctx->args.prefetchthreads < 0)
+                return_error(gs_error_rangecheck);
+        }
+        if (argis(param, "PDFPrefetchMemory")) {
+            if (pvalue.type == gs_param_type_int)
+                ctx->args.prefetchmemory = pvalue.value.i;
+            else {
+                code = plist_value_get_int64(&pvalue, &ctx->args.prefetchmemory);
+                if (code < 0)
+                    return code;
+            }
+            if (ctx->args.prefetchmemory < 0)
+                return_error(gs_error_rangecheck);
+        }
+        if (argis(param, "PDFJPXThreads")) {
+            code = plist_value_get_int(&pvalue, &ctx->args.jpxthreads);
+            if (code < 0)
+                return code;
+            if (ctx->args.jpxthreads < 0)
+                return_error(gs_error_rangecheck);
+        }
+        if (argis(param, "PDFJPXReduce")) {
+            code = plist_value_get_bool(&pvalue, &ctx->args.jpxreduce);
+            if (code < 0)
+                return code;
+        }
+        if (argis(param, "PDFDCTReduce")) {
+            code = plist_value_get_bool(&pvalue, &ctx->args.dctreduce);
+            if (code < 0)
+                return code;
+        }
+        if (argis(param, "PDFPatternCacheSize")) {
+            if (pvalue.type == gs_param_type_int)
+                ctx->args.patterncachesize = pvalue.value.i;
+            else {
+                code = plist_value_get_int64(&pvalue, &ctx->args.patterncachesize);
+                if (code < 0)
+                    return code;
+            }
+            if (ctx->args.patterncachesize < 0)
+                return_error(gs_error_rangecheck);
+        }
+        if (argis(param, "PDFPatternCacheStats")) {
+            code = plist_value_get_bool(&pvalue, &ctx->args.patterncachestats);
+            if (code < 0)
+                return code;
+        }
         if (argis(param, "OutputFile")) {
             if (!Printed_set)
                 ctx->args.printed = true;
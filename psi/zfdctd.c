@@ -120,6 +120,9 @@ zDCTD(i_ctx_t *i_ctx_p)
         jddp->PassThrough = 0;
         jddp->device = (void *)NULL;
     }
+    /* The device gets the JPEG data as it is, so decode it the same way */
+    if (jddp->PassThrough)
+        jddp->scale_denom = 1;
 
     /* Create the filter. */
     jddp->templat = s_DCTD_template;
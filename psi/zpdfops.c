@@ -1341,6 +1341,56 @@ static int apply_interpreter_params(i_ctx_t *i_ctx_p, pdfctx_t *pdfctx, ref *pdi
             goto error;
         pdfctx->ctx->args.nonativefontmap = pvalueref->value.boolval;
     }
+    if (dict_find_string(pdictref, "PDFObjectCacheSize", &pvalueref) > 0) {
+        if (!r_has_type(pvalueref, t_integer) || pvalueref->value.intval < 0)
+            goto error;
+        pdfctx->ctx->args.objectcachesize = pvalueref->value.intval;
+    }
+    if (dict_find_string(pdictref, "PDFObjectCacheStats", &pvalueref) > 0) {
+        if (!r_has_type(pvalueref, t_boolean))
+            goto error;
+        pdfctx->ctx->args.objectcachestats = pvalueref->value.boolval;
+    }
+    if (dict_find_string(pdictref, "PDFMapInput", &pvalueref) > 0) {
+        if (!r_has_type(pvalueref, t_boolean))
+            goto error;
+        pdfctx->ctx->args.mapinput = pvalueref->value.boolval;
+    }
+    if (dict_find_string(pdictref, "PDFPrefetchThreads", &pvalueref) > 0) {
+        if (!r_has_type(pvalueref, t_integer) || pvalueref->value.intval < 0)
+            goto error;
+        pdfctx->ctx->args.prefetchthreads = pvalueref->value.intval;
+    }
+    if (dict_find_string(pdictref, "PDFPrefetchMemory", &pvalueref) > 0) {
+        if (!r_has_type(pvalueref, t_integer) || pvalueref->value.intval < 0)
+            goto error;
+        pdfctx->ctx->args.prefetchmemory = pvalueref->value.intval;
+    }
+    if (dict_find_string(pdictref, "PDFJPXThreads", &pvalueref) > 0) {
+        if (!r_has_type(pvalueref, t_integer) || pvalueref->value.intval < 0)
+            goto error;
+        pdfctx->ctx->args.jpxthreads = pvalueref->value.intval;
+    }
+    if (dict_find_string(pdictref, "PDFJPXReduce", &pvalueref) > 0) {
+        if (!r_has_type(pvalueref, t_boolean))
+            goto error;
+        pdfctx->ctx->args.jpxreduce = pvalueref->value.boolval;
+    }
+    if (dict_find_string(pdictref, "PDFDCTReduce", &pvalueref) > 0) {
+        if (!r_has_type(pvalueref, t_boolean))
+            goto error;
+        pdfctx->ctx->args.dctreduce = pvalueref->value.boolval;
+    }
+    if (dict_find_string(pdictref, "PDFPatternCacheSize", &pvalueref) > 0) {
+        if (!r_has_type(pvalueref, t_integer) || pvalueref->value.intval < 0)
+            goto error;
+        pdfctx->ctx->args.patterncachesize = pvalueref->value.intval;
+    }
+    if (dict_find_string(pdictref, "PDFPatternCacheStats", &pvalueref) > 0) {
+        if (!r_has_type(pvalueref, t_boolean))
+            goto error;
+        pdfctx->ctx->args.patterncachestats = pvalueref->value.boolval;
+    }
     if (dict_find_string(pdictref, "PageCount", &pvalueref) > 0) {
         if (!r_has_type(pvalueref, t_integer))
             goto error;
@@ -558,6 +558,18 @@ set_icc_directory(i_ctx_t *i_ctx_p, gs_param_string * pval)
     return gs_seticcdirectory(igs, pval);
 }
 
+static void
+current_icc_link_cache_dir(i_ctx_t *i_ctx_p, gs_param_string * pval)
+{
+    gs_currenticclinkcachedir(igs, pval);
+}
+
+static int
+set_icc_link_cache_dir(i_ctx_t *i_ctx_p, gs_param_string * pval)
+{
+    return gs_seticclinkcachedir(igs, pval);
+}
+
 static void
 current_srcgtag_icc(i_ctx_t *i_ctx_p, gs_param_string * pval)
 {
@@ -674,6 +686,7 @@ static const string_param_def_t user_string_params[] =
     {"DefaultCMYKProfile", current_default_cmyk_icc, set_default_cmyk_icc},
     {"NamedProfile", current_named_icc, set_named_profile_icc},
     {"ICCProfilesDir", current_icc_directory, set_icc_directory},
+    {"ICCLinkCacheDir", current_icc_link_cache_dir, set_icc_link_cache_dir},
     {"LabProfile", current_lab_icc, set_lab_icc},
     {"DeviceNProfile", current_devicen_icc, set_devicen_profile_icc},
     {"SourceObjectICC", current_srcgtag_icc, set_srcgtag_icc}
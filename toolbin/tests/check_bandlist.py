@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2001-2025 Artifex Software, Inc.
+# All Rights Reserved.
+#
+# This software is provided AS-IS with no warranty, either express or
+# implied.
+#
+# This software is distributed under license and may not be copied,
+# modified or distributed except as expressly authorized under the terms
+# of the license contained in the file LICENSE in this distribution.
+#
+# Refer to licensing information at http://www.artifex.com or contact
+# Artifex Software, Inc.,  39 Mesa Street, Suite 108A, San Francisco,
+# CA 94129, USA, for further information.
+#
+
+
+# Check that compressed in-memory band lists render the same as an
+# unbanded page.  The page is an image of random bytes, so most memfile
+# blocks don't compress at all.
+#
+# Band lists are only compressed once they pass COMPRESSION_THRESHOLD
+# (gxclmem.c), so build gs with -DTEST_BAND_LIST_COMPRESSION in XCFLAGS
+# to make this test reach the compressors.  Usage:
+#
+#	check_bandlist.py [path/to/gs]
+
+import os, random, subprocess, sys, tempfile
+
+WIDTH = 600
+HEIGHT = 600
+
+def make_page(path):
+    data = random.Random(0).randbytes(WIDTH * HEIGHT * 3)
+    with open(path, 'wb') as f:
+        f.write(b'%%!PS\n/buf %d string def\ncurrentfile buf readstring\n'
+                % len(data))
+        f.write(data)
+        f.write(b'\npop pop\n%d %d scale\n%d %d 8 [%d 0 0 -%d 0 %d]\n'
+                b'buf false 3 colorimage\nshowpage\n'
+                % (WIDTH, HEIGHT, WIDTH, HEIGHT, WIDTH, HEIGHT, HEIGHT))
+
+def render(gs, page, out, options):
+    cmd = [gs, '-q', '-dNOPAUSE', '-dBATCH', '-dSAFER', '-sDEVICE=ppmraw',
+           '-r72', '-g%dx%d' % (WIDTH, HEIGHT), '-o', out] + options + [page]
+    result = subprocess.run(cmd, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT)
+    output = result.stdout.decode('latin-1')
+    if result.returncode != 0:
+        sys.exit('%s failed (%d):\n%s' % (' '.join(cmd), result.returncode,
+                                           output))
+    with open(out, 'rb') as f:
+        return f.read(), output
+
+def main(argv):
+    gs = argv[1] if len(argv) > 1 else 'bin/gs'
+    failures = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        page = os.path.join(tmp, 'random.ps')
+        make_page(page)
+        reference, output = render(gs, page, os.path.join(tmp, 'ref.ppm'),
+                                   ['-dMaxBitmap=100000000'])
+        for method in ('default', 'fast'):
+            for threads in ('0', '2'):
+                options = ['-dMaxBitmap=0', '-dBufferSpace=100000',
+                           '-sBandListStorage=memory',
+                           '-sBandListCompression=' + method,
+                           '-dBandListCompressionStats',
+                           '-dNumRenderingThreads=' + threads]
+                image, output = render(gs, page,
+                                       os.path.join(tmp, 'band.ppm'), options)
+                name = '%s compression, %s threads' % (method, threads)
+                if 'Band list %s compression' % method not in output:
+                    print('%s: band list was not compressed '
+                          '(build without TEST_BAND_LIST_COMPRESSION?)'
+                          % name)
+                    failures += 1
+                elif image != reference:
+                    print('%s: output differs from the unbanded page' % name)
+                    failures += 1
+                else:
+                    print('%s: ok' % name)
+    return failures
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))